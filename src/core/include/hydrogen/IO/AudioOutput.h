@@ -63,6 +63,19 @@ public:
 		return __track_out_enabled;
 	}
 
+	/// Number of per-track outputs, one for each instrument of the song
+	virtual int getNumTracks() {
+		return 0;
+	}
+	/// Left buffer of a per-track output, NULL if the driver has none
+	virtual float* getTrackOut_L( unsigned nTrack ) {
+		return NULL;
+	}
+	/// Right buffer of a per-track output, NULL if the driver has none
+	virtual float* getTrackOut_R( unsigned nTrack ) {
+		return NULL;
+	}
+
 protected:
 	bool __track_out_enabled;	///< True if is capable of per-track audio output
 
@@ -57,12 +57,14 @@ public:
 	int m_nData2;
 	int m_nChannel;
 	std::vector<unsigned char> m_sysexData;
+	int m_nFrameOffset;	///< frame of the message within the driver period, -1 if the driver does not tell
 
 	MidiMessage()
 			: m_type( UNKNOWN )
 			, m_nData1( -1 )
 			, m_nData2( -1 )
-			, m_nChannel( -1 ) {}
+			, m_nChannel( -1 )
+			, m_nFrameOffset( -1 ) {}
 };
 
 
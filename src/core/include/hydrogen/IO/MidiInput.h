@@ -24,15 +24,29 @@
 #define H2_MIDI_INPUT_H
 
 #include <hydrogen/object.h>
+#include <hydrogen/helpers/ring_buffer.h>
 #include <string>
 #include <vector>
 #include "MidiCommon.h"
 
+#ifdef WIN32
+#    include "hydrogen/timehelper.h"
+#else
+#    include <sys/time.h>
+#endif
+
+/// number of note messages waiting for the audio engine a MIDI driver can hold
+#define MIDI_INPUT_NOTE_QUEUE_SIZE	256
+
 namespace H2Core
 {
 
 /**
  * MIDI input base class
+ *
+ * Note on and note off messages are not handled by the driver thread, they are
+ * queued in a lock free ring and played by the audio thread, which never makes
+ * the driver wait for the audio engine lock.
  */
 class MidiInput : public virtual Object
 {
@@ -51,6 +65,9 @@ public:
 	void handleSysexMessage( const MidiMessage& msg );
 	void handleControlChangeMessage( const MidiMessage& msg );
 
+	/// Play the notes queued since the last call. Called by the audio thread, the audio engine being locked.
+	void processQueuedNotes();
+
 protected:
 	bool m_bActive;
 
@@ -59,10 +76,24 @@ protected:
 
 
 private:
+	/// A note message waiting for the audio thread
+	struct QueuedNote {
+		bool bNoteOff;
+		int nNote;
+		float fVelocity;
+		timeval time;		///< when the message was received
+		int nFrameOffset;	///< frame of the message within the driver period, -1 if unknown
+	};
+
+	RingBuffer<QueuedNote> __noteQueue;	///< written by the driver thread, read by the audio thread
 	unsigned long  __noteOnTick;
 	unsigned long  __noteOffTick;
 	unsigned long computeDeltaNoteOnOfftime();
 
+	void queueNote( bool bNoteOff, int nNote, float fVelocity, int nFrameOffset );
+	void playNoteOn( const QueuedNote& note );
+	void playNoteOff( const QueuedNote& note );
+
 
 
 };
@@ -45,6 +45,9 @@ public:
 	virtual void handleQueueNote(Note* pNote) = 0;
         virtual void handleQueueNoteOff( int channel, int key, int velocity ) = 0;
         virtual void handleQueueAllNoteOff() = 0;
+	/// Same as handleQueueAllNoteOff(), called by the audio thread at the end
+	/// of the song. The drivers queuing from the audio thread without locking override it.
+	virtual void handleQueueAllNoteOffFromAudio() { handleQueueAllNoteOff(); }
 	
 //protected:
 //	std::vector<MidiMessage> m_pendingMessages;
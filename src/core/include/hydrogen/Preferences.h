@@ -175,6 +175,8 @@ public:
 
 	bool m_bFollowPlayhead;
 
+	bool m_bCompiledSongs;	///< keep a compiled copy next to the saved songs, loaded instead of the xml while it matches
+
 
 	
 	// switch to enable / disable lash, only on h2 startup
@@ -201,6 +203,13 @@ public:
 	bool m_bUseMetronome;		///< Use metronome?
 	float m_fMetronomeVolume;	///< Metronome volume FIXME: remove this volume!!
 	unsigned m_nMaxNotes;		///< max notes
+	unsigned m_nRenderThreads;	///< number of threads rendering notes along with the audio thread, 0 = disabled
+	unsigned m_nSampleCacheSize;	///< memory kept for the decoded samples no longer in use, in MB
+	bool m_bUseSampleStore;		///< keep the decoded drumkit samples on disk, mapped by the next loads
+	unsigned m_nSampleStoreSize;	///< disk space kept for the decoded drumkit samples, in MB
+	unsigned m_nStreamThreshold;	///< length from which samples are streamed from the disk, in seconds, 0 = never
+	unsigned m_nSampleBits;		///< bits per value the samples are stored with in memory, 16, 24 or 32 = float
+	bool m_bResampleLayers;		///< convert the samples to the driver sample rate in the background, instead of resampling every note
 	unsigned m_nBufferSize;		///< Audio buffer size
 	unsigned m_nSampleRate;		///< Audio sample rate
 
@@ -25,6 +25,7 @@
 
 #include "hydrogen/config.h"
 #include <hydrogen/object.h>
+#include <hydrogen/basics/note_pool.h>
 #include <hydrogen/sampler/Sampler.h>
 #include <hydrogen/synth/Synth.h>
 
@@ -76,12 +77,15 @@ public:
 
 	Sampler* get_sampler();
 	Synth* get_synth();
+	/// Notes played by the engine are taken from this pool
+	NotePool* get_note_pool();
 
 private:
 	static AudioEngine* __instance;
 
 	Sampler* __sampler;
 	Synth* __synth;
+	NotePool* __note_pool;
 
 	/// Mutex for syncronized access to the Song object and the AudioEngine.
 	pthread_mutex_t __engine_mutex;
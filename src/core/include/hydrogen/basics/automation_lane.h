@@ -0,0 +1,162 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_AUTOMATION_LANE_H
+#define H2C_AUTOMATION_LANE_H
+
+#include <vector>
+
+#include <hydrogen/object.h>
+#include <hydrogen/basics/instrument.h>
+
+namespace H2Core
+{
+
+class InstrumentList;
+
+/**
+ * Automation of a parameter of an instrument along the song.
+ *
+ * The lane is a list of points, sorted by tick from the beginning of the
+ * song, the value between two points is linearly interpolated. The audio
+ * engine evaluates the lanes once per period while the song plays, sets the
+ * targets of the instrument parameters, and the sampler follows them
+ * smoothly. The evaluation goes on from the segment of the previous period,
+ * it neither allocates nor searches unless the song position jumps back.
+ * The points are changed with the audio engine locked.
+ */
+class AutomationLane : public H2Core::Object
+{
+        H2_OBJECT
+    public:
+        /** a point of the lane */
+        struct Point {
+            int tick;       ///< position from the beginning of the song
+            float value;    ///< value of the parameter
+        };
+
+        /**
+         * constructor
+         * \param instrument_id the id of the instrument to automate
+         * \param parameter the parameter to automate
+         */
+        AutomationLane( int instrument_id, Instrument::Parameter parameter );
+        /** destructor */
+        ~AutomationLane();
+
+        /** __instrument_id accessor */
+        int get_instrument_id() const;
+        /** __parameter accessor */
+        Instrument::Parameter get_parameter() const;
+
+        /**
+         * add a point, the one at the same tick is replaced
+         * \param tick the position of the point
+         * \param value the value of the parameter
+         */
+        void add_point( int tick, float value );
+        /**
+         * remove a point
+         * \param idx the index of the point
+         */
+        void remove_point( int idx );
+        /** remove all the points */
+        void clear();
+        /** the number of points */
+        int size() const;
+        /**
+         * get a point
+         * \param idx the index of the point
+         */
+        const Point& get_point( int idx ) const;
+
+        /**
+         * the value of the lane at a position, the lane must have a point
+         * \param tick the position from the beginning of the song
+         */
+        float get_value( double tick ) const;
+        /**
+         * same as get_value(), starting from the segment of the previous evaluation.
+         * Called by the audio thread.
+         * \param tick the position from the beginning of the song
+         */
+        float evaluate( double tick );
+        /**
+         * evaluate the lane and set the target of the parameter of its instrument
+         * if the value changed since the previous period, so that the parameter can be
+         * moved by hand while the lane is flat. Called by the audio thread.
+         * \param tick the position of the period from the beginning of the song
+         * \param instruments the instruments of the song
+         */
+        void process( double tick, InstrumentList* instruments );
+
+        /** the name of a parameter, as saved in the song */
+        static QString get_parameter_name( Instrument::Parameter parameter );
+        /**
+         * the parameter of a name
+         * \param name the name saved in the song
+         * \return the parameter, Instrument::PARAMETER_COUNT if the name is unknown
+         */
+        static Instrument::Parameter get_parameter_from_name( const QString& name );
+
+    private:
+        int __instrument_id;                ///< the id of the automated instrument
+        Instrument::Parameter __parameter;  ///< the automated parameter
+        std::vector<Point> __points;        ///< the points, sorted by tick
+        int __cursor;                       ///< the point starting the segment of the previous evaluation
+        bool __processed;                   ///< a target has been set since the lane changed
+        float __last_value;                 ///< the target set at the previous period
+
+        /** the index of the last point at or before tick, -1 if none */
+        int __find( double tick ) const;
+        /** the value at tick, within the segment starting at point idx */
+        float __interpolate( int idx, double tick ) const;
+};
+
+// DEFINITIONS
+
+inline int AutomationLane::get_instrument_id() const
+{
+    return __instrument_id;
+}
+
+inline Instrument::Parameter AutomationLane::get_parameter() const
+{
+    return __parameter;
+}
+
+inline int AutomationLane::size() const
+{
+    return __points.size();
+}
+
+inline const AutomationLane::Point& AutomationLane::get_point( int idx ) const
+{
+    assert( idx >= 0 && idx < ( int )__points.size() );
+    return __points[idx];
+}
+
+};
+
+#endif // H2C_AUTOMATION_LANE_H
+
+/* vim: set softtabstop=4 expandtab: */
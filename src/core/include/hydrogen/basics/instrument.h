@@ -27,6 +27,7 @@
 
 #include <hydrogen/object.h>
 #include <hydrogen/basics/adsr.h>
+#include <hydrogen/helpers/smoothed_value.h>
 
 #define EMPTY_INSTR_ID          -1
 #define METRONOME_INSTR_ID      -2
@@ -38,6 +39,7 @@ class XMLNode;
 class ADSR;
 class Drumkit;
 class InstrumentLayer;
+class SampleLoader;
 
 /**
 Instrument class
@@ -46,6 +48,16 @@ class Instrument : public H2Core::Object
 {
         H2_OBJECT
     public:
+        /** the parameters followed smoothly by the sampler, see get_parameter() */
+        enum Parameter {
+            VOLUME,
+            GAIN,
+            PAN_L,
+            PAN_R,
+            FILTER_CUTOFF,
+            FILTER_RESONANCE,
+            PARAMETER_COUNT
+        };
         /**
          * constructor
          * \param id the id of this instrument
@@ -81,6 +93,40 @@ class Instrument : public H2Core::Object
          * \param is_live is it performed while playing
          */
         void load_from( Drumkit* drumkit, Instrument* instrument, bool is_live = true );
+        /**
+         * same as load_from( Drumkit*, Instrument*, bool ) with samples queued by queue_samples(),
+         * the layers and members are all replaced at once
+         * \param drumkit the drumkit the instrument belongs to
+         * \param instrument to load samples and members from
+         * \param loader the loader the samples were queued to
+         * \param jobs the jobs filled by queue_samples()
+         * \param is_live is it performed while playing
+         */
+        void load_from( Drumkit* drumkit, Instrument* instrument, SampleLoader* loader, const int jobs[], bool is_live = true );
+        /**
+         * create an instrument out of the reach of the audio engine, with the members load_from() sets
+         * and the samples queued by queue_samples(), to be given to take_from()
+         * \param drumkit the drumkit the instrument belongs to
+         * \param instrument to load samples and members from
+         * \param loader the loader the samples were queued to
+         * \param jobs the jobs filled by queue_samples()
+         * \return a new Instrument instance
+         */
+        static Instrument* stage( Drumkit* drumkit, Instrument* instrument, SampleLoader* loader, const int jobs[] );
+        /**
+         * swap the layers, the ADSR and the members load_from() sets with those of a staged instrument,
+         * nothing is allocated nor freed so that it can be done under the engine lock
+         * \param staged an instrument created by stage(), gets the replaced layers, to be deleted by the caller
+         */
+        void take_from( Instrument* staged );
+        /**
+         * queue the samples of the layers of an instrument of a drumkit, to be decoded in the background
+         * \param loader the loader to queue the samples to
+         * \param drumkit the drumkit the instrument belongs to
+         * \param instrument the instrument to load the samples of
+         * \param jobs receives the job of each of the MAX_LAYERS layers, -1 for no layer
+         */
+        static void queue_samples( SampleLoader* loader, Drumkit* drumkit, Instrument* instrument, int jobs[] );
 
         /**
          * load samples data
@@ -195,6 +241,19 @@ class Instrument : public H2Core::Object
         void set_filter_cutoff( float val );
         /** get the filter cutoff of the instrument */
         float get_filter_cutoff() const;
+        /**
+         * get a smoothed parameter of the instrument, the setters above change its target
+         * \param parameter the parameter
+         */
+        SmoothedValue* get_parameter( Parameter parameter );
+        /**
+         * pick the targets of the parameters up for the period starting at frame,
+         * only once per period whatever the number of notes playing the instrument.
+         * Called by the sampler.
+         * \param frame the first frame of the period, counted by the sampler
+         * \param length the smoothing length in frames
+         */
+        void update_parameters( long long frame, int length );
 
         /** set the left peak of the instrument */
         void set_peak_l( float val );
@@ -247,16 +306,17 @@ class Instrument : public H2Core::Object
         int __id;			                    ///< instrument id, should be unique
         QString __name;			                ///< instrument name
         QString __drumkit_name;                         ///< the name of the drumkit this instrument belongs tos
-        float __gain;                           ///< gain of the instrument
-        float __volume;			                ///< volume of the instrument
-        float __pan_l;			                ///< left pan of the instrument
-        float __pan_r;			                ///< right pan of the instrument
+        SmoothedValue __gain;                   ///< gain of the instrument
+        SmoothedValue __volume;                 ///< volume of the instrument
+        SmoothedValue __pan_l;                  ///< left pan of the instrument
+        SmoothedValue __pan_r;                  ///< right pan of the instrument
         float __peak_l;			                ///< left current peak value
         float __peak_r;			                ///< right current peak value
         ADSR* __adsr;                           ///< attack delay sustain release instance
         bool __filter_active;		            ///< is filter active?
-        float __filter_cutoff;		            ///< filter cutoff (0..1)
-        float __filter_resonance;	            ///< filter resonant frequency (0..1)
+        SmoothedValue __filter_cutoff;          ///< filter cutoff (0..1)
+        SmoothedValue __filter_resonance;       ///< filter resonant frequency (0..1)
+        long long __parameters_frame;           ///< frame the parameters were last updated at, -1 if never
         float __random_pitch_factor;            ///< random pitch factor
         int __midi_out_note;		            ///< midi out note
         int __midi_out_channel;		            ///< midi out channel
@@ -352,42 +412,42 @@ inline bool Instrument::is_muted() const
 
 inline void Instrument::set_pan_l( float val )
 {
-    __pan_l = val;
+    __pan_l.set_target( val );
 }
 
 inline float Instrument::get_pan_l() const
 {
-    return __pan_l;
+    return __pan_l.get_target();
 }
 
 inline void Instrument::set_pan_r( float val )
 {
-    __pan_r = val;
+    __pan_r.set_target( val );
 }
 
 inline float Instrument::get_pan_r() const
 {
-    return __pan_r;
+    return __pan_r.get_target();
 }
 
 inline void Instrument::set_gain( float gain )
 {
-    __gain = gain;
+    __gain.set_target( gain );
 }
 
 inline float Instrument::get_gain() const
 {
-    return __gain;
+    return __gain.get_target();
 }
 
 inline void Instrument::set_volume( float volume )
 {
-    __volume = volume;
+    __volume.set_target( volume );
 }
 
 inline float Instrument::get_volume() const
 {
-    return __volume;
+    return __volume.get_target();
 }
 
 inline void Instrument::set_filter_active( bool active )
@@ -402,22 +462,22 @@ inline bool Instrument::is_filter_active() const
 
 inline void Instrument::set_filter_resonance( float val )
 {
-    __filter_resonance = val;
+    __filter_resonance.set_target( val );
 }
 
 inline float Instrument::get_filter_resonance() const
 {
-    return __filter_resonance;
+    return __filter_resonance.get_target();
 }
 
 inline void Instrument::set_filter_cutoff( float val )
 {
-    __filter_cutoff = val;
+    __filter_cutoff.set_target( val );
 }
 
 inline float Instrument::get_filter_cutoff() const
 {
-    return __filter_cutoff;
+    return __filter_cutoff.get_target();
 }
 
 inline void Instrument::set_peak_l( float val )
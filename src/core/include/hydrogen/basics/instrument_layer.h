@@ -80,6 +80,14 @@ class InstrumentLayer : public H2Core::Object
         void set_sample( Sample* sample );
         /** get the sample of the layer */
         Sample* get_sample() const;
+        /**
+         * set the copy of the sample converted to the sample rate of the audio driver
+         * \param sample the converted sample, owned by the layer, 0 to play the sample itself
+         * \return the previous converted sample, owned by the caller
+         */
+        Sample* set_resampled( Sample* sample );
+        /** get the copy of the sample converted to the sample rate of the audio driver, 0 if there is none */
+        Sample* get_resampled() const;
 
         /**
          * load the sample data
@@ -109,6 +117,7 @@ class InstrumentLayer : public H2Core::Object
         float __start_velocity;     ///< the start velocity of the sample, 0.0 by default
         float __end_velocity;       ///< the end velocity of the sample, 1.0 by default
         Sample* __sample;           ///< the underlaying sample
+        Sample* __resampled;        ///< __sample converted to the sample rate of the audio driver, 0 if not converted
 };
 
 // DEFINITIONS
@@ -153,14 +162,21 @@ inline float InstrumentLayer::get_end_velocity() const
     return __end_velocity;
 }
 
-inline void InstrumentLayer::set_sample( Sample* sample )
+inline Sample* InstrumentLayer::get_sample() const
 {
-    __sample = sample;
+    return __sample;
 }
 
-inline Sample* InstrumentLayer::get_sample() const
+inline Sample* InstrumentLayer::set_resampled( Sample* sample )
 {
-    return __sample;
+    Sample* previous = __resampled;
+    __resampled = sample;
+    return previous;
+}
+
+inline Sample* InstrumentLayer::get_resampled() const
+{
+    return __resampled;
 }
 
 };
@@ -24,6 +24,7 @@
 #define H2C_NOTE_H
 
 #include <hydrogen/object.h>
+#include <hydrogen/basics/adsr.h>
 #include <hydrogen/basics/instrument.h>
 
 #define KEY_MIN                 0
@@ -48,7 +49,6 @@ namespace H2Core
 {
 
 class XMLNode;
-class ADSR;
 class Instrument;
 class InstrumentList;
 
@@ -189,7 +189,14 @@ class Note : public H2Core::Object
         /** __just_recorder accessor */
         bool get_just_recorded() const;
         /** __sample_position accessor */
-        float get_sample_position() const;
+        double get_sample_position() const;
+        /**
+         * __stream setter
+         * \param value the new value
+         */
+        void set_stream( int value );
+        /** __stream accessor */
+        int get_stream() const;
         /**
          * __humanize_delay setter
          * \param value the new value
@@ -197,6 +204,12 @@ class Note : public H2Core::Object
         void set_humanize_delay( int value );
         /** __humanize_delay accessor */
         int get_humanize_delay() const;
+        /**
+         * place the note on a frame, __position becomes its tick and __humanize_delay the frames past the tick
+         * \param frame the frame the note starts on
+         * \param tick_size the number of frames per tick
+         */
+        void set_start_frame( long long frame, float tick_size );
         /** __cut_off accessor */
         float get_cut_off() const;
         /** __resonance accessor */
@@ -243,7 +256,7 @@ class Note : public H2Core::Object
         void set_midi_info( Key key, Octave octave, int msg );
 
         /** get the ADSR of the note */
-        ADSR* get_adsr() const;
+        ADSR* get_adsr();
         /** call release on adsr */
         //float release_adsr() const              { return __adsr->release(); }
         /** call get value on adsr */
@@ -253,7 +266,7 @@ class Note : public H2Core::Object
          * update sample_position with increment
          * \param incr the value to add to current sample position
          */
-        float update_sample_position( float incr );
+        double update_sample_position( double incr );
 
         /** return true if instrument, key and octave matches with internal
          * \param instrument the instrument to match with __instrument
@@ -268,6 +281,14 @@ class Note : public H2Core::Object
          * \param val_r the right channel value
          */
         void compute_lr_values( float* val_l, float* val_r );
+        /**
+         * compute left and right output based on filters, with given filter parameters
+         * \param val_l the left channel value
+         * \param val_r the right channel value
+         * \param cut_off the filter cutoff
+         * \param resonance the filter resonance
+         */
+        void compute_lr_values( float* val_l, float* val_r, float cut_off, float resonance );
 
     private:
         Instrument* __instrument;   ///< the instrument to be played by this note
@@ -280,12 +301,13 @@ class Note : public H2Core::Object
         float __pitch;              ///< the frequency of the note
         Key __key;                  ///< the key, [0;11]==[C;B]
         Octave __octave;            ///< the octave [-3;3]
-        ADSR* __adsr;               ///< attack decay sustain release
+        ADSR __adsr;                ///< attack decay sustain release, part of the note so that pooled notes never allocate
         float __lead_lag;           ///< lead or lag offset of the note
         float __cut_off;            ///< filter cutoff [0;1]
         float __resonance;          ///< filter resonant frequency [0;1]
         int __humanize_delay;       ///< used in "humanize" function
-        float __sample_position;    ///< place marker for overlapping process() cycles
+        double __sample_position;   ///< place marker for overlapping process() cycles, precise enough for long samples
+        int __stream;               ///< DiskStreamer stream feeding a streamed sample, -1 if none
         float __bpfb_l;             ///< left band pass filter buffer
         float __bpfb_r;             ///< right band pass filter buffer
         float __lpfb_l;             ///< left low pass filter buffer
@@ -299,9 +321,9 @@ class Note : public H2Core::Object
 
 // DEFINITIONS
 
-inline ADSR* Note::get_adsr() const
+inline ADSR* Note::get_adsr()
 {
-    return __adsr;
+    return &__adsr;
 }
 
 inline Instrument* Note::get_instrument()
@@ -409,11 +431,21 @@ inline bool Note::get_just_recorded() const
     return __just_recorded;
 }
 
-inline float Note::get_sample_position() const
+inline double Note::get_sample_position() const
 {
     return __sample_position;
 }
 
+inline void Note::set_stream( int value )
+{
+    __stream = value;
+}
+
+inline int Note::get_stream() const
+{
+    return __stream;
+}
+
 inline void Note::set_humanize_delay( int value )
 {
     __humanize_delay = value;
@@ -424,6 +456,13 @@ inline int Note::get_humanize_delay() const
     return __humanize_delay;
 }
 
+inline void Note::set_start_frame( long long frame, float tick_size )
+{
+    __position = ( int )( frame / ( double )tick_size );
+    // computed as the sampler does, which adds the delay to the start of the tick
+    __humanize_delay = ( int )( frame - ( long long )( __position * tick_size ) );
+}
+
 inline float Note::get_cut_off() const
 {
     return __cut_off;
@@ -502,7 +541,7 @@ inline void Note::set_midi_info( Key key, Octave octave, int msg )
 
 
 
-inline float Note::update_sample_position( float incr )
+inline double Note::update_sample_position( double incr )
 {
     __sample_position += incr;
     return __sample_position;
@@ -522,8 +561,11 @@ inline void Note::compute_lr_values( float* val_l, float* val_r )
         return;
     }
     */
-    float cut_off = __instrument->get_filter_cutoff();
-    float resonance = __instrument->get_filter_resonance();
+    compute_lr_values( val_l, val_r, __instrument->get_filter_cutoff(), __instrument->get_filter_resonance() );
+}
+
+inline void Note::compute_lr_values( float* val_l, float* val_r, float cut_off, float resonance )
+{
     __bpfb_l  =  resonance * __bpfb_l  + cut_off * ( *val_l - __lpfb_l );
     __lpfb_l +=  cut_off   * __bpfb_l;
     __bpfb_r  =  resonance * __bpfb_r  + cut_off * ( *val_r - __lpfb_r );
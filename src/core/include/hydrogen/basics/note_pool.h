@@ -0,0 +1,123 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_NOTE_POOL_H
+#define H2C_NOTE_POOL_H
+
+#include <QtCore/QAtomicInt>
+
+#include <hydrogen/object.h>
+
+/** number of notes waiting in the song queue within the lookahead window the pool is sized for */
+#define NOTE_POOL_LOOKAHEAD     256
+
+namespace H2Core
+{
+
+class Note;
+class Instrument;
+
+/**
+ * A fixed capacity pool of notes played by the audio engine.
+ *
+ * The notes are constructed in preallocated storage, their ADSR being part
+ * of the note, so getting and releasing a note never reaches the heap.
+ * Free slots are kept in a lock free list, notes can be got and released from
+ * any thread. When the pool is exhausted notes are allocated from the heap,
+ * which is counted by get_heap_allocations().
+ * Notes of the patterns are not pooled, they are copied with copy() when
+ * queued for playing.
+ */
+class NotePool : public H2Core::Object
+{
+        H2_OBJECT
+    public:
+        /**
+         * constructor
+         * \param capacity the number of preallocated notes
+         */
+        NotePool( int capacity );
+        /** destructor */
+        ~NotePool();
+
+        /**
+         * get a note from the pool, see Note::Note()
+         * \return a note to be given back with release()
+         */
+        Note* get( Instrument* instrument, int position, float velocity, float pan_l, float pan_r, int length, float pitch );
+        /**
+         * get a copy of a note from the pool, see Note::Note( Note*, Instrument* )
+         * \return a note to be given back with release()
+         */
+        Note* copy( Note* other, Instrument* instrument=0 );
+        /**
+         * destroy a note and give its slot back to the pool,
+         * notes which do not come from the pool are deleted
+         * \param note the note to release
+         */
+        void release( Note* note );
+
+        /** __capacity accessor */
+        int get_capacity() const;
+        /** number of pooled notes currently in use */
+        int get_in_use() const;
+        /** number of notes allocated from the heap because the pool was exhausted */
+        int get_heap_allocations() const;
+
+    private:
+        int __capacity;                 ///< number of preallocated notes
+        Note* __notes;                  ///< storage of the notes
+        int* __next;                    ///< index of the next free slot, for each free slot
+        QAtomicInt __head;              ///< index of the first free slot, tagged against ABA
+        QAtomicInt __in_use;            ///< number of pooled notes in use
+        QAtomicInt __heap_allocations;  ///< number of notes allocated out of the pool
+
+        /** pop a free slot, return -1 if the pool is exhausted */
+        int __pop();
+        /** push back a free slot */
+        void __push( int idx );
+        /** return true if the note lives in the pool storage */
+        bool __owns( Note* note ) const;
+};
+
+// DEFINITIONS
+
+inline int NotePool::get_capacity() const
+{
+    return __capacity;
+}
+
+inline int NotePool::get_in_use() const
+{
+    return __in_use;
+}
+
+inline int NotePool::get_heap_allocations() const
+{
+    return __heap_allocations;
+}
+
+};
+
+#endif // H2C_NOTE_POOL_H
+
+/* vim: set softtabstop=4 expandtab: */
@@ -0,0 +1,140 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_NOTE_QUEUE_H
+#define H2C_NOTE_QUEUE_H
+
+#include <vector>
+
+/** log2 of the number of frames covered by a bucket of the NoteQueue */
+#define NOTE_QUEUE_BUCKET_SHIFT     6
+/** number of buckets of the NoteQueue, a power of 2 */
+#define NOTE_QUEUE_BUCKETS          1024
+
+namespace H2Core
+{
+
+class Note;
+
+/**
+ * Notes waiting to be played, scheduled on their start frame.
+ *
+ * The queue is a timing wheel: each bucket holds the notes starting within
+ * 2^NOTE_QUEUE_BUCKET_SHIFT frames, the wheel covering NOTE_QUEUE_BUCKETS buckets
+ * from the current position. Notes starting further away wait in an overflow list
+ * until the wheel reaches them. Pushing a note is O(1), popping the k notes of a
+ * period costs O(k) plus the buckets the period spans.
+ * Notes of a bucket are kept sorted by start frame, notes starting at the same
+ * frame are popped in the order they were pushed.
+ * The queue is not thread safe, it is used under the audio engine lock.
+ */
+class NoteQueue
+{
+    public:
+        /** constructor */
+        NoteQueue();
+
+        /**
+         * preallocate room for the given number of notes,
+         * the queue only allocates when more notes are queued
+         */
+        void reserve( int count );
+
+        /**
+         * queue a note
+         * \param note the note to queue
+         * \param start the start frame of the note
+         */
+        void push( Note* note, long long start );
+        /**
+         * remove the next note starting before a frame
+         * \param end the first frame not to consider
+         * \return the note, or 0 if none start before end
+         */
+        Note* pop( long long end );
+        /**
+         * remove any note, used to empty the queue
+         * \return the note, or 0 if the queue is empty
+         */
+        Note* pop_any();
+        /**
+         * compute again the start frame of every queued note,
+         * needed when the tick size changes
+         * \param start_frame returns the start frame of a note
+         */
+        void reschedule( long long ( *start_frame )( Note* ) );
+
+        /** return the number of queued notes */
+        int size() const;
+        /** return true if no note is queued */
+        bool empty() const;
+
+    private:
+        /** a queued note */
+        struct Node {
+            Note* note;             ///< the queued note
+            long long start;        ///< its start frame
+            int next;               ///< index of the next node in the same list, -1 for the last one
+        };
+        /** a list of nodes */
+        struct List {
+            int head;               ///< first node, -1 if empty
+            int tail;               ///< last node, -1 if empty
+        };
+
+        std::vector<Node> __nodes;              ///< storage of the nodes
+        int __free;                             ///< first free node
+        List __buckets[ NOTE_QUEUE_BUCKETS ];   ///< the wheel
+        List __overflow;                        ///< notes starting after the end of the wheel
+        long long __cursor;                     ///< first frame of the current bucket
+        int __wheel_size;                       ///< number of notes within the wheel
+        int __size;                             ///< number of queued notes
+
+        /** get a free node */
+        int __alloc_node();
+        /** insert a node in the bucket of its start frame, or append it to the overflow list */
+        void __insert( int idx );
+        /** move the overflow notes reached by the wheel into their bucket */
+        void __migrate_overflow();
+        /** unlink a node, prev being the node before it in the list or -1 */
+        void __unlink( List* list, int prev, int idx );
+        /** unlink a node and return its note, releasing the node */
+        Note* __take( List* list, int prev, int idx );
+};
+
+// DEFINITIONS
+
+inline int NoteQueue::size() const
+{
+    return __size;
+}
+
+inline bool NoteQueue::empty() const
+{
+    return __size == 0;
+}
+
+};
+
+#endif // H2C_NOTE_QUEUE_H
+
+/* vim: set softtabstop=4 expandtab: */
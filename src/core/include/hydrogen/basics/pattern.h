@@ -24,6 +24,9 @@
 #define H2C_PATTERN_H
 
 #include <set>
+#include <vector>
+
+#include <QtCore/QAtomicPointer>
 
 #include <hydrogen/object.h>
 #include <hydrogen/basics/note.h>
@@ -55,6 +58,20 @@ class Pattern : public H2Core::Object
         typedef virtual_patterns_t::iterator virtual_patterns_it_t;
         ///< note set const iterator type;
         typedef virtual_patterns_t::const_iterator virtual_patterns_cst_it_t;
+        /** a note not created yet, see set_pending_notes() */
+        struct PendingNote {
+            Instrument* instrument;     ///< the instrument played
+            int position;               ///< position within the pattern
+            int length;                 ///< length of the note
+            float velocity;             ///< velocity
+            float pan_l;                ///< left pan
+            float pan_r;                ///< right pan
+            float lead_lag;             ///< lead or lag offset
+            float pitch;                ///< pitch
+            Note::Key key;              ///< key
+            Note::Octave octave;        ///< octave
+            bool note_off;              ///< is a note off
+        };
         /**
          * constructor
          * \param name the name of the pattern
@@ -95,6 +112,8 @@ class Pattern : public H2Core::Object
         int get_length() const;
         ///< get the note multimap
         const notes_t* get_notes() const;
+        ///< get the note multimap without creating the pending notes, empty until they are, for the audio thread
+        const notes_t* get_created_notes() const;
         ///< get the virtual pattern set
         const virtual_patterns_t* get_virtual_patterns() const;
         ///< get the flattened virtual pattern set
@@ -147,6 +166,20 @@ class Pattern : public H2Core::Object
          * mark all notes as old
          */
         void set_to_old();
+        /**
+         * give the pattern notes to create on first access to __notes
+         * Loading a song this way only creates the notes of the patterns it plays,
+         * the others are created once opened in the editor, selected, queued,
+         * or by create_pending_notes() in the background, never by the audio thread.
+         * \param notes the notes to create, owned by the pattern, replaces the pending ones
+         */
+        void set_pending_notes( std::vector<PendingNote>* notes );
+        ///< return true if the pattern has notes not created yet
+        bool has_pending_notes() const;
+        ///< create the pending notes of every pattern, one pattern at a time
+        static void create_pending_notes();
+        ///< run create_pending_notes() on a thread of its own
+        static void create_pending_notes_in_background();
 
         ///< return true if __virtual_patterns is empty
         bool virtual_patterns_empty() const;
@@ -179,7 +212,8 @@ class Pattern : public H2Core::Object
         int __length;                                           ///< the length of the pattern
         QString __name;                                         ///< the name of thepattern
         QString __category;                                     ///< the category of the pattern
-        notes_t __notes;                                        ///< a multimap (hash with possible multiple values for one key) of note
+        mutable notes_t __notes;                                ///< a multimap (hash with possible multiple values for one key) of note
+        mutable QAtomicPointer< std::vector<PendingNote> > __pending;   ///< notes to create into __notes on first access
         virtual_patterns_t __virtual_patterns;                  ///< a list of patterns directly referenced by this one
         virtual_patterns_t __flattened_virtual_patterns;        ///< the complete list of virtual patterns
 
@@ -195,6 +229,12 @@ class Pattern : public H2Core::Object
          * \return a new Pattern instance
          */
         static Pattern* load_from( XMLNode* node, InstrumentList* instruments );
+        ///< create the pending notes if any, called before each access to __notes
+        void __load_pending() const;
+        ///< create the pending notes into __notes
+        void __create_pending() const;
+        ///< create the pending notes into __notes, pending_mutex being locked
+        void __create_pending_locked() const;
 };
 
 #define FOREACH_NOTE_CST_IT_BEGIN_END(_notes,_it) \
@@ -241,8 +281,28 @@ inline int Pattern::get_length() const
     return __length;
 }
 
+inline void Pattern::__load_pending() const
+{
+    // acquire, the notes created by another thread are visible once __pending is reset
+    if ( !__pending.testAndSetAcquire( 0, 0 ) ) __create_pending();
+}
+
+inline const Pattern::notes_t* Pattern::get_created_notes() const
+{
+    static const notes_t no_notes;
+    // acquire, __notes is complete once __pending is reset
+    if ( has_pending_notes() ) return &no_notes;
+    return &__notes;
+}
+
+inline bool Pattern::has_pending_notes() const
+{
+    return !__pending.testAndSetAcquire( 0, 0 );
+}
+
 inline const Pattern::notes_t* Pattern::get_notes() const
 {
+    __load_pending();
     return &__notes;
 }
 
@@ -258,6 +318,7 @@ inline const Pattern::virtual_patterns_t* Pattern::get_flattened_virtual_pattern
 
 inline void Pattern::insert_note( Note* note, int position )
 {
+    __load_pending();
     __notes.insert( std::make_pair( ( position==-1 ? note->get_position() : position ), note ) );
 }
 
@@ -27,6 +27,10 @@
 #include <sndfile.h>
 
 #include <hydrogen/object.h>
+#include <hydrogen/basics/sample_cache.h>
+
+/** length of the head of a streamed sample held in memory, in seconds */
+#define SAMPLE_STREAM_HEAD  2
 
 namespace H2Core
 {
@@ -120,6 +124,13 @@ class Sample : public H2Core::Object
                 }
         };
 
+        /** possible in memory storage formats of the audio data */
+        enum Format {
+            FLOAT=0,            ///< 32 bit floats, full precision
+            INT16,              ///< 16 bit integers
+            INT24               ///< 24 bit little endian integers packed in 3 bytes
+        };
+
         /**
          * Sample constructor
          * \param filepath the path to the sample
@@ -154,8 +165,9 @@ class Sample : public H2Core::Object
          * \param rubber band transformation parameters
          * \param velocity envelope points
          * \param pan envelope points
+         * \param bpm the tempo to stretch the sample to, 0 for the current one
          */
-        static Sample* load( const QString& filepath, const Loops& loops, const Rubberband& rubber, const VelocityEnvelope& velocity, const PanEnvelope& pan );
+        static Sample* load( const QString& filepath, const Loops& loops, const Rubberband& rubber, const VelocityEnvelope& velocity, const PanEnvelope& pan, float bpm=0 );
 
         /**
          * load sample data
@@ -172,8 +184,15 @@ class Sample : public H2Core::Object
          * \param rubber band transformation parameters
          * \param velocity envelope points
          * \param pan envelope points
+         * \param bpm the tempo to stretch the sample to, 0 for the current one
          */
-        void apply( const Loops& loops, const Rubberband& rubber, const VelocityEnvelope& velocity, const PanEnvelope& pan );
+        void apply( const Loops& loops, const Rubberband& rubber, const VelocityEnvelope& velocity, const PanEnvelope& pan, float bpm=0 );
+        /**
+         * convert the audio data to another sample rate with a band limited (windowed sinc) interpolation
+         * \param sample_rate the sample rate of the new sample
+         * \return a new sample holding the converted data in the storage format, 0 for a streamed or empty sample
+         */
+        Sample* resample( int sample_rate ) const;
         /**
          * aplly loop transformation to the sample
          * \param lo loops parameters
@@ -192,13 +211,15 @@ class Sample : public H2Core::Object
         /**
          * aplly rubberband transformation to the sample
          * \param r rubberband parameters
+         * \param bpm the tempo to stretch the sample to, 0 for the current one
          */
-        void apply_rubberband( const Rubberband& rb );
+        void apply_rubberband( const Rubberband& rb, float bpm=0 );
         /**
          * call rubberband cli to modify the sample
          * \param r rubberband parameters
+         * \param bpm the tempo to stretch the sample to, 0 for the current one
          */
-        bool exec_rubberband_cli( const Rubberband& rb );
+        bool exec_rubberband_cli( const Rubberband& rb, float bpm=0 );
 
         /** return true if both data channels are null pointers */
         bool is_empty() const;
@@ -211,8 +232,27 @@ class Sample : public H2Core::Object
          * \parama value the new value for __frames
          */
         void set_frames( int value );
-        /** __frames accessor */
+        /** __frames accessor, the frames held in memory, only the head of a streamed sample */
         int get_frames() const;
+        /** return the number of frames of the whole audio data, more than get_frames() for a streamed sample */
+        int get_total_frames() const;
+        /** return true if only the head of the audio data is held in memory, the rest being read from the disk while playing */
+        bool is_streamed() const;
+        /** __serial accessor */
+        int get_serial() const;
+        /**
+         * set the length from which the samples loaded next are streamed
+         * \param seconds the length in seconds, 0 to load every sample in memory
+         */
+        static void set_stream_threshold( int seconds );
+        /**
+         * set the format the samples loaded next are stored in,
+         * they are converted back to floats on the fly while rendering
+         * \param format FLOAT keeps the decoded data as is, INT16 and INT24 trade precision for memory
+         */
+        static void set_storage_format( Format format );
+        /** return the size of one value of a channel in the given format, in bytes */
+        static int format_size( Format format );
         /**
          * __sample_rate setter
          * \parama value the new value for __sample_rate
@@ -223,12 +263,28 @@ class Sample : public H2Core::Object
         /** return sample duration in seconds */
         double get_sample_duration( ) const;
 
-        /** return data size */
+        /** return the memory used by the data, in bytes */
         int get_size() const;
-        /** __data_l accessor */
+        /** __format accessor */
+        Format get_format() const;
+        /** return true if both channels share the same data */
+        bool is_mono() const;
+        /** __data_l accessor, 0 if the data is not stored as floats */
         float* get_data_l() const;
-        /** __data_r accessor */
+        /** __data_r accessor, 0 if the data is not stored as floats */
         float* get_data_r() const;
+        /**
+         * convert a range of frames to floats, whatever the storage format
+         * \param first the first frame to read
+         * \param count the number of frames to read
+         * \param out_l receives the left channel
+         * \param out_r receives the right channel, 0 to skip it
+         */
+        void read( int first, int count, float* out_l, float* out_r ) const;
+        /** return the value of a frame of the left channel as a float */
+        float get_value_l( int frame ) const;
+        /** return the value of a frame of the right channel as a float */
+        float get_value_r( int frame ) const;
         /**
          * __is_modified setter
          * \parama value the new value for __is_modified
@@ -256,8 +312,9 @@ class Sample : public H2Core::Object
         QString __filepath;                     ///< filepath of the sample
         int __frames;                           ///< number of frames in this sample
         int __sample_rate;                      ///< samplerate for this sample
-        float* __data_l;                        ///< left channel data
-        float* __data_r;                        ///< right channel data
+        void* __data_l;                         ///< left channel data, in __format
+        void* __data_r;                         ///< right channel data, in __format, __data_l itself for a mono sample
+        Format __format;                        ///< storage format of the data
         bool __is_modified;                     ///< true if sample is modified
         PanEnvelope __pan_envelope;             ///< pan envelope vector
         VelocityEnvelope __velocity_envelope;   ///< velocity envelope vector
@@ -265,22 +322,54 @@ class Sample : public H2Core::Object
         Rubberband __rubberband;                ///< set of rubberband parameters
         /** loop modes string */
         static const char* __loop_modes[];
+        SampleCache::Data* __shared;            ///< cached data __data_l and __data_r belong to, 0 if they are owned
+        int __stream_frames;                    ///< number of frames of the file of a streamed sample, 0 if it is held in memory
+        int __serial;                           ///< unique among the samples created, unlike their addresses which get reused
+        static int __stream_threshold;          ///< length from which samples are streamed, in seconds, 0 if never
+        static Format __storage_format;         ///< format the samples loaded next are stored in
+
+        /**
+         * decode the audio data of a file
+         * \param filepath the file to decode
+         * \param data_l receives the left channel data
+         * \param data_r receives the right channel data, data_l itself for a mono file
+         * \param frames receives the number of frames per channel
+         * \param sample_rate receives the sample rate
+         * \return false if the file could not be read
+         */
+        static bool __decode( const QString& filepath, float** data_l, float** data_r, int* frames, int* sample_rate );
+        /**
+         * load sample data
+         * \param stream if set to false the whole file is loaded, whatever its length
+         */
+        void __load( bool stream );
+        /** load the head of the file if it is long enough to be streamed, return false otherwise */
+        bool __load_head();
+        /** use shared data in place of the current one, the reference is given to the sample */
+        void __share( SampleCache::Data* data );
+        /** use owned float data in place of the current one */
+        void __set_data( float* data_l, float* data_r, int frames );
+        /** make the data owned by the sample, as floats in both channels, before modifying it */
+        void __detach();
+        /** convert owned float data to the storage format the samples are loaded in */
+        void __pack();
+        /** key of the storage format, appended to the file key */
+        static QString __format_key();
+        /** convert a range of values of a channel held in a format other than FLOAT */
+        static void __unpack( float* dst, const void* src, Format format, int first, int count );
+        /** delete channel data allocated in the given format */
+        static void __free( void* data, Format format );
+        /** key of the transformations given to load(), appended to the file key */
+        static QString __transforms_key( const Loops& loops, const Rubberband& rubber, const VelocityEnvelope& velocity, const PanEnvelope& pan, float bpm );
+        /** the tempo to stretch to, the current one if bpm is 0 */
+        static float __stretch_bpm( float bpm );
 };
 
 // DEFINITIONS
 
-inline void Sample::unload()
-{
-    if( __data_l ) delete __data_l;
-    if( __data_r ) delete __data_r;
-    __frames = __sample_rate = 0;
-    __data_l = __data_r = 0;
-    // __is_modified = false; leave this unchanged as pan, velocity, loop and rubberband are kept unchanged
-}
-
 inline bool Sample::is_empty() const
 {
-    return ( __data_l==__data_r==0 );
+    return ( __data_l==0 && __data_r==0 );
 }
 
 inline const QString Sample::get_filepath() const
@@ -308,24 +397,80 @@ inline int Sample::get_sample_rate() const
     return __sample_rate;
 }
 
+inline int Sample::get_total_frames() const
+{
+    return ( __stream_frames ? __stream_frames : __frames );
+}
+
+inline bool Sample::is_streamed() const
+{
+    return __stream_frames > 0;
+}
+
+inline int Sample::get_serial() const
+{
+    return __serial;
+}
+
+inline void Sample::set_stream_threshold( int seconds )
+{
+    __stream_threshold = seconds;
+}
+
+inline void Sample::set_storage_format( Format format )
+{
+    __storage_format = format;
+}
+
+inline int Sample::format_size( Format format )
+{
+    return ( format==INT16 ? 2 : ( format==INT24 ? 3 : sizeof( float ) ) );
+}
+
 inline double Sample::get_sample_duration() const
 {
-    return ( double )__frames / ( double )__sample_rate;
+    return ( double )get_total_frames() / ( double )__sample_rate;
 }
 
 inline int Sample::get_size() const
 {
-    return __frames * sizeof( float ) * 2;
+    return __frames * format_size( __format ) * ( is_mono() ? 1 : 2 );
+}
+
+inline Sample::Format Sample::get_format() const
+{
+    return __format;
+}
+
+inline bool Sample::is_mono() const
+{
+    return __data_l==__data_r;
 }
 
 inline float* Sample::get_data_l() const
 {
-    return __data_l;
+    return ( __format==FLOAT ? ( float* )__data_l : 0 );
 }
 
 inline float* Sample::get_data_r() const
 {
-    return __data_r;
+    return ( __format==FLOAT ? ( float* )__data_r : 0 );
+}
+
+inline float Sample::get_value_l( int frame ) const
+{
+    if ( __format==FLOAT ) return ( ( float* )__data_l )[ frame ];
+    float value;
+    __unpack( &value, __data_l, __format, frame, 1 );
+    return value;
+}
+
+inline float Sample::get_value_r( int frame ) const
+{
+    if ( __format==FLOAT ) return ( ( float* )__data_r )[ frame ];
+    float value;
+    __unpack( &value, __data_r, __format, frame, 1 );
+    return value;
 }
 
 inline void Sample::set_is_modified( bool is_modified )
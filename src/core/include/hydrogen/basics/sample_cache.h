@@ -0,0 +1,161 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_SAMPLE_CACHE_H
+#define H2C_SAMPLE_CACHE_H
+
+#include <map>
+#include <list>
+#include <cassert>
+#include <QtCore/QMutex>
+
+#include <hydrogen/object.h>
+#include <hydrogen/basics/sample_store.h>
+
+namespace H2Core
+{
+
+/**
+ * Process wide store of decoded audio data, shared by the samples.
+ *
+ * The audio data of a file is decoded once and shared by every Sample
+ * loading it, for as long as the file is not modified. The data resulting
+ * from transformations (loops, envelopes, rubberband) is stored as well,
+ * under a key describing them.
+ * Data no longer used by any sample is kept in least recently used order,
+ * within a memory budget, so that loading the next song of a playlist can
+ * reuse what the previous one decoded.
+ * The shared data must never be modified, a sample makes its own copy first.
+ */
+class SampleCache : public H2Core::Object
+{
+        H2_OBJECT
+    public:
+        /** audio data shared by the samples */
+        class Data
+        {
+            public:
+                void* data_l;                   ///< left channel data
+                void* data_r;                   ///< right channel data, data_l itself for mono data
+                int format;                     ///< Sample::Format of the data
+                int frames;                     ///< number of frames per channel
+                int sample_rate;                ///< sample rate of the data
+                /** __key accessor */
+                const QString& get_key() const { return __key; }
+            private:
+                friend class SampleCache;
+                QString __key;                  ///< key the data is stored under
+                int __refs;                     ///< number of samples using the data
+                void* __address;                ///< start of the store file mapping, 0 if allocated
+                size_t __length;                ///< length of the store file mapping
+                std::list<Data*>::iterator __lru; ///< position in the unused list, valid if __refs is 0
+        };
+
+        /** create the instance */
+        static void create_instance();
+        /** return the instance, 0 if not created, the samples are not shared then */
+        static SampleCache* get_instance() { return __instance; }
+        /** destructor */
+        ~SampleCache();
+
+        /**
+         * look up the data stored under a key
+         * \param key the key of the data
+         * \return the data with a new reference, 0 if not stored
+         */
+        Data* acquire( const QString& key );
+        /**
+         * add a reference to data already referenced
+         * \param data the data to share
+         */
+        void acquire( Data* data );
+        /**
+         * store new data, the cache takes ownership of the arrays.
+         * If data has been stored under the same key meanwhile, the arrays are deleted and the stored data is used
+         * \param key the key of the data
+         * \param data_l left channel data, allocated with new float[] for FLOAT data, new char[] otherwise
+         * \param data_r right channel data, allocated the same way, or data_l itself for mono data
+         * \param format Sample::Format of the data
+         * \param frames number of frames per channel
+         * \param sample_rate sample rate of the data
+         * \return the stored data with a new reference
+         */
+        Data* insert( const QString& key, void* data_l, void* data_r, int format, int frames, int sample_rate );
+        /**
+         * store data mapped from a SampleStore file and acquire it
+         * \param key the key to store the data under
+         * \param mapping the mapped data, unmapped by the cache once evicted
+         * \return the stored data, which might be another one inserted meanwhile
+         */
+        Data* insert( const QString& key, const SampleStore::Mapping& mapping );
+        /**
+         * drop a reference, the data is kept within the budget once unused
+         * \param data the data not used anymore
+         */
+        void release( Data* data );
+        /** delete every unused data */
+        void clear();
+
+        /**
+         * set the memory kept for unused data
+         * \param bytes the budget in bytes, 0 keeps nothing unused
+         */
+        void set_budget( long long bytes );
+        /** return the memory budget in bytes */
+        long long get_budget() const;
+        /** return the memory used by the stored data in bytes, used or not */
+        long long get_size() const;
+        /** return the number of stored data */
+        int get_count() const;
+
+        /**
+         * key of the plain audio data of a file, made of its path, modification time and size
+         * \param filepath the path of the file
+         * \return the key, empty if the file does not exist
+         */
+        static QString file_key( const QString& filepath );
+
+    private:
+        static SampleCache* __instance;         ///< the instance
+        mutable QMutex __mutex;                 ///< protects every member
+        std::map<QString, Data*> __data;        ///< stored data by key
+        std::list<Data*> __unused;              ///< unused data, least recently used first
+        long long __size;                       ///< memory used by the stored data
+        long long __budget;                     ///< memory kept for unused data
+
+        /** constructor */
+        SampleCache();
+        /** store a new data under key, the mutex is held */
+        Data* __insert( const QString& key, Data* data );
+        /** delete unused data, least recently used first, down to the budget */
+        void __evict();
+        /** delete a stored data */
+        void __destroy( Data* data );
+        /** memory used by a data */
+        static long long __bytes( const Data* data );
+};
+
+};
+
+#endif // H2C_SAMPLE_CACHE_H
+
+/* vim: set softtabstop=4 expandtab: */
@@ -0,0 +1,122 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_SAMPLE_LOADER_H
+#define H2C_SAMPLE_LOADER_H
+
+#include <vector>
+#include <pthread.h>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+
+#include <hydrogen/object.h>
+
+namespace H2Core
+{
+
+class Sample;
+
+/**
+ * Decodes samples on a pool of threads.
+ *
+ * The samples to load are queued as jobs, the threads take them in order,
+ * so the first queued are the first available. take() only waits for its
+ * own job, the caller can use a sample while the next ones are decoded.
+ * The instance is shared by whoever loads samples, the job numbers are
+ * reused once every queued job has been taken.
+ */
+class SampleLoader : public H2Core::Object
+{
+        H2_OBJECT
+    public:
+        /**
+         * constructor, starts the threads
+         * \param threads number of decoding threads, 0 for one per cpu
+         */
+        SampleLoader( int threads=0 );
+        /** destructor, waits for the queued jobs and deletes the samples which were not taken */
+        ~SampleLoader();
+        /** create the shared instance, with one thread per cpu */
+        static void create_instance();
+        /** return the shared instance, 0 if not created */
+        static SampleLoader* get_instance() { return __instance; }
+
+        /**
+         * queue the loading of a new sample
+         * \param filepath the file to load audio data from
+         * \return the job number to give to take()
+         */
+        int add( const QString& filepath );
+        /**
+         * queue the loading of the audio data of an existing sample
+         * \param sample the sample to load, owned by the caller
+         * \return the job number to give to take()
+         */
+        int add( Sample* sample );
+        /**
+         * wait for a job to be done
+         * \param job the number returned by add()
+         * \return the loaded sample, owned by the caller when queued by file path, 0 if it could not be read
+         */
+        Sample* take( int job );
+        /** wait for every queued job to be done, the jobs still have to be taken */
+        void wait();
+
+        /** number of jobs done */
+        int get_done() const;
+        /** number of jobs queued */
+        int get_count() const;
+
+    private:
+        /** a sample to load */
+        struct Job {
+            QString filepath;                   ///< the file to load a new sample from, if sample is 0
+            Sample* sample;                     ///< the sample to load, or the new sample once done
+            bool owned;                         ///< true if the sample was created by the loader and not taken yet
+            bool done;                          ///< true once loaded
+            bool taken;                         ///< true once given back by take()
+        };
+
+        static SampleLoader* __instance;        ///< the shared instance
+        std::vector<Job> __jobs;                ///< every job queued since they were last all taken
+        int __next;                             ///< next job to run
+        int __done;                             ///< number of jobs done
+        int __taken;                            ///< number of jobs taken
+        bool __quit;                            ///< stops the threads once the queue is empty
+        mutable QMutex __mutex;                 ///< protects the jobs
+        QWaitCondition __queued;                ///< signaled when a job is queued
+        QWaitCondition __finished;              ///< signaled when a job is done
+        std::vector<pthread_t> __threads;       ///< the decoding threads
+
+        /** queue a job */
+        int __add( const Job& job );
+        /** decoding thread body */
+        void __run();
+        /** decoding thread entry */
+        static void* __thread_main( void* param );
+};
+
+};
+
+#endif // H2C_SAMPLE_LOADER_H
+
+/* vim: set softtabstop=4 expandtab: */
@@ -0,0 +1,153 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_SAMPLE_STORE_H
+#define H2C_SAMPLE_STORE_H
+
+#include <cstddef>
+
+#include <QtCore/QStringList>
+#include <hydrogen/object.h>
+
+namespace H2Core
+{
+
+/**
+ * On disk store of decoded audio data, mapped in memory to load samples.
+ *
+ * The first time a file is decoded, its data is written to the store as
+ * raw planar floats, each channel aligned on 32 bytes. Next loads map the
+ * store file read only instead of decoding again, the pages are shared
+ * with every other process mapping the same file.
+ * A store file records the modification time and size of the audio file
+ * it was decoded from, it is ignored and written again once they differ.
+ * Only the samples of the installed drumkits are stored, mono ones as a
+ * single channel. The least recently mapped files are removed once the
+ * store exceeds its budget.
+ */
+class SampleStore : public H2Core::Object
+{
+        H2_OBJECT
+    public:
+        /** audio data mapped from a store file */
+        struct Mapping {
+            float* data_l;                  ///< left channel data
+            float* data_r;                  ///< right channel data, data_l itself for mono data
+            int frames;                     ///< number of frames per channel
+            int sample_rate;                ///< sample rate of the data
+            void* address;                  ///< start of the mapping
+            size_t length;                  ///< length of the mapping
+        };
+
+        /**
+         * create the instance
+         * \param dir the directory holding the store files, created if needed
+         */
+        static void create_instance( const QString& dir );
+        /** return the instance, 0 if not created, the samples are always decoded then */
+        static SampleStore* get_instance() { return __instance; }
+        /** destructor, the mappings are left alone */
+        ~SampleStore();
+
+        /**
+         * map the stored data of an audio file
+         * \param filepath the audio file
+         * \param mapping filled with the mapped data
+         * \return false if the data is not stored or stale
+         */
+        bool map( const QString& filepath, Mapping* mapping ) const;
+        /**
+         * return true if the decoded data of an audio file should be stored,
+         * which is if it lies within the system or user drumkits directory
+         * \param filepath the audio file
+         */
+        bool accepts( const QString& filepath ) const;
+        /**
+         * store the decoded data of an audio file,
+         * then remove the least recently mapped files exceeding the budget
+         * \param filepath the audio file the data has been decoded from
+         * \param data_l left channel data
+         * \param data_r right channel data, data_l itself for mono data
+         * \param frames number of frames per channel
+         * \param sample_rate sample rate of the data
+         * \return true on success
+         */
+        bool write( const QString& filepath, const float* data_l, const float* data_r, int frames, int sample_rate ) const;
+        /**
+         * release a mapping
+         * \param mapping a mapping filled by map()
+         */
+        static void unmap( const Mapping& mapping );
+
+        /** return the path of the store file of an audio file */
+        QString get_path( const QString& filepath ) const;
+        /** __dir accessor */
+        const QString& get_dir() const;
+        /**
+         * set the disk space the store files may use
+         * \param bytes the budget in bytes
+         */
+        void set_budget( long long bytes );
+        /** __budget accessor */
+        long long get_budget() const;
+
+    private:
+        static SampleStore* __instance;     ///< the instance
+        QString __dir;                      ///< directory holding the store files
+        QStringList __roots;                ///< canonical drumkits directories, ended by a separator
+        long long __budget;                 ///< disk space the store files may use, in bytes
+
+        /**
+         * remove the least recently mapped store files until they fit within the budget
+         * \param keep the store file just written, never removed
+         */
+        void __evict( const QString& keep ) const;
+
+        /**
+         * constructor
+         * \param dir the directory holding the store files
+         */
+        SampleStore( const QString& dir );
+};
+
+// DEFINITIONS
+
+inline const QString& SampleStore::get_dir() const
+{
+    return __dir;
+}
+
+inline void SampleStore::set_budget( long long bytes )
+{
+    __budget = bytes;
+}
+
+inline long long SampleStore::get_budget() const
+{
+    return __budget;
+}
+
+};
+
+#endif // H2C_SAMPLE_STORE_H
+
+/* vim: set softtabstop=4 expandtab: */
@@ -41,6 +41,7 @@ class Sample;
 class Note;
 class Instrument;
 class InstrumentList;
+class AutomationLane;
 class Pattern;
 class Song;
 class PatternList;
@@ -186,6 +187,11 @@ class Song : public H2Core::Object
 
         void readTempPatternList( QString filename );
 
+        /** the automation lanes, changed with the audio engine locked */
+        std::vector<AutomationLane*>* get_automation_lanes() {
+            return &__automation_lanes;
+        }
+
 
     private:
         float __volume;						///< volume of the song (0.0..1.0)
@@ -201,6 +207,7 @@ class Song : public H2Core::Object
         float __swing_factor;
 
         SongMode __song_mode;
+        std::vector<AutomationLane*> __automation_lanes;	///< Automation lanes, played in song mode
 };
 
 
@@ -0,0 +1,117 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_SONG_BINARY_H
+#define H2C_SONG_BINARY_H
+
+#include <vector>
+
+#include <QtCore/QByteArray>
+#include <QtCore/QFile>
+#include <QtXml/QDomDocument>
+
+#include <hydrogen/object.h>
+
+namespace H2Core
+{
+
+class Pattern;
+class PatternList;
+class InstrumentList;
+
+/**
+ * Compiled copy of a song file, loaded instead of the xml while it matches.
+ *
+ * The file is written next to the song, named after it with a .bin suffix.
+ * It records the hash of the song file it was compiled from, a copy of the
+ * xml document without the notes of the patterns, then each pattern with
+ * its notes as a flat array of fixed size records. The file is mapped in
+ * memory and the records are read in place, no xml is parsed for the notes.
+ */
+class SongBinary : public H2Core::Object
+{
+        H2_OBJECT
+    public:
+        /** destructor */
+        ~SongBinary();
+
+        /** return the path of the compiled copy of a song file */
+        static QString get_path( const QString& song_path );
+        /**
+         * load the compiled copy of a song file
+         * \param song_path the song file
+         * \return 0 if there is none, or if it is stale or invalid
+         */
+        static SongBinary* load( const QString& song_path );
+        /**
+         * write the compiled copy of a song file
+         * \param song_path the song file, already written
+         * \param doc the xml document of the song
+         * \param patterns the patterns of the song
+         * \return true on success
+         */
+        static bool save( const QString& song_path, const QDomDocument& doc, PatternList* patterns );
+
+        /** return the song document, the patterns have no notes */
+        QDomDocument get_document() const;
+        /** __patterns size accessor */
+        int get_pattern_count() const;
+        /**
+         * create a pattern, its notes are created on first access
+         * \param idx the index of the pattern
+         * \param instruments the instruments of the song, to resolve the notes instrument ids
+         */
+        Pattern* get_pattern( int idx, InstrumentList* instruments ) const;
+
+    private:
+        QFile __file;                   ///< the compiled file
+        const uchar* __data;            ///< the mapping of __file
+        qint64 __size;                  ///< the size of __data
+        std::vector<qint64> __patterns; ///< offset of each pattern within __data
+
+        /**
+         * constructor
+         * \param path the compiled file
+         */
+        SongBinary( const QString& path );
+        /**
+         * map the compiled file and check its content
+         * \param hash the hash of the song file
+         * \return false if the file is invalid or stale
+         */
+        bool __map( const QByteArray& hash );
+        /** return the hash of a song file, empty if it can't be read */
+        static QByteArray __hash( const QString& song_path );
+};
+
+// DEFINITIONS
+
+inline int SongBinary::get_pattern_count() const
+{
+    return __patterns.size();
+}
+
+};
+
+#endif // H2C_SONG_BINARY_H
+
+/* vim: set softtabstop=4 expandtab: */
@@ -0,0 +1,113 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_STRETCH_SCHEDULER_H
+#define H2C_STRETCH_SCHEDULER_H
+
+#include <vector>
+#include <pthread.h>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+
+#include <hydrogen/object.h>
+#include <hydrogen/basics/sample.h>
+
+namespace H2Core
+{
+
+class Song;
+class InstrumentLayer;
+
+/**
+ * Stretches the rubberband enabled layers of a song to a new tempo on a pool of threads.
+ *
+ * Each layer is reloaded and stretched by a thread of the pool, the results
+ * being shared through the SampleCache under a key made of the file, the
+ * tempo and the rubberband parameters, so that going back to a previous
+ * tempo is immediate. Once every layer is stretched, they are all swapped in
+ * at once under the audio engine lock, the song never plays two tempos.
+ * Scheduling a tempo while the previous one is processed drops the latter.
+ */
+class StretchScheduler : public H2Core::Object
+{
+        H2_OBJECT
+    public:
+        /**
+         * constructor, starts the threads
+         * \param threads number of stretching threads, 0 for one per cpu
+         */
+        StretchScheduler( int threads=0 );
+        /** destructor, drops the pending work and stops the threads */
+        ~StretchScheduler();
+
+        /**
+         * stretch the layers of a song in the background, called by the main thread
+         * \param song the song whose layers to stretch, 0 to only drop the pending work
+         * \param bpm the tempo to stretch to
+         */
+        void schedule( Song* song, float bpm );
+        /** wait for the last scheduled tempo to be swapped in */
+        void wait();
+
+        /** number of layers left to stretch */
+        int get_pending() const;
+
+    private:
+        /** a layer to stretch */
+        struct Job {
+            InstrumentLayer* layer;             ///< the layer to give the stretched sample to, checked before use
+            Sample* source;                     ///< the sample of the layer when scheduled, only compared
+            QString filepath;                   ///< the file of the sample
+            Sample::Loops loops;                ///< loops of the sample
+            Sample::Rubberband rubberband;      ///< rubberband parameters of the sample
+            Sample::VelocityEnvelope velocity;  ///< velocity envelope of the sample
+            Sample::PanEnvelope pan;            ///< pan envelope of the sample
+            Sample* result;                     ///< the stretched sample once done
+        };
+
+        std::vector<Job> __jobs;                ///< the layers of the tempo being processed
+        float __bpm;                            ///< the tempo being processed
+        int __next;                             ///< next job to run
+        int __done;                             ///< number of jobs done
+        int __swapping;                         ///< number of threads swapping finished tempos in
+        int __generation;                       ///< number of scheduled tempos, the results of a previous one are dropped
+        bool __quit;                            ///< stops the threads
+        mutable QMutex __mutex;                 ///< protects the jobs
+        QWaitCondition __queued;                ///< signaled when jobs are scheduled
+        QWaitCondition __finished;              ///< signaled when a tempo is swapped in or dropped
+        std::vector<pthread_t> __threads;       ///< the stretching threads
+
+        /** delete the pending jobs, __mutex must be held */
+        void __clear();
+        /** give the stretched samples to the layers still playing their source */
+        void __swap( int generation, std::vector<Job>& jobs );
+        /** stretching thread body */
+        void __run();
+        /** stretching thread entry */
+        static void* __thread_main( void* param );
+};
+
+};
+
+#endif // H2C_STRETCH_SCHEDULER_H
+
+/* vim: set softtabstop=4 expandtab: */
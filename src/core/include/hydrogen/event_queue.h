@@ -25,9 +25,14 @@
 
 #include <hydrogen/object.h>
 #include <hydrogen/basics/note.h>
+#include <hydrogen/helpers/ring_buffer.h>
+#include <QtCore/QAtomicInt>
 #include <cassert>
 
-#define MAX_EVENTS 1024
+#define MAX_EVENTS 1024		// a power of 2
+#define EVENT_QUEUE_CACHE_LINE 64
+/// number of EVENT_METRONOME values coalesced
+#define EVENT_METRONOME_VALUES 4
 
 namespace H2Core
 {
@@ -48,7 +53,8 @@ enum EventType {
         EVENT_PROGRESS,
         EVENT_JACK_SESSION,
         EVENT_PLAYLIST_LOADSONG,
-        EVENT_UNDO_REDO
+        EVENT_UNDO_REDO,
+        EVENT_DRUMKIT_LOADING	///< percentage of the instruments of a drumkit loaded
 };
 
 
@@ -62,6 +68,13 @@ public:
 ///
 /// Event queue: is the way the engine talks to the GUI
 ///
+/// Events are pushed from any thread, the audio thread included, and popped by
+/// the GUI. The queue is a bounded lock free ring, an event is dropped and
+/// counted when it is full. Frequent events are coalesced: an EVENT_NOTEON
+/// waiting for an instrument, an EVENT_METRONOME waiting with the same value
+/// or an EVENT_PROGRESS waiting (which gets the latest value) absorb the
+/// new ones.
+///
 class EventQueue : public H2Core::Object
 {
     H2_OBJECT
@@ -70,8 +83,12 @@ public:
 	static EventQueue* get_instance() { assert(__instance); return __instance; }
 	~EventQueue();
 
-	void push_event( EventType type, int nValue );
+	/// Queue an event, never blocks. Returns false if it was dropped.
+	bool push_event( EventType type, int nValue );
+	/// Next event, EVENT_NONE if none is waiting. Called by the GUI thread only.
 	Event pop_event();
+	/// Number of events dropped because the queue was full
+	int get_dropped_events() const { return __dropped_events; }
 
         struct AddMidiNoteVector
         {
@@ -88,15 +105,41 @@ public:
                 bool b_isInstrumentMode;
                 bool b_noteExist;
         };
-        std::vector<AddMidiNoteVector> m_addMidiNoteVector;
+        /// Queue a note recorded by the audio thread, which is the only one to call it
+        bool push_midi_note( const AddMidiNoteVector& note );
+        /// Next recorded note, returns false if none is waiting. Called by the GUI thread only.
+        bool pop_midi_note( AddMidiNoteVector& note );
 
 private:
 	EventQueue();
 	static EventQueue *__instance;
 
-	int __read_index;
-	int __write_index;
-	Event __events_buffer[ MAX_EVENTS ];
+	/// A slot of the ring, its sequence telling whether it is free or filled for the current lap
+	struct Slot {
+		QAtomicInt sequence;
+		Event event;
+	};
+
+	// the indices are written by different threads, keep them on their own cache line
+	QAtomicInt __write_index;
+	char __pad_write[ EVENT_QUEUE_CACHE_LINE - sizeof( QAtomicInt ) ];
+	QAtomicInt __read_index;
+	char __pad_read[ EVENT_QUEUE_CACHE_LINE - sizeof( QAtomicInt ) ];
+	Slot __events_buffer[ MAX_EVENTS ];
+
+	QAtomicInt __dropped_events;
+	int __reported_dropped_events;		///< dropped events already logged by the GUI thread
+
+	QAtomicInt __noteon_pending[ MAX_INSTRUMENTS ];		///< 1 while an EVENT_NOTEON of the instrument waits
+	QAtomicInt __metronome_pending[ EVENT_METRONOME_VALUES ];	///< 1 while an EVENT_METRONOME of the value waits
+	QAtomicInt __progress_pending;			///< 1 while an EVENT_PROGRESS waits
+	QAtomicInt __progress_value;			///< latest EVENT_PROGRESS value
+
+	RingBuffer<AddMidiNoteVector> __midi_notes;	///< notes recorded by the audio thread
+
+	bool __push( EventType type, int nValue );
+	/// the pending flag an event is coalesced on, NULL if it is not
+	QAtomicInt* __pending_flag( EventType type, int nValue );
 };
 
 };
@@ -29,15 +29,29 @@
 #include <hydrogen/globals.h>
 #include <hydrogen/object.h>
 #include <hydrogen/fx/LadspaFX.h>
+#include <hydrogen/helpers/reclaimer.h>
 
 #include <vector>
 #include <cassert>
+#include <QtCore/QAtomicPointer>
+#include <QtCore/QMutex>
 
 namespace H2Core
 {
 
+/// The effect slots as published to the audio thread, never modified once published
+struct LadspaFXChain
+{
+	LadspaFX* m_FX[ MAX_FX ];
+};
+
 /**
+ * The LADSPA effects.
  *
+ * The audio thread plays a snapshot of the effect slots taken at the start
+ * of each cycle, see beginProcess(). Changing an effect publishes a new
+ * snapshot, the replaced effect is deleted once the audio thread is done
+ * with it, so editing the effects never waits for the audio engine lock.
  */
 class Effects : public H2Core::Object
 {
@@ -50,6 +64,15 @@ public:
 	LadspaFX* getLadspaFX( int nFX );
 	void  setLadspaFX( LadspaFX* pFX, int nFX );
 
+	/// Take the snapshot of the effects played during the audio cycle starting. Called by the audio thread.
+	void beginProcess();
+	/// Release the snapshot at the end of the audio cycle. Called by the audio thread.
+	void endProcess();
+	/// Effect of a slot as played during the current audio cycle, NULL out of a cycle
+	LadspaFX* getPlayingLadspaFX( int nFX ) {
+		return m_pPlayingChain ? m_pPlayingChain->m_FX[ nFX ] : NULL;
+	}
+
 	std::vector<LadspaFXInfo*> getPluginList();
 	LadspaFXGroup* getLadspaFXGroup();
 
@@ -62,7 +85,10 @@ private:
 	
 	void updateRecentGroup();
 
-	LadspaFX* m_FXList[ MAX_FX ];
+	QAtomicPointer<LadspaFXChain> m_pChain;	///< current effect slots
+	LadspaFXChain* m_pPlayingChain;		///< effect slots of the running audio cycle
+	QMutex m_chainMutex;			///< serializes the changes of effects
+	Reclaimer m_reclaimer;			///< deletes the replaced effects and snapshots
 
 	Effects();
 
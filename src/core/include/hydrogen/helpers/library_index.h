@@ -0,0 +1,142 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_LIBRARY_INDEX_H
+#define H2C_LIBRARY_INDEX_H
+
+#include <vector>
+
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QStringList>
+
+#include <hydrogen/object.h>
+
+namespace H2Core
+{
+
+/**
+ * On disk index of the sound library, to list it without parsing it.
+ *
+ * It records the metadata of the drumkits, the names of their instruments
+ * with the length of their samples, and the names and categories of the
+ * patterns. A directory is listed again only once its modification time
+ * changed, a drumkit or a pattern is parsed again only once its file did.
+ * The index is kept in the cache directory and written back when an
+ * update changed it.
+ */
+class LibraryIndex : public H2Core::Object
+{
+        H2_OBJECT
+    public:
+        /** what the index knows of a drumkit */
+        struct DrumkitInfo {
+            QString path;                   ///< directory of the drumkit
+            QString name;                   ///< name of the drumkit
+            QString author;                 ///< author of the drumkit
+            QString info;                   ///< description of the drumkit
+            QString license;                ///< license of the drumkit
+            QStringList instruments;        ///< names of the instruments
+            std::vector<float> lengths;     ///< length of the longest sample of each instrument, in seconds, -1 if unknown
+            qint64 mtime;                   ///< modification time of drumkit.xml
+            qint64 size;                    ///< size of drumkit.xml
+        };
+        /** what the index knows of a pattern */
+        struct PatternInfo {
+            QString path;                   ///< the pattern file
+            QString name;                   ///< name of the pattern
+            QString category;               ///< category of the pattern
+            QString drumkit;                ///< name of the drumkit the pattern has been written for
+            qint64 mtime;                   ///< modification time of the file
+            qint64 size;                    ///< size of the file
+        };
+
+        /**
+         * create the instance
+         * \param path the index file, read if it exists
+         */
+        static void create_instance( const QString& path );
+        /** return the instance, 0 if not created */
+        static LibraryIndex* get_instance() { return __instance; }
+        /** destructor, writes the index back if needed */
+        ~LibraryIndex();
+
+        /**
+         * return the drumkits of a directory, brought up to date, in the order of their directory names
+         * \param dir a directory holding drumkits, the system or the user one
+         */
+        std::vector<DrumkitInfo> get_drumkits( const QString& dir );
+        /** return the patterns of the drumkit subdirectories of the user patterns directory, brought up to date */
+        std::vector<PatternInfo> get_patterns();
+        /**
+         * return what is known of a pattern file, parsed only if it changed
+         * the index is not written back, call save() after a series of calls
+         * \param path the pattern file
+         * \param info filled with the pattern info
+         * \return false if the file can't be read
+         */
+        bool get_pattern( const QString& path, PatternInfo* info );
+        /** write the index back if it changed */
+        void save();
+
+    private:
+        /** a directory listing */
+        struct Listing {
+            qint64 mtime;                   ///< modification time of the directory when listed
+            QStringList entries;            ///< the entries found
+        };
+        static LibraryIndex* __instance;                ///< the instance
+        QString __path;                                 ///< the index file
+        mutable QMutex __mutex;                         ///< guards the maps below
+        QMap<QString, Listing> __listings;              ///< listings by directory and kind of entries
+        QMap<QString, DrumkitInfo> __drumkits;          ///< drumkits by directory
+        QMap<QString, PatternInfo> __patterns;          ///< patterns by file
+        bool __modified;                                ///< the maps differ from the index file
+
+        /**
+         * constructor
+         * \param path the index file
+         */
+        LibraryIndex( const QString& path );
+        /** read the index file, an outdated or foreign one is ignored */
+        void __load();
+        /** write the index file, called with __mutex locked */
+        void __save();
+        /**
+         * list a directory, unless it did not change since the last time
+         * \param dir the directory
+         * \param dirs list the subdirectories if true, the pattern files otherwise
+         */
+        QStringList __list( const QString& dir, bool dirs );
+        /** bring a drumkit entry up to date, return false if it is not a drumkit, called with __mutex locked */
+        bool __update_drumkit( const QString& dk_path );
+        /** bring a pattern entry up to date, return false if it can't be read, called with __mutex locked */
+        bool __update_pattern( const QString& path );
+        /** return the length of an audio file in seconds, from its header, -1 if it can't be read */
+        static float __sample_length( const QString& path );
+};
+
+};
+
+#endif // H2C_LIBRARY_INDEX_H
+
+/* vim: set softtabstop=4 expandtab: */
@@ -0,0 +1,132 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_RECLAIMER_H
+#define H2C_RECLAIMER_H
+
+#include <vector>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+
+#include <hydrogen/object.h>
+
+namespace H2Core
+{
+
+/**
+ * Epoch based deferred deletion of the snapshots read by the audio thread.
+ *
+ * The LADSPA effect chain and the MIDI map are published as immutable
+ * snapshots, swapped through an atomic pointer. The song itself, its
+ * instruments, layers and patterns, is still edited in place and read by
+ * the audio thread under the audio engine lock. The audio thread brackets each cycle
+ * with enter() and leave(). The writers retire() what they replaced, it is
+ * deleted by collect() once the audio thread can not see it anymore, that is
+ * when it is out of a cycle or in a cycle entered after the retirement.
+ * The audio thread never waits, nor frees anything.
+ * Besides the writers, a background thread collects the reclaimers
+ * periodically, so that nothing waits for the next change to be destroyed.
+ */
+class Reclaimer : public H2Core::Object
+{
+        H2_OBJECT
+    public:
+        /**
+         * constructor
+         * \param periodic true to be collected periodically by the background thread too
+         */
+        Reclaimer( bool periodic=true );
+        /** destructor, deletes what is left, the audio thread must be out of its cycle */
+        ~Reclaimer();
+
+        /** enter a cycle, called by the audio thread before reading the published snapshots */
+        void enter();
+        /** leave the cycle, called by the audio thread once done with the snapshots */
+        void leave();
+
+        /**
+         * hand over an object which has just been replaced by a new snapshot,
+         * it is deleted once the audio thread can not see it anymore
+         * \param object the object to delete
+         */
+        template<class T> void retire( T* object );
+        /**
+         * same as retire( T* ) with a custom destruction
+         * \param object the object to destroy
+         * \param destroy called with object to destroy it
+         */
+        void retire( void* object, void ( *destroy )( void* ) );
+        /** destroy the retired objects the audio thread can not see anymore, not to be called by the audio thread, thread safe */
+        void collect();
+
+        /** number of retired objects waiting to be destroyed */
+        int get_pending() const;
+
+    private:
+        /** an object waiting to be destroyed */
+        struct Retired {
+            void* object;                   ///< the object
+            void ( *destroy )( void* );     ///< how to destroy it
+            int epoch;                      ///< epoch it was retired at
+        };
+
+        QAtomicInt __epoch;                 ///< incremented on each retirement
+        QAtomicInt __reader;                ///< epoch the audio thread entered its cycle at, -1 when out of a cycle
+        mutable QMutex __mutex;             ///< serializes the writers
+        std::vector<Retired> __retired;     ///< objects waiting to be destroyed
+        bool __periodic;                    ///< true if collected by the background thread
+
+        /** destroy the objects retired before the given epoch */
+        void __destroy_before( int epoch );
+        /** plain deletion of a retired object */
+        template<class T> static void __delete( void* object );
+        /** start the thread collecting the reclaimers, once */
+        static void __start_collector();
+};
+
+// DEFINITIONS
+
+inline void Reclaimer::enter()
+{
+    __reader.fetchAndStoreOrdered( __epoch );
+}
+
+inline void Reclaimer::leave()
+{
+    __reader.fetchAndStoreRelease( -1 );
+}
+
+template<class T> inline void Reclaimer::retire( T* object )
+{
+    retire( object, &Reclaimer::__delete<T> );
+}
+
+template<class T> void Reclaimer::__delete( void* object )
+{
+    delete static_cast<T*>( object );
+}
+
+};
+
+#endif // H2C_RECLAIMER_H
+
+/* vim: set softtabstop=4 expandtab: */
@@ -0,0 +1,204 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_RING_BUFFER_H
+#define H2C_RING_BUFFER_H
+
+#include <QtCore/QAtomicInt>
+
+namespace H2Core
+{
+
+/**
+ * A bounded single producer, single consumer lock free queue.
+ *
+ * One thread pushes, one other thread pops, neither of them ever blocks
+ * nor allocates. The items are copied in and out of a preallocated array,
+ * they should be plain data.
+ * The read and write counters run freely, their difference being the
+ * number of queued items.
+ */
+template<class T>
+class RingBuffer
+{
+    public:
+        /**
+         * constructor
+         * \param capacity the number of items the buffer can hold, rounded up to a power of 2
+         */
+        RingBuffer( int capacity );
+        /** destructor */
+        ~RingBuffer();
+
+        /**
+         * queue an item, called by the producer only
+         * \param item the item to copy into the buffer
+         * \return false if the buffer is full, the item is dropped then
+         */
+        bool push( const T& item );
+        /**
+         * dequeue an item, called by the consumer only
+         * \param item where to copy the item
+         * \return false if the buffer is empty
+         */
+        bool pop( T& item );
+        /**
+         * queue as many items as there is room for, called by the producer only
+         * \param items the items to copy into the buffer
+         * \param count the number of items
+         * \return the number of items queued
+         */
+        int write( const T* items, int count );
+        /**
+         * dequeue up to count items, called by the consumer only
+         * \param items where to copy the items, 0 to drop them
+         * \param count the number of items wanted
+         * \return the number of items dequeued
+         */
+        int read( T* items, int count );
+        /** drop every queued item, called by the consumer only */
+        void clear();
+
+        /** return the number of queued items, exact only for the producer or the consumer */
+        int size() const;
+        /** return true if no item is queued */
+        bool empty() const;
+        /** __capacity accessor */
+        int get_capacity() const;
+
+    private:
+        int __capacity;         ///< number of items the buffer can hold, a power of 2
+        T* __items;             ///< storage of the items
+        QAtomicInt __write;     ///< number of items pushed so far, written by the producer
+        QAtomicInt __read;      ///< number of items popped so far, written by the consumer
+
+        /** read a counter written by the other thread */
+        static int __acquire( const QAtomicInt& counter );
+
+        RingBuffer( const RingBuffer& );
+        RingBuffer& operator=( const RingBuffer& );
+};
+
+// DEFINITIONS
+
+template<class T>
+RingBuffer<T>::RingBuffer( int capacity )
+    : __capacity( 1 ),
+      __items( 0 ),
+      __write( 0 ),
+      __read( 0 )
+{
+    while ( __capacity < capacity ) __capacity <<= 1;
+    __items = new T[ __capacity ];
+}
+
+template<class T>
+RingBuffer<T>::~RingBuffer()
+{
+    delete[] __items;
+}
+
+template<class T>
+inline int RingBuffer<T>::__acquire( const QAtomicInt& counter )
+{
+    return const_cast<QAtomicInt&>( counter ).fetchAndAddAcquire( 0 );
+}
+
+template<class T>
+inline bool RingBuffer<T>::push( const T& item )
+{
+    unsigned write = ( int )__write;
+    if ( write - ( unsigned )__acquire( __read ) >= ( unsigned )__capacity ) return false;
+    __items[ write & ( __capacity - 1 ) ] = item;
+    // publish the item
+    __write.fetchAndStoreRelease( write + 1 );
+    return true;
+}
+
+template<class T>
+inline bool RingBuffer<T>::pop( T& item )
+{
+    unsigned read = ( int )__read;
+    if ( read == ( unsigned )__acquire( __write ) ) return false;
+    item = __items[ read & ( __capacity - 1 ) ];
+    // hand the slot back to the producer
+    __read.fetchAndStoreRelease( read + 1 );
+    return true;
+}
+
+template<class T>
+int RingBuffer<T>::write( const T* items, int count )
+{
+    unsigned write = ( int )__write;
+    int room = __capacity - ( int )( write - ( unsigned )__acquire( __read ) );
+    if ( count > room ) count = room;
+    for ( int i = 0; i < count; i++ ) {
+        __items[ ( write + i ) & ( __capacity - 1 ) ] = items[i];
+    }
+    __write.fetchAndStoreRelease( write + count );
+    return count;
+}
+
+template<class T>
+int RingBuffer<T>::read( T* items, int count )
+{
+    unsigned read = ( int )__read;
+    int queued = ( int )( ( unsigned )__acquire( __write ) - read );
+    if ( count > queued ) count = queued;
+    if ( items ) {
+        for ( int i = 0; i < count; i++ ) {
+            items[i] = __items[ ( read + i ) & ( __capacity - 1 ) ];
+        }
+    }
+    __read.fetchAndStoreRelease( read + count );
+    return count;
+}
+
+template<class T>
+inline void RingBuffer<T>::clear()
+{
+    __read.fetchAndStoreRelease( __acquire( __write ) );
+}
+
+template<class T>
+inline int RingBuffer<T>::size() const
+{
+    return ( unsigned )__acquire( __write ) - ( unsigned )__acquire( __read );
+}
+
+template<class T>
+inline bool RingBuffer<T>::empty() const
+{
+    return size() == 0;
+}
+
+template<class T>
+inline int RingBuffer<T>::get_capacity() const
+{
+    return __capacity;
+}
+
+};
+
+#endif // H2C_RING_BUFFER_H
+
+/* vim: set softtabstop=4 expandtab: */
@@ -0,0 +1,220 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_SMOOTHED_VALUE_H
+#define H2C_SMOOTHED_VALUE_H
+
+#include <cmath>
+#include <QtCore/QAtomicInt>
+
+namespace H2Core
+{
+
+/**
+ * A parameter changed by any thread and followed smoothly by the audio thread.
+ *
+ * The target is stored atomically, it is written by the GUI, the midi input
+ * or the automation and read at any time. The audio thread picks it up
+ * once per period with update(), then reads the value of each frame of the
+ * period with get_values(), moving towards the target either linearly or
+ * exponentially. Nothing is allocated nor locked.
+ */
+class SmoothedValue
+{
+    public:
+        /** how the value moves towards the target */
+        enum Mode {
+            LINEAR,         ///< constant step, the target is reached after the smoothing length
+            EXPONENTIAL     ///< one pole low pass, 98% of the way is done after the smoothing length
+        };
+
+        /**
+         * constructor
+         * \param value the target and the current value
+         * \param mode how the value follows the target
+         */
+        SmoothedValue( float value=0.0, Mode mode=LINEAR );
+        /** copy constructor, the copy starts at the target of other */
+        SmoothedValue( const SmoothedValue& other );
+
+        /** set the target, from any thread */
+        void set_target( float value );
+        /** get the target, from any thread */
+        float get_target() const;
+        /** set the target and the current value at once, while the audio thread does not use it */
+        void reset( float value );
+
+        /**
+         * advance the value by the frames elapsed since the last update, then pick the target up.
+         * Called by the audio thread at the beginning of a period.
+         * \param elapsed the number of frames since the last update
+         * \param length the smoothing length in frames
+         */
+        void update( int elapsed, int length );
+        /** true if the value will stay constant during the period, called by the audio thread */
+        bool is_settled() const;
+        /** the value at the beginning of the period, called by the audio thread */
+        float get_value() const;
+        /**
+         * the values of frames of the period
+         * \param out where to write the values
+         * \param offset the first frame, from the beginning of the period
+         * \param n the number of frames
+         */
+        void get_values( float* out, int offset, int n ) const;
+
+    private:
+        QAtomicInt __target;    ///< the target, as the bits of a float
+        Mode __mode;            ///< how the value follows the target
+        float __value;          ///< the value at the beginning of the period
+        float __end;            ///< the target __value moves towards
+        float __step;           ///< LINEAR: increment per frame, EXPONENTIAL: factor of the distance per frame
+        int __remaining;        ///< number of frames left before __value reaches __end, 0 when settled
+
+        /** store a float in an int */
+        static int __to_bits( float value );
+        /** read a float stored in an int */
+        static float __from_bits( int bits );
+};
+
+// DEFINITIONS
+
+inline int SmoothedValue::__to_bits( float value )
+{
+    union { float f; int i; } u;
+    u.f = value;
+    return u.i;
+}
+
+inline float SmoothedValue::__from_bits( int bits )
+{
+    union { float f; int i; } u;
+    u.i = bits;
+    return u.f;
+}
+
+inline SmoothedValue::SmoothedValue( float value, Mode mode )
+    : __target( __to_bits( value ) ),
+      __mode( mode ),
+      __value( value ),
+      __end( value ),
+      __step( 0.0 ),
+      __remaining( 0 )
+{
+}
+
+inline SmoothedValue::SmoothedValue( const SmoothedValue& other )
+    : __target( __to_bits( other.get_target() ) ),
+      __mode( other.__mode ),
+      __value( other.get_target() ),
+      __end( other.get_target() ),
+      __step( 0.0 ),
+      __remaining( 0 )
+{
+}
+
+inline void SmoothedValue::set_target( float value )
+{
+    __target.fetchAndStoreRelease( __to_bits( value ) );
+}
+
+inline float SmoothedValue::get_target() const
+{
+    return __from_bits( ( int )__target );
+}
+
+inline void SmoothedValue::reset( float value )
+{
+    set_target( value );
+    __value = __end = value;
+    __remaining = 0;
+}
+
+inline bool SmoothedValue::is_settled() const
+{
+    return __remaining == 0;
+}
+
+inline float SmoothedValue::get_value() const
+{
+    return __value;
+}
+
+inline void SmoothedValue::update( int elapsed, int length )
+{
+    if ( __remaining > 0 ) {
+        if ( elapsed >= __remaining ) {
+            __value = __end;
+            __remaining = 0;
+        } else if ( __mode == LINEAR ) {
+            __value += __step * elapsed;
+            __remaining -= elapsed;
+        } else {
+            __value = __end + ( __value - __end ) * pow( __step, elapsed );
+            __remaining -= elapsed;
+        }
+    }
+    float target = get_target();
+    if ( target == __end ) return;
+    __end = target;
+    if ( length <= 0 ) {
+        __value = target;
+        __remaining = 0;
+    } else if ( __mode == LINEAR ) {
+        __step = ( target - __value ) / length;
+        __remaining = length;
+    } else {
+        // 2% of the distance is left after length frames, the
+        // 0.03% left after twice as much are skipped
+        __step = exp( -4.0 / length );
+        __remaining = 2 * length;
+    }
+}
+
+inline void SmoothedValue::get_values( float* out, int offset, int n ) const
+{
+    int i = 0;
+    if ( offset < __remaining ) {
+        int ramp = __remaining - offset;
+        if ( ramp > n ) ramp = n;
+        if ( __mode == LINEAR ) {
+            for ( ; i < ramp; ++i ) {
+                out[i] = __value + __step * ( offset + i );
+            }
+        } else {
+            float distance = ( __value - __end ) * pow( __step, offset );
+            for ( ; i < ramp; ++i ) {
+                out[i] = __end + distance;
+                distance *= __step;
+            }
+        }
+    }
+    for ( ; i < n; ++i ) {
+        out[i] = __end;
+    }
+}
+
+};
+
+#endif // H2C_SMOOTHED_VALUE_H
+
+/* vim: set softtabstop=4 expandtab: */
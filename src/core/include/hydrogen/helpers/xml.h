@@ -3,9 +3,14 @@
 #define H2C_XML_H
 
 #include <hydrogen/object.h>
+#include <QtCore/QSet>
 #include <QtCore/QString>
 #include <QtXml/QDomDocument>
 
+class QFile;
+class QIODevice;
+class QXmlStreamReader;
+
 namespace H2Core
 {
 
@@ -92,6 +97,14 @@ class XMLNode : public H2Core::Object, public QDomNode
          * \param text the text to write
          */
         void write_child_node( const QString& node, const QString& text );
+
+        /**
+         * the child elements are walked through once, in the order the fields are mostly read,
+         * each search then goes on from the last element walked through, __cursor.
+         * the first element of a name already walked through is searched from the first child
+         */
+        QDomElement __cursor;
+        QSet<QString> __walked;                 ///< names of the child elements up to __cursor
 };
 
 /**
@@ -120,6 +133,54 @@ class XMLDoc : public H2Core::Object, public QDomDocument
          * \param xmlns, the xml namespace prefix to add after XMLNS_BASE
          */
         void set_root( const QString& node_name, const QString& xmlns );
+        /**
+         * check if a file has been validated against a schema since it was last modified
+         * \param filepath the path to the xml file
+         * \param schemapath the path to the XML Schema file
+         */
+        static bool is_validated( const QString& filepath, const QString& schemapath );
+    private:
+        /**
+         * validate an xml file against a schema, unless it has already been since it was last modified
+         * \param file the xml file, open for reading
+         * \param schemapath the path to the XML Schema file
+         * \return false if the file is not valid, true if it is or if the schema is not usable
+         */
+        static bool __validate( QFile* file, const QString& schemapath );
+};
+
+/**
+ * XMLReader fills a QDomDocument in a single pass of a QXmlStreamReader
+ * Only the elements, their attributes and the non blank texts are kept,
+ * which is all the load_from methods read through XMLNode.
+ */
+class XMLReader : public H2Core::Object
+{
+        H2_OBJECT
+    public:
+        /** basic constructor */
+        XMLReader( );
+        /**
+         * read a document from a device
+         * \param device the device to read from, open for reading
+         * \param doc the empty document to fill
+         * \return false if the document is not well formed
+         */
+        bool read( QIODevice* device, QDomDocument* doc );
+        /**
+         * read a document from memory
+         * \param data the document content
+         * \param doc the empty document to fill
+         * \return false if the document is not well formed
+         */
+        bool read( const QByteArray& data, QDomDocument* doc );
+    private:
+        /**
+         * fill a document with the tokens of a stream reader
+         * \param reader the stream reader
+         * \param doc the empty document to fill
+         */
+        bool __read( QXmlStreamReader* reader, QDomDocument* doc );
 };
 
 };
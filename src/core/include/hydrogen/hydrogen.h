@@ -46,6 +46,8 @@ inline int randomValue( int max );
 namespace H2Core
 {
 
+class StretchScheduler;
+
 ///
 /// Hydrogen Audio Engine.
 ///
@@ -83,7 +85,10 @@ public:
 	Song* getSong();
 	void removeSong();
 
+	/// Queue a note played from the GUI, the audio thread plays and records it without the caller waiting for the engine lock
 	void addRealtimeNote ( int instrument, float velocity, float pan_L=1.0, float pan_R=1.0, float pitch=0.0, bool noteoff=false, bool forcePlay=false, int msg1=0 );
+	/// Play and record a note played at the given time, or at the given frame of the current cycle if nFrameOffset is not -1. Called by the audio thread, the audio engine being locked.
+	void __playRealtimeNote( int instrument, float velocity, float pan_L, float pan_R, float pitch, bool noteoff, bool forcePlay, int msg1, const timeval& time, int nFrameOffset = -1 );
 
 	float getMasterPeak_L();
 	void setMasterPeak_L( float value );
@@ -99,6 +104,8 @@ public:
 	unsigned long getRealtimeTickPosition();
 	unsigned long getTotalFrames();
 	unsigned long getRealtimeFrames();
+	/// Time the current audio cycle has been started at, on CLOCK_MONOTONIC
+	timespec getCurrentCycleTime();
 
 
 	PatternList * getCurrentPatternList();
@@ -115,7 +122,12 @@ public:
 
         void restartDrivers();
 
-	void startExportSong( const QString& filename, int rate, int depth  );
+	/**
+	 * Export the song to filename in one pass
+	 * \param bStems also write each instrument and each effect return to its own file, named after filename
+	 * \param bMix write the song mix to filename
+	 */
+	void startExportSong( const QString& filename, int rate, int depth, bool bStems = false, bool bMix = true );
         void stopExportSong( bool reconnectOldDriver );
 
 	AudioOutput* getAudioOutput();
@@ -202,6 +214,12 @@ public:
 	long getTickForHumanPosition( int humanpos );
 	float getNewBpmJTM();
 	void setNewBpmJTM( float bpmJTM);
+	/// Stretch the rubberband samples of the song to a tempo on a pool of threads,
+	/// they are swapped in at once when all done. bWait blocks until then.
+	void recalculateRubberband( float fBpm, bool bWait = false );
+	/// Convert the samples of the song to the sample rate of the audio driver in the background,
+	/// if enabled in the preferences, to be called once layers are given new samples
+	void resampleLayers();
 	void ComputeHumantimeFrames(uint32_t nFrames);
 
 	void __panic();
@@ -267,6 +285,8 @@ private:
 
 	std::list<Instrument*> __instrument_death_row; /// Deleting instruments too soon leads to potential crashes.
 
+	StretchScheduler* m_pStretchScheduler;	///< stretches the rubberband samples on tempo changes
+
 
 	/// Private constructor
 	Hydrogen();
@@ -32,14 +32,73 @@ using namespace std;
 class MidiAction : public H2Core::Object {
     H2_OBJECT
 	public:
+		/**
+		 * The actions hydrogen is able to interpret, in the order of
+		 * MidiActionManager::getActionList(). Unknown types are NOTHING.
+		 */
+		enum ActionType {
+			NOTHING,
+			PLAY,
+			PLAY_STOP_TOGGLE,
+			PLAY_PAUSE_TOGGLE,
+			STOP,
+			PAUSE,
+			RECORD_READY,
+			RECORD_STROBE_TOGGLE,
+			RECORD_STROBE,
+			RECORD_EXIT,
+			MUTE,
+			UNMUTE,
+			MUTE_TOGGLE,
+			NEXT_BAR,
+			PREVIOUS_BAR,
+			BPM_INCR,
+			BPM_DECR,
+			BPM_CC_RELATIVE,
+			BPM_FINE_CC_RELATIVE,
+			MASTER_VOLUME_RELATIVE,
+			MASTER_VOLUME_ABSOLUTE,
+			STRIP_VOLUME_RELATIVE,
+			STRIP_VOLUME_ABSOLUTE,
+			EFFECT1_LEVEL_RELATIVE,
+			EFFECT2_LEVEL_RELATIVE,
+			EFFECT3_LEVEL_RELATIVE,
+			EFFECT4_LEVEL_RELATIVE,
+			EFFECT1_LEVEL_ABSOLUTE,
+			EFFECT2_LEVEL_ABSOLUTE,
+			EFFECT3_LEVEL_ABSOLUTE,
+			EFFECT4_LEVEL_ABSOLUTE,
+			SELECT_NEXT_PATTERN,
+			SELECT_NEXT_PATTERN_CC_ABSOLUT,
+			SELECT_NEXT_PATTERN_PROMPTLY,
+			SELECT_NEXT_PATTERN_RELATIVE,
+			SELECT_AND_PLAY_PATTERN,
+			PAN_RELATIVE,
+			PAN_ABSOLUTE,
+			BEATCOUNTER,
+			TAP_TEMPO,
+			PLAYLIST_NEXT_SONG,
+			PLAYLIST_PREV_SONG,
+			TOGGLE_METRONOME,
+			SELECT_INSTRUMENT,
+			UNDO_ACTION,
+			REDO_ACTION,
+			ACTION_TYPE_COUNT
+		};
+
 		MidiAction( QString );
+
+		/// Name of an action type, as stored in the preferences
+		static const char* getTypeName( ActionType nType );
 			
 		void setParameter1( QString text ){
 			parameter1 = text;
+			nParameter1 = text.toInt();
 		}
 		
 		void setParameter2( QString text ){
 			parameter2 = text;
+			nParameter2 = text.toInt();
 		}
 		
 		QString getParameter1(){
@@ -53,12 +112,29 @@ class MidiAction : public H2Core::Object {
 		QString getType(){
 			return type;
 		}
+
+		/// The type, resolved once when the action is created
+		ActionType getTypeId() const {
+			return nType;
+		}
+
+		int getIntParameter1() const {
+			return nParameter1;
+		}
+
+		int getIntParameter2() const {
+			return nParameter2;
+		}
 		
 
 	private:
 		QString type;
 		QString parameter1;
 		QString parameter2;
+
+		ActionType nType;
+		int nParameter1;
+		int nParameter2;
 };
 
 
@@ -75,8 +151,59 @@ class MidiActionManager : public H2Core::Object
 
 		int lastBpmChangeCCParameter;
 
+		/// Executes an action with its first parameter and a value
+		typedef bool ( MidiActionManager::*action_t )( int nParameter1, int nValue );
+		/// The implementations of the actions, indexed by MidiAction::ActionType
+		static const action_t __actions[ MidiAction::ACTION_TYPE_COUNT ];
+
+		bool play( int, int );
+		bool playStopToggle( int, int );
+		bool playPauseToggle( int, int );
+		bool playToggle( bool bRewind );
+		bool stop( int, int );
+		bool pause( int, int );
+		bool recordReady( int, int );
+		bool recordStrobeToggle( int, int );
+		bool recordStrobe( int, int );
+		bool recordExit( int, int );
+		bool mute( int, int );
+		bool unmute( int, int );
+		bool muteToggle( int, int );
+		bool nextBar( int, int );
+		bool previousBar( int, int );
+		bool bpmIncr( int nMult, int );
+		bool bpmDecr( int nMult, int );
+		bool bpmCcRelative( int nMult, int nValue );
+		bool bpmFineCcRelative( int nMult, int nValue );
+		bool bpmChangeRelative( float fStep, int nValue );
+		bool masterVolumeRelative( int, int nValue );
+		bool masterVolumeAbsolute( int, int nValue );
+		bool stripVolumeRelative( int nLine, int nValue );
+		bool stripVolumeAbsolute( int nLine, int nValue );
+		bool effect1LevelAbsolute( int nLine, int nValue );
+		bool effect2LevelAbsolute( int nLine, int nValue );
+		bool effect3LevelAbsolute( int nLine, int nValue );
+		bool effect4LevelAbsolute( int nLine, int nValue );
+		bool selectNextPattern( int nRow, int );
+		bool selectNextPatternCcAbsolute( int, int nRow );
+		bool selectNextPatternPromptly( int, int nRow );
+		bool selectNextPatternRelative( int nStep, int );
+		bool selectAndPlayPattern( int nRow, int );
+		bool panRelative( int nLine, int nValue );
+		bool panAbsolute( int nLine, int nValue );
+		bool beatcounter( int, int );
+		bool tapTempo( int, int );
+		bool playlistNextSong( int, int );
+		bool playlistPrevSong( int, int );
+		bool toggleMetronome( int, int );
+		bool selectInstrument( int, int nInstrument );
+		bool undoAction( int, int );
+		bool redoAction( int, int );
+
 	public:
 		bool handleAction( MidiAction * );
+		/// Executes an action with the value of a cc message in place of its second parameter
+		bool handleAction( MidiAction *, int nValue );
 		
 		static void create_instance();
 		static MidiActionManager* get_instance() { assert(__instance); return __instance; }
@@ -26,8 +26,10 @@
 #include <map>
 #include <cassert>
 #include <hydrogen/object.h>
+#include <hydrogen/helpers/reclaimer.h>
 
 #include <QtCore/QMutex>
+#include <QtCore/QAtomicPointer>
 
 class MidiAction;
 
@@ -57,13 +59,26 @@ class MidiMap : public H2Core::Object
 
 		void setupNoteArray();
 
+		/// Begin the lookups of a midi message. Called by the midi input thread.
+		void beginLookup() { __reclaimer.enter(); }
+		/// End the lookups, the actions returned since beginLookup() may be deleted from now on.
+		void endLookup() { __reclaimer.leave(); }
+
 	private:
 		MidiMap();
 
-		MidiAction* __note_array[ 128 ];
-		MidiAction* __cc_array[ 128 ];
+		/// The actions of all the events, replaced as a whole on each change
+		struct Table {
+			MidiAction* note_array[ 128 ];
+			MidiAction* cc_array[ 128 ];
+			map_t mmcMap;
+		};
+
+		QAtomicPointer<Table> __table;		///< current actions, read without locking
+		QMutex __mutex;				///< serializes the changes
+		H2Core::Reclaimer __reclaimer;		///< deletes the replaced tables and actions
 
-		map_t mmcMap;
-		QMutex __mutex;
+		/// Publish pTable in place of the current table, which is retired
+		void publish( Table* pTable );
 };
 #endif
@@ -30,6 +30,8 @@
 #include <inttypes.h>
 #include <vector>
 
+#include <QtCore/QAtomicInt>
+
 
 namespace H2Core
 {
@@ -39,6 +41,9 @@ class Song;
 class Sample;
 class Instrument;
 class AudioOutput;
+class DiskStreamer;
+class LayerResampler;
+class InstrumentLayer;
 
 ///
 /// Waveform based sampler.
@@ -86,116 +91,83 @@ public:
 
         InterpolateMode getInterpolateMode(){ return __interpolateMode; }
 
+	/// Start nThreads voice rendering threads, working along with the audio thread.
+	/// 0 renders every note on the audio thread. The audio engine must be locked.
+	void set_render_threads( int nThreads );
+	int get_render_threads() { return __render_workers.size(); }
+
+	/// Feeds the notes playing streamed samples
+	DiskStreamer* get_disk_streamer() { return __disk_streamer; }
+
+	/// Converts the layers to the sample rate of the audio driver
+	LayerResampler* get_layer_resampler() { return __layer_resampler; }
+
+	/// Give pLayer a copy of its sample converted to the driver sample rate, 0 to drop it.
+	/// The notes playing the layer go on at the same place. The audio engine must be locked.
+	/// \return the previous converted copy, owned by the caller
+	Sample* set_resampled( InstrumentLayer* pLayer, Sample* pResampled );
+
 private:
+	/// Where a note is mixed to
+	struct RenderBuffers {
+		float *main_L;
+		float *main_R;
+		float *fx_L[ MAX_FX ];	///< LADSPA sends, NULL if the FX slot is empty
+		float *fx_R[ MAX_FX ];
+		float *track_L;		///< track output, the one of the driver if NULL
+		float *track_R;
+		float *peak_L;		///< instrument peak, the one of the instrument if NULL
+		float *peak_R;
+	};
+	struct RenderWorker;
+	friend void* samplerWorker_processCaller( void* param );
+
 	std::vector<Note*> __playing_notes_queue;
 	std::vector<Note*> __queuedNoteOffs;
 
+	std::vector<RenderWorker*> __render_workers;
+	std::vector<unsigned> __render_results;		///< __render_note() result for each playing note
+	std::vector<int> __render_order;		///< playing notes sorted by track
+	std::vector<int> __render_track;		///< track of each playing note
+	std::vector<int> __render_groups;		///< first index in __render_order of each track, then the number of notes
+	QAtomicInt __render_next;			///< next track of __render_groups to render
+	QAtomicInt* __render_owners;			///< thread rendering each track of __render_groups
+	unsigned __render_capacity;			///< most notes rendered in parallel, every note has a copy in each worker
+	int __render_period;				///< number of the period rendered in parallel
+
 	/// Instrument used for the preview feature.
 	Instrument* __preview_instrument;
 
-	unsigned __render_note( Note* pNote, unsigned nBufferSize, Song* pSong );
+	DiskStreamer* __disk_streamer;
+	LayerResampler* __layer_resampler;
+
+	long long __frames;	///< number of frames processed so far, the smoothed parameters are updated against it
+
+	/// give a note which was playing back to the pool, closing its stream
+	void __release_note( Note* pNote );
+
+	/// the layer of its instrument a note plays, chosen by velocity, NULL if none
+	InstrumentLayer* __get_layer( Note* pNote );
+	/// the sample a layer is rendered from, its converted copy if it matches the driver sample rate
+	Sample* __get_render_sample( InstrumentLayer* pLayer );
+
+	unsigned __render_note( Note* pNote, unsigned nBufferSize, Song* pSong, RenderBuffers* pBuffers );
+	/// render the playing notes on the audio thread and the render workers
+	void __render_parallel( uint32_t nFrames, Song* pSong, RenderBuffers* pBuffers );
+	/// render the notes of a track of __render_groups
+	void __render_group( int nGroup, uint32_t nFrames, Song* pSong, RenderBuffers* pBuffers );
+	/// render copies of the notes of the tracks left to render, called by a render worker
+	void __render_worker( RenderWorker* pWorker );
+	/// drop the work of a render worker the audio thread gave up on
+	void __drop_worker( RenderWorker* pWorker );
+	void __delete_worker( RenderWorker* pWorker );
 
         InterpolateMode __interpolateMode;
 
-        /*
-        double Interpolate( float y0, float y1, float y2, float y3, double mu )
-        {
-                switch( __interpolateMode ){
-
-                case LINEAR:
-                        return linear_Interpolate( y1, y2, (float) mu );
-                case COSINE:
-                        return cosine_Interpolate( y1, y2, mu );
-                case THIRD:
-                        return third_Interpolate( y0, y1, y2, y3, mu );
-                case CUBIC:
-                        return cubic_Interpolate( y0, y1, y2, y3, mu );
-                case HERMITE:
-                        return hermite_Interpolate( y0, y1, y2, y3, mu );
-                }
-        };*/
-
-        inline static float linear_Interpolate( float y1, float y2, float mu )
-        {
-                /*
-                 * mu defines where to estimate the value on the interpolated line
-                 * y1 = buffervalue on position
-                 * y2 = buffervalue on position +1
-                 */
-                return y1 * ( 1 - mu ) + y2 * mu;
-        };
-
-        inline static float cosine_Interpolate( float y1, float y2, double mu )
-        {
-                /*
-                 * mu defines where to estimate the value on the interpolated line
-                 * y1 = buffervalue on position
-                 * y2 = buffervalue on position +1
-                 */
-                double mu2;
-
-                mu2 = ( 1 - cos ( mu * 3.14159 ) ) / 2;
-                return( y1 * (1 - mu2 ) + y2 * mu2 );
-        };
-
-        inline static float third_Interpolate( float y0, float y1, float y2, float y3, double mu )
-        {
-                /*
-                 * mu defines where to estimate the value on the interpolated line
-                 * y0 = buffervalue on position -1
-                 * y1 = buffervalue on position
-                 * y2 = buffervalue on position +1
-                 * y3 = buffervalue on position +2
-                 */
-
-                float c0 = y1;
-                float c1 = 0.5f * ( y2 - y0 );
-                float c3 = 1.5f * ( y1 - y2 ) + 0.5f * ( y3 - y0 );
-                float c2 = y0 - y1 + c1 - c3;
-                return ( ( c3 * mu + c2 ) * mu + c1 ) * mu + c0;
-        };
-
-        inline static float cubic_Interpolate( float y0, float y1, float y2, float y3, double mu)
-        {
-                /*
-                 * mu defines where to estimate the value on the interpolated line
-                 * y0 = buffervalue on position -1
-                 * y1 = buffervalue on position
-                 * y2 = buffervalue on position +1
-                 * y3 = buffervalue on position +2
-                 */
-
-                double a0, a1, a2, a3, mu2;
-
-                mu2 = mu * mu;
-                a0 = y3 - y2 - y0 + y1;
-                a1 = y0 - y1 - a0;
-                a2 = y2 - y0;
-                a3 = y1;
-
-                return( a0 * mu * mu2 + a1 * mu2 + a2 * mu + a3 );
-        };
-
-        inline static float hermite_Interpolate( float y0, float y1, float y2, float y3, double mu )
-        {
-                /*
-                 * mu defines where to estimate the value on the interpolated line
-                 * y0 = buffervalue on position -1
-                 * y1 = buffervalue on position
-                 * y2 = buffervalue on position +1
-                 * y3 = buffervalue on position +2
-                 */
-
-                double a0, a1, a2, a3, mu2;
-
-                mu2 = mu * mu;
-                a0 = -0.5 * y0 + 1.5 * y1 - 1.5 * y2 + 0.5 * y3;
-                a1 = y0 - 2.5 * y1 + 2 * y2 - 0.5 * y3;
-                a2 = -0.5 * y0 + 0.5 * y2;
-                a3 = y1;
-
-                return( a0 * mu * mu2 + a1 * mu2 + a2 * mu + a3 );
-        };
+	/// gains of the instrument volume, gain and pan, frame by frame, nOffset frames after the beginning of the period
+	void __instrument_gains( Instrument* pInstr, float* pGain_L, float* pGain_R, float* pTemp, int nOffset, int nFrames );
+	/// low pass resonant filter of a block, nOffset frames after the beginning of the period
+	void __filter_block( Note* pNote, float* pVal_L, float* pVal_R, float* pTemp1, float* pTemp2, int nOffset, int nFrames );
 
 	int __render_note_no_resample(
 	    Sample *pSample,
@@ -206,7 +178,10 @@ private:
 	    float cost_R,
 	    float cost_track_L,
             float cost_track_R,
-	    Song* pSong
+	    bool bSmoothing,
+	    int nSampleFrames,
+	    Song* pSong,
+	    RenderBuffers* pBuffers
 	);
 
 	int __render_note_resample(
@@ -218,9 +193,18 @@ private:
 	    float cost_R,
 	    float cost_track_L,
 	    float cost_track_R,
+	    bool bSmoothing,
             float fLayerPitch,
-	    Song* pSong
+	    int nSampleFrames,
+	    Song* pSong,
+	    RenderBuffers* pBuffers
 	);
+
+	/// resample nFrames of pSample from fSamplePos, the interpolation is chosen once for the whole block
+	/// the frames of a streamed sample are fetched from nStream, nSampleFrames long, packed ones are converted to floats
+	void __resample_block( float* pOut_L, float* pOut_R, Sample* pSample, int nStream, int nSampleFrames, double& fSamplePos, float fStep, int nFrames );
+	/// resample nFrames of float data, nDataFrames long, from fPos with the current interpolation
+	void __resample( float* pOut_L, float* pOut_R, const float* pData_L, const float* pData_R, int nDataFrames, double& fPos, float fStep, int nFrames );
 };
 
 } // namespace
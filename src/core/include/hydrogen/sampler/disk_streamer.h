@@ -0,0 +1,145 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_DISK_STREAMER_H
+#define H2C_DISK_STREAMER_H
+
+#include <vector>
+#include <pthread.h>
+#include <semaphore.h>
+#include <QtCore/QAtomicInt>
+#include <QtCore/QString>
+
+#include <hydrogen/object.h>
+#include <hydrogen/helpers/ring_buffer.h>
+
+/** number of streamed samples which can be played at once */
+#define DISK_STREAMER_STREAMS       32
+/** number of frames read ahead of the play position, per stream */
+#define DISK_STREAMER_RING_FRAMES   65536
+/** number of frames a fetch can span */
+#define DISK_STREAMER_WINDOW_FRAMES 4096
+
+namespace H2Core
+{
+
+class Sample;
+
+/**
+ * Feeds the playing streamed samples from the disk.
+ *
+ * A streamed Sample only holds the head of its audio data in memory. When
+ * a note starts playing one, the audio thread opens a stream, a disk thread
+ * then reads the rest of the file into the ring buffer of the stream, ahead
+ * of the play position. The audio thread fetches the frames it renders from
+ * the head, then from the ring, without ever waiting: frames not read in
+ * time are rendered as silence and counted as underruns.
+ * The streams are preallocated, opening, fetching from and closing a stream
+ * never allocate nor lock.
+ * The disk thread never uses the sample of a stream, which can be deleted
+ * while its notes play, the audio thread checks with is_open_on() that the
+ * sample it renders is still the one the stream reads the head of.
+ */
+class DiskStreamer : public H2Core::Object
+{
+        H2_OBJECT
+    public:
+        /** constructor, starts the disk thread */
+        DiskStreamer();
+        /** destructor, stops the disk thread */
+        ~DiskStreamer();
+
+        /**
+         * open a stream, called by the audio thread
+         * \param sample the streamed sample to play, its head is read by fetch()
+         * \return the stream index, -1 if every stream is in use
+         */
+        int open( Sample* sample );
+        /**
+         * tell if a stream has been opened on a sample, called by the audio thread
+         * before fetching, as the sample might have been replaced and deleted meanwhile
+         * \param stream the stream index
+         * \param sample the sample to play
+         */
+        bool is_open_on( int stream, const Sample* sample ) const;
+        /**
+         * give the audio data of a range of frames, called by the audio thread
+         * the frames must be fetched in increasing order, the range can overlap the previous one,
+         * the sample the stream has been opened on must still exist
+         * \param stream the stream index
+         * \param first the first frame wanted
+         * \param count the number of frames wanted, at most DISK_STREAMER_WINDOW_FRAMES
+         * \param data_l set to the left channel data of first
+         * \param data_r set to the right channel data of first
+         * \return the number of frames available, which is count unless it is too large
+         */
+        int fetch( int stream, long long first, int count, const float** data_l, const float** data_r );
+        /**
+         * close a stream, called by the audio thread
+         * \param stream the stream index
+         */
+        void close( int stream );
+
+        /** number of open streams */
+        int get_active() const;
+        /** number of fetches which missed frames not yet read from the disk */
+        int get_underruns() const;
+
+    private:
+        /** a frame of a ring buffer */
+        struct Frame {
+            float l;
+            float r;
+        };
+        /** states of a stream */
+        enum State {
+            Free,           ///< available for open()
+            Claimed,        ///< being set up by open()
+            Opening,        ///< opened by the audio thread, the disk thread has to open the file
+            Playing,        ///< the disk thread fills the ring
+            Closing         ///< closed by the audio thread, the disk thread has to close the file
+        };
+        struct Stream;
+        friend void* diskStreamer_thread( void* param );
+
+        Stream* __streams;              ///< the streams
+        pthread_t __disk_thread;        ///< the disk thread
+        sem_t __wake;                   ///< posted to wake the disk thread up
+        volatile bool __running;        ///< false to stop the disk thread
+        QAtomicInt __active;            ///< number of open streams
+        QAtomicInt __underruns;         ///< number of fetches which missed frames
+        std::vector<float> __interleaved;   ///< file data read by the disk thread
+        std::vector<Frame> __frames;        ///< frames pushed by the disk thread
+
+        /** body of the disk thread */
+        void __run();
+        /** read ahead of a stream, return true if the ring got frames */
+        bool __fill( Stream* stream );
+        /** append frames starting at frame to the window of a stream */
+        void __pull( Stream* stream, long long frame, int count );
+};
+
+};
+
+#endif // H2C_DISK_STREAMER_H
+
+/* vim: set softtabstop=4 expandtab: */
@@ -0,0 +1,109 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_LAYER_RESAMPLER_H
+#define H2C_LAYER_RESAMPLER_H
+
+#include <vector>
+#include <pthread.h>
+#include <QtCore/QMutex>
+#include <QtCore/QWaitCondition>
+
+#include <hydrogen/object.h>
+
+namespace H2Core
+{
+
+class Song;
+class Sample;
+class InstrumentLayer;
+
+/**
+ * Converts the samples of the layers to the sample rate of the audio driver.
+ *
+ * A sample recorded at another rate than the driver one is resampled on
+ * every note, even at zero pitch. Once converted in the background, with a
+ * band limited interpolation, the layer plays the converted copy through the
+ * cheaper no resample path instead.
+ * The converted copies are swapped in under the audio engine lock, the
+ * position of the notes playing them is rescaled to the new rate.
+ */
+class LayerResampler : public H2Core::Object
+{
+        H2_OBJECT
+    public:
+        /** constructor, starts the conversion thread */
+        LayerResampler();
+        /** destructor, drops the pending jobs and stops the conversion thread */
+        ~LayerResampler();
+
+        /**
+         * convert the layers of a song to a sample rate, called by the main thread,
+         * the copies converted to another rate are dropped, the pending jobs replaced
+         * \param song the song whose instruments to convert, 0 to only drop pending jobs
+         * \param sample_rate the sample rate of the audio driver, 0 to drop every converted copy
+         */
+        void update( Song* song, int sample_rate );
+        /**
+         * convert the sample of a layer which has just been given a new one,
+         * the audio engine must be locked
+         * \param layer the layer to convert
+         * \param sample_rate the sample rate of the audio driver
+         */
+        void add( InstrumentLayer* layer, int sample_rate );
+
+        /** number of layers waiting for their conversion */
+        int get_pending() const;
+
+    private:
+        /** a layer to convert */
+        struct Job {
+            InstrumentLayer* layer;             ///< the layer to give the converted sample to, checked before use
+            Sample* source;                     ///< the sample of the layer when queued, only compared
+            Sample* copy;                       ///< copy of the sample, owned by the job
+            int sample_rate;                    ///< the sample rate to convert to
+            int generation;                     ///< value of __generation when queued
+        };
+
+        std::vector<Job> __jobs;                ///< pending jobs
+        int __generation;                       ///< number of updates, the jobs of a previous one are dropped
+        bool __quit;                            ///< stops the thread
+        mutable QMutex __mutex;                 ///< protects the jobs
+        QWaitCondition __queued;                ///< signaled when jobs are queued
+        pthread_t __worker;                     ///< the conversion thread
+        bool __started;                         ///< true if the thread is running
+
+        /** delete the pending jobs, __mutex must be held */
+        void __clear();
+        /** give a converted sample to its layer if it still plays the source, return false otherwise */
+        bool __install( const Job& job, Sample* resampled );
+        /** conversion thread body */
+        void __run();
+        /** conversion thread entry */
+        static void* __thread_main( void* param );
+};
+
+};
+
+#endif // H2C_LAYER_RESAMPLER_H
+
+/* vim: set softtabstop=4 expandtab: */
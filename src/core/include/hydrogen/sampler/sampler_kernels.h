@@ -0,0 +1,253 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#ifndef H2C_SAMPLER_KERNELS_H
+#define H2C_SAMPLER_KERNELS_H
+
+#include <cmath>
+
+/** number of frames the sampler renders per block, sized to fit the stack of the audio thread */
+#define SAMPLER_BLOCK_SIZE  256
+/** number of frames of packed sample data the resample path converts to floats at once */
+#define SAMPLER_WINDOW_SIZE ( SAMPLER_BLOCK_SIZE * 4 )
+
+namespace H2Core
+{
+
+/**
+ * Block operations used by the Sampler render paths.
+ *
+ * Each operation exists as a plain scalar reference (the *_ref methods)
+ * and as a vectorized version selected at compile time (SSE or NEON, whichever
+ * the compiler targets). Both versions perform exactly the same float operations
+ * in the same order for every frame, so their output is bit for bit identical.
+ * Buffers do not need to be aligned.
+ */
+class SamplerKernels
+{
+    public:
+        /** name of the instruction set the vectorized kernels were built for */
+        static const char* simd_name();
+
+        /**
+         * dst[i] = src[i] * gain[i]
+         * \param dst destination buffer
+         * \param src source buffer
+         * \param gain per frame gain buffer
+         * \param n number of frames
+         */
+        static void mul( float* dst, const float* src, const float* gain, int n );
+        /** scalar reference of mul */
+        static void mul_ref( float* dst, const float* src, const float* gain, int n );
+
+        /**
+         * dst[i] += src[i] * k
+         * \param dst destination buffer
+         * \param src source buffer
+         * \param k constant gain
+         * \param n number of frames
+         */
+        static void mac( float* dst, const float* src, float k, int n );
+        /** scalar reference of mac */
+        static void mac_ref( float* dst, const float* src, float k, int n );
+
+        /**
+         * dst[i] += src[i] * k, keeping track of the greatest value added
+         * \param dst destination buffer
+         * \param src source buffer
+         * \param k constant gain
+         * \param peak the peak value so far
+         * \param n number of frames
+         * \return the maximum of peak and of all src[i] * k
+         */
+        static float mac_peak( float* dst, const float* src, float k, float peak, int n );
+        /** scalar reference of mac_peak */
+        static float mac_peak_ref( float* dst, const float* src, float k, float peak, int n );
+
+        /**
+         * dst[i] = src[i] / 32768, 16 bit integers to floats
+         * \param dst destination buffer
+         * \param src 16 bit integers
+         * \param n number of values
+         */
+        static void s16_to_float( float* dst, const short* src, int n );
+        /** scalar reference of s16_to_float */
+        static void s16_to_float_ref( float* dst, const short* src, int n );
+
+        /**
+         * dst[i] = src[i] / 8388608, 24 bit little endian integers packed in 3 bytes to floats
+         * \param dst destination buffer
+         * \param src 3 bytes per value
+         * \param n number of values
+         */
+        static void s24_to_float( float* dst, const unsigned char* src, int n );
+        /** scalar reference of s24_to_float */
+        static void s24_to_float_ref( float* dst, const unsigned char* src, int n );
+
+        /*
+         * interpolation methods used by the resample path,
+         * mu defines where to estimate the value on the interpolated line
+         * y0 = buffervalue on position -1
+         * y1 = buffervalue on position
+         * y2 = buffervalue on position +1
+         * y3 = buffervalue on position +2
+         */
+        struct Linear {
+            static inline float interpolate( float y0, float y1, float y2, float y3, double mu ) {
+                return y1 * ( 1 - mu ) + y2 * mu;
+            }
+        };
+        struct Cosine {
+            static inline float interpolate( float y0, float y1, float y2, float y3, double mu ) {
+                double mu2 = ( 1 - cos ( mu * 3.14159 ) ) / 2;
+                return( y1 * ( 1 - mu2 ) + y2 * mu2 );
+            }
+        };
+        struct Third {
+            static inline float interpolate( float y0, float y1, float y2, float y3, double mu ) {
+                float c0 = y1;
+                float c1 = 0.5f * ( y2 - y0 );
+                float c3 = 1.5f * ( y1 - y2 ) + 0.5f * ( y3 - y0 );
+                float c2 = y0 - y1 + c1 - c3;
+                return ( ( c3 * mu + c2 ) * mu + c1 ) * mu + c0;
+            }
+        };
+        struct Cubic {
+            static inline float interpolate( float y0, float y1, float y2, float y3, double mu ) {
+                double mu2 = mu * mu;
+                double a0 = y3 - y2 - y0 + y1;
+                double a1 = y0 - y1 - a0;
+                double a2 = y2 - y0;
+                double a3 = y1;
+                return( a0 * mu * mu2 + a1 * mu2 + a2 * mu + a3 );
+            }
+        };
+        struct Hermite {
+            static inline float interpolate( float y0, float y1, float y2, float y3, double mu ) {
+                double mu2 = mu * mu;
+                double a0 = -0.5 * y0 + 1.5 * y1 - 1.5 * y2 + 0.5 * y3;
+                double a1 = y0 - 2.5 * y1 + 2 * y2 - 0.5 * y3;
+                double a2 = -0.5 * y0 + 0.5 * y2;
+                double a3 = y1;
+                return( a0 * mu * mu2 + a1 * mu2 + a2 * mu + a3 );
+            }
+        };
+
+        /**
+         * resample a block of a stereo sample using the given Interpolation
+         *
+         * Frames in the middle of the sample are computed without any bounds check,
+         * only the first frame and the last 3 frames of the sample go through the
+         * checked path, where the points outside of the sample are taken as 0.
+         * \param out_l left output buffer
+         * \param out_r right output buffer
+         * \param data_l left sample data
+         * \param data_r right sample data
+         * \param frames number of frames of the sample
+         * \param pos position within the sample, updated with the position of the next frame
+         * \param step position increment per output frame, must be positive
+         * \param n number of frames to produce
+         */
+        template<class Interpolation>
+        static void resample( float* out_l, float* out_r, const float* data_l, const float* data_r, int frames, double& pos, float step, int n );
+        /** resample reference implementation with every frame going through the checked path */
+        template<class Interpolation>
+        static void resample_ref( float* out_l, float* out_r, const float* data_l, const float* data_r, int frames, double& pos, float step, int n );
+
+    private:
+        template<class Interpolation>
+        static inline void resample_checked( float* out_l, float* out_r, const float* data_l, const float* data_r, int frames, double pos );
+};
+
+// DEFINITIONS
+
+template<class Interpolation>
+inline void SamplerKernels::resample_checked( float* out_l, float* out_r, const float* data_l, const float* data_r, int frames, double pos )
+{
+    int idx = ( int )pos;
+    double mu = pos - idx;
+    if ( ( idx + 1 ) >= frames ) {
+        // we reach the last audioframe, set it to zero
+        *out_l = 0.0;
+        *out_r = 0.0;
+        return;
+    }
+    float first_l = 0.0;
+    float first_r = 0.0;
+    if ( idx >= 1 ) {
+        first_l = data_l[ idx - 1 ];
+        first_r = data_r[ idx - 1 ];
+    }
+    float last_l = 0.0;
+    float last_r = 0.0;
+    if ( ( idx + 2 ) < frames ) {
+        last_l = data_l[ idx + 2 ];
+        last_r = data_r[ idx + 2 ];
+    }
+    *out_l = Interpolation::interpolate( first_l, data_l[ idx ], data_l[ idx + 1 ], last_l, mu );
+    *out_r = Interpolation::interpolate( first_r, data_r[ idx ], data_r[ idx + 1 ], last_r, mu );
+}
+
+template<class Interpolation>
+inline void SamplerKernels::resample_ref( float* out_l, float* out_r, const float* data_l, const float* data_r, int frames, double& pos, float step, int n )
+{
+    for ( int i = 0; i < n; i++ ) {
+        resample_checked<Interpolation>( &out_l[i], &out_r[i], data_l, data_r, frames, pos );
+        pos += step;
+    }
+}
+
+template<class Interpolation>
+inline void SamplerKernels::resample( float* out_l, float* out_r, const float* data_l, const float* data_r, int frames, double& pos, float step, int n )
+{
+    int i = 0;
+    // head, data[ idx - 1 ] is not available
+    for ( ; ( i < n ) && ( pos < 1.0 ); i++ ) {
+        resample_checked<Interpolation>( &out_l[i], &out_r[i], data_l, data_r, frames, pos );
+        pos += step;
+    }
+    // fast region, idx + 2 < frames for every frame, one frame of margin for the rounding of pos
+    int fast_end = i;
+    double room = ( frames - 3 ) - pos;
+    if ( room > 0.0 ) {
+        double fast = room / step;
+        fast_end = ( fast >= n - i ? n : i + ( int )fast );
+    }
+    for ( ; i < fast_end; i++ ) {
+        int idx = ( int )pos;
+        double mu = pos - idx;
+        out_l[i] = Interpolation::interpolate( data_l[ idx - 1 ], data_l[ idx ], data_l[ idx + 1 ], data_l[ idx + 2 ], mu );
+        out_r[i] = Interpolation::interpolate( data_r[ idx - 1 ], data_r[ idx ], data_r[ idx + 1 ], data_r[ idx + 2 ], mu );
+        pos += step;
+    }
+    // tail
+    for ( ; i < n; i++ ) {
+        resample_checked<Interpolation>( &out_l[i], &out_r[i], data_l, data_r, frames, pos );
+        pos += step;
+    }
+}
+
+};
+
+#endif // H2C_SAMPLER_KERNELS_H
+
+/* vim: set softtabstop=4 expandtab: */
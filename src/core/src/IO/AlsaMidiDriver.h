@@ -25,13 +25,21 @@
 
 #include <hydrogen/IO/MidiInput.h>
 #include <hydrogen/IO/MidiOutput.h>
+#include <hydrogen/helpers/ring_buffer.h>
 
 #ifdef H2CORE_HAVE_ALSA
 
 #include <alsa/asoundlib.h>
+#include <semaphore.h>
 #include <string>
 #include <vector>
 
+#include <QtCore/QAtomicInt>
+#include <QtCore/QMutex>
+
+/// number of MIDI output events waiting for the output thread
+#define ALSA_MIDI_OUT_QUEUE_SIZE	512
+
 namespace H2Core
 {
 
@@ -39,6 +47,10 @@ namespace H2Core
 /// Alsa Midi Driver
 /// Based on Matthias Nagorni alsa sequencer example
 ///
+/// The outgoing events are not sent by the audio thread, they are queued in
+/// a lock free ring, stamped with the time they are to be heard at. An output
+/// thread schedules them on an ALSA queue and drains them once per batch.
+///
 class AlsaMidiDriver : public virtual MidiInput, public virtual MidiOutput
 {
     H2_OBJECT
@@ -55,8 +67,30 @@ public:
 	virtual void handleQueueNote(Note* pNote);
 	virtual void handleQueueNoteOff( int channel, int key, int velocity );
         virtual void handleQueueAllNoteOff();
+	virtual void handleQueueAllNoteOffFromAudio();
+
+	/// Wait for outgoing events and schedule them, called by the output thread.
+	void midi_output_action( snd_seq_t *seq_handle, int nQueue, const timespec& queueStart );
 
 private:
+	/// An outgoing event
+	struct OutEvent {
+		timespec time;		///< when the event is to be heard, on CLOCK_MONOTONIC
+		bool bNoteOff;
+		int nChannel;
+		int nKey;
+		int nVelocity;
+	};
+
+	RingBuffer<OutEvent> __outQueue;	///< written by the audio thread, the audio engine being locked
+	RingBuffer<OutEvent> __outAsyncQueue;	///< written by the other threads, under __outAsyncMutex
+	QMutex __outAsyncMutex;
+	sem_t __outSemaphore;			///< posted when a queue gets its first event
+	QAtomicInt __droppedOutEvents;		///< events dropped because a queue was full
+	int __reportedDroppedOutEvents;		///< dropped events already logged by the output thread
+
+	void queueOutEvent( bool bNoteOff, int nChannel, int nKey, int nVelocity, long long nFrame );
+	void queueAllNoteOff( RingBuffer<OutEvent>* pQueue );
 };
 
 };
@@ -26,6 +26,7 @@
 #include <sndfile.h>
 
 #include <inttypes.h>
+#include <vector>
 
 #include <hydrogen/IO/AudioOutput.h>
 #include <hydrogen/object.h>
@@ -33,6 +34,8 @@
 namespace H2Core
 {
 
+class Song;
+
 typedef int  ( *audioProcessCallback )( uint32_t, void * );
 
 ///
@@ -50,8 +53,12 @@ class DiskWriterDriver : public AudioOutput
 		audioProcessCallback m_processCallback;
 		float* m_pOut_L;
 		float* m_pOut_R;
+		bool m_bMix;		///< write the song mix to m_sFilename
+		bool m_bStems;		///< write each instrument and each effect return to its own file
+		std::vector<float*> m_trackOut_L;	///< per-instrument outputs rendered by the sampler in stem mode
+		std::vector<float*> m_trackOut_R;
 	
-		DiskWriterDriver( audioProcessCallback processCallback, unsigned nSamplerate, const QString& sFilename, int nSampleDepth );
+		DiskWriterDriver( audioProcessCallback processCallback, unsigned nSamplerate, const QString& sFilename, int nSampleDepth, bool bStems = false, bool bMix = true );
 		~DiskWriterDriver();
 	
 		int init( unsigned nBufferSize );
@@ -74,6 +81,18 @@ class DiskWriterDriver : public AudioOutput
 		float* getOut_R() {
 			return m_pOut_R;
 		}
+
+		/// Allocate one output for each instrument of the song, for the stem export
+		void makeTrackOutputs( Song* pSong );
+		int getNumTracks() {
+			return m_trackOut_L.size();
+		}
+		float* getTrackOut_L( unsigned nTrack ) {
+			return nTrack < m_trackOut_L.size() ? m_trackOut_L[ nTrack ] : NULL;
+		}
+		float* getTrackOut_R( unsigned nTrack ) {
+			return nTrack < m_trackOut_R.size() ? m_trackOut_R[ nTrack ] : NULL;
+		}
 	
 		virtual void play();
 		virtual void stop();
@@ -82,7 +101,8 @@ class DiskWriterDriver : public AudioOutput
 		virtual void setBpm( float fBPM );
 	
 	private:
-
+		/// Free the per-instrument outputs
+		void freeTrackOutputs();
 
 };
 
@@ -29,11 +29,14 @@
 
 #include <hydrogen/IO/MidiInput.h>
 #include <hydrogen/IO/MidiOutput.h>
+#include <hydrogen/helpers/ring_buffer.h>
 
 #ifdef H2CORE_HAVE_JACK
 
 #include <pthread.h>
 
+#include <QtCore/QAtomicInt>
+
 #include <jack/jack.h>
 #include <jack/midiport.h>
 #include <jack/ringbuffer.h>
@@ -41,7 +44,7 @@
 #include <string>
 #include <vector>
 
-#define	JACK_MIDI_BUFFER_MAX 64	/* events */
+#define	JACK_MIDI_BUFFER_MAX 256	/* events */
 
 namespace H2Core
 {
@@ -59,13 +62,29 @@ public:
 
 	void getPortInfo( const QString& sPortName, int& nClient, int& nPort );
 	void JackMidiWrite(jack_nframes_t nframes);
+	/**
+	 * Decode a JACK MIDI input event, its frame within the period included.
+	 * \return false if the message is not handled
+	 */
+	static bool decodeEvent(const jack_midi_event_t& event, MidiMessage* msg);
 	void JackMidiRead(jack_nframes_t nframes);
         virtual void handleQueueNote(Note* pNote);
         virtual void handleQueueNoteOff( int channel, int key, int velocity );
         virtual void handleQueueAllNoteOff();
+        virtual void handleQueueAllNoteOffFromAudio();
 
 private:
-	void JackMidiOutEvent(uint8_t *buf, uint8_t len);
+	/* an outgoing event, stamped with the JACK frame it is played on */
+	struct OutEvent {
+		jack_nframes_t frame;
+		uint8_t len;
+		uint8_t data[3];
+	};
+
+	void JackMidiOutEvent(uint8_t *buf, uint8_t len, jack_nframes_t frame);
+	jack_nframes_t JackMidiEventFrame(long long note_frame);
+	void JackMidiAllNoteOff(RingBuffer<OutEvent> *ring);
+	void JackMidiReportDropped();
 
 	void lock();
 	void unlock();
@@ -73,11 +92,12 @@ private:
 	jack_port_t *output_port;
 	jack_port_t *input_port;
 	jack_client_t *jack_client;
-	pthread_mutex_t mtx;
+	pthread_mutex_t mtx;	/* serializes the writers of tx_async */
 	int running;
-        uint8_t jack_buffer[JACK_MIDI_BUFFER_MAX * 4];
-	uint32_t rx_in_pos;
-	uint32_t rx_out_pos;
+	RingBuffer<OutEvent> tx_ring;	/* written by the audio thread, the audio engine being locked */
+	RingBuffer<OutEvent> tx_async;	/* written by the other threads, under mtx */
+	QAtomicInt tx_dropped;	/* events dropped by the audio thread, tx_ring being full */
+	int tx_reported;	/* dropped events already logged, under mtx */
 };
 
 };
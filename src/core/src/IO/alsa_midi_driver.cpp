@@ -31,6 +31,7 @@
 #include <hydrogen/event_queue.h>
 
 #include <pthread.h>
+#include <hydrogen/IO/AudioOutput.h>
 #include <hydrogen/basics/note.h>
 #include <hydrogen/basics/instrument.h>
 #include <hydrogen/basics/instrument_list.h>
@@ -45,6 +46,7 @@ namespace H2Core
 {
 
 pthread_t midiDriverThread;
+pthread_t midiOutputThread;
 
 bool isMidiDriverRunning = false;
 
@@ -54,6 +56,37 @@ struct pollfd *pfd;
 int portId;
 int clientId;
 int outPortId;
+int outQueueId = -1;
+timespec outQueueStart;	///< CLOCK_MONOTONIC time of the real time 0 of the queue
+
+/// a = b + nNsec, nNsec may be negative
+static void timespecAdd( timespec& a, const timespec& b, long long nNsec )
+{
+	nNsec += b.tv_nsec;
+	a.tv_sec = b.tv_sec + nNsec / 1000000000LL;
+	a.tv_nsec = nNsec % 1000000000LL;
+	if ( a.tv_nsec < 0 ) {
+		a.tv_nsec += 1000000000LL;
+		a.tv_sec--;
+	}
+}
+
+/// Nanoseconds from b to a
+static long long timespecDiff( const timespec& a, const timespec& b )
+{
+	return ( a.tv_sec - b.tv_sec ) * 1000000000LL + ( a.tv_nsec - b.tv_nsec );
+}
+
+
+void* alsaMidiDriver_outputThread( void* param )
+{
+	AlsaMidiDriver *pDriver = ( AlsaMidiDriver* )param;
+	while ( isMidiDriverRunning ) {
+		pDriver->midi_output_action( seq_handle, outQueueId, outQueueStart );
+	}
+	pthread_exit( NULL );
+	return NULL;
+}
 
 
 void* alsaMidiDriver_thread( void* param )
@@ -144,6 +177,32 @@ void* alsaMidiDriver_thread( void* param )
 
 	__INFOLOG( QString( "Midi input port at %1:%2" ).arg( clientId ).arg( portId ) );
 
+	// the outgoing events are scheduled on a queue, in real time
+	outQueueId = snd_seq_alloc_queue( seq_handle );
+	if ( outQueueId < 0 ) {
+		__ERRORLOG( "Error allocating sequencer queue, MIDI output events sent directly." );
+	} else {
+		snd_seq_start_queue( seq_handle, outQueueId, NULL );
+		snd_seq_drain_output( seq_handle );
+
+		// the queue runs on its own timer, its real time is taken
+		// back to the monotonic clock the events are stamped with
+		timespec now;
+		snd_seq_queue_status_t *status;
+		snd_seq_queue_status_alloca( &status );
+		clock_gettime( CLOCK_MONOTONIC, &now );
+		if ( snd_seq_get_queue_status( seq_handle, outQueueId, status ) < 0 ) {
+			__ERRORLOG( "Error reading the sequencer queue status." );
+			outQueueStart = now;
+		} else {
+			const snd_seq_real_time_t *rtime = snd_seq_queue_status_get_real_time( status );
+			timespecAdd( outQueueStart, now, -( ( long long )rtime->tv_sec * 1000000000LL + rtime->tv_nsec ) );
+		}
+	}
+	pthread_attr_t attr;
+	pthread_attr_init( &attr );
+	pthread_create( &midiOutputThread, &attr, alsaMidiDriver_outputThread, param );
+
 	npfd = snd_seq_poll_descriptors_count( seq_handle, POLLIN );
 	pfd = ( struct pollfd* )alloca( npfd * sizeof( struct pollfd ) );
 	snd_seq_poll_descriptors( seq_handle, pfd, npfd, POLLIN );
@@ -154,6 +213,11 @@ void* alsaMidiDriver_thread( void* param )
 			pDriver->midi_action( seq_handle );
 		}
 	}
+	pthread_join( midiOutputThread, NULL );
+	if ( outQueueId >= 0 ) {
+		snd_seq_free_queue( seq_handle, outQueueId );
+		outQueueId = -1;
+	}
 	snd_seq_close ( seq_handle );
 	seq_handle = NULL;
 	__INFOLOG( "MIDI Thread DESTROY" );
@@ -169,8 +233,13 @@ const char* AlsaMidiDriver::__class_name = "AlsaMidiDriver";
 
 AlsaMidiDriver::AlsaMidiDriver()
 		: MidiInput( __class_name ), MidiOutput( __class_name ), Object( __class_name )
+		, __outQueue( ALSA_MIDI_OUT_QUEUE_SIZE )
+		, __outAsyncQueue( ALSA_MIDI_OUT_QUEUE_SIZE )
+		, __droppedOutEvents( 0 )
+		, __reportedDroppedOutEvents( 0 )
 {
 //	infoLog("INIT");
+	sem_init( &__outSemaphore, 0, 0 );
 }
 
 
@@ -181,6 +250,7 @@ AlsaMidiDriver::~AlsaMidiDriver()
 	if ( isMidiDriverRunning ) {
 		close();
 	}
+	sem_destroy( &__outSemaphore );
 //	infoLog("DESTROY");
 }
 
@@ -443,30 +513,13 @@ void AlsaMidiDriver::handleQueueNote(Note* pNote)
 	//int key = pNote->get_instrument()->get_midi_out_note();
 	int velocity = pNote->get_midi_velocity();
 
-	snd_seq_event_t ev;	
-	
-	//Note off
-	snd_seq_ev_clear(&ev);
-        snd_seq_ev_set_source(&ev, outPortId);
-        snd_seq_ev_set_subs(&ev);
-        snd_seq_ev_set_direct(&ev);
-	snd_seq_ev_set_noteoff(&ev, channel, key, velocity);
-	snd_seq_event_output(seq_handle, &ev);
-	snd_seq_drain_output(seq_handle);
-	
-	//Note on
-	//snd_seq_event_input(seq_handle, &ev);
-	snd_seq_ev_clear(&ev);	
-        snd_seq_ev_set_source(&ev, outPortId);
-        snd_seq_ev_set_subs(&ev);
-        snd_seq_ev_set_direct(&ev);
-        //snd_seq_event_output_direct( seq_handle, ev );
-	
-	snd_seq_ev_set_noteon(&ev, channel, key, velocity);
-	snd_seq_event_output(seq_handle, &ev);
+	// the start of the note, as the sampler computes it
+	long long nFrame = ( long long )( pNote->get_position() * Hydrogen::get_instance()->getAudioOutput()->m_transport.m_nTickSize )
+			   + pNote->get_humanize_delay();
 
-        //snd_seq_free_event(ev);
-	snd_seq_drain_output(seq_handle);
+	//Note off, then note on
+	queueOutEvent( true, channel, key, velocity, nFrame );
+	queueOutEvent( false, channel, key, velocity, nFrame );
 }
 
 void AlsaMidiDriver::handleQueueNoteOff( int channel, int key, int velocity )
@@ -481,19 +534,18 @@ void AlsaMidiDriver::handleQueueNoteOff( int channel, int key, int velocity )
 		return;
 	}
 
-//	key = (pNote->m_noteKey.m_nOctave +3 ) * 12 + pNote->m_noteKey.m_key;
-//	int velocity = pNote->get_midi_velocity();
+	// the note has been rendered to its end somewhere in the current
+	// cycle, the note off goes at the end of the cycle
+	Hydrogen *pEngine = Hydrogen::get_instance();
+	long long nFrame;
+	if ( pEngine->getState() == STATE_PLAYING ) {
+		nFrame = pEngine->getAudioOutput()->m_transport.m_nFrames;
+	} else {
+		nFrame = pEngine->getRealtimeFrames();
+	}
+	nFrame += pEngine->getAudioOutput()->getBufferSize() - 1;
 
-	snd_seq_event_t ev;	
-	
-	//Note off
-	snd_seq_ev_clear(&ev);
-        snd_seq_ev_set_source(&ev, outPortId);
-        snd_seq_ev_set_subs(&ev);
-        snd_seq_ev_set_direct(&ev);
-	snd_seq_ev_set_noteoff(&ev, channel, key, velocity);
-	snd_seq_event_output(seq_handle, &ev);
-	snd_seq_drain_output(seq_handle);
+	queueOutEvent( true, channel, key, velocity, nFrame );
 }
 
 void AlsaMidiDriver::handleQueueAllNoteOff()
@@ -502,9 +554,32 @@ void AlsaMidiDriver::handleQueueAllNoteOff()
 		ERRORLOG( "seq_handle = NULL " );
 		return;
 	}
-	
+
+	QMutexLocker lock( &__outAsyncMutex );
+	queueAllNoteOff( &__outAsyncQueue );
+}
+
+void AlsaMidiDriver::handleQueueAllNoteOffFromAudio()
+{
+	if ( seq_handle == NULL ) {
+		return;
+	}
+
+	// the audio thread is the writer of __outQueue, it takes no lock
+	queueAllNoteOff( &__outQueue );
+}
+
+/// Queue a note off for every instrument, sent at once
+void AlsaMidiDriver::queueAllNoteOff( RingBuffer<OutEvent>* pQueue )
+{
 	InstrumentList *instList = Hydrogen::get_instance()->getSong()->get_instrument_list();
-		
+
+	OutEvent event;
+	clock_gettime( CLOCK_MONOTONIC, &event.time );
+	event.bNoteOff = true;
+	event.nVelocity = 0;
+
+	bool bWasEmpty = pQueue->empty();
 	unsigned int numInstruments = instList->size();
 	for (int index = 0; index < numInstruments; ++index) {
 		Instrument *curInst = instList->get(index);
@@ -513,18 +588,113 @@ void AlsaMidiDriver::handleQueueAllNoteOff()
 		if (channel < 0) {
 			continue;
 		}
-		int key = curInst->get_midi_out_note();
-	
-		snd_seq_event_t ev;	
-	
-		//Note off
-		snd_seq_ev_clear(&ev);
-	        snd_seq_ev_set_source(&ev, outPortId);
-	        snd_seq_ev_set_subs(&ev);
-	        snd_seq_ev_set_direct(&ev);
-		snd_seq_ev_set_noteoff(&ev, channel, key, 0);
-		snd_seq_event_output(seq_handle, &ev);
-		snd_seq_drain_output(seq_handle);
+		event.nChannel = channel;
+		event.nKey = curInst->get_midi_out_note();
+		if ( !pQueue->push( event ) ) {
+			__droppedOutEvents.fetchAndAddRelaxed( 1 );
+		}
+	}
+	if ( bWasEmpty ) {
+		sem_post( &__outSemaphore );
+	}
+}
+
+/**
+ * Queue an event for the output thread, stamped with the time the frame
+ * nFrame of the audio engine is heard at: the start of the current cycle,
+ * plus the offset of the frame within the cycle, plus the cycle itself
+ * being played while the next one is computed.
+ */
+void AlsaMidiDriver::queueOutEvent( bool bNoteOff, int nChannel, int nKey, int nVelocity, long long nFrame )
+{
+	Hydrogen *pEngine = Hydrogen::get_instance();
+	AudioOutput *pAudioOutput = pEngine->getAudioOutput();
+	long long nCycleFrame;
+	if ( pEngine->getState() == STATE_PLAYING ) {
+		nCycleFrame = pAudioOutput->m_transport.m_nFrames;
+	} else {
+		nCycleFrame = pEngine->getRealtimeFrames();
+	}
+	long long nBufferSize = pAudioOutput->getBufferSize();
+	long long nOffset = nFrame - nCycleFrame;
+	if ( nOffset < 0 ) {
+		nOffset = 0;
+	}
+	if ( nOffset >= nBufferSize ) {
+		nOffset = nBufferSize - 1;
+	}
+	long long nNsec = ( nOffset + nBufferSize ) * 1000000000LL / pAudioOutput->getSampleRate();
+
+	OutEvent event;
+	timespecAdd( event.time, pEngine->getCurrentCycleTime(), nNsec );
+	event.bNoteOff = bNoteOff;
+	event.nChannel = nChannel;
+	event.nKey = nKey;
+	event.nVelocity = nVelocity;
+
+	// no logging on the audio thread, the output thread reports the drops
+	if ( !__outQueue.push( event ) ) {
+		__droppedOutEvents.fetchAndAddRelaxed( 1 );
+		return;
+	}
+	// the output thread empties the queue before waiting again, it is
+	// woken up once per batch
+	if ( __outQueue.size() == 1 ) {
+		sem_post( &__outSemaphore );
+	}
+}
+
+void AlsaMidiDriver::midi_output_action( snd_seq_t *seq_handle, int nQueue, const timespec& queueStart )
+{
+	timespec timeout;
+	clock_gettime( CLOCK_REALTIME, &timeout );
+	timeout.tv_nsec += 100000000;
+	if ( timeout.tv_nsec >= 1000000000 ) {
+		timeout.tv_sec++;
+		timeout.tv_nsec -= 1000000000;
+	}
+	sem_timedwait( &__outSemaphore, &timeout );
+
+	OutEvent events[ 64 ];
+	int nEvents;
+	bool bOutput = false;
+	while ( ( nEvents = __outQueue.read( events, 64 ) ) > 0
+		|| ( nEvents = __outAsyncQueue.read( events, 64 ) ) > 0 ) {
+		for ( int i = 0; i < nEvents; i++ ) {
+			snd_seq_event_t ev;
+			snd_seq_ev_clear( &ev );
+			snd_seq_ev_set_source( &ev, outPortId );
+			snd_seq_ev_set_subs( &ev );
+			if ( nQueue >= 0 ) {
+				// the time since the queue has been started, late events are sent at once
+				long long nNsec = timespecDiff( events[i].time, queueStart );
+				snd_seq_real_time_t rtime;
+				if ( nNsec < 0 ) {
+					nNsec = 0;
+				}
+				rtime.tv_sec = nNsec / 1000000000LL;
+				rtime.tv_nsec = nNsec % 1000000000LL;
+				snd_seq_ev_schedule_real( &ev, nQueue, 0, &rtime );
+			} else {
+				snd_seq_ev_set_direct( &ev );
+			}
+			if ( events[i].bNoteOff ) {
+				snd_seq_ev_set_noteoff( &ev, events[i].nChannel, events[i].nKey, events[i].nVelocity );
+			} else {
+				snd_seq_ev_set_noteon( &ev, events[i].nChannel, events[i].nKey, events[i].nVelocity );
+			}
+			snd_seq_event_output( seq_handle, &ev );
+			bOutput = true;
+		}
+	}
+	if ( bOutput ) {
+		snd_seq_drain_output( seq_handle );
+	}
+
+	int nDropped = __droppedOutEvents;
+	if ( nDropped != __reportedDroppedOutEvents ) {
+		WARNINGLOG( QString( "%1 MIDI output events dropped, the queue was full" ).arg( nDropped - __reportedDroppedOutEvents ) );
+		__reportedDroppedOutEvents = nDropped;
 	}
 }
 
@@ -27,15 +27,126 @@
 #include <hydrogen/hydrogen.h>
 #include <hydrogen/basics/pattern.h>
 #include <hydrogen/basics/pattern_list.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_list.h>
+#include <hydrogen/basics/song.h>
+#include <hydrogen/fx/Effects.h>
 
 #include <pthread.h>
 #include <cassert>
+#include <algorithm>
+#include <cstring>
+#include <QtCore/QSemaphore>
+#include <QtCore/QThread>
+
+// number of driver buffers gathered before handing them to the writer thread
+#define DISK_WRITER_CHUNK_BUFFERS	16
 
 namespace H2Core
 {
 
 pthread_t diskWriterDriverThread;
 
+/// Interleaved audio handed by the render thread to the encoder threads, double buffered.
+/// Each encoder writes its own share of the files, so that FLAC and OGG encoding of the stems
+/// does not serialize the render.
+struct DiskWriterChunks
+{
+	std::vector<SNDFILE*> files;		///< the song mix first, then the stems, NULL for the files not written
+	std::vector<float*> pData[ 2 ];		///< interleaved frames of each file
+	unsigned nFrames[ 2 ];			///< frames in the chunk, 0 for the end of the song
+	int nEncoders;
+	QSemaphore free[ 2 ];			///< one per encoder done with the chunk, the render thread takes them all
+	QSemaphore* filled;			///< chunks each encoder thread can write
+	int nChunk;				///< chunk filled by the render thread
+
+	DiskWriterChunks( int encoders ) : nEncoders( encoders ), filled( new QSemaphore[ encoders ] ), nChunk( 0 ) {
+		free[ 0 ].release( encoders );
+		free[ 1 ].release( encoders );
+	}
+	~DiskWriterChunks() {
+		delete[] filled;
+	}
+
+	/// Hand the current chunk over to the encoders, then wait for the other one to be written
+	void handOver( unsigned nChunkFrames ) {
+		nFrames[ nChunk ] = nChunkFrames;
+		for ( int i = 0; i < nEncoders; i++ ) {
+			filled[ i ].release();
+		}
+		if ( nChunkFrames != 0 ) {
+			nChunk ^= 1;
+			free[ nChunk ].acquire( nEncoders );
+		}
+	}
+};
+
+/// An encoder thread, writing the files nIndex, nIndex + nEncoders, ...
+struct DiskWriterEncoder
+{
+	DiskWriterChunks* pChunks;
+	int nIndex;
+};
+
+/// Writes the chunks to the files while the render thread fills the other one
+void* diskWriterDriver_writerThread( void* param )
+{
+	DiskWriterEncoder* pEncoder = ( DiskWriterEncoder* )param;
+	DiskWriterChunks* pChunks = pEncoder->pChunks;
+	for ( int nChunk = 0; ; nChunk ^= 1 ) {
+		pChunks->filled[ pEncoder->nIndex ].acquire();
+		unsigned nFrames = pChunks->nFrames[ nChunk ];
+		if ( nFrames == 0 ) {
+			break;
+		}
+		for ( unsigned nFile = pEncoder->nIndex; nFile < pChunks->files.size(); nFile += pChunks->nEncoders ) {
+			if ( pChunks->files[ nFile ] == NULL ) {
+				continue;
+			}
+			int res = sf_writef_float( pChunks->files[ nFile ], pChunks->pData[ nChunk ][ nFile ], nFrames );
+			if ( res != ( int )nFrames ) {
+				___ERRORLOG( "Error during sf_write_float" );
+			}
+		}
+		pChunks->free[ nChunk ].release();
+	}
+	return NULL;
+}
+
+/// Interleave a buffer into pData, clipped to [-1,1]
+static inline void diskWriterDriver_interleave( float* pData, const float* pData_L, const float* pData_R, unsigned nFrames )
+{
+	for ( unsigned i = 0; i < nFrames; i++ ) {
+		pData[i * 2] = std::min( 1.0f, std::max( -1.0f, pData_L[i] ) );
+		pData[i * 2 + 1] = std::min( 1.0f, std::max( -1.0f, pData_R[i] ) );
+	}
+}
+
+/// Name of a stem file, the song file name with the name of the track appended
+static QString diskWriterDriver_stemFilename( const QString& sFilename, const QString& sTrack )
+{
+	int nDot = sFilename.lastIndexOf( '.' );
+	if ( nDot == -1 ) {
+		return sFilename + "-" + sTrack;
+	}
+	return sFilename.left( nDot ) + "-" + sTrack + sFilename.mid( nDot );
+}
+
+/// True if the instrument has notes in a pattern of the song, no stem is written for the others
+static bool diskWriterDriver_isPlayed( Song* pSong, Instrument* pInstr )
+{
+	PatternList* pPatterns = pSong->get_pattern_list();
+	for ( int i = 0; i < pPatterns->size(); i++ ) {
+		const Pattern::notes_t* notes = pPatterns->get( i )->get_notes();
+		FOREACH_NOTE_CST_IT_BEGIN_END( notes, it ) {
+			if ( it->second->get_instrument() == pInstr ) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
 void* diskWriterDriver_thread( void* param )
 {
 
@@ -127,9 +238,64 @@ void* diskWriterDriver_thread( void* param )
 	}
 
 
-	SNDFILE* m_file = sf_open( pDriver->m_sFilename.toLocal8Bit(), SFM_WRITE, &soundInfo );
+	Song* pSong = Hydrogen::get_instance()->getSong();
+	std::vector<SNDFILE*> files;
+	files.push_back( pDriver->m_bMix ? sf_open( pDriver->m_sFilename.toLocal8Bit(), SFM_WRITE, &soundInfo ) : NULL );
+
+	// stems: one file per instrument, rendered to the track outputs, then one per effect return
+	unsigned nTracks = 0;
+	std::vector<int> fxStems;
+	if ( pDriver->m_bStems ) {
+		pDriver->makeTrackOutputs( pSong );
+		nTracks = pDriver->getNumTracks();
+		InstrumentList* pInstruments = pSong->get_instrument_list();
+		for ( unsigned nTrack = 0; nTrack < nTracks; nTrack++ ) {
+			Instrument* pInstr = pInstruments->get( nTrack );
+			SNDFILE* pFile = NULL;
+			if ( diskWriterDriver_isPlayed( pSong, pInstr ) ) {
+				QString sStem = diskWriterDriver_stemFilename( pDriver->m_sFilename, pInstr->get_name() );
+				pFile = sf_open( sStem.toLocal8Bit(), SFM_WRITE, &soundInfo );
+				if ( pFile == NULL ) {
+					__ERRORLOG( QString( "Error opening %1" ).arg( sStem ) );
+				}
+			}
+			files.push_back( pFile );
+		}
+#ifdef H2CORE_HAVE_LADSPA
+		for ( int nFX = 0; nFX < MAX_FX; nFX++ ) {
+			LadspaFX* pFX = Effects::get_instance()->getLadspaFX( nFX );
+			if ( pFX == NULL || !pFX->isEnabled() ) {
+				continue;
+			}
+			QString sStem = diskWriterDriver_stemFilename( pDriver->m_sFilename, QString( "FX%1-%2" ).arg( nFX + 1 ).arg( pFX->getPluginName() ) );
+			SNDFILE* pFile = sf_open( sStem.toLocal8Bit(), SFM_WRITE, &soundInfo );
+			if ( pFile == NULL ) {
+				__ERRORLOG( QString( "Error opening %1" ).arg( sStem ) );
+			}
+			files.push_back( pFile );
+			fxStems.push_back( nFX );
+		}
+#endif
+	}
 
-	float *pData = new float[ pDriver->m_nBufferSize * 2 ];	// always stereo
+	// the render thread fills a chunk while the encoder threads write the other one
+	unsigned nChunkFrames = pDriver->m_nBufferSize * DISK_WRITER_CHUNK_BUFFERS;
+	int nEncoders = std::max( 1, std::min( ( int )files.size(), QThread::idealThreadCount() ) );
+	DiskWriterChunks chunks( nEncoders );
+	chunks.files = files;
+	for ( unsigned nFile = 0; nFile < files.size(); nFile++ ) {
+		chunks.pData[ 0 ].push_back( files[ nFile ] ? new float[ nChunkFrames * 2 ] : NULL );	// always stereo
+		chunks.pData[ 1 ].push_back( files[ nFile ] ? new float[ nChunkFrames * 2 ] : NULL );
+	}
+	unsigned nChunkUsed = 0;
+	chunks.free[ 0 ].acquire( nEncoders );
+	std::vector<pthread_t> encoderThreads( nEncoders );
+	std::vector<DiskWriterEncoder> encoders( nEncoders );
+	for ( int i = 0; i < nEncoders; i++ ) {
+		encoders[ i ].pChunks = &chunks;
+		encoders[ i ].nIndex = i;
+		pthread_create( &encoderThreads[ i ], NULL, diskWriterDriver_writerThread, &encoders[ i ] );
+	}
 
 	float *pData_L = pDriver->m_pOut_L;
 	float *pData_R = pDriver->m_pOut_R;
@@ -169,11 +335,9 @@ void* diskWriterDriver_thread( void* param )
                         pDriver->audioEngine_process_checkBPMChanged();
                         engine->setPatternPos(patternposition);
 
-                        // delay needed time to calculate all rubberband samples
+                        // stretch the rubberband samples for the new tempo before rendering with it
                         if( Preferences::get_instance()->getRubberBandBatchMode() && validBpm != oldBPM ){
-                                EventQueue::get_instance()->push_event( EVENT_RECALCULATERUBBERBAND, -1);
-                                int sleepTime = Preferences::get_instance()->getRubberBandCalcTime()+1;
-                                while ((sleepTime = sleep(sleepTime)) > 0);
+                                engine->recalculateRubberband( validBpm, true );
                         }
                         oldBPM = validBpm;
 
@@ -203,31 +367,42 @@ void* diskWriterDriver_thread( void* param )
         
                         frameNumber += usedBuffer;
                         int ret = pDriver->m_processCallback( usedBuffer, NULL );
-        
-                        for ( unsigned i = 0; i < usedBuffer; i++ ) {
-                                if(pData_L[i] > 1){
-                                        pData[i * 2] = 1;
-                                }
-                                else if(pData_L[i] < -1){
-                                        pData[i * 2] = -1;
-                                }else
-                                {
-                                        pData[i * 2] = pData_L[i];
-                                }
-        
-                                if(pData_R[i] > 1){
-                                        pData[i * 2 + 1] = 1;
+
+                        std::vector<float*>& chunkData = chunks.pData[ chunks.nChunk ];
+                        if ( chunkData[ 0 ] ) {
+                                diskWriterDriver_interleave( chunkData[ 0 ] + nChunkUsed * 2, pData_L, pData_R, usedBuffer );
+                        }
+                        for ( unsigned nTrack = 0; nTrack < nTracks; nTrack++ ) {
+                                if ( chunkData[ 1 + nTrack ] ) {
+                                        diskWriterDriver_interleave( chunkData[ 1 + nTrack ] + nChunkUsed * 2, pDriver->getTrackOut_L( nTrack ), pDriver->getTrackOut_R( nTrack ), usedBuffer );
                                 }
-                                else if(pData_R[i] < -1){
-                                        pData[i * 2 + 1] = -1;
-                                }else
-                                {
-                                        pData[i * 2 + 1] = pData_R[i];
+                        }
+#ifdef H2CORE_HAVE_LADSPA
+                        if ( !fxStems.empty() ) {
+                                // the effects as played by the cycle just rendered, this thread being the audio thread
+                                Effects* pEffects = Effects::get_instance();
+                                pEffects->beginProcess();
+                                for ( unsigned i = 0; i < fxStems.size(); i++ ) {
+                                        float* pFXData = chunkData[ 1 + nTracks + i ];
+                                        if ( pFXData == NULL ) {
+                                                continue;
+                                        }
+                                        LadspaFX* pFX = pEffects->getPlayingLadspaFX( fxStems[ i ] );
+                                        if ( pFX && pFX->isEnabled() ) {
+                                                float* pFX_R = ( pFX->getPluginType() == LadspaFX::STEREO_FX ) ? pFX->m_pBuffer_R : pFX->m_pBuffer_L;
+                                                diskWriterDriver_interleave( pFXData + nChunkUsed * 2, pFX->m_pBuffer_L, pFX_R, usedBuffer );
+                                        } else {
+                                                memset( pFXData + nChunkUsed * 2, 0, usedBuffer * 2 * sizeof( float ) );
+                                        }
                                 }
+                                pEffects->endProcess();
                         }
-                        int res = sf_writef_float( m_file, pData, usedBuffer );
-                        if ( res != ( int )usedBuffer ) {
-                                __ERRORLOG( "Error during sf_write_float" );
+#endif
+                        nChunkUsed += usedBuffer;
+                        if ( nChunkUsed + pDriver->m_nBufferSize > nChunkFrames ) {
+                                // hand the chunk over to the encoder threads
+                                chunks.handOver( nChunkUsed );
+                                nChunkUsed = 0;
                         }
                 }
 
@@ -236,10 +411,22 @@ void* diskWriterDriver_thread( void* param )
                 EventQueue::get_instance()->push_event( EVENT_PROGRESS, ( int )fPercent );
         }
 
-	delete[] pData;
-	pData = NULL;
+	// the last chunk, then the end
+	if ( nChunkUsed > 0 ) {
+		chunks.handOver( nChunkUsed );
+	}
+	chunks.handOver( 0 );
+	for ( int i = 0; i < nEncoders; i++ ) {
+		pthread_join( encoderThreads[ i ], NULL );
+	}
 
-	sf_close( m_file );
+	for ( unsigned nFile = 0; nFile < files.size(); nFile++ ) {
+		delete[] chunks.pData[ 0 ][ nFile ];
+		delete[] chunks.pData[ 1 ][ nFile ];
+		if ( files[ nFile ] ) {
+			sf_close( files[ nFile ] );
+		}
+	}
 
 	__INFOLOG( "DiskWriterDriver thread end" );
 
@@ -252,12 +439,14 @@ void* diskWriterDriver_thread( void* param )
 
 const char* DiskWriterDriver::__class_name = "DiskWriterDriver";
 
-DiskWriterDriver::DiskWriterDriver( audioProcessCallback processCallback, unsigned nSamplerate, const QString& sFilename, int nSampleDepth )
+DiskWriterDriver::DiskWriterDriver( audioProcessCallback processCallback, unsigned nSamplerate, const QString& sFilename, int nSampleDepth, bool bStems, bool bMix )
 		: AudioOutput( __class_name )
 		, m_nSampleRate( nSamplerate )
 		, m_sFilename( sFilename )
 		, m_nSampleDepth ( nSampleDepth )
 		, m_processCallback( processCallback )
+		, m_bMix( bMix )
+		, m_bStems( bStems )
 {
 	INFOLOG( "INIT" );
 }
@@ -313,6 +502,35 @@ void DiskWriterDriver::disconnect()
 	delete[] m_pOut_R;
 	m_pOut_R = NULL;
 
+	freeTrackOutputs();
+}
+
+
+
+void DiskWriterDriver::makeTrackOutputs( Song* pSong )
+{
+	freeTrackOutputs();
+	int nTracks = pSong->get_instrument_list()->size();
+	for ( int nTrack = 0; nTrack < nTracks; nTrack++ ) {
+		m_trackOut_L.push_back( new float[ m_nBufferSize ] );
+		m_trackOut_R.push_back( new float[ m_nBufferSize ] );
+		memset( m_trackOut_L.back(), 0, m_nBufferSize * sizeof( float ) );
+		memset( m_trackOut_R.back(), 0, m_nBufferSize * sizeof( float ) );
+	}
+	__track_out_enabled = nTracks > 0;
+}
+
+
+
+void DiskWriterDriver::freeTrackOutputs()
+{
+	__track_out_enabled = false;
+	for ( unsigned nTrack = 0; nTrack < m_trackOut_L.size(); nTrack++ ) {
+		delete[] m_trackOut_L[ nTrack ];
+		delete[] m_trackOut_R[ nTrack ];
+	}
+	m_trackOut_L.clear();
+	m_trackOut_R.clear();
 }
 
 
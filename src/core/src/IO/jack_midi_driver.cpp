@@ -67,7 +67,6 @@ JackMidiDriver::JackMidiWrite(jack_nframes_t nframes)
 	int i;
 	void *buf;
 	jack_midi_event_t event;
-        uint8_t buffer[13];// 13 is needed if we get sysex goto messages
 
 	if (input_port == NULL)
 		return;
@@ -95,100 +94,104 @@ JackMidiDriver::JackMidiWrite(jack_nframes_t nframes)
 		if (running < 1)
 			continue;
 
-		error = event.size;
-		if (error > (int)sizeof(buffer))
-			error = (int)sizeof(buffer);
+		if (decodeEvent(event, &msg))
+			handleMidiMessage(msg);
+	}
+}
 
-		memset(buffer, 0, sizeof(buffer));
-		memcpy(buffer, event.buffer, error);
+bool
+JackMidiDriver::decodeEvent(const jack_midi_event_t& event, MidiMessage* msg)
+{
+	int size;
+        uint8_t buffer[13];// 13 is needed if we get sysex goto messages
 
-		switch (buffer[0] >> 4) {
-		case 0x8:	 /* note off */
-			msg.m_type = MidiMessage::NOTE_OFF;
-			msg.m_nData1 = buffer[1];
-			msg.m_nData2 = buffer[2];
-			msg.m_nChannel = buffer[0] & 0xF;
-			handleMidiMessage(msg);
+	size = event.size;
+	if (size > (int)sizeof(buffer))
+		size = (int)sizeof(buffer);
+
+	memset(buffer, 0, sizeof(buffer));
+	memcpy(buffer, event.buffer, size);
+
+	/* the frame of the event within the period, the note is played there */
+	msg->m_nFrameOffset = event.time;
+
+	switch (buffer[0] >> 4) {
+	case 0x8:	 /* note off */
+		msg->m_type = MidiMessage::NOTE_OFF;
+		msg->m_nData1 = buffer[1];
+		msg->m_nData2 = buffer[2];
+		msg->m_nChannel = buffer[0] & 0xF;
+		break;
+	case 0x9:	 /* note on */
+		msg->m_type = MidiMessage::NOTE_ON;
+		msg->m_nData1 = buffer[1];
+		msg->m_nData2 = buffer[2];
+                msg->m_nChannel = buffer[0] & 0xF;
+		break;
+	case 0xB:	 /* control change */
+		msg->m_type = MidiMessage::CONTROL_CHANGE;
+		msg->m_nData1 = buffer[1];
+		msg->m_nData2 = buffer[2];
+		msg->m_nChannel = buffer[0] & 0xF;
+		break;
+	case 0xC:	 /* program change */
+		msg->m_type = MidiMessage::PROGRAM_CHANGE;
+		msg->m_nData1 = buffer[1];
+		msg->m_nData2 = buffer[2];
+		msg->m_nChannel = buffer[0] & 0xF;
+		break;
+        case 0xF:
+            switch (buffer[0]) {
+                case 0xF0:	/* system exclusive */
+                        msg->m_type = MidiMessage::SYSEX;
+                        if(buffer[3] == 06 ){// MMC message
+                            for ( int i = 0; i < sizeof(buffer) && i<6; i++ ) {
+                                     msg->m_sysexData.push_back( buffer[i] );
+                            }
+                        }else
+                        {
+                            for ( int i = 0; i < sizeof(buffer); i++ ) {
+                                     msg->m_sysexData.push_back( buffer[i] );
+                            }
+                        }
+                        break;
+		case 0xF1:
+			msg->m_type = MidiMessage::QUARTER_FRAME;
+			msg->m_nData1 = buffer[1];
+			msg->m_nData2 = buffer[2];
+			msg->m_nChannel = 0;
 			break;
-		case 0x9:	 /* note on */
-			msg.m_type = MidiMessage::NOTE_ON;
-			msg.m_nData1 = buffer[1];
-			msg.m_nData2 = buffer[2];
-                        msg.m_nChannel = buffer[0] & 0xF;
-                        handleMidiMessage(msg);
+		case 0xF2:
+			msg->m_type = MidiMessage::SONG_POS;
+			msg->m_nData1 = buffer[1];
+			msg->m_nData2 = buffer[2];
+			msg->m_nChannel = 0;
 			break;
-		case 0xB:	 /* control change */
-			msg.m_type = MidiMessage::CONTROL_CHANGE;
-			msg.m_nData1 = buffer[1];
-			msg.m_nData2 = buffer[2];
-			msg.m_nChannel = buffer[0] & 0xF;
-			handleMidiMessage(msg);
+		case 0xFA:
+			msg->m_type = MidiMessage::START;
+			msg->m_nData1 = buffer[1];
+			msg->m_nData2 = buffer[2];
+			msg->m_nChannel = 0;
 			break;
-		case 0xC:	 /* program change */
-			msg.m_type = MidiMessage::PROGRAM_CHANGE;
-			msg.m_nData1 = buffer[1];
-			msg.m_nData2 = buffer[2];
-			msg.m_nChannel = buffer[0] & 0xF;
-			handleMidiMessage(msg);
+		case 0xFB:
+			msg->m_type = MidiMessage::CONTINUE;
+			msg->m_nData1 = buffer[1];
+			msg->m_nData2 = buffer[2];
+			msg->m_nChannel = 0;
+			break;
+		case 0xFC:
+			msg->m_type = MidiMessage::STOP;
+			msg->m_nData1 = buffer[1];
+			msg->m_nData2 = buffer[2];
+			msg->m_nChannel = 0;
 			break;
-                case 0xF:
-                    switch (buffer[0]) {
-                        case 0xF0:	/* system exclusive */
-                                msg.m_type = MidiMessage::SYSEX;
-                                if(buffer[3] == 06 ){// MMC message
-                                    for ( int i = 0; i < sizeof(buffer) && i<6; i++ ) {
-                                             msg.m_sysexData.push_back( buffer[i] );
-                                    }
-                                }else
-                                {
-                                    for ( int i = 0; i < sizeof(buffer); i++ ) {
-                                             msg.m_sysexData.push_back( buffer[i] );
-                                    }
-                                }
-                                handleMidiMessage(msg);
-                                break;
-			case 0xF1:
-				msg.m_type = MidiMessage::QUARTER_FRAME;
-				msg.m_nData1 = buffer[1];
-				msg.m_nData2 = buffer[2];
-				msg.m_nChannel = 0;
-				handleMidiMessage(msg);
-				break;
-			case 0xF2:
-				msg.m_type = MidiMessage::SONG_POS;
-				msg.m_nData1 = buffer[1];
-				msg.m_nData2 = buffer[2];
-				msg.m_nChannel = 0;
-				handleMidiMessage(msg);
-				break;
-			case 0xFA:
-				msg.m_type = MidiMessage::START;
-				msg.m_nData1 = buffer[1];
-				msg.m_nData2 = buffer[2];
-				msg.m_nChannel = 0;
-				handleMidiMessage(msg);
-				break;
-			case 0xFB:
-				msg.m_type = MidiMessage::CONTINUE;
-				msg.m_nData1 = buffer[1];
-				msg.m_nData2 = buffer[2];
-				msg.m_nChannel = 0;
-				handleMidiMessage(msg);
-				break;
-			case 0xFC:
-				msg.m_type = MidiMessage::STOP;
-				msg.m_nData1 = buffer[1];
-				msg.m_nData2 = buffer[2];
-				msg.m_nChannel = 0;
-				handleMidiMessage(msg);
-				break;
-			default:
-				break;
-			}
 		default:
 			break;
 		}
+	default:
+		break;
 	}
+	return (msg->m_type != MidiMessage::UNKNOWN);
 }
 
 void
@@ -196,9 +199,12 @@ JackMidiDriver::JackMidiRead(jack_nframes_t nframes)
 {
 	uint8_t *buffer;
 	void *buf;
-	jack_nframes_t t;
-	uint8_t data[1];
-	uint8_t len;
+	jack_nframes_t start;
+	OutEvent events[JACK_MIDI_BUFFER_MAX];
+	jack_nframes_t offsets[JACK_MIDI_BUFFER_MAX];
+	int count;
+	int i;
+	int j;
 
 	if (output_port == NULL)
 		return;
@@ -213,64 +219,104 @@ JackMidiDriver::JackMidiRead(jack_nframes_t nframes)
 	jack_midi_clear_buffer(buf);
 #endif
 
-	t = 0;
-	lock();
-	while ((t < nframes) &&
-	       (rx_out_pos != rx_in_pos)) {
-
-                len = jack_buffer[4 * rx_in_pos];
-		if (len == 0) {
-			rx_in_pos++;
-			if (rx_in_pos >= JACK_MIDI_BUFFER_MAX)
-				rx_in_pos = 0;
-			continue;
+	count = tx_ring.read(events, JACK_MIDI_BUFFER_MAX);
+	count += tx_async.read(events + count, JACK_MIDI_BUFFER_MAX - count);
+
+	/*
+	 * An event stamped before this period has been queued after this
+	 * client ran in the previous cycle, it is played one period later
+	 * to keep its place in the period.
+	 */
+	start = jack_last_frame_time(jack_client);
+	for (i = 0; i < count; i++) {
+		OutEvent event = events[i];
+		int32_t offset = (int32_t)(event.frame - start);
+		if (offset < 0)
+			offset += nframes;
+		if (offset < 0)
+			offset = 0;
+		if (offset >= (int32_t)nframes)
+			offset = nframes - 1;
+
+		/* JACK wants the events in time order, keep the queue order on ties */
+		for (j = i; j > 0 && offsets[j - 1] > (jack_nframes_t)offset; j--) {
+			offsets[j] = offsets[j - 1];
+			events[j] = events[j - 1];
 		}
+		offsets[j] = offset;
+		events[j] = event;
+	}
 
+	for (i = 0; i < count; i++) {
 #ifdef JACK_MIDI_NEEDS_NFRAMES
-		buffer = jack_midi_event_reserve(buf, t, len, nframes);
+		buffer = jack_midi_event_reserve(buf, offsets[i], events[i].len, nframes);
 #else
-		buffer = jack_midi_event_reserve(buf, t, len);
+		buffer = jack_midi_event_reserve(buf, offsets[i], events[i].len);
 #endif
 		if (buffer == NULL)
 			break;
 
-                memcpy(buffer, jack_buffer + (4 * rx_in_pos) + 1, len);
-		t++;
-		rx_in_pos++;
-		if (rx_in_pos >= JACK_MIDI_BUFFER_MAX)
-			rx_in_pos = 0;
+		memcpy(buffer, events[i].data, events[i].len);
 	}
-	unlock();
 }
 
 void
-JackMidiDriver::JackMidiOutEvent(uint8_t buf[4], uint8_t len)
+JackMidiDriver::JackMidiOutEvent(uint8_t buf[4], uint8_t len, jack_nframes_t frame)
 {
-	uint32_t next_pos;
-
-	lock();
-
-	next_pos = rx_out_pos + 1;
-	if (next_pos >= JACK_MIDI_BUFFER_MAX)
-		next_pos = 0;
-
-	if (next_pos == rx_in_pos) {
-		/* buffer is full */
-		unlock();
-		return;
-	}
+	OutEvent event;
 
 	if (len > 3)
 		len = 3;
 
-        jack_buffer[(4 * next_pos)] = len;
-        jack_buffer[(4 * next_pos) + 1] = buf[0];
-        jack_buffer[(4 * next_pos) + 2] = buf[1];
-        jack_buffer[(4 * next_pos) + 3] = buf[2];
+	event.frame = frame;
+	event.len = len;
+	memcpy(event.data, buf, len);
+
+	/* no logging on the audio thread, the drops are reported later */
+	if (!tx_ring.push(event))
+		tx_dropped.fetchAndAddRelaxed(1);
+}
 
-	rx_out_pos = next_pos;
+/*
+ * Log the events dropped since the last report, out of the audio thread
+ * and under mtx.
+ */
+void
+JackMidiDriver::JackMidiReportDropped()
+{
+	int dropped = tx_dropped;
 
-	unlock();
+	if (dropped == tx_reported)
+		return;
+	WARNINGLOG(QString("%1 MIDI output events dropped, the queue was full")
+	    .arg(dropped - tx_reported));
+	tx_reported = dropped;
+}
+
+/*
+ * Return the JACK frame of a note starting on note_frame, a frame of the
+ * audio engine, as the sampler places it within the current cycle.
+ */
+jack_nframes_t
+JackMidiDriver::JackMidiEventFrame(long long note_frame)
+{
+	Hydrogen *pEngine = Hydrogen::get_instance();
+	AudioOutput *pAudioOutput = pEngine->getAudioOutput();
+	long long cycle_frame;
+	long long offset;
+
+	if (pEngine->getState() == STATE_PLAYING)
+		cycle_frame = pAudioOutput->m_transport.m_nFrames;
+	else
+		cycle_frame = pEngine->getRealtimeFrames();
+
+	offset = note_frame - cycle_frame;
+	if (offset < 0)
+		offset = 0;
+	if (offset >= (long long)pAudioOutput->getBufferSize())
+		offset = pAudioOutput->getBufferSize() - 1;
+
+	return jack_last_frame_time(jack_client) + offset;
 }
 
 static int
@@ -296,12 +342,14 @@ JackMidiShutdown(void *arg)
 
 JackMidiDriver::JackMidiDriver()
     : MidiInput( __class_name ), MidiOutput( __class_name ), Object( __class_name )
+    , tx_ring( JACK_MIDI_BUFFER_MAX )
+    , tx_async( JACK_MIDI_BUFFER_MAX )
+    , tx_dropped( 0 )
+    , tx_reported( 0 )
 {
 	pthread_mutex_init(&mtx, NULL);
 
 	running = 0;
-	rx_in_pos = 0;
-	rx_out_pos = 0;
 	output_port = 0;
 	input_port = 0;
 
@@ -349,6 +397,10 @@ void
 JackMidiDriver::close()
 {
 	running --;
+
+	lock();
+	JackMidiReportDropped();
+	unlock();
 }
 
 std::vector<QString>
@@ -381,6 +433,10 @@ void JackMidiDriver::handleQueueNote(Note* pNote)
 	int channel;
 	int key;
 	int vel;
+	long long frame;
+
+	if (output_port == NULL)
+		return;
 
 	channel = pNote->get_instrument()->get_midi_out_channel();
 	if (channel < 0 || channel > 15)
@@ -399,14 +455,22 @@ void JackMidiDriver::handleQueueNote(Note* pNote)
 	buffer[2] = vel;
 	buffer[3] = 0;
 
-	JackMidiOutEvent(buffer, 3);
+	/* the start of the note, as the sampler computes it */
+	frame = (long long)(pNote->get_position() * Hydrogen::get_instance()->getAudioOutput()->m_transport.m_nTickSize)
+	    + pNote->get_humanize_delay();
+
+	JackMidiOutEvent(buffer, 3, JackMidiEventFrame(frame));
 }
 
 void
 JackMidiDriver::handleQueueNoteOff(int channel, int key, int vel)
 {
 	uint8_t buffer[4];
+	Hydrogen *pEngine;
+	long long frame;
 
+	if (output_port == NULL)
+		return;
 	if (channel < 0 || channel > 15)
 		return;
 	if (key < 0 || key > 127)
@@ -419,10 +483,46 @@ JackMidiDriver::handleQueueNoteOff(int channel, int key, int vel)
 	buffer[2] = 0;
 	buffer[3] = 0;
 
-	JackMidiOutEvent(buffer, 3);
+	/*
+	 * The sampler sends the note off once the note has been rendered
+	 * to its end, somewhere in the current cycle: it goes at the end
+	 * of the cycle, never before the sound stops.
+	 */
+	pEngine = Hydrogen::get_instance();
+	if (pEngine->getState() == STATE_PLAYING)
+		frame = pEngine->getAudioOutput()->m_transport.m_nFrames;
+	else
+		frame = pEngine->getRealtimeFrames();
+	frame += pEngine->getAudioOutput()->getBufferSize() - 1;
+
+	JackMidiOutEvent(buffer, 3, JackMidiEventFrame(frame));
 }
 
 void JackMidiDriver::handleQueueAllNoteOff()
+{
+	if (output_port == NULL)
+		return;
+
+	lock();
+	JackMidiAllNoteOff(&tx_async);
+	JackMidiReportDropped();
+	unlock();
+}
+
+/*
+ * The audio thread at the end of the song: it is the writer of tx_ring,
+ * mtx is left to the other threads.
+ */
+void JackMidiDriver::handleQueueAllNoteOffFromAudio()
+{
+	if (output_port == NULL)
+		return;
+
+	JackMidiAllNoteOff(&tx_ring);
+}
+
+void
+JackMidiDriver::JackMidiAllNoteOff(RingBuffer<OutEvent> *ring)
 {
 	InstrumentList *instList = Hydrogen::get_instance()->getSong()->get_instrument_list();
 	Instrument *curInst;
@@ -430,6 +530,11 @@ void JackMidiDriver::handleQueueAllNoteOff()
 	unsigned int i;
 	int channel;
 	int key;
+	OutEvent event;
+
+	/* the notes off are sent as soon as possible */
+	event.frame = jack_frame_time(jack_client);
+	event.len = 3;
 
 	for (i = 0; i < numInstruments; i++) {
 		curInst = instList->get(i);
@@ -441,7 +546,11 @@ void JackMidiDriver::handleQueueAllNoteOff()
 		if (key < 0 || key > 127)
 			continue;
 
-		handleQueueNoteOff(channel, key, 0);	
+		event.data[0] = 0x80 | channel;	/* note off */
+		event.data[1] = key;
+		event.data[2] = 0;
+		if (!ring->push(event))
+			tx_dropped.fetchAndAddRelaxed(1);
 	}
 }
 
@@ -37,6 +37,9 @@ namespace H2Core
 MidiInput::MidiInput( const char* class_name )
 		: Object( class_name )
 		, m_bActive( false )
+		, __noteQueue( MIDI_INPUT_NOTE_QUEUE_SIZE )
+		, __noteOnTick( 0 )
+		, __noteOffTick( 0 )
 {
 	//INFOLOG( "INIT" );
 	
@@ -78,6 +81,9 @@ void MidiInput::handleMidiMessage( const MidiMessage& msg )
         }
         if(!bIsChannelValid) return;
 
+        // the actions looked up in the midi map stay valid till endLookup()
+        MidiMap::get_instance()->beginLookup();
+
         switch ( type ) {
         case MidiMessage::SYSEX:
                 handleSysexMessage( msg );
@@ -150,6 +156,8 @@ void MidiInput::handleMidiMessage( const MidiMessage& msg )
         default:
                 ERRORLOG( QString( "unhandled midi message type: %1" ).arg( msg.m_type ) );
         }
+
+        MidiMap::get_instance()->endLookup();
 }
 
 void MidiInput::handleControlChangeMessage( const MidiMessage& msg )
@@ -163,9 +171,8 @@ void MidiInput::handleControlChangeMessage( const MidiMessage& msg )
         MidiAction * pAction;
 
 	pAction = mM->getCCAction( msg.m_nData1 );
-	pAction->setParameter2( QString::number( msg.m_nData2 ) );
 
-	aH->handleAction( pAction );
+	aH->handleAction( pAction, msg.m_nData2 );
 
 	pEngine->lastMidiEvent = "CC";
 	pEngine->lastMidiEventParameter = msg.m_nData1;
@@ -208,21 +215,9 @@ void MidiInput::handleNoteOnMessage( const MidiMessage& msg )
 
                 pEngine->sequencer_setNextPattern( patternNumber, false, false );
         } else {
-                static const float fPan_L = 1.0f;
-                static const float fPan_R = 1.0f;
-
-                int nInstrument = nNote - 36;
-                if ( nInstrument < 0 ) {
-                        nInstrument = 0;
-                }
-                if ( nInstrument > ( MAX_INSTRUMENTS -1 ) ) {
-                        nInstrument = MAX_INSTRUMENTS - 1;
-                }
-
-                pEngine->addRealtimeNote( nInstrument, fVelocity, fPan_L, fPan_R, 0.0, false, true, nNote );
+                // played by the audio thread, see processQueuedNotes()
+                queueNote( false, nNote, fVelocity, msg.m_nFrameOffset );
         }
-
-	__noteOnTick = pEngine->__getMidiRealtimeNoteTickPosition();
 }
 
 
@@ -234,14 +229,73 @@ void MidiInput::handleNoteOffMessage( const MidiMessage& msg )
 		return;
 	}
 
+	//float fVelocity = msg.m_nData2 / 127.0; //we need this in future to controll release velocity
+	queueNote( true, msg.m_nData1, 0.0, msg.m_nFrameOffset );
+}
+
+
+
+void MidiInput::queueNote( bool bNoteOff, int nNote, float fVelocity, int nFrameOffset )
+{
+	QueuedNote note;
+	note.bNoteOff = bNoteOff;
+	note.nNote = nNote;
+	note.fVelocity = fVelocity;
+	note.nFrameOffset = nFrameOffset;
+	gettimeofday( &note.time, NULL );
+
+	if ( !__noteQueue.push( note ) ) {
+		ERRORLOG( QString( "Note queue full, note %1 dropped" ).arg( nNote ) );
+	}
+}
+
+
+
+void MidiInput::processQueuedNotes()
+{
+	QueuedNote note;
+	while ( __noteQueue.pop( note ) ) {
+		if ( note.bNoteOff ) {
+			playNoteOff( note );
+		} else {
+			playNoteOn( note );
+		}
+	}
+}
+
+
+
+void MidiInput::playNoteOn( const QueuedNote& note )
+{
+	static const float fPan_L = 1.0f;
+	static const float fPan_R = 1.0f;
+
+	Hydrogen *pEngine = Hydrogen::get_instance();
+
+	int nInstrument = note.nNote - 36;
+	if ( nInstrument < 0 ) {
+		nInstrument = 0;
+	}
+	if ( nInstrument > ( MAX_INSTRUMENTS -1 ) ) {
+		nInstrument = MAX_INSTRUMENTS - 1;
+	}
+
+	pEngine->__playRealtimeNote( nInstrument, note.fVelocity, fPan_L, fPan_R, 0.0, false, true, note.nNote, note.time, note.nFrameOffset );
+
+	__noteOnTick = pEngine->__getMidiRealtimeNoteTickPosition();
+}
+
+
+
+void MidiInput::playNoteOff( const QueuedNote& note )
+{
 	Hydrogen *pEngine = Hydrogen::get_instance();
 	Song *pSong = pEngine->getSong();
 
 	__noteOffTick = pEngine->getTickPosition();
 	unsigned long notelength = computeDeltaNoteOnOfftime();
 
-	int nNote = msg.m_nData1;
-	//float fVelocity = msg.m_nData2 / 127.0; //we need this in future to controll release velocity
+	int nNote = note.nNote;
 	int nInstrument = nNote - 36;
 	if ( nInstrument < 0 ) {
 		nInstrument = 0;
@@ -263,12 +317,12 @@ void MidiInput::handleNoteOffMessage( const MidiMessage& msg )
 	bool use_note_off = AudioEngine::get_instance()->get_sampler()->is_instrument_playing( pInstr );
 	if(use_note_off){
 		if ( Preferences::get_instance()->__playselectedinstrument ){
-			AudioEngine::get_instance()->get_sampler()->midi_keyboard_note_off( msg.m_nData1 );
+			AudioEngine::get_instance()->get_sampler()->midi_keyboard_note_off( nNote );
 		}else
 		{
 			if ( pSong->get_instrument_list()->size() < nInstrument +1 )
 				return;
-			Note *offnote = new Note( pInstr,
+			Note *offnote = AudioEngine::get_instance()->get_note_pool()->get( pInstr,
 						0.0,
 						0.0,
 						0.0,
@@ -24,6 +24,7 @@
 
 #include <hydrogen/fx/Effects.h>
 #include <hydrogen/sampler/Sampler.h>
+#include <hydrogen/Preferences.h>
 
 #include <hydrogen/hydrogen.h>	// TODO: remove this line as soon as possible
 #include <cassert>
@@ -47,12 +48,15 @@ AudioEngine::AudioEngine()
 		: Object( __class_name )
 		, __sampler( NULL )
 		, __synth( NULL )
+		, __note_pool( NULL )
 {
 	__instance = this;
 	INFOLOG( "INIT" );
 
 	pthread_mutex_init( &__engine_mutex, NULL );
 
+	// the playing notes plus the notes queued within the lookahead
+	__note_pool = new NotePool( Preferences::get_instance()->m_nMaxNotes + NOTE_POOL_LOOKAHEAD );
 	__sampler = new Sampler;
 	__synth = new Synth;
 
@@ -74,6 +78,7 @@ AudioEngine::~AudioEngine()
 //	delete Sequencer::get_instance();
 	delete __sampler;
 	delete __synth;
+	delete __note_pool;
 }
 
 
@@ -93,6 +98,14 @@ Synth* AudioEngine::get_synth()
 	return __synth;
 }
 
+
+
+NotePool* AudioEngine::get_note_pool()
+{
+	assert(__note_pool);
+	return __note_pool;
+}
+
 void AudioEngine::lock( const char* file, unsigned int line, const char* function )
 {
 	pthread_mutex_lock( &__engine_mutex );
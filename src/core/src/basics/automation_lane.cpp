@@ -0,0 +1,156 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/basics/automation_lane.h>
+
+#include <hydrogen/basics/instrument_list.h>
+
+namespace H2Core
+{
+
+const char* AutomationLane::__class_name = "AutomationLane";
+
+/* names of the parameters, indexed by Instrument::Parameter */
+static const char* __parameter_names[] = { "volume", "gain", "pan_L", "pan_R", "filterCutoff", "filterResonance" };
+
+AutomationLane::AutomationLane( int instrument_id, Instrument::Parameter parameter )
+    : Object( __class_name ),
+      __instrument_id( instrument_id ),
+      __parameter( parameter ),
+      __cursor( 0 ),
+      __processed( false ),
+      __last_value( 0.0 )
+{
+}
+
+AutomationLane::~AutomationLane()
+{
+}
+
+void AutomationLane::add_point( int tick, float value )
+{
+    int idx = __find( tick );
+    if ( idx >= 0 && __points[idx].tick == tick ) {
+        __points[idx].value = value;
+    } else {
+        Point point;
+        point.tick = tick;
+        point.value = value;
+        __points.insert( __points.begin() + ( idx + 1 ), point );
+    }
+    __cursor = 0;
+    __processed = false;
+}
+
+void AutomationLane::remove_point( int idx )
+{
+    assert( idx >= 0 && idx < ( int )__points.size() );
+    __points.erase( __points.begin() + idx );
+    __cursor = 0;
+    __processed = false;
+}
+
+void AutomationLane::clear()
+{
+    __points.clear();
+    __cursor = 0;
+    __processed = false;
+}
+
+int AutomationLane::__find( double tick ) const
+{
+    // binary search of the last point at or before tick
+    int lo = 0;
+    int hi = __points.size();
+    while ( lo < hi ) {
+        int mid = ( lo + hi ) / 2;
+        if ( __points[mid].tick <= tick ) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo - 1;
+}
+
+float AutomationLane::__interpolate( int idx, double tick ) const
+{
+    if ( idx < 0 ) return __points[0].value;
+    if ( idx + 1 >= ( int )__points.size() ) return __points[idx].value;
+    const Point& a = __points[idx];
+    const Point& b = __points[idx + 1];
+    return a.value + ( b.value - a.value ) * ( float )( ( tick - a.tick ) / ( b.tick - a.tick ) );
+}
+
+float AutomationLane::get_value( double tick ) const
+{
+    assert( !__points.empty() );
+    return __interpolate( __find( tick ), tick );
+}
+
+float AutomationLane::evaluate( double tick )
+{
+    assert( !__points.empty() );
+    int n = __points.size();
+    if ( __cursor >= n || ( __cursor > 0 && __points[__cursor].tick > tick ) ) {
+        // the song position jumped back
+        __cursor = __find( tick );
+        if ( __cursor < 0 ) __cursor = 0;
+    }
+    while ( __cursor + 1 < n && __points[__cursor + 1].tick <= tick ) {
+        __cursor++;
+    }
+    if ( __points[__cursor].tick > tick ) {
+        return __points[0].value;   // before the first point
+    }
+    return __interpolate( __cursor, tick );
+}
+
+void AutomationLane::process( double tick, InstrumentList* instruments )
+{
+    if ( __points.empty() ) return;
+    float value = evaluate( tick );
+    if ( __processed && value == __last_value ) return;
+    Instrument* instrument = instruments->find( __instrument_id );
+    if ( instrument == 0 ) return;
+    instrument->get_parameter( __parameter )->set_target( value );
+    __last_value = value;
+    __processed = true;
+}
+
+QString AutomationLane::get_parameter_name( Instrument::Parameter parameter )
+{
+    if ( parameter < 0 || parameter >= Instrument::PARAMETER_COUNT ) return QString();
+    return __parameter_names[parameter];
+}
+
+Instrument::Parameter AutomationLane::get_parameter_from_name( const QString& name )
+{
+    for ( int i = 0; i < Instrument::PARAMETER_COUNT; i++ ) {
+        if ( name == __parameter_names[i] ) return ( Instrument::Parameter )i;
+    }
+    return Instrument::PARAMETER_COUNT;
+}
+
+};
+
+/* vim: set softtabstop=4 expandtab: */
@@ -31,6 +31,7 @@
 
 #include <hydrogen/basics/adsr.h>
 #include <hydrogen/basics/sample.h>
+#include <hydrogen/basics/sample_loader.h>
 #include <hydrogen/basics/drumkit.h>
 #include <hydrogen/basics/instrument_list.h>
 #include <hydrogen/basics/instrument_layer.h>
@@ -52,8 +53,9 @@ Instrument::Instrument( const int id, const QString& name, ADSR* adsr )
     , __peak_r( 0.0 )
     , __adsr( adsr )
     , __filter_active( false )
-    , __filter_cutoff( 1.0 )
-    , __filter_resonance( 0.0 )
+    , __filter_cutoff( 1.0, SmoothedValue::EXPONENTIAL )
+    , __filter_resonance( 0.0, SmoothedValue::EXPONENTIAL )
+    , __parameters_frame( -1 )
     , __random_pitch_factor( 0.0 )
     , __midi_out_note( MIDI_MIDDLE_C )
     , __midi_out_channel( -1 )
@@ -74,15 +76,16 @@ Instrument::Instrument( Instrument* other )
     , __id( other->get_id() )
     , __name( other->get_name() )
     , __gain( other->__gain )
-    , __volume( other->get_volume() )
-    , __pan_l( other->get_pan_l() )
-    , __pan_r( other->get_pan_r() )
+    , __volume( other->__volume )
+    , __pan_l( other->__pan_l )
+    , __pan_r( other->__pan_r )
     , __peak_l( other->get_peak_l() )
     , __peak_r( other->get_peak_r() )
     , __adsr( new ADSR( *( other->get_adsr() ) ) )
     , __filter_active( other->is_filter_active() )
-    , __filter_cutoff( other->get_filter_cutoff() )
-    , __filter_resonance( other->get_filter_resonance() )
+    , __filter_cutoff( other->__filter_cutoff )
+    , __filter_resonance( other->__filter_resonance )
+    , __parameters_frame( -1 )
     , __random_pitch_factor( other->get_random_pitch_factor() )
     , __midi_out_note( other->get_midi_out_note() )
     , __midi_out_channel( other->get_midi_out_channel() )
@@ -123,55 +126,89 @@ Instrument* Instrument::load_instrument( const QString& drumkit_name, const QStr
 }
 
 void Instrument::load_from( Drumkit* drumkit, Instrument* instrument, bool is_live )
+{
+    SampleLoader::create_instance();
+    SampleLoader* loader = SampleLoader::get_instance();
+    int jobs[ MAX_LAYERS ];
+    queue_samples( loader, drumkit, instrument, jobs );
+    load_from( drumkit, instrument, loader, jobs, is_live );
+}
+
+void Instrument::queue_samples( SampleLoader* loader, Drumkit* drumkit, Instrument* instrument, int jobs[] )
 {
     for ( int i=0; i<MAX_LAYERS; i++ ) {
         InstrumentLayer* src_layer = instrument->get_layer( i );
-        InstrumentLayer* my_layer = this->get_layer( i );
         if( src_layer==0 ) {
-            if ( is_live )
-                AudioEngine::get_instance()->lock( RIGHT_HERE );
-            this->set_layer( NULL, i );
-            if ( is_live )
-                AudioEngine::get_instance()->unlock();
+            jobs[i] = -1;
         } else {
-            QString sample_path =  drumkit->get_path() + "/" + src_layer->get_sample()->get_filename();
-            Sample* sample = Sample::load( sample_path );
-            if ( sample==0 ) {
-                _ERRORLOG( QString( "Error loading sample %1. Creating a new empty layer." ).arg( sample_path ) );
-                if ( is_live )
-                    AudioEngine::get_instance()->lock( RIGHT_HERE );
-                this->set_layer( NULL, i );
-                if ( is_live )
-                    AudioEngine::get_instance()->unlock();
-            } else {
-                if ( is_live )
-                    AudioEngine::get_instance()->lock( RIGHT_HERE );
-                this->set_layer( new InstrumentLayer( src_layer, sample ), i );
-                if ( is_live )
-                    AudioEngine::get_instance()->unlock();
-            }
+            jobs[i] = loader->add( drumkit->get_path() + "/" + src_layer->get_sample()->get_filename() );
         }
-        delete my_layer;
     }
+}
+
+void Instrument::load_from( Drumkit* drumkit, Instrument* instrument, SampleLoader* loader, const int jobs[], bool is_live )
+{
+    // build the new layers while the old ones are still played
+    Instrument* staged = stage( drumkit, instrument, loader, jobs );
     if ( is_live )
         AudioEngine::get_instance()->lock( RIGHT_HERE );
-
-    this->set_id( instrument->get_id() );
-    this->set_name( instrument->get_name() );
-    this->set_drumkit_name( drumkit->get_name() );
-    this->set_gain( instrument->get_gain() );
-    this->set_volume( instrument->get_volume() );
-    this->set_pan_l( instrument->get_pan_l() );
-    this->set_pan_r( instrument->get_pan_r() );
-    this->set_adsr( new ADSR( *( instrument->get_adsr() ) ) );
-    this->set_filter_active( instrument->is_filter_active() );
-    this->set_filter_cutoff( instrument->get_filter_cutoff() );
-    this->set_filter_resonance( instrument->get_filter_resonance() );
-    this->set_random_pitch_factor( instrument->get_random_pitch_factor() );
-    this->set_muted( instrument->is_muted() );
-    this->set_mute_group( instrument->get_mute_group() );
+    take_from( staged );
     if ( is_live )
         AudioEngine::get_instance()->unlock();
+    // the old layers are not reachable anymore
+    delete staged;
+}
+
+Instrument* Instrument::stage( Drumkit* drumkit, Instrument* instrument, SampleLoader* loader, const int jobs[] )
+{
+    Instrument* staged = new Instrument( instrument->get_id(), instrument->get_name(), new ADSR( *( instrument->get_adsr() ) ) );
+    for ( int i=0; i<MAX_LAYERS; i++ ) {
+        InstrumentLayer* src_layer = instrument->get_layer( i );
+        if( src_layer==0 || jobs[i]==-1 ) continue;
+        Sample* sample = loader->take( jobs[i] );
+        if ( sample==0 ) {
+            _ERRORLOG( QString( "Error loading sample %1. Creating a new empty layer." ).arg( drumkit->get_path() + "/" + src_layer->get_sample()->get_filename() ) );
+        } else {
+            staged->set_layer( new InstrumentLayer( src_layer, sample ), i );
+        }
+    }
+    staged->set_drumkit_name( drumkit->get_name() );
+    staged->set_gain( instrument->get_gain() );
+    staged->set_volume( instrument->get_volume() );
+    staged->set_pan_l( instrument->get_pan_l() );
+    staged->set_pan_r( instrument->get_pan_r() );
+    staged->set_filter_active( instrument->is_filter_active() );
+    staged->set_filter_cutoff( instrument->get_filter_cutoff() );
+    staged->set_filter_resonance( instrument->get_filter_resonance() );
+    staged->set_random_pitch_factor( instrument->get_random_pitch_factor() );
+    staged->set_muted( instrument->is_muted() );
+    staged->set_mute_group( instrument->get_mute_group() );
+    return staged;
+}
+
+void Instrument::take_from( Instrument* staged )
+{
+    for ( int i=0; i<MAX_LAYERS; i++ ) {
+        InstrumentLayer* my_layer = __layers[i];
+        __layers[i] = staged->__layers[i];
+        staged->__layers[i] = my_layer;
+    }
+    ADSR* my_adsr = __adsr;
+    __adsr = staged->__adsr;
+    staged->__adsr = my_adsr;
+    this->set_id( staged->get_id() );
+    this->set_name( staged->get_name() );
+    this->set_drumkit_name( staged->get_drumkit_name() );
+    this->set_gain( staged->get_gain() );
+    this->set_volume( staged->get_volume() );
+    this->set_pan_l( staged->get_pan_l() );
+    this->set_pan_r( staged->get_pan_r() );
+    this->set_filter_active( staged->is_filter_active() );
+    this->set_filter_cutoff( staged->get_filter_cutoff() );
+    this->set_filter_resonance( staged->get_filter_resonance() );
+    this->set_random_pitch_factor( staged->get_random_pitch_factor() );
+    this->set_muted( staged->is_muted() );
+    this->set_mute_group( staged->get_mute_group() );
 }
 
 void Instrument::load_from( const QString& drumkit_name, const QString& instrument_name, bool is_live )
@@ -245,20 +282,57 @@ void Instrument::unload_samples()
     }
 }
 
+SmoothedValue* Instrument::get_parameter( Parameter parameter )
+{
+    switch( parameter ) {
+    case VOLUME:
+        return &__volume;
+    case GAIN:
+        return &__gain;
+    case PAN_L:
+        return &__pan_l;
+    case PAN_R:
+        return &__pan_r;
+    case FILTER_CUTOFF:
+        return &__filter_cutoff;
+    case FILTER_RESONANCE:
+        return &__filter_resonance;
+    default:
+        return 0;
+    }
+}
+
+void Instrument::update_parameters( long long frame, int length )
+{
+    if ( __parameters_frame == frame ) return;
+    // the parameters keep moving while no note plays the instrument
+    int elapsed = ( __parameters_frame < 0 || frame - __parameters_frame > ( 1 << 30 ) ) ? ( 1 << 30 ) : ( int )( frame - __parameters_frame );
+    __parameters_frame = frame;
+    for ( int i = 0; i < PARAMETER_COUNT; i++ ) {
+        SmoothedValue* parameter = get_parameter( ( Parameter )i );
+        if ( elapsed >= length ) {
+            // idle long enough to have reached its target
+            parameter->reset( parameter->get_target() );
+        } else {
+            parameter->update( elapsed, length );
+        }
+    }
+}
+
 void Instrument::save_to( XMLNode* node )
 {
     XMLNode instrument_node = node->ownerDocument().createElement( "instrument" );
     instrument_node.write_int( "id", __id );
     instrument_node.write_string( "name", __name );
-    instrument_node.write_float( "volume", __volume );
+    instrument_node.write_float( "volume", __volume.get_target() );
     instrument_node.write_bool( "isMuted", __muted );
-    instrument_node.write_float( "pan_L", __pan_l );
-    instrument_node.write_float( "pan_R", __pan_r );
+    instrument_node.write_float( "pan_L", __pan_l.get_target() );
+    instrument_node.write_float( "pan_R", __pan_r.get_target() );
     instrument_node.write_float( "randomPitchFactor", __random_pitch_factor );
-    instrument_node.write_float( "gain", __gain );
+    instrument_node.write_float( "gain", __gain.get_target() );
     instrument_node.write_bool( "filterActive", __filter_active );
-    instrument_node.write_float( "filterCutoff", __filter_cutoff );
-    instrument_node.write_float( "filterResonance", __filter_resonance );
+    instrument_node.write_float( "filterCutoff", __filter_cutoff.get_target() );
+    instrument_node.write_float( "filterResonance", __filter_resonance.get_target() );
     instrument_node.write_float( "Attack", __adsr->get_attack() );
     instrument_node.write_float( "Decay", __adsr->get_decay() );
     instrument_node.write_float( "Sustain", __adsr->get_sustain() );
@@ -35,7 +35,8 @@ InstrumentLayer::InstrumentLayer( Sample* sample ) : Object( __class_name ),
     __end_velocity( 1.0 ),
     __pitch( 0.0 ),
     __gain( 1.0 ),
-    __sample( sample )
+    __sample( sample ),
+    __resampled( 0 )
 {
 }
 
@@ -44,7 +45,8 @@ InstrumentLayer::InstrumentLayer( InstrumentLayer* other ) : Object( __class_nam
     __end_velocity( other->get_end_velocity() ),
     __pitch( other->get_pitch() ),
     __gain( other->get_gain() ),
-    __sample( new Sample( other->get_sample() ) )
+    __sample( new Sample( other->get_sample() ) ),
+    __resampled( 0 )
 {
 }
 
@@ -53,7 +55,8 @@ InstrumentLayer::InstrumentLayer( InstrumentLayer* other, Sample* sample ) : Obj
     __end_velocity( other->get_end_velocity() ),
     __pitch( other->get_pitch() ),
     __gain( other->get_gain() ),
-    __sample( sample )
+    __sample( sample ),
+    __resampled( 0 )
 {
 }
 
@@ -61,6 +64,16 @@ InstrumentLayer::~InstrumentLayer()
 {
     delete __sample;
     __sample = 0;
+    delete __resampled;
+    __resampled = 0;
+}
+
+void InstrumentLayer::set_sample( Sample* sample )
+{
+    // the converted copy belongs to the previous sample
+    delete __resampled;
+    __resampled = 0;
+    __sample = sample;
 }
 
 void InstrumentLayer::load_sample()
@@ -71,6 +84,8 @@ void InstrumentLayer::load_sample()
 void InstrumentLayer::unload_sample()
 {
     if( __sample ) __sample->unload();
+    delete __resampled;
+    __resampled = 0;
 }
 
 InstrumentLayer* InstrumentLayer::load_from( XMLNode* node, const QString& dk_path )
@@ -24,6 +24,8 @@
 
 #include <hydrogen/helpers/xml.h>
 #include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_layer.h>
+#include <hydrogen/basics/sample_loader.h>
 
 namespace H2Core
 {
@@ -51,9 +53,17 @@ InstrumentList::~InstrumentList()
 
 void InstrumentList::load_samples()
 {
+    // the layers of every instrument are decoded concurrently
+    SampleLoader::create_instance();
+    SampleLoader* loader = SampleLoader::get_instance();
+    std::vector<int> jobs;
     for( int i=0; i<__instruments.size(); i++ ) {
-        __instruments[i]->load_samples();
+        for ( int j=0; j<MAX_LAYERS; j++ ) {
+            InstrumentLayer* layer = __instruments[i]->get_layer( j );
+            if( layer && layer->get_sample() ) jobs.push_back( loader->add( layer->get_sample() ) );
+        }
     }
+    for( unsigned i=0; i<jobs.size(); i++ ) loader->take( jobs[i] );
 }
 
 void InstrumentList::unload_samples()
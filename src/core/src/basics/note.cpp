@@ -26,7 +26,6 @@
 
 #include <hydrogen/helpers/xml.h>
 
-#include <hydrogen/basics/adsr.h>
 #include <hydrogen/basics/instrument.h>
 #include <hydrogen/basics/instrument_list.h>
 
@@ -48,12 +47,13 @@ Note::Note( Instrument* instrument, int position, float velocity, float pan_l, f
       __pitch( pitch ),
       __key( C ),
       __octave( P8 ),
-      __adsr( 0 ),
+      __adsr(),
       __lead_lag( 0.0 ),
       __cut_off( 1.0 ),
       __resonance( 0.0 ),
       __humanize_delay( 0 ),
       __sample_position( 0.0 ),
+      __stream( -1 ),
       __bpfb_l( 0.0 ),
       __bpfb_r( 0.0 ),
       __lpfb_l( 0.0 ),
@@ -64,7 +64,7 @@ Note::Note( Instrument* instrument, int position, float velocity, float pan_l, f
       __just_recorded( false )
 {
     if ( __instrument != 0 ) {
-        __adsr = __instrument->copy_adsr();
+        __adsr = ADSR( __instrument->get_adsr() );
         __instrument_id = __instrument->get_id();
     }
 }
@@ -81,12 +81,13 @@ Note::Note( Note* other, Instrument* instrument )
       __pitch( other->get_pitch() ),
       __key( other->get_key() ),
       __octave( other->get_octave() ),
-      __adsr( 0 ),
+      __adsr(),
       __lead_lag( other->get_lead_lag() ),
       __cut_off( other->get_cut_off() ),
       __resonance( other->get_resonance() ),
       __humanize_delay( other->get_humanize_delay() ),
       __sample_position( other->get_sample_position() ),
+      __stream( -1 ),
       __bpfb_l( other->get_bpfb_l() ),
       __bpfb_r( other->get_bpfb_r() ),
       __lpfb_l( other->get_lpfb_l() ),
@@ -98,15 +99,13 @@ Note::Note( Note* other, Instrument* instrument )
 {
     if ( instrument != 0 ) __instrument = instrument;
     if ( __instrument != 0 ) {
-        __adsr = __instrument->copy_adsr();
+        __adsr = ADSR( __instrument->get_adsr() );
         __instrument_id = __instrument->get_id();
     }
 }
 
 Note::~Note()
 {
-    delete __adsr;
-    __adsr = 0;
 }
 
 static inline float check_boundary( float v, float min, float max )
@@ -0,0 +1,130 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/basics/note_pool.h>
+
+#include <new>
+
+#include <hydrogen/basics/note.h>
+
+// the head of the free list holds a slot index in its low 16 bits and a tag in the upper ones
+#define NOTE_POOL_EMPTY     0xFFFF
+#define NOTE_POOL_MAX       0xFFFE
+
+namespace H2Core
+{
+
+const char* NotePool::__class_name = "NotePool";
+
+NotePool::NotePool( int capacity )
+    : Object( __class_name ),
+      __capacity( capacity ),
+      __notes( 0 ),
+      __next( 0 ),
+      __head( NOTE_POOL_EMPTY ),
+      __in_use( 0 ),
+      __heap_allocations( 0 )
+{
+    if ( __capacity < 0 ) __capacity = 0;
+    if ( __capacity > NOTE_POOL_MAX ) __capacity = NOTE_POOL_MAX;
+    __notes = static_cast<Note*>( ::operator new( __capacity * sizeof( Note ) ) );
+    __next = new int[ __capacity ];
+    for ( int i = __capacity - 1; i >= 0; i-- ) __push( i );
+    INFOLOG( QString( "%1 notes, %2 bytes" ).arg( __capacity ).arg( __capacity * sizeof( Note ) ) );
+}
+
+NotePool::~NotePool()
+{
+    if ( __in_use != 0 ) {
+        ERRORLOG( QString( "%1 notes still in use" ).arg( __in_use ) );
+    }
+    if ( __heap_allocations != 0 ) {
+        WARNINGLOG( QString( "%1 notes had to be allocated from the heap, the pool is too small" ).arg( __heap_allocations ) );
+    }
+    ::operator delete( __notes );
+    delete[] __next;
+}
+
+int NotePool::__pop()
+{
+    while ( true ) {
+        int head = __head;
+        int idx = head & 0xFFFF;
+        if ( idx == NOTE_POOL_EMPTY ) return -1;
+        // __next[ idx ] may be stale if idx was popped meanwhile, the tag makes the swap fail then
+        int tag = ( ( ( unsigned )head >> 16 ) + 1 ) & 0x7FFF;
+        if ( __head.testAndSetOrdered( head, ( tag << 16 ) | __next[ idx ] ) ) return idx;
+    }
+}
+
+void NotePool::__push( int idx )
+{
+    while ( true ) {
+        int head = __head;
+        __next[ idx ] = head & 0xFFFF;
+        int tag = ( ( ( unsigned )head >> 16 ) + 1 ) & 0x7FFF;
+        if ( __head.testAndSetOrdered( head, ( tag << 16 ) | idx ) ) return;
+    }
+}
+
+bool NotePool::__owns( Note* note ) const
+{
+    return ( note >= __notes ) && ( note < __notes + __capacity );
+}
+
+Note* NotePool::get( Instrument* instrument, int position, float velocity, float pan_l, float pan_r, int length, float pitch )
+{
+    int idx = __pop();
+    if ( idx == -1 ) {
+        __heap_allocations.fetchAndAddRelaxed( 1 );
+        return new Note( instrument, position, velocity, pan_l, pan_r, length, pitch );
+    }
+    __in_use.fetchAndAddRelaxed( 1 );
+    return new ( __notes + idx ) Note( instrument, position, velocity, pan_l, pan_r, length, pitch );
+}
+
+Note* NotePool::copy( Note* other, Instrument* instrument )
+{
+    int idx = __pop();
+    if ( idx == -1 ) {
+        __heap_allocations.fetchAndAddRelaxed( 1 );
+        return new Note( other, instrument );
+    }
+    __in_use.fetchAndAddRelaxed( 1 );
+    return new ( __notes + idx ) Note( other, instrument );
+}
+
+void NotePool::release( Note* note )
+{
+    if ( note == 0 ) return;
+    if ( !__owns( note ) ) {
+        delete note;
+        return;
+    }
+    note->~Note();
+    __in_use.fetchAndAddRelaxed( -1 );
+    __push( note - __notes );
+}
+
+};
+
+/* vim: set softtabstop=4 expandtab: */
@@ -0,0 +1,221 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/basics/note_queue.h>
+
+#define BUCKET_FRAMES   ( ( long long )1 << NOTE_QUEUE_BUCKET_SHIFT )
+#define WHEEL_FRAMES    ( ( long long )NOTE_QUEUE_BUCKETS << NOTE_QUEUE_BUCKET_SHIFT )
+#define BUCKET_MASK     ( NOTE_QUEUE_BUCKETS - 1 )
+
+namespace H2Core
+{
+
+/** first frame of the bucket holding frame */
+static inline long long bucket_start( long long frame )
+{
+    return ( frame >> NOTE_QUEUE_BUCKET_SHIFT ) << NOTE_QUEUE_BUCKET_SHIFT;
+}
+
+NoteQueue::NoteQueue()
+    : __free( -1 ),
+      __cursor( 0 ),
+      __wheel_size( 0 ),
+      __size( 0 )
+{
+    for ( int i = 0; i < NOTE_QUEUE_BUCKETS; i++ ) {
+        __buckets[i].head = -1;
+        __buckets[i].tail = -1;
+    }
+    __overflow.head = -1;
+    __overflow.tail = -1;
+}
+
+void NoteQueue::reserve( int count )
+{
+    int n = __nodes.size();
+    if ( count <= n ) return;
+    __nodes.resize( count );
+    for ( int i = count - 1; i >= n; i-- ) {
+        __nodes[i].next = __free;
+        __free = i;
+    }
+}
+
+int NoteQueue::__alloc_node()
+{
+    if ( __free == -1 ) reserve( __nodes.empty() ? 64 : 2 * __nodes.size() );
+    int idx = __free;
+    __free = __nodes[ idx ].next;
+    return idx;
+}
+
+void NoteQueue::__insert( int idx )
+{
+    Node* node = &__nodes[ idx ];
+    node->next = -1;
+    List* list;
+    if ( node->start >= __cursor + WHEEL_FRAMES ) {
+        list = &__overflow;
+    } else {
+        // late notes go to the current bucket, they are played right away
+        long long frame = ( node->start < __cursor ? __cursor : node->start );
+        list = &__buckets[ ( frame >> NOTE_QUEUE_BUCKET_SHIFT ) & BUCKET_MASK ];
+        __wheel_size++;
+    }
+    if ( list->tail == -1 ) {
+        list->head = idx;
+        list->tail = idx;
+    } else if ( list == &__overflow || __nodes[ list->tail ].start <= node->start ) {
+        // the usual case, notes are mostly pushed in order
+        __nodes[ list->tail ].next = idx;
+        list->tail = idx;
+    } else {
+        // keep the bucket sorted by start frame, after the notes starting at the same frame
+        int prev = -1;
+        int next = list->head;
+        while ( __nodes[ next ].start <= node->start ) {
+            prev = next;
+            next = __nodes[ next ].next;
+        }
+        node->next = next;
+        if ( prev == -1 ) {
+            list->head = idx;
+        } else {
+            __nodes[ prev ].next = idx;
+        }
+    }
+}
+
+void NoteQueue::__unlink( List* list, int prev, int idx )
+{
+    int next = __nodes[ idx ].next;
+    if ( prev == -1 ) {
+        list->head = next;
+    } else {
+        __nodes[ prev ].next = next;
+    }
+    if ( list->tail == idx ) list->tail = prev;
+}
+
+Note* NoteQueue::__take( List* list, int prev, int idx )
+{
+    __unlink( list, prev, idx );
+    if ( list != &__overflow ) __wheel_size--;
+    __size--;
+    __nodes[ idx ].next = __free;
+    __free = idx;
+    return __nodes[ idx ].note;
+}
+
+void NoteQueue::__migrate_overflow()
+{
+    int prev = -1;
+    int idx = __overflow.head;
+    while ( idx != -1 ) {
+        int next = __nodes[ idx ].next;
+        if ( __nodes[ idx ].start < __cursor + WHEEL_FRAMES ) {
+            __unlink( &__overflow, prev, idx );
+            __insert( idx );
+        } else {
+            prev = idx;
+        }
+        idx = next;
+    }
+}
+
+void NoteQueue::push( Note* note, long long start )
+{
+    int idx = __alloc_node();
+    __nodes[ idx ].note = note;
+    __nodes[ idx ].start = start;
+    __insert( idx );
+    __size++;
+}
+
+Note* NoteQueue::pop( long long end )
+{
+    if ( __size == 0 ) {
+        // nothing to keep in order, follow the caller
+        __cursor = bucket_start( end );
+        return 0;
+    }
+    while ( true ) {
+        List* bucket = &__buckets[ ( __cursor >> NOTE_QUEUE_BUCKET_SHIFT ) & BUCKET_MASK ];
+        if ( bucket->head != -1 && __nodes[ bucket->head ].start < end ) return __take( bucket, -1, bucket->head );
+        // the notes left in the current bucket start at end or later
+        if ( __cursor + BUCKET_FRAMES > end ) return 0;
+        if ( __wheel_size == 0 ) {
+            // skip the empty buckets, up to end or to the first overflow note
+            long long target = bucket_start( end );
+            for ( int idx = __overflow.head; idx != -1; idx = __nodes[ idx ].next ) {
+                long long start = bucket_start( __nodes[ idx ].start );
+                if ( start < target ) target = start;
+            }
+            __cursor = target;
+        } else {
+            __cursor += BUCKET_FRAMES;
+        }
+        if ( __overflow.head != -1 ) __migrate_overflow();
+    }
+}
+
+Note* NoteQueue::pop_any()
+{
+    if ( __size == 0 ) return 0;
+    if ( __overflow.head != -1 ) return __take( &__overflow, -1, __overflow.head );
+    // moving over empty buckets never changes which notes pop( end ) returns
+    while ( true ) {
+        List* bucket = &__buckets[ ( __cursor >> NOTE_QUEUE_BUCKET_SHIFT ) & BUCKET_MASK ];
+        if ( bucket->head != -1 ) return __take( bucket, -1, bucket->head );
+        __cursor += BUCKET_FRAMES;
+    }
+}
+
+void NoteQueue::reschedule( long long ( *start_frame )( Note* ) )
+{
+    // chain every node, then insert them again
+    int head = -1;
+    int tail = -1;
+    for ( int i = -1; i < NOTE_QUEUE_BUCKETS; i++ ) {
+        List* list = ( i == -1 ? &__overflow : &__buckets[i] );
+        if ( list->head == -1 ) continue;
+        if ( tail == -1 ) {
+            head = list->head;
+        } else {
+            __nodes[ tail ].next = list->head;
+        }
+        tail = list->tail;
+        list->head = -1;
+        list->tail = -1;
+    }
+    __wheel_size = 0;
+    while ( head != -1 ) {
+        int next = __nodes[ head ].next;
+        __nodes[ head ].start = start_frame( __nodes[ head ].note );
+        __insert( head );
+        head = next;
+    }
+}
+
+};
+
+/* vim: set softtabstop=4 expandtab: */
@@ -23,6 +23,11 @@
 #include <hydrogen/basics/pattern.h>
 
 #include <cassert>
+#include <set>
+#include <pthread.h>
+
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
 
 #include <hydrogen/basics/note.h>
 #include <hydrogen/basics/pattern_list.h>
@@ -37,11 +42,17 @@ namespace H2Core
 
 const char* Pattern::__class_name = "Pattern";
 
+/** serializes the creation of the pending notes, it may be asked by the gui, the midi and the background threads at once */
+static QMutex pending_mutex;
+/** the patterns having pending notes, protected by pending_mutex */
+static std::set<const Pattern*> pending_patterns;
+
 Pattern::Pattern( const QString& name, const QString& category, int length )
     : Object( __class_name )
     , __length( length )
     , __name( name )
     , __category( category )
+    , __pending( 0 )
 {
 }
 
@@ -50,6 +61,7 @@ Pattern::Pattern( Pattern* other )
     , __length( other->get_length() )
     , __name( other->get_name() )
     , __category( other->get_category() )
+    , __pending( 0 )
 {
     FOREACH_NOTE_CST_IT_BEGIN_END( other->get_notes(),it ) {
         __notes.insert( std::make_pair( it->first, new Note( it->second ) ) );
@@ -58,6 +70,10 @@ Pattern::Pattern( Pattern* other )
 
 Pattern::~Pattern()
 {
+    pending_mutex.lock();
+    pending_patterns.erase( this );
+    pending_mutex.unlock();
+    delete ( std::vector<PendingNote>* )__pending;
     for( notes_cst_it_t it=__notes.begin(); it!=__notes.end(); it++ ) {
         delete it->second;
     }
@@ -121,6 +137,7 @@ bool Pattern::save_file( const QString& pattern_path, bool overwrite )
 
 void Pattern::save_to( XMLNode* node )
 {
+    __load_pending();
     // TODO drumkit_name !!!!!!
     node->write_string( "drumkit_name", "TODO" );
     XMLNode pattern_node =  node->ownerDocument().createElement( "pattern" );
@@ -142,6 +159,7 @@ void Pattern::save_to( XMLNode* node )
 
 Note* Pattern::find_note( int idx_a, int idx_b, Instrument* instrument, Note::Key key, Note::Octave octave, bool strict )
 {
+    __load_pending();
     for( notes_cst_it_t it=__notes.lower_bound( idx_a ); it!=__notes.upper_bound( idx_a ); it++ ) {
         Note* note = it->second;
         assert( note );
@@ -167,6 +185,7 @@ Note* Pattern::find_note( int idx_a, int idx_b, Instrument* instrument, Note::Ke
 
 Note* Pattern::find_note( int idx_a, int idx_b, Instrument* instrument, bool strict )
 {
+    __load_pending();
     notes_cst_it_t it;
     for( it=__notes.lower_bound( idx_a ); it!=__notes.upper_bound( idx_a ); it++ ) {
         Note* note = it->second;
@@ -193,6 +212,7 @@ Note* Pattern::find_note( int idx_a, int idx_b, Instrument* instrument, bool str
 
 void Pattern::remove_note( Note* note )
 {
+    __load_pending();
     for( notes_it_t it=__notes.begin(); it!=__notes.end(); ++it ) {
         if( it->second==note ) {
             __notes.erase( it );
@@ -203,6 +223,7 @@ void Pattern::remove_note( Note* note )
 
 bool Pattern::references( Instrument* instr )
 {
+    __load_pending();
     for( notes_cst_it_t it=__notes.begin(); it!=__notes.end(); it++ ) {
         Note* note = it->second;
         assert( note );
@@ -215,6 +236,7 @@ bool Pattern::references( Instrument* instr )
 
 void Pattern::purge_instrument( Instrument* instr )
 {
+    __load_pending();
     bool locked = false;
     std::list< Note* > slate;
     for( notes_it_t it=__notes.begin(); it!=__notes.end(); it++ ) {
@@ -240,6 +262,7 @@ void Pattern::purge_instrument( Instrument* instr )
 
 void Pattern::set_to_old()
 {
+    __load_pending();
     for( notes_cst_it_t it=__notes.begin(); it!=__notes.end(); it++ ) {
         Note* note = it->second;
         assert( note );
@@ -247,6 +270,68 @@ void Pattern::set_to_old()
     }
 }
 
+void Pattern::set_pending_notes( std::vector<PendingNote>* notes )
+{
+    QMutexLocker lock( &pending_mutex );
+    delete __pending.fetchAndStoreOrdered( notes );
+    if ( notes ) {
+        pending_patterns.insert( this );
+    } else {
+        pending_patterns.erase( this );
+    }
+}
+
+void Pattern::create_pending_notes()
+{
+    while ( true ) {
+        // a pattern is not deleted while the mutex is held
+        QMutexLocker lock( &pending_mutex );
+        if ( pending_patterns.empty() ) return;
+        ( *pending_patterns.begin() )->__create_pending_locked();
+    }
+}
+
+static void* pattern_createPendingNotes( void* )
+{
+    Pattern::create_pending_notes();
+    return 0;
+}
+
+void Pattern::create_pending_notes_in_background()
+{
+    pthread_t thread;
+    if ( pthread_create( &thread, 0, pattern_createPendingNotes, 0 ) ) {
+        ERRORLOG( "unable to start the thread creating the pattern notes, they are created on first access" );
+        return;
+    }
+    pthread_detach( thread );
+}
+
+void Pattern::__create_pending() const
+{
+    QMutexLocker lock( &pending_mutex );
+    __create_pending_locked();
+}
+
+void Pattern::__create_pending_locked() const
+{
+    std::vector<PendingNote>* pending = __pending;
+    // created meanwhile by another thread
+    if ( pending == 0 ) return;
+    pending_patterns.erase( this );
+    for ( unsigned i = 0; i < pending->size(); i++ ) {
+        const PendingNote& p = ( *pending )[i];
+        Note* note = new Note( p.instrument, p.position, p.velocity, p.pan_l, p.pan_r, p.length, p.pitch );
+        note->set_key_octave( p.key, p.octave );
+        note->set_lead_lag( p.lead_lag );
+        note->set_note_off( p.note_off );
+        __notes.insert( std::make_pair( p.position, note ) );
+    }
+    // release, publishes __notes before the threads stop waiting for it
+    __pending.fetchAndStoreRelease( 0 );
+    delete pending;
+}
+
 void Pattern::flattened_virtual_patterns_compute()
 {
     // __flattened_virtual_patterns must have been cleared before
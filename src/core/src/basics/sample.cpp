@@ -23,26 +23,43 @@
 #include <hydrogen/basics/sample.h>
 
 #include <limits>
+#include <algorithm>
+#include <unistd.h>
+
+#include <QtCore/QAtomicInt>
 
 #include <hydrogen/hydrogen.h>
 #include <hydrogen/Preferences.h>
 #include <hydrogen/helpers/filesystem.h>
+#include <hydrogen/sampler/sampler_kernels.h>
 #ifdef H2CORE_HAVE_RUBBERBAND
 #include <rubberband/RubberBandStretcher.h>
 #define RUBBERBAND_BUFFER_OVERSIZE  500
 #define RUBBERBAND_DEBUG            0
+#define RUBBERBAND_BLOCK_SIZE       1024
 #endif
+#define RESAMPLE_ZEROS              16  // zero crossings of the resampling sinc on each side
+#define RESAMPLE_PHASES             512 // values of the sinc table per zero crossing
+#define RESAMPLE_BETA               9.0 // Kaiser window shape, about 90dB of stop band attenuation
 
 namespace H2Core
 {
 
 const char* Sample::__class_name = "Sample";
 const char* Sample::__loop_modes[] = { "forward", "reverse", "pingpong" };
+int Sample::__stream_threshold = 0;
+Sample::Format Sample::__storage_format = Sample::FLOAT;
+static QAtomicInt rubberband_runs( 0 );    // numbers the temporary files of exec_rubberband_cli()
+static QAtomicInt sample_serials( 0 );     // numbers the samples created
 
 #ifdef H2CORE_HAVE_RUBBERBAND
 static double compute_pitch_scale( const Sample::Rubberband& r );
 static RubberBand::RubberBandStretcher::Options compute_rubberband_options( const Sample::Rubberband& r );
 #endif
+static void* alloc_channel( Sample::Format format, int frames );
+static void* pack_channel( const float* data, int frames, Sample::Format format );
+static void sinc_table( std::vector<float>& table );
+static void sinc_resample( const float* in, int in_frames, float* out, int out_frames, double step, const std::vector<float>& table );
 
 Sample::Sample( const QString& filepath,  int frames, int sample_rate, float* data_l, float* data_r ) : Object( __class_name ),
     __filepath( filepath ),
@@ -50,7 +67,11 @@ Sample::Sample( const QString& filepath,  int frames, int sample_rate, float* da
     __sample_rate( sample_rate ),
     __data_l( data_l ),
     __data_r( data_r ),
-    __is_modified( false )
+    __format( FLOAT ),
+    __is_modified( false ),
+    __shared( 0 ),
+    __stream_frames( 0 ),
+    __serial( sample_serials.fetchAndAddRelaxed( 1 ) )
 {
     /*
     if( !(filepath.lastIndexOf( "/" ) >0) ) {
@@ -68,14 +89,29 @@ Sample::Sample( Sample* other ): Object( __class_name ),
     __sample_rate( other->get_sample_rate() ),
     __data_l( 0 ),
     __data_r( 0 ),
+    __format( other->__format ),
     __is_modified( other->get_is_modified() ),
     __loops( other->__loops ),
-    __rubberband( other->__rubberband )
+    __rubberband( other->__rubberband ),
+    __shared( 0 ),
+    __stream_frames( other->__stream_frames ),
+    __serial( sample_serials.fetchAndAddRelaxed( 1 ) )
 {
-    __data_l = new float[__frames];
-    __data_r = new float[__frames];
-    memcpy( __data_l, other->get_data_l(), __frames );
-    memcpy( __data_r, other->get_data_r(), __frames );
+    if( other->__shared ) {
+        // the data is never modified in place, share it
+        SampleCache::get_instance()->acquire( other->__shared );
+        __share( other->__shared );
+    } else if( other->__data_l ) {
+        int bytes = __frames * format_size( __format );
+        __data_l = alloc_channel( __format, __frames );
+        memcpy( __data_l, other->__data_l, bytes );
+        if( other->is_mono() ) {
+            __data_r = __data_l;
+        } else {
+            __data_r = alloc_channel( __format, __frames );
+            memcpy( __data_r, other->__data_r, bytes );
+        }
+    }
     EnvelopePoint pt;
     PanEnvelope* pan = other->get_pan_envelope();
     for( int i=0; i<pan->size(); i++ ) __pan_envelope.push_back( pan->at( i ) );
@@ -86,8 +122,7 @@ Sample::Sample( Sample* other ): Object( __class_name ),
 
 Sample::~Sample()
 {
-    if( __data_l!=0 ) delete[] __data_l;
-    if( __data_r!=0 ) delete[] __data_r;
+    unload();
 }
 
 Sample* Sample::load( const QString& filepath )
@@ -101,40 +136,162 @@ Sample* Sample::load( const QString& filepath )
     return sample;
 }
 
-Sample* Sample::load( const QString& filepath, const Loops& loops, const Rubberband& rubber, const VelocityEnvelope& velocity, const PanEnvelope& pan )
+Sample* Sample::load( const QString& filepath, const Loops& loops, const Rubberband& rubber, const VelocityEnvelope& velocity, const PanEnvelope& pan, float bpm )
 {
-    Sample* sample = Sample::load( filepath );
-    if( !sample ) return 0;
-    sample->apply( loops, rubber, velocity, pan );
+    // the tempo can change while a stretch runs in the background
+    bpm = __stretch_bpm( bpm );
+    SampleCache* cache = SampleCache::get_instance();
+    QString key;
+    if( cache ) {
+        key = SampleCache::file_key( filepath );
+        if( !key.isEmpty() ) key += __format_key() + __transforms_key( loops, rubber, velocity, pan, bpm );
+    }
+    if( !key.isEmpty() ) {
+        SampleCache::Data* data = cache->acquire( key );
+        if( data ) {
+            // the data stored under key is the result of the same transformations
+            Sample* sample = new Sample( filepath );
+            sample->__share( data );
+            sample->__loops = loops;
+            if( rubber.use ) sample->__rubberband = rubber;
+            sample->__velocity_envelope = velocity;
+            sample->__pan_envelope = pan;
+            sample->__is_modified = true;
+            return sample;
+        }
+    }
+    if( !Filesystem::file_readable( filepath ) ) {
+        ERRORLOG( QString( "Unable to read %1" ).arg( filepath ) );
+        return 0;
+    }
+    // never streamed, the transformations need the whole data
+    Sample* sample = new Sample( filepath );
+    sample->__load( false );
+    sample->apply( loops, rubber, velocity, pan, bpm );
+    // the transformations work on floats
+    sample->__pack();
+    // store the result only if every transformation has been applied as asked
+    if( !key.isEmpty() && sample->__is_modified && sample->__loops==loops && ( !rubber.use || sample->__rubberband==rubber ) && !sample->__shared ) {
+        SampleCache::Data* data = cache->insert( key, sample->__data_l, sample->__data_r, sample->__format, sample->__frames, sample->__sample_rate );
+        sample->__data_l = sample->__data_r = 0;
+        sample->__share( data );
+    }
     return sample;
 }
 
-void Sample::apply( const Loops& loops, const Rubberband& rubber, const VelocityEnvelope& velocity, const PanEnvelope& pan )
+QString Sample::__format_key()
+{
+    switch( __storage_format ) {
+    case INT16:
+        return "|int16";
+    case INT24:
+        return "|int24";
+    default:
+        return QString();
+    }
+}
+
+QString Sample::__transforms_key( const Loops& loops, const Rubberband& rubber, const VelocityEnvelope& velocity, const PanEnvelope& pan, float bpm )
+{
+    QString key = QString( "|loops:%1,%2,%3,%4,%5" ).arg( loops.start_frame ).arg( loops.loop_frame ).arg( loops.end_frame ).arg( loops.count ).arg( loops.mode );
+    if( rubber.use ) {
+        // the stretch depends on the tempo
+        key += QString( "|rubberband:%1,%2,%3,%4" ).arg( rubber.divider ).arg( rubber.pitch ).arg( rubber.c_settings ).arg( bpm );
+    }
+    key += "|velocity:";
+    for( unsigned i=0; i<velocity.size(); i++ ) key += QString( "%1/%2," ).arg( velocity[i].frame ).arg( velocity[i].value );
+    key += "|pan:";
+    for( unsigned i=0; i<pan.size(); i++ ) key += QString( "%1/%2," ).arg( pan[i].frame ).arg( pan[i].value );
+    return key;
+}
+
+float Sample::__stretch_bpm( float bpm )
 {
+    return ( bpm>0 ? bpm : Hydrogen::get_instance()->getNewBpmJTM() );
+}
+
+void Sample::apply( const Loops& loops, const Rubberband& rubber, const VelocityEnvelope& velocity, const PanEnvelope& pan, float bpm )
+{
+    if( __stream_frames ) {
+        // the transformations need the whole data
+        INFOLOG( QString( "%1 is transformed, it is not streamed anymore" ).arg( __filepath ) );
+        unload();
+        __load( false );
+    }
     apply_loops( loops );
     apply_velocity( velocity );
     apply_pan( pan );
 #ifdef H2CORE_HAVE_RUBBERBAND
-    apply_rubberband( rubber );
+    apply_rubberband( rubber, bpm );
 #else
-    exec_rubberband_cli( rubber );
+    exec_rubberband_cli( rubber, bpm );
 #endif
 }
 
 void Sample::load()
+{
+    // the transformations of a modified sample need the whole data
+    __load( !__is_modified );
+}
+
+void Sample::__load( bool stream )
+{
+    SampleCache* cache = SampleCache::get_instance();
+    QString key = ( cache ? SampleCache::file_key( __filepath ) : QString() );
+    if( !key.isEmpty() ) {
+        key += __format_key();
+        SampleCache::Data* data = cache->acquire( key );
+        if( data ) {
+            __share( data );
+            return;
+        }
+    }
+    SampleStore* store = ( key.isEmpty() ? 0 : SampleStore::get_instance() );
+    SampleStore::Mapping mapping;
+    if( store && store->map( __filepath, &mapping ) ) {
+        if( __storage_format==FLOAT ) {
+            __share( cache->insert( key, mapping ) );
+            return;
+        }
+        // packed from the stored floats, still faster than decoding
+        bool mono = ( mapping.data_r==mapping.data_l );
+        void* data_l = pack_channel( mapping.data_l, mapping.frames, __storage_format );
+        void* data_r = ( mono ? data_l : pack_channel( mapping.data_r, mapping.frames, __storage_format ) );
+        __share( cache->insert( key, data_l, data_r, __storage_format, mapping.frames, mapping.sample_rate ) );
+        SampleStore::unmap( mapping );
+        return;
+    }
+    float* data_l;
+    float* data_r;
+    int frames;
+    int sample_rate;
+    if( stream && __stream_threshold>0 && __load_head() ) return;
+    if( !__decode( __filepath, &data_l, &data_r, &frames, &sample_rate ) ) return;
+    if( store && store->accepts( __filepath ) ) store->write( __filepath, data_l, data_r, frames, sample_rate );
+    __set_data( data_l, data_r, frames );
+    __sample_rate = sample_rate;
+    __pack();
+    if( !key.isEmpty() ) {
+        SampleCache::Data* data = cache->insert( key, __data_l, __data_r, __format, __frames, __sample_rate );
+        __data_l = __data_r = 0;
+        __share( data );
+    }
+}
+
+bool Sample::__decode( const QString& filepath, float** data_l, float** data_r, int* frames, int* sample_rate )
 {
     SF_INFO sound_info;
-    SNDFILE* file = sf_open( __filepath.toLocal8Bit(), SFM_READ, &sound_info );
+    SNDFILE* file = sf_open( filepath.toLocal8Bit(), SFM_READ, &sound_info );
     if ( !file ) {
-        ERRORLOG( QString( "[Sample::load] Error loading file %1" ).arg( __filepath ) );
-        return;
+        ___ERRORLOG( QString( "[Sample::load] Error loading file %1" ).arg( filepath ) );
+        return false;
     }
     if ( sound_info.channels > SAMPLE_CHANNELS ) {
-        WARNINGLOG( QString( "can't handle %1 channels, only 2 will be used" ).arg( sound_info.channels ) );
+        ___WARNINGLOG( QString( "can't handle %1 channels, only 2 will be used" ).arg( sound_info.channels ) );
         sound_info.channels = SAMPLE_CHANNELS;
     }
     if ( sound_info.frames > ( std::numeric_limits<int>::max()/sound_info.channels ) ) {
-        WARNINGLOG( QString( "sample frames count (%1) and channels (%2) are too much, truncate it." ).arg( sound_info.frames ).arg( sound_info.channels ) );
+        ___WARNINGLOG( QString( "sample frames count (%1) and channels (%2) are too much, truncate it." ).arg( sound_info.frames ).arg( sound_info.channels ) );
         sound_info.frames = ( std::numeric_limits<int>::max()/sound_info.channels );
     }
 
@@ -142,29 +299,292 @@ void Sample::load()
     //memset( buffer, 0, sound_info.frames *sound_info.channels );
     sf_count_t count = sf_read_float( file, buffer, sound_info.frames * sound_info.channels );
     sf_close( file );
-    if( count==0 ) WARNINGLOG( QString( "%1 is an empty sample" ).arg( __filepath ) );
+    if( count==0 ) ___WARNINGLOG( QString( "%1 is an empty sample" ).arg( filepath ) );
 
-    unload();
+    *frames = sound_info.frames;
+    *sample_rate = sound_info.samplerate;
 
-    __data_l = new float[ sound_info.frames ];
-    __data_r = new float[ sound_info.frames ];
-    __frames = sound_info.frames;
+    if ( sound_info.channels == 1 ) {
+        // both channels share the same data
+        *data_l = *data_r = buffer;
+        return true;
+    }
+    *data_l = new float[ sound_info.frames ];
+    *data_r = new float[ sound_info.frames ];
+    for ( int i = 0; i < *frames; i++ ) {
+        ( *data_l )[i] = buffer[i * SAMPLE_CHANNELS];
+        ( *data_r )[i] = buffer[i * SAMPLE_CHANNELS + 1];
+    }
+    delete[] buffer;
+    return true;
+}
+
+bool Sample::__load_head()
+{
+    SF_INFO sound_info;
+    SNDFILE* file = sf_open( __filepath.toLocal8Bit(), SFM_READ, &sound_info );
+    if ( !file ) return false;
+    if ( sound_info.frames <= ( sf_count_t )__stream_threshold * sound_info.samplerate
+         || sound_info.frames > std::numeric_limits<int>::max() ) {
+        sf_close( file );
+        return false;
+    }
+    int head = std::min( ( sf_count_t )SAMPLE_STREAM_HEAD * sound_info.samplerate, sound_info.frames );
+    float* buffer = new float[ head * sound_info.channels ];
+    head = sf_readf_float( file, buffer, head );
+    sf_close( file );
+
+    // same channel mapping as __decode
+    float* data_l = buffer;
+    float* data_r = buffer;
+    if ( sound_info.channels > 1 ) {
+        data_l = new float[ head ];
+        data_r = new float[ head ];
+        for ( int i = 0; i < head; i++ ) {
+            data_l[i] = buffer[ i * sound_info.channels ];
+            data_r[i] = buffer[ i * sound_info.channels + 1 ];
+        }
+        delete[] buffer;
+    }
+    __set_data( data_l, data_r, head );
     __sample_rate = sound_info.samplerate;
+    __stream_frames = sound_info.frames;
+    INFOLOG( QString( "%1 is streamed, %2 frames out of %3 in memory" ).arg( __filepath ).arg( head ).arg( __stream_frames ) );
+    return true;
+}
 
-    if ( sound_info.channels == 1 ) {
-        memcpy( __data_l, buffer, __frames * sizeof( float ) );
-        memcpy( __data_r, buffer, __frames * sizeof( float ) );
-    } else if ( sound_info.channels == SAMPLE_CHANNELS ) {
-        for ( int i = 0; i < __frames; i++ ) {
-            __data_l[i] = buffer[i * SAMPLE_CHANNELS];
-            __data_r[i] = buffer[i * SAMPLE_CHANNELS + 1];
+void Sample::unload()
+{
+    if( __shared ) {
+        SampleCache::get_instance()->release( __shared );
+        __shared = 0;
+    } else {
+        if( __data_r!=__data_l ) __free( __data_r, __format );
+        __free( __data_l, __format );
+    }
+    __frames = __sample_rate = __stream_frames = 0;
+    __data_l = __data_r = 0;
+    __format = FLOAT;
+    // __is_modified = false; leave this unchanged as pan, velocity, loop and rubberband are kept unchanged
+}
+
+void Sample::__share( SampleCache::Data* data )
+{
+    unload();
+    __shared = data;
+    __data_l = data->data_l;
+    __data_r = data->data_r;
+    __format = ( Format )data->format;
+    __frames = data->frames;
+    __sample_rate = data->sample_rate;
+}
+
+void Sample::__set_data( float* data_l, float* data_r, int frames )
+{
+    int sample_rate = __sample_rate;
+    unload();
+    __data_l = data_l;
+    __data_r = data_r;
+    __frames = frames;
+    __sample_rate = sample_rate;
+}
+
+void Sample::__detach()
+{
+    if( !__data_l || ( !__shared && __format==FLOAT && !is_mono() ) ) return;
+    float* data_l = new float[ __frames ];
+    float* data_r = new float[ __frames ];
+    read( 0, __frames, data_l, data_r );
+    __set_data( data_l, data_r, __frames );
+}
+
+void Sample::__pack()
+{
+    // streamed samples only hold their head, it is kept as is
+    if( __storage_format==FLOAT || __format!=FLOAT || __shared || !__data_l || __stream_frames ) return;
+    void* data_l = pack_channel( ( float* )__data_l, __frames, __storage_format );
+    void* data_r = ( is_mono() ? data_l : pack_channel( ( float* )__data_r, __frames, __storage_format ) );
+    int frames = __frames;
+    int sample_rate = __sample_rate;
+    unload();
+    __data_l = data_l;
+    __data_r = data_r;
+    __format = __storage_format;
+    __frames = frames;
+    __sample_rate = sample_rate;
+}
+
+void Sample::__free( void* data, Format format )
+{
+    if( format==FLOAT ) {
+        delete[] static_cast<float*>( data );
+    } else {
+        delete[] static_cast<char*>( data );
+    }
+}
+
+void Sample::read( int first, int count, float* out_l, float* out_r ) const
+{
+    if( __format==FLOAT ) {
+        memcpy( out_l, ( float* )__data_l + first, count * sizeof( float ) );
+        if( out_r ) memcpy( out_r, ( float* )__data_r + first, count * sizeof( float ) );
+        return;
+    }
+    __unpack( out_l, __data_l, __format, first, count );
+    if( out_r ) __unpack( out_r, __data_r, __format, first, count );
+}
+
+void Sample::__unpack( float* dst, const void* src, Format format, int first, int count )
+{
+    if( format==INT16 ) {
+        SamplerKernels::s16_to_float( dst, ( const short* )src + first, count );
+    } else {
+        SamplerKernels::s24_to_float( dst, ( const unsigned char* )src + first * 3, count );
+    }
+}
+
+/* allocate a channel of frames values in the given format, the way __free deletes it */
+static void* alloc_channel( Sample::Format format, int frames )
+{
+    if( format==Sample::FLOAT ) return new float[ frames ];
+    return new char[ frames * Sample::format_size( format ) ];
+}
+
+/* scale a float to full_scale and round it, clipped to the range of the integer format */
+static int quantize( float value, float full_scale )
+{
+    float scaled = floor( value * full_scale + 0.5f );
+    if( scaled > full_scale - 1 ) return ( int )full_scale - 1;
+    if( scaled < -full_scale ) return -( int )full_scale;
+    return ( int )scaled;
+}
+
+/* convert a float channel to an integer format, native 16 bit values or 3 bytes little endian ones */
+static void* pack_channel( const float* data, int frames, Sample::Format format )
+{
+    char* packed = static_cast<char*>( alloc_channel( format, frames ) );
+    if( format==Sample::INT16 ) {
+        short* values = reinterpret_cast<short*>( packed );
+        for( int i=0; i<frames; i++ ) values[i] = ( short )quantize( data[i], 32768.0f );
+    } else {
+        unsigned char* bytes = reinterpret_cast<unsigned char*>( packed );
+        for( int i=0; i<frames; i++ ) {
+            unsigned value = ( unsigned )quantize( data[i], 8388608.0f );
+            bytes[ i*3 ] = value & 0xff;
+            bytes[ i*3 + 1 ] = ( value >> 8 ) & 0xff;
+            bytes[ i*3 + 2 ] = ( value >> 16 ) & 0xff;
         }
     }
-    delete[] buffer;
+    return packed;
+}
+
+Sample* Sample::resample( int sample_rate ) const
+{
+    if( sample_rate<=0 || !__data_l || __stream_frames || __sample_rate<=0 ) return 0;
+    Sample* sample = new Sample( __filepath );
+    sample->__is_modified = __is_modified;
+    sample->__loops = __loops;
+    sample->__rubberband = __rubberband;
+    sample->__velocity_envelope = __velocity_envelope;
+    sample->__pan_envelope = __pan_envelope;
+
+    // the data is converted once for every sample sharing it
+    SampleCache* cache = ( __shared ? SampleCache::get_instance() : 0 );
+    QString key;
+    if( cache ) {
+        key = __shared->get_key() + QString( "|rate:%1" ).arg( sample_rate );
+        SampleCache::Data* data = cache->acquire( key );
+        if( data ) {
+            sample->__share( data );
+            return sample;
+        }
+    }
+
+    const float* in_l = ( __format==FLOAT ? ( const float* )__data_l : 0 );
+    const float* in_r = ( __format==FLOAT ? ( const float* )__data_r : 0 );
+    float* unpacked = 0;
+    if( !in_l ) {
+        unpacked = new float[ __frames * ( is_mono() ? 1 : 2 ) ];
+        in_l = unpacked;
+        in_r = ( is_mono() ? unpacked : unpacked + __frames );
+        read( 0, __frames, unpacked, ( is_mono() ? 0 : unpacked + __frames ) );
+    }
+    double step = ( double )__sample_rate / sample_rate;
+    int frames = ( int )ceil( __frames / step );
+    std::vector<float> table;
+    sinc_table( table );
+    float* data_l = new float[ frames ];
+    float* data_r = data_l;
+    sinc_resample( in_l, __frames, data_l, frames, step, table );
+    if( in_r!=in_l ) {
+        data_r = new float[ frames ];
+        sinc_resample( in_r, __frames, data_r, frames, step, table );
+    }
+    delete[] unpacked;
+
+    sample->__set_data( data_l, data_r, frames );
+    sample->__sample_rate = sample_rate;
+    sample->__pack();
+    if( cache ) {
+        SampleCache::Data* data = cache->insert( key, sample->__data_l, sample->__data_r, sample->__format, sample->__frames, sample->__sample_rate );
+        sample->__data_l = sample->__data_r = 0;
+        sample->__share( data );
+    }
+    return sample;
+}
+
+/* zeroth order modified Bessel function of the first kind */
+static double bessel_i0( double x )
+{
+    double sum = 1.0, term = 1.0;
+    for( int k=1; k<32; k++ ) {
+        term *= ( x / ( 2 * k ) ) * ( x / ( 2 * k ) );
+        sum += term;
+    }
+    return sum;
+}
+
+/* the Kaiser windowed sinc, sampled RESAMPLE_PHASES times per zero crossing, one side only */
+static void sinc_table( std::vector<float>& table )
+{
+    int n = RESAMPLE_ZEROS * RESAMPLE_PHASES;
+    table.resize( n + 2 );
+    double norm = bessel_i0( RESAMPLE_BETA );
+    for( int i=0; i<=n; i++ ) {
+        double x = ( double )i / RESAMPLE_PHASES;
+        double sinc = ( i==0 ? 1.0 : sin( M_PI * x ) / ( M_PI * x ) );
+        double r = x / RESAMPLE_ZEROS;
+        table[i] = sinc * bessel_i0( RESAMPLE_BETA * sqrt( std::max( 0.0, 1.0 - r * r ) ) ) / norm;
+    }
+    table[ n + 1 ] = 0.0f;
+}
+
+/* convert a channel, step being the number of input frames per output frame,
+ * the cutoff is lowered below the output Nyquist frequency when downsampling */
+static void sinc_resample( const float* in, int in_frames, float* out, int out_frames, double step, const std::vector<float>& table )
+{
+    double scale = std::min( 1.0, 1.0 / step );
+    double reach = RESAMPLE_ZEROS / scale;
+    double phases = scale * RESAMPLE_PHASES;
+    for( int i=0; i<out_frames; i++ ) {
+        double t = i * step;
+        int first = std::max( ( int )ceil( t - reach ), 0 );
+        int last = std::min( ( int )floor( t + reach ), in_frames - 1 );
+        double acc = 0.0;
+        for( int k=first; k<=last; k++ ) {
+            double x = fabs( t - k ) * phases;
+            int j = ( int )x;
+            double f = x - j;
+            acc += in[k] * ( table[j] + f * ( table[ j + 1 ] - table[j] ) );
+        }
+        out[i] = acc * scale;
+    }
 }
 
 bool Sample::apply_loops( const Loops& lo )
 {
+    // only the head of a streamed sample is in memory
+    if( __stream_frames ) return false;
     if( __loops == lo ) return true;
     if( lo.start_frame<0 ) {
         ERRORLOG( QString( "start_frame %1 < 0 is not allowed" ).arg( lo.start_frame ) );
@@ -188,6 +608,11 @@ bool Sample::apply_loops( const Loops& lo )
     }
     //if( lo == __loops ) return true;
 
+    // the loops are built from float data, shared or not
+    if( __format!=FLOAT ) __detach();
+    const float* data_l = get_data_l();
+    const float* data_r = get_data_r();
+
     bool full_loop = lo.start_frame==lo.loop_frame;
     int full_length =  lo.end_frame - lo.start_frame;
     int loop_length =  lo.end_frame - lo.loop_frame;
@@ -200,21 +625,21 @@ bool Sample::apply_loops( const Loops& lo )
     if ( lo.mode==Loops::REVERSE && ( lo.count==0 || full_loop ) ) {
         if( full_loop ) {
             // copy end => start
-            for( int i=0, j=lo.end_frame; i<full_length; i++, j-- ) new_data_l[i]=__data_l[j];
-            for( int i=0, j=lo.end_frame; i<full_length; i++, j-- ) new_data_r[i]=__data_r[j];
+            for( int i=0, j=lo.end_frame; i<full_length; i++, j-- ) new_data_l[i]=data_l[j];
+            for( int i=0, j=lo.end_frame; i<full_length; i++, j-- ) new_data_r[i]=data_r[j];
         } else {
             // copy start => loop
             int to_loop = lo.loop_frame - lo.start_frame;
-            memcpy( new_data_l, __data_l+lo.start_frame, sizeof( float )*to_loop );
-            memcpy( new_data_r, __data_r+lo.start_frame, sizeof( float )*to_loop );
+            memcpy( new_data_l, data_l+lo.start_frame, sizeof( float )*to_loop );
+            memcpy( new_data_r, data_r+lo.start_frame, sizeof( float )*to_loop );
             // copy end => loop
-            for( int i=to_loop, j=lo.end_frame; i<full_length; i++, j-- ) new_data_l[i]=__data_l[j];
-            for( int i=to_loop, j=lo.end_frame; i<full_length; i++, j-- ) new_data_r[i]=__data_r[j];
+            for( int i=to_loop, j=lo.end_frame; i<full_length; i++, j-- ) new_data_l[i]=data_l[j];
+            for( int i=to_loop, j=lo.end_frame; i<full_length; i++, j-- ) new_data_r[i]=data_r[j];
         }
     } else {
         // copy start => end
-        memcpy( new_data_l, __data_l+lo.start_frame, sizeof( float )*full_length );
-        memcpy( new_data_r, __data_r+lo.start_frame, sizeof( float )*full_length );
+        memcpy( new_data_l, data_l+lo.start_frame, sizeof( float )*full_length );
+        memcpy( new_data_r, data_r+lo.start_frame, sizeof( float )*full_length );
     }
     // copy the loops
     if( lo.count>0 ) {
@@ -224,12 +649,12 @@ bool Sample::apply_loops( const Loops& lo )
         for( int i=0; i<lo.count; i++ ) {
             if ( forward ) {
                 // copy loop => end
-                memcpy( &new_data_l[x], __data_l+lo.loop_frame, sizeof( float )*loop_length );
-                memcpy( &new_data_r[x], __data_r+lo.loop_frame, sizeof( float )*loop_length );
+                memcpy( &new_data_l[x], data_l+lo.loop_frame, sizeof( float )*loop_length );
+                memcpy( &new_data_r[x], data_r+lo.loop_frame, sizeof( float )*loop_length );
             } else {
                 // copy end => loop
-                for( int i=lo.end_frame, y=x; i>lo.loop_frame; i--, y++ ) new_data_l[y]=__data_l[i];
-                for( int i=lo.end_frame, y=x; i>lo.loop_frame; i--, y++ ) new_data_r[y]=__data_r[i];
+                for( int i=lo.end_frame, y=x; i>lo.loop_frame; i--, y++ ) new_data_l[y]=data_l[i];
+                for( int i=lo.end_frame, y=x; i>lo.loop_frame; i--, y++ ) new_data_r[y]=data_r[i];
             }
             x+=loop_length;
             if( ping_pong ) forward=!forward;
@@ -237,11 +662,7 @@ bool Sample::apply_loops( const Loops& lo )
         assert( x==new_length );
     }
     __loops = lo;
-    delete __data_l;
-    delete __data_r;
-    __data_l = new_data_l;
-    __data_r = new_data_r;
-    __frames = new_length;
+    __set_data( new_data_l, new_data_r, new_length );
     __is_modified = true;
     return true;
 }
@@ -252,9 +673,13 @@ void Sample::apply_velocity( const VelocityEnvelope& v )
     // the VelocityEnvelope should be processed within TargetWaveDisplay
     // so that we here have ( int frame_idx, float scale ) points
     // but that will break the xml storage
+    if( __stream_frames ) return;
     if( v.empty() && __velocity_envelope.empty() ) return;
     __velocity_envelope.clear();
     if ( v.size() > 0 ) {
+        __detach();
+        float* data_l = get_data_l();
+        float* data_r = get_data_r();
         float inv_resolution = __frames / 841.0F;
         for ( int i = 1; i < v.size(); i++ ) {
             float y = ( 91 - v[i - 1].value ) / 91.0F;
@@ -265,8 +690,8 @@ void Sample::apply_velocity( const VelocityEnvelope& v )
             int length = end_frame - start_frame ;
             float step = ( y - k ) / length;;
             for ( int z = start_frame ; z < end_frame; z++ ) {
-                __data_l[z] = __data_l[z] * y;
-                __data_r[z] = __data_r[z] * y;
+                data_l[z] = data_l[z] * y;
+                data_r[z] = data_r[z] * y;
                 y-=step;
             }
         }
@@ -278,9 +703,13 @@ void Sample::apply_velocity( const VelocityEnvelope& v )
 void Sample::apply_pan( const PanEnvelope& p )
 {
     // TODO see apply_velocity
+    if( __stream_frames ) return;
     if( p.empty() && __pan_envelope.empty() ) return;
     __pan_envelope.clear();
     if ( p.size() > 0 ) {
+        __detach();
+        float* data_l = get_data_l();
+        float* data_r = get_data_r();
         float inv_resolution = __frames / 841.0F;
         for ( int i = 1; i < p.size(); i++ ) {
             float y = ( 45 - p[i - 1].value ) / 45.0F;
@@ -294,15 +723,15 @@ void Sample::apply_pan( const PanEnvelope& p )
                 // seems wrong to modify only one channel ?!?!
                 if( y < 0 ) {
                     float k = 1 + y;
-                    __data_l[z] = __data_l[z] * k;
-                    __data_r[z] = __data_r[z];
+                    data_l[z] = data_l[z] * k;
+                    data_r[z] = data_r[z];
                 } else if ( y > 0 ) {
                     float k = 1 - y;
-                    __data_l[z] = __data_l[z];
-                    __data_r[z] = __data_r[z] * k;
+                    data_l[z] = data_l[z];
+                    data_r[z] = data_r[z] * k;
                 } else if( y==0 ) {
-                    __data_l[z] = __data_l[z];
-                    __data_r[z] = __data_r[z];
+                    data_l[z] = data_l[z];
+                    data_r[z] = data_r[z];
                 }
                 y-=step;
             }
@@ -312,14 +741,14 @@ void Sample::apply_pan( const PanEnvelope& p )
     __is_modified = true;
 }
 
-void Sample::apply_rubberband( const Rubberband& rb )
+void Sample::apply_rubberband( const Rubberband& rb, float bpm )
 {
     // TODO see Rubberband declaration in sample.h
 #ifdef H2CORE_HAVE_RUBBERBAND
     //if( __rubberband == rb ) return;
-    if( !rb.use ) return;
+    if( !rb.use || __stream_frames ) return;
     // compute rubberband options
-    double output_duration = 60.0 / Hydrogen::get_instance()->getNewBpmJTM() * rb.divider;
+    double output_duration = 60.0 / __stretch_bpm( bpm ) * rb.divider;
     double time_ratio = output_duration / get_sample_duration();
     RubberBand::RubberBandStretcher::Options options = compute_rubberband_options( rb );
     double pitch_scale = compute_pitch_scale( rb );
@@ -332,7 +761,8 @@ void Sample::apply_rubberband( const Rubberband& rb )
 
     //DEBUGLOG( QString( "on %1\n\toptions\t\t: %2\n\ttime ratio\t: %3\n\tpitch\t\t: %4" ).arg( get_filename() ).arg( options ).arg( time_ratio ).arg( pitch_scale ) );
 
-    int block_size = Hydrogen::get_instance()->getAudioOutput()->getBufferSize();
+    // stretches run in the background too, away from the audio driver
+    int block_size = RUBBERBAND_BLOCK_SIZE;
     float* ibuf[2];
     int studied = 0;
 
@@ -342,10 +772,7 @@ void Sample::apply_rubberband( const Rubberband& rb )
         //___DEBUGLOG( QString(" ibs : %1").arg( ibs ) );
         float tempIbufL[ibs];
         float tempIbufR[ibs];
-        for(int i = 0 ;i < ibs; i++){
-            tempIbufL[i] = __data_l[i + studied];
-            tempIbufR[i] = __data_r[i + studied];
-        }
+        read( studied, ibs, tempIbufL, tempIbufR );
         ibuf[0] = tempIbufL;
         ibuf[1] = tempIbufR;
         rubber->study( ibuf, ibs, final );
@@ -366,10 +793,7 @@ void Sample::apply_rubberband( const Rubberband& rb )
         int ibs = (final ? (__frames-processed) : block_size );
         float tempIbufL[ibs];
         float tempIbufR[ibs];
-        for(int i = 0 ;i < ibs; i++){
-            tempIbufL[i] = __data_l[i + processed];
-            tempIbufR[i] = __data_r[i + processed];
-        }
+        read( processed, ibs, tempIbufL, tempIbufR );
         ibuf[0] = tempIbufL;
         ibuf[1] = tempIbufR;
         rubber->process( ibuf, ibs, final );
@@ -412,23 +836,22 @@ void Sample::apply_rubberband( const Rubberband& rb )
 
     // DEBUGLOG( QString( "%1 frames processed, %2 frames retrieved" ).arg( __frames ).arg( retrieved ) );
     // final data buffers
-    delete __data_l;
-    delete __data_r;
-    __data_l = new float[ retrieved ];
-    __data_r = new float[ retrieved ];
-    memcpy( __data_l, out_data_l, retrieved*sizeof( float ) );
-    memcpy( __data_r, out_data_r, retrieved*sizeof( float ) );
+    float* data_l = new float[ retrieved ];
+    float* data_r = new float[ retrieved ];
+    memcpy( data_l, out_data_l, retrieved*sizeof( float ) );
+    memcpy( data_r, out_data_r, retrieved*sizeof( float ) );
     delete out_data_l;
     delete out_data_r;
     // update sample
+    __set_data( data_l, data_r, retrieved );
     __rubberband = rb;
-    __frames = retrieved;
     __is_modified = true;
 #endif
 }
 
-bool Sample::exec_rubberband_cli( const Rubberband& rb )
+bool Sample::exec_rubberband_cli( const Rubberband& rb, float bpm )
 {
+    if( __stream_frames ) return false;
     //set the path to rubberband-cli
     QString program = Preferences::get_instance()->m_rubberBandCLIexecutable;
     //test the path. if test fails return NULL
@@ -438,7 +861,9 @@ bool Sample::exec_rubberband_cli( const Rubberband& rb )
     }
 
     if( rb.use ) {
-        QString outfilePath =  QDir::tempPath() + "/tmp_rb_outfile.wav";
+        // several samples can be stretched at once
+        int run = rubberband_runs.fetchAndAddOrdered( 1 );
+        QString outfilePath =  QDir::tempPath() + QString( "/tmp_rb_outfile_%1_%2.wav" ).arg( getpid() ).arg( run );
         if( !write( outfilePath ) ) {
             ERRORLOG( "unable to write sample" );
             return false;
@@ -446,7 +871,7 @@ bool Sample::exec_rubberband_cli( const Rubberband& rb )
 
         unsigned rubberoutframes = 0;
         double ratio = 1.0;
-        double durationtime = 60.0 / Hydrogen::get_instance()->getNewBpmJTM() * rb.divider/*beats*/;
+        double durationtime = 60.0 / __stretch_bpm( bpm ) * rb.divider/*beats*/;
         double induration = get_sample_duration();
         if ( induration != 0.0 ) ratio = durationtime / induration;
         rubberoutframes = int( __frames * ratio + 0.1 );
@@ -458,7 +883,7 @@ bool Sample::exec_rubberband_cli( const Rubberband& rb )
         QString rCs = QString( " %1" ).arg( rb.c_settings );
         float pitch = pow( 1.0594630943593, ( double )rb.pitch );
         QString rPs = QString( " %1" ).arg( pitch );
-        QString rubberResultPath = QDir::tempPath() + "/tmp_rb_result_file.wav";
+        QString rubberResultPath = QDir::tempPath() + QString( "/tmp_rb_result_file_%1_%2.wav" ).arg( getpid() ).arg( run );
         arguments << "-D" << QString( " %1" ).arg( durationtime ) 	//stretch or squash to make output file X seconds long
                   << "--threads"					//assume multi-CPU even if only one CPU is identified
                   << "-P"						//aim for minimal time distortion
@@ -467,30 +892,30 @@ bool Sample::exec_rubberband_cli( const Rubberband& rb )
                   << outfilePath 					//infile
                   << rubberResultPath;					//outfile
         rubberband->start( program, arguments );
-        while( !rubberband->waitForFinished() ) {
-            //_ERRORLOG( QString( "prozessing" ));
-        }
+        // false if it could not be started, the result is missing then
+        rubberband->waitForFinished( -1 );
+        delete rubberband;
         if ( QFile( rubberResultPath ).exists() == false ) {
+            QFile( outfilePath ).remove();
             _ERRORLOG( QString( "Rubberband reimporter File %1 not found" ).arg( rubberResultPath ) );
             return false;
         }
 
-        Sample* rubberbanded = Sample::load( rubberResultPath.toLocal8Bit() );
-        if( rubberbanded==0 ) {
+        // a temporary file, not worth caching
+        float* data_l;
+        float* data_r;
+        int frames;
+        int sample_rate;
+        if( !__decode( rubberResultPath, &data_l, &data_r, &frames, &sample_rate ) ) {
             return false;
         }
         if( QFile( outfilePath ).remove() );
 //			_INFOLOG("remove outfile");
         if( QFile( rubberResultPath ).remove() );
 //			_INFOLOG("remove rubberResultFile");
-        __frames = rubberbanded->get_frames();
-        __data_l = rubberbanded->get_data_l();
-        __data_r = rubberbanded->get_data_r();
-        rubberbanded->__data_l = 0;
-        rubberbanded->__data_r = 0;
+        __set_data( data_l, data_r, frames );
         __is_modified = true;
         __rubberband = rb;
-        delete rubberbanded;
     }
     return true;
 }
@@ -508,8 +933,8 @@ bool Sample::write( const QString& path, int format )
 {
     float* obuf = new float[ SAMPLE_CHANNELS * __frames ];
     for ( int i = 0; i < __frames; ++i ) {
-        float value_l = __data_l[i];
-        float value_r = __data_r[i];
+        float value_l = get_value_l( i );
+        float value_r = get_value_r( i );
         if ( value_l > 1.f ) value_l = 1.f;
         else if ( value_l < -1.f ) value_l = -1.f;
         else if ( value_r > 1.f ) value_r = 1.f;
@@ -0,0 +1,226 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/basics/sample_cache.h>
+#include <hydrogen/basics/sample.h>
+
+#include <QtCore/QFileInfo>
+#include <QtCore/QDateTime>
+#include <QtCore/QMutexLocker>
+
+namespace H2Core
+{
+
+const char* SampleCache::__class_name = "SampleCache";
+SampleCache* SampleCache::__instance = 0;
+
+void SampleCache::create_instance()
+{
+    if ( __instance == 0 ) {
+        __instance = new SampleCache;
+    }
+}
+
+SampleCache::SampleCache()
+    : Object( __class_name ),
+      __size( 0 ),
+      __budget( 0 )
+{
+}
+
+SampleCache::~SampleCache()
+{
+    QMutexLocker lock( &__mutex );
+    for ( std::map<QString, Data*>::iterator it = __data.begin(); it != __data.end(); it++ ) {
+        if ( it->second->__refs > 0 ) {
+            // samples still point to it, let it leak rather than dangle
+            WARNINGLOG( QString( "%1 still used by %2 samples" ).arg( it->first ).arg( it->second->__refs ) );
+            continue;
+        }
+        __destroy( it->second );
+    }
+    __data.clear();
+    __unused.clear();
+    if ( __instance == this ) __instance = 0;
+}
+
+QString SampleCache::file_key( const QString& filepath )
+{
+    QFileInfo info( filepath );
+    if ( !info.exists() ) return QString();
+    return QString( "%1|%2|%3" ).arg( info.canonicalFilePath() ).arg( info.lastModified().toTime_t() ).arg( info.size() );
+}
+
+long long SampleCache::__bytes( const Data* data )
+{
+    int channels = ( data->data_r == data->data_l ? 1 : 2 );
+    return ( long long )data->frames * Sample::format_size( ( Sample::Format )data->format ) * channels;
+}
+
+SampleCache::Data* SampleCache::acquire( const QString& key )
+{
+    QMutexLocker lock( &__mutex );
+    std::map<QString, Data*>::iterator it = __data.find( key );
+    if ( it == __data.end() ) return 0;
+    Data* data = it->second;
+    if ( data->__refs++ == 0 ) __unused.erase( data->__lru );
+    return data;
+}
+
+void SampleCache::acquire( Data* data )
+{
+    QMutexLocker lock( &__mutex );
+    assert( data->__refs > 0 );
+    data->__refs++;
+}
+
+SampleCache::Data* SampleCache::insert( const QString& key, void* data_l, void* data_r, int format, int frames, int sample_rate )
+{
+    QMutexLocker lock( &__mutex );
+    Data* data = new Data;
+    data->data_l = data_l;
+    data->data_r = data_r;
+    data->format = format;
+    data->__address = 0;
+    data->__length = 0;
+    std::map<QString, Data*>::iterator it = __data.find( key );
+    if ( it != __data.end() ) {
+        // decoded by another thread meanwhile
+        __destroy( data );
+        data = it->second;
+        if ( data->__refs++ == 0 ) __unused.erase( data->__lru );
+        return data;
+    }
+    data->frames = frames;
+    data->sample_rate = sample_rate;
+    return __insert( key, data );
+}
+
+SampleCache::Data* SampleCache::insert( const QString& key, const SampleStore::Mapping& mapping )
+{
+    QMutexLocker lock( &__mutex );
+    std::map<QString, Data*>::iterator it = __data.find( key );
+    if ( it != __data.end() ) {
+        SampleStore::unmap( mapping );
+        Data* data = it->second;
+        if ( data->__refs++ == 0 ) __unused.erase( data->__lru );
+        return data;
+    }
+    Data* data = new Data;
+    data->data_l = mapping.data_l;
+    data->data_r = mapping.data_r;
+    data->format = Sample::FLOAT;
+    data->frames = mapping.frames;
+    data->sample_rate = mapping.sample_rate;
+    data->__address = mapping.address;
+    data->__length = mapping.length;
+    return __insert( key, data );
+}
+
+SampleCache::Data* SampleCache::__insert( const QString& key, Data* data )
+{
+    data->__key = key;
+    data->__refs = 1;
+    __data[ key ] = data;
+    __size += __bytes( data );
+    __evict();
+    return data;
+}
+
+void SampleCache::release( Data* data )
+{
+    QMutexLocker lock( &__mutex );
+    assert( data->__refs > 0 );
+    if ( --data->__refs > 0 ) return;
+    data->__lru = __unused.insert( __unused.end(), data );
+    __evict();
+}
+
+void SampleCache::clear()
+{
+    QMutexLocker lock( &__mutex );
+    while ( !__unused.empty() ) {
+        Data* data = __unused.front();
+        __unused.pop_front();
+        __data.erase( data->__key );
+        __size -= __bytes( data );
+        __destroy( data );
+    }
+}
+
+void SampleCache::__evict()
+{
+    // what is used is never deleted, the budget bounds the whole cache
+    while ( !__unused.empty() && __size > __budget ) {
+        Data* data = __unused.front();
+        __unused.pop_front();
+        __data.erase( data->__key );
+        __size -= __bytes( data );
+        __destroy( data );
+    }
+}
+
+void SampleCache::__destroy( Data* data )
+{
+    if ( data->__address ) {
+        SampleStore::Mapping mapping;
+        mapping.address = data->__address;
+        mapping.length = data->__length;
+        SampleStore::unmap( mapping );
+    } else if ( data->format == Sample::FLOAT ) {
+        if ( data->data_r != data->data_l ) delete[] static_cast<float*>( data->data_r );
+        delete[] static_cast<float*>( data->data_l );
+    } else {
+        if ( data->data_r != data->data_l ) delete[] static_cast<char*>( data->data_r );
+        delete[] static_cast<char*>( data->data_l );
+    }
+    delete data;
+}
+
+void SampleCache::set_budget( long long bytes )
+{
+    QMutexLocker lock( &__mutex );
+    __budget = ( bytes < 0 ? 0 : bytes );
+    __evict();
+}
+
+long long SampleCache::get_budget() const
+{
+    QMutexLocker lock( &__mutex );
+    return __budget;
+}
+
+long long SampleCache::get_size() const
+{
+    QMutexLocker lock( &__mutex );
+    return __size;
+}
+
+int SampleCache::get_count() const
+{
+    QMutexLocker lock( &__mutex );
+    return __data.size();
+}
+
+};
+
+/* vim: set softtabstop=4 expandtab: */
@@ -0,0 +1,185 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/basics/sample_loader.h>
+#include <hydrogen/basics/sample.h>
+
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThread>
+
+namespace H2Core
+{
+
+const char* SampleLoader::__class_name = "SampleLoader";
+SampleLoader* SampleLoader::__instance = 0;
+
+void SampleLoader::create_instance()
+{
+    if ( __instance == 0 ) {
+        __instance = new SampleLoader;
+    }
+}
+
+SampleLoader::SampleLoader( int threads )
+    : Object( __class_name ),
+      __next( 0 ),
+      __done( 0 ),
+      __taken( 0 ),
+      __quit( false )
+{
+    if ( threads <= 0 ) threads = QThread::idealThreadCount();
+    if ( threads <= 0 ) threads = 1;
+    for ( int i = 0; i < threads; i++ ) {
+        pthread_t thread;
+        if ( pthread_create( &thread, 0, SampleLoader::__thread_main, this ) != 0 ) {
+            ERRORLOG( "unable to start a decoding thread" );
+            break;
+        }
+        __threads.push_back( thread );
+    }
+}
+
+SampleLoader::~SampleLoader()
+{
+    __mutex.lock();
+    __quit = true;
+    __queued.wakeAll();
+    __mutex.unlock();
+    for ( unsigned i = 0; i < __threads.size(); i++ ) pthread_join( __threads[i], 0 );
+    for ( unsigned i = 0; i < __jobs.size(); i++ ) {
+        if ( __jobs[i].owned ) delete __jobs[i].sample;
+    }
+    if ( __instance == this ) __instance = 0;
+}
+
+int SampleLoader::add( const QString& filepath )
+{
+    Job job;
+    job.filepath = filepath;
+    job.sample = 0;
+    job.owned = false;
+    job.done = false;
+    job.taken = false;
+    return __add( job );
+}
+
+int SampleLoader::add( Sample* sample )
+{
+    Job job;
+    job.sample = sample;
+    job.owned = false;
+    job.done = false;
+    job.taken = false;
+    return __add( job );
+}
+
+int SampleLoader::__add( const Job& job )
+{
+    QMutexLocker lock( &__mutex );
+    if ( __taken == ( int )__jobs.size() ) {
+        // nobody waits for any job anymore, start over
+        __jobs.clear();
+        __next = __done = __taken = 0;
+    }
+    __jobs.push_back( job );
+    if ( __threads.empty() ) {
+        // no thread could be started, load right away
+        lock.unlock();
+        __run();
+        lock.relock();
+    } else {
+        __queued.wakeOne();
+    }
+    return __jobs.size() - 1;
+}
+
+Sample* SampleLoader::take( int job )
+{
+    QMutexLocker lock( &__mutex );
+    if ( job < 0 || job >= ( int )__jobs.size() ) return 0;
+    while ( !__jobs[ job ].done ) __finished.wait( &__mutex );
+    __jobs[ job ].owned = false;
+    if ( !__jobs[ job ].taken ) {
+        __jobs[ job ].taken = true;
+        __taken++;
+    }
+    return __jobs[ job ].sample;
+}
+
+void SampleLoader::wait()
+{
+    QMutexLocker lock( &__mutex );
+    while ( __done < ( int )__jobs.size() ) __finished.wait( &__mutex );
+}
+
+int SampleLoader::get_done() const
+{
+    QMutexLocker lock( &__mutex );
+    return __done;
+}
+
+int SampleLoader::get_count() const
+{
+    QMutexLocker lock( &__mutex );
+    return __jobs.size();
+}
+
+void SampleLoader::__run()
+{
+    QMutexLocker lock( &__mutex );
+    while ( true ) {
+        if ( __next == ( int )__jobs.size() ) {
+            if ( __quit || __threads.empty() ) return;
+            __queued.wait( &__mutex );
+            continue;
+        }
+        int job = __next++;
+        QString filepath = __jobs[ job ].filepath;
+        Sample* sample = __jobs[ job ].sample;
+        lock.unlock();
+
+        // decoding runs unlocked, concurrently with the other threads
+        bool owned = ( sample == 0 );
+        if ( owned ) {
+            sample = Sample::load( filepath );
+        } else {
+            sample->load();
+        }
+
+        lock.relock();
+        __jobs[ job ].sample = sample;
+        __jobs[ job ].owned = owned && sample;
+        __jobs[ job ].done = true;
+        __done++;
+        __finished.wakeAll();
+    }
+}
+
+void* SampleLoader::__thread_main( void* param )
+{
+    static_cast<SampleLoader*>( param )->__run();
+    return 0;
+}
+
+};
+
+/* vim: set softtabstop=4 expandtab: */
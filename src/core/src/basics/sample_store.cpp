@@ -0,0 +1,277 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/basics/sample_store.h>
+#include <hydrogen/helpers/filesystem.h>
+
+#include <cstring>
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QTemporaryFile>
+
+#ifndef WIN32
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#endif
+
+#define STORE_MAGIC     "H2PCM\0\0"
+#define STORE_VERSION   2
+#define STORE_ORDER     0x01020304
+#define STORE_ALIGN     32
+#define STORE_BUDGET    1024        // default budget, in MB
+
+namespace H2Core
+{
+
+/** head of a store file, the channels follow, each aligned on STORE_ALIGN bytes */
+struct StoreHeader {
+    char magic[8];                  ///< STORE_MAGIC
+    qint32 version;                 ///< STORE_VERSION
+    qint32 order;                   ///< STORE_ORDER, as written by this machine
+    qint64 source_mtime;            ///< modification time of the audio file
+    qint64 source_size;             ///< size of the audio file
+    qint32 frames;                  ///< number of frames per channel
+    qint32 sample_rate;             ///< sample rate of the data
+    qint32 channels;                ///< 1 for mono data, 2 otherwise
+    char padding[12];               ///< up to 64 bytes, keeps the first channel aligned
+};
+
+/** offset of the right channel */
+static inline size_t right_offset( int frames )
+{
+    size_t bytes = ( size_t )frames * sizeof( float );
+    return sizeof( StoreHeader ) + ( ( bytes + STORE_ALIGN - 1 ) & ~( size_t )( STORE_ALIGN - 1 ) );
+}
+
+/** length of a store file */
+static inline size_t file_length( int frames, int channels )
+{
+    size_t bytes = ( size_t )frames * sizeof( float );
+    return ( channels == 1 ? sizeof( StoreHeader ) : right_offset( frames ) ) + bytes;
+}
+
+/** canonical path of a directory ended by a separator, empty if it does not exist */
+static QString canonical_dir( const QString& dir )
+{
+    QString path = QFileInfo( dir ).canonicalFilePath();
+    return ( path.isEmpty() ? path : path + "/" );
+}
+
+/** fill a header describing filepath */
+static bool source_header( const QString& filepath, StoreHeader* header )
+{
+    QFileInfo info( filepath );
+    if ( !info.exists() ) return false;
+    memset( header, 0, sizeof( StoreHeader ) );
+    memcpy( header->magic, STORE_MAGIC, sizeof( header->magic ) );
+    header->version = STORE_VERSION;
+    header->order = STORE_ORDER;
+    header->source_mtime = info.lastModified().toTime_t();
+    header->source_size = info.size();
+    return true;
+}
+
+const char* SampleStore::__class_name = "SampleStore";
+SampleStore* SampleStore::__instance = 0;
+
+void SampleStore::create_instance( const QString& dir )
+{
+    if ( __instance == 0 ) {
+        __instance = new SampleStore( dir );
+    }
+}
+
+SampleStore::SampleStore( const QString& dir )
+    : Object( __class_name ),
+      __dir( dir ),
+      __budget( ( long long )STORE_BUDGET << 20 )
+{
+    if ( sizeof( StoreHeader ) != 64 ) ERRORLOG( "unexpected store header size" );
+    Filesystem::path_usable( __dir );
+    QString root = canonical_dir( Filesystem::sys_drumkits_dir() );
+    if ( !root.isEmpty() ) __roots << root;
+    root = canonical_dir( Filesystem::usr_drumkits_dir() );
+    if ( !root.isEmpty() ) __roots << root;
+}
+
+SampleStore::~SampleStore()
+{
+    if ( __instance == this ) __instance = 0;
+}
+
+QString SampleStore::get_path( const QString& filepath ) const
+{
+    QString path = QFileInfo( filepath ).canonicalFilePath();
+    if ( path.isEmpty() ) path = filepath;
+    QByteArray hash = QCryptographicHash::hash( path.toUtf8(), QCryptographicHash::Sha1 );
+    return __dir + "/" + QString( hash.toHex() ) + ".pcm";
+}
+
+bool SampleStore::accepts( const QString& filepath ) const
+{
+    // one-off files, previews or song samples, would only fill the store
+    QString path = QFileInfo( filepath ).canonicalFilePath();
+    if ( path.isEmpty() ) return false;
+    for ( int i = 0; i < __roots.size(); i++ ) {
+        if ( path.startsWith( __roots[i] ) ) return true;
+    }
+    return false;
+}
+
+#ifndef WIN32
+
+bool SampleStore::map( const QString& filepath, Mapping* mapping ) const
+{
+    StoreHeader expected;
+    if ( !source_header( filepath, &expected ) ) return false;
+    QByteArray path = get_path( filepath ).toLocal8Bit();
+    int fd = ::open( path.constData(), O_RDONLY );
+    if ( fd == -1 ) return false;
+    struct stat st;
+    if ( fstat( fd, &st ) != 0 || st.st_size < ( off_t )sizeof( StoreHeader ) ) {
+        ::close( fd );
+        return false;
+    }
+    size_t length = st.st_size;
+    void* address = mmap( 0, length, PROT_READ, MAP_SHARED, fd, 0 );
+    // the mapping holds its own reference to the file
+    ::close( fd );
+    if ( address == MAP_FAILED ) {
+        ERRORLOG( QString( "unable to map %1" ).arg( path.constData() ) );
+        return false;
+    }
+    const StoreHeader* header = ( const StoreHeader* )address;
+    if ( memcmp( header->magic, expected.magic, sizeof( header->magic ) ) != 0
+         || header->version != expected.version
+         || header->order != expected.order
+         || header->source_mtime != expected.source_mtime
+         || header->source_size != expected.source_size
+         || header->frames < 0
+         || ( header->channels != 1 && header->channels != 2 )
+         || length != file_length( header->frames, header->channels ) ) {
+        // stale or truncated, decode again
+        munmap( address, length );
+        return false;
+    }
+    // the modification time orders the files for eviction
+    utimes( path.constData(), 0 );
+    mapping->address = address;
+    mapping->length = length;
+    mapping->frames = header->frames;
+    mapping->sample_rate = header->sample_rate;
+    mapping->data_l = ( float* )( ( char* )address + sizeof( StoreHeader ) );
+    if ( header->channels == 1 ) {
+        mapping->data_r = mapping->data_l;
+    } else {
+        mapping->data_r = ( float* )( ( char* )address + right_offset( header->frames ) );
+    }
+    return true;
+}
+
+bool SampleStore::write( const QString& filepath, const float* data_l, const float* data_r, int frames, int sample_rate ) const
+{
+    StoreHeader header;
+    if ( !source_header( filepath, &header ) ) return false;
+    header.frames = frames;
+    header.sample_rate = sample_rate;
+    header.channels = ( data_r == data_l ? 1 : 2 );
+    size_t bytes = ( size_t )frames * sizeof( float );
+    QByteArray padding( right_offset( frames ) - sizeof( StoreHeader ) - bytes, 0 );
+
+    // written aside then renamed, a concurrent map() never sees a partial file
+    QTemporaryFile file( __dir + "/XXXXXX.part" );
+    if ( !file.open() ) {
+        ERRORLOG( QString( "unable to create a store file in %1" ).arg( __dir ) );
+        return false;
+    }
+    bool ok = file.write( ( const char* )&header, sizeof( StoreHeader ) ) == sizeof( StoreHeader )
+              && file.write( ( const char* )data_l, bytes ) == ( qint64 )bytes;
+    if ( ok && header.channels == 2 ) {
+        ok = file.write( padding ) == padding.size()
+             && file.write( ( const char* )data_r, bytes ) == ( qint64 )bytes;
+    }
+    ok = ok && file.flush();
+    if ( !ok ) {
+        ERRORLOG( QString( "unable to write %1" ).arg( file.fileName() ) );
+        return false;
+    }
+    QString path = get_path( filepath );
+    // rename replaces the stale file at once, the existing mappings are left alone
+    if ( ::rename( file.fileName().toLocal8Bit().constData(), path.toLocal8Bit().constData() ) != 0 ) {
+        ERRORLOG( QString( "unable to rename %1 to %2" ).arg( file.fileName() ).arg( path ) );
+        return false;
+    }
+    file.setAutoRemove( false );
+    __evict( path );
+    return true;
+}
+
+void SampleStore::__evict( const QString& keep ) const
+{
+    // least recently mapped first
+    QFileInfoList files = QDir( __dir ).entryInfoList( QStringList( "*.pcm" ), QDir::Files, QDir::Time | QDir::Reversed );
+    long long size = 0;
+    for ( int i = 0; i < files.size(); i++ ) size += files[i].size();
+    // the existing mappings of a removed file are left alone
+    for ( int i = 0; i < files.size() && size > __budget; i++ ) {
+        if ( files[i].absoluteFilePath() == QFileInfo( keep ).absoluteFilePath() ) continue;
+        if ( !Filesystem::rm( files[i].absoluteFilePath() ) ) break;
+        size -= files[i].size();
+    }
+}
+
+void SampleStore::unmap( const Mapping& mapping )
+{
+    munmap( mapping.address, mapping.length );
+}
+
+#else // WIN32
+
+bool SampleStore::map( const QString& filepath, Mapping* mapping ) const
+{
+    return false;
+}
+
+bool SampleStore::write( const QString& filepath, const float* data_l, const float* data_r, int frames, int sample_rate ) const
+{
+    return false;
+}
+
+void SampleStore::__evict( const QString& keep ) const
+{
+}
+
+void SampleStore::unmap( const Mapping& mapping )
+{
+}
+
+#endif // WIN32
+
+};
+
+/* vim: set softtabstop=4 expandtab: */
@@ -25,12 +25,14 @@
 #include <cassert>
 
 #include <hydrogen/basics/adsr.h>
+#include <hydrogen/basics/automation_lane.h>
 #include <hydrogen/LocalFileMng.h>
 #include <hydrogen/Preferences.h>
 
 #include <hydrogen/fx/Effects.h>
 #include <hydrogen/globals.h>
 #include <hydrogen/basics/song.h>
+#include <hydrogen/basics/song_binary.h>
 #include <hydrogen/basics/sample.h>
 #include <hydrogen/basics/instrument.h>
 #include <hydrogen/basics/instrument_list.h>
@@ -98,6 +100,10 @@ Song::~Song()
 
     delete __instrument_list;
 
+    for ( unsigned i = 0; i < __automation_lanes.size(); ++i ) {
+        delete __automation_lanes[i];
+    }
+
     INFOLOG( QString( "DESTROY '%1'" ).arg( __name ) );
 }
 
@@ -369,12 +375,23 @@ Song* SongReader::readSong( const QString& filename )
         return NULL;
     }
 
-    QDomDocument doc = LocalFileMng::openXmlDocument( filename );
+    // the compiled copy of the song, if it matches the file
+    SongBinary* pBinary = NULL;
+    if ( Preferences::get_instance()->m_bCompiledSongs ) {
+        pBinary = SongBinary::load( filename );
+    }
+    bool bCompiled = ( pBinary != NULL );
+    if ( bCompiled ) {
+        INFOLOG( "Loading the compiled copy of the song" );
+    }
+
+    QDomDocument doc = bCompiled ? pBinary->get_document() : LocalFileMng::openXmlDocument( filename );
     QDomNodeList nodeList = doc.elementsByTagName( "song" );
 
 
     if( nodeList.isEmpty() ) {
         ERRORLOG( "Error reading song: song node not found" );
+        delete pBinary;
         return NULL;
     }
 
@@ -627,6 +644,7 @@ Song* SongReader::readSong( const QString& filename )
         song->set_instrument_list( instrumentList );
     } else {
         ERRORLOG( "Error reading song: instrumentList node not found" );
+        delete pBinary;
         delete song;
         return NULL;
     }
@@ -639,6 +657,16 @@ Song* SongReader::readSong( const QString& filename )
     PatternList* patternList = new PatternList();
     int pattern_count = 0;
 
+    if ( bCompiled ) {
+        // the document holds no pattern, their notes come from the compiled copy
+        pattern_count = pBinary->get_pattern_count();
+        for ( int i = 0; i < pattern_count; i++ ) {
+            patternList->add( pBinary->get_pattern( i, instrumentList ) );
+        }
+        delete pBinary;
+        pBinary = NULL;
+    }
+
     QDomNode patternNode =  patterns.firstChildElement( "pattern" );
     while (  !patternNode.isNull()  ) {
         pattern_count++;
@@ -776,6 +804,27 @@ Song* SongReader::readSong( const QString& filename )
 
     song->set_pattern_group_vector( pPatternGroupVector );
 
+    if ( bCompiled ) {
+        // create the notes of the patterns played, the others are created on first access
+        for ( unsigned i = 0; i < pPatternGroupVector->size(); i++ ) {
+            PatternList* pGroup = ( *pPatternGroupVector )[i];
+            for ( unsigned j = 0; j < pGroup->size(); j++ ) {
+                Pattern* pPattern = pGroup->get( j );
+                pPattern->get_notes();
+                const Pattern::virtual_patterns_t* pVirtuals = pPattern->get_flattened_virtual_patterns();
+                for ( Pattern::virtual_patterns_cst_it_t it = pVirtuals->begin(); it != pVirtuals->end(); ++it ) {
+                    ( *it )->get_notes();
+                }
+            }
+        }
+        // selected in pattern mode
+        if ( patternList->size() > 0 ) {
+            patternList->get( 0 )->get_notes();
+        }
+        // the audio thread never creates them, the other patterns get theirs meanwhile
+        Pattern::create_pending_notes_in_background();
+    }
+
 #ifdef H2CORE_HAVE_LADSPA
     // reset FX
     for ( int fx = 0; fx < MAX_FX; ++fx ) {
@@ -832,6 +881,29 @@ Song* SongReader::readSong( const QString& filename )
         WARNINGLOG( "ladspa node not found" );
     }
 
+    // Automation
+    QDomNode automationNode = songNode.firstChildElement( "automation" );
+    QDomNode laneNode = automationNode.firstChildElement( "lane" );
+    while ( !laneNode.isNull() ) {
+        int nInstrument = LocalFileMng::readXmlInt( laneNode, "instrument", -1 );
+        QString sParameter = LocalFileMng::readXmlString( laneNode, "parameter", "" );
+        Instrument::Parameter parameter = AutomationLane::get_parameter_from_name( sParameter );
+        if ( parameter == Instrument::PARAMETER_COUNT ) {
+            ERRORLOG( QString( "Unknown automation parameter '%1'" ).arg( sParameter ) );
+        } else {
+            AutomationLane* pLane = new AutomationLane( nInstrument, parameter );
+            QDomNode pointNode = laneNode.firstChildElement( "point" );
+            while ( !pointNode.isNull() ) {
+                int nTick = LocalFileMng::readXmlInt( pointNode, "tick", 0 );
+                float fValue = LocalFileMng::readXmlFloat( pointNode, "value", 0.0 );
+                pLane->add_point( nTick, fValue );
+                pointNode = ( QDomNode ) pointNode.nextSiblingElement( "point" );
+            }
+            song->get_automation_lanes()->push_back( pLane );
+        }
+        laneNode = ( QDomNode ) laneNode.nextSiblingElement( "lane" );
+    }
+
 
     Hydrogen::get_instance()->m_timelinevector.clear();
     Hydrogen::HTimelineVector tlvector;
@@ -867,6 +939,11 @@ Song* SongReader::readSong( const QString& filename )
     }
 
 
+    // compiled once, the next loads use it until the file changes
+    if ( !bCompiled && Preferences::get_instance()->m_bCompiledSongs ) {
+        SongBinary::save( filename, doc, patternList );
+    }
+
     song->__is_modified = false;
     song->set_filename( filename );
 
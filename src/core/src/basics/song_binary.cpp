@@ -0,0 +1,286 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/basics/song_binary.h>
+#include <hydrogen/basics/instrument_list.h>
+#include <hydrogen/basics/pattern.h>
+#include <hydrogen/basics/pattern_list.h>
+
+#include <cstring>
+#include <QtCore/QCryptographicHash>
+
+#define BINARY_MAGIC    "H2SONG\0"
+#define BINARY_VERSION  1
+#define BINARY_ORDER    0x01020304
+#define BINARY_ALIGN    8
+
+namespace H2Core
+{
+
+/** head of a compiled file, the xml document follows then the patterns, each aligned on BINARY_ALIGN bytes */
+struct BinaryHeader {
+    char magic[8];                  ///< BINARY_MAGIC
+    qint32 version;                 ///< BINARY_VERSION
+    qint32 order;                   ///< BINARY_ORDER, as written by this machine
+    char hash[20];                  ///< sha1 of the song file
+    qint32 head_size;               ///< size of the xml document
+    qint32 pattern_count;           ///< number of patterns
+    char padding[20];               ///< up to 64 bytes
+};
+
+/** head of a pattern, its name and category follow then its notes */
+struct PatternHeader {
+    qint32 length;                  ///< length of the pattern
+    qint32 note_count;              ///< number of note records
+    qint32 name_size;               ///< size of the utf8 name
+    qint32 category_size;           ///< size of the utf8 category
+};
+
+/** a note of a pattern */
+struct NoteRecord {
+    qint32 instrument;              ///< id of the instrument
+    qint32 position;                ///< position within the pattern
+    qint32 length;                  ///< length of the note
+    float velocity;                 ///< velocity
+    float pan_l;                    ///< left pan
+    float pan_r;                    ///< right pan
+    float lead_lag;                 ///< lead or lag offset
+    float pitch;                    ///< pitch
+    qint8 key;                      ///< key
+    qint8 octave;                   ///< octave
+    qint8 note_off;                 ///< is a note off
+    qint8 reserved;                 ///< 0
+};
+
+/** round a size up to BINARY_ALIGN */
+static inline qint64 aligned( qint64 size )
+{
+    return ( size + BINARY_ALIGN - 1 ) & ~( qint64 )( BINARY_ALIGN - 1 );
+}
+
+/** offset of the note records of a pattern */
+static inline qint64 notes_offset( qint64 pattern, const PatternHeader* header )
+{
+    return aligned( pattern + sizeof( PatternHeader ) + header->name_size + header->category_size );
+}
+
+const char* SongBinary::__class_name = "SongBinary";
+
+SongBinary::SongBinary( const QString& path )
+    : Object( __class_name ),
+      __file( path ),
+      __data( 0 ),
+      __size( 0 )
+{
+    if ( sizeof( BinaryHeader ) != 64 ) ERRORLOG( "unexpected binary header size" );
+}
+
+SongBinary::~SongBinary()
+{
+    if ( __data ) __file.unmap( ( uchar* )__data );
+}
+
+QString SongBinary::get_path( const QString& song_path )
+{
+    return song_path + ".bin";
+}
+
+QByteArray SongBinary::__hash( const QString& song_path )
+{
+    QFile file( song_path );
+    if ( !file.open( QIODevice::ReadOnly ) ) return QByteArray();
+    return QCryptographicHash::hash( file.readAll(), QCryptographicHash::Sha1 );
+}
+
+SongBinary* SongBinary::load( const QString& song_path )
+{
+    if ( !QFile::exists( get_path( song_path ) ) ) return 0;
+    QByteArray hash = __hash( song_path );
+    if ( hash.size() != 20 ) return 0;
+    SongBinary* binary = new SongBinary( get_path( song_path ) );
+    if ( !binary->__map( hash ) ) {
+        delete binary;
+        return 0;
+    }
+    return binary;
+}
+
+bool SongBinary::__map( const QByteArray& hash )
+{
+    if ( !__file.open( QIODevice::ReadOnly ) ) return false;
+    __size = __file.size();
+    if ( __size < ( qint64 )sizeof( BinaryHeader ) ) return false;
+    __data = __file.map( 0, __size );
+    if ( __data == 0 ) {
+        ERRORLOG( QString( "unable to map %1" ).arg( __file.fileName() ) );
+        return false;
+    }
+    const BinaryHeader* header = ( const BinaryHeader* )__data;
+    if ( memcmp( header->magic, BINARY_MAGIC, sizeof( header->magic ) ) != 0
+         || header->version != BINARY_VERSION
+         || header->order != BINARY_ORDER
+         || memcmp( header->hash, hash.constData(), sizeof( header->hash ) ) != 0
+         || header->head_size < 0
+         || header->pattern_count < 0 ) {
+        // stale or foreign, the xml is loaded
+        return false;
+    }
+    qint64 offset = aligned( sizeof( BinaryHeader ) + ( qint64 )header->head_size );
+    for ( int i = 0; i < header->pattern_count; i++ ) {
+        if ( offset + ( qint64 )sizeof( PatternHeader ) > __size ) return false;
+        const PatternHeader* pattern = ( const PatternHeader* )( __data + offset );
+        if ( pattern->note_count < 0 || pattern->name_size < 0 || pattern->category_size < 0 ) return false;
+        __patterns.push_back( offset );
+        offset = aligned( notes_offset( offset, pattern ) + ( qint64 )pattern->note_count * sizeof( NoteRecord ) );
+    }
+    // truncated
+    if ( offset != __size ) return false;
+    return true;
+}
+
+QDomDocument SongBinary::get_document() const
+{
+    const BinaryHeader* header = ( const BinaryHeader* )__data;
+    QDomDocument doc;
+    doc.setContent( QByteArray::fromRawData( ( const char* )( __data + sizeof( BinaryHeader ) ), header->head_size ) );
+    return doc;
+}
+
+Pattern* SongBinary::get_pattern( int idx, InstrumentList* instruments ) const
+{
+    qint64 offset = __patterns[idx];
+    const PatternHeader* header = ( const PatternHeader* )( __data + offset );
+    const char* name = ( const char* )( header + 1 );
+    Pattern* pattern = new Pattern(
+        QString::fromUtf8( name, header->name_size ),
+        QString::fromUtf8( name + header->name_size, header->category_size ),
+        header->length
+    );
+    const NoteRecord* records = ( const NoteRecord* )( __data + notes_offset( offset, header ) );
+    std::vector<Pattern::PendingNote>* notes = new std::vector<Pattern::PendingNote>();
+    notes->reserve( header->note_count );
+    for ( int i = 0; i < header->note_count; i++ ) {
+        const NoteRecord& record = records[i];
+        Pattern::PendingNote note;
+        note.instrument = instruments->find( record.instrument );
+        if ( note.instrument == 0 ) {
+            ERRORLOG( QString( "Instrument with ID: '%1' not found. Note skipped." ).arg( record.instrument ) );
+            continue;
+        }
+        note.position = record.position;
+        note.length = record.length;
+        note.velocity = record.velocity;
+        note.pan_l = record.pan_l;
+        note.pan_r = record.pan_r;
+        note.lead_lag = record.lead_lag;
+        note.pitch = record.pitch;
+        note.key = ( Note::Key )qBound( KEY_MIN, ( int )record.key, KEY_MAX );
+        note.octave = ( Note::Octave )qBound( OCTAVE_MIN, ( int )record.octave, OCTAVE_MAX );
+        note.note_off = record.note_off != 0;
+        notes->push_back( note );
+    }
+    pattern->set_pending_notes( notes );
+    return pattern;
+}
+
+bool SongBinary::save( const QString& song_path, const QDomDocument& doc, PatternList* patterns )
+{
+    BinaryHeader header;
+    memset( &header, 0, sizeof( BinaryHeader ) );
+    QByteArray hash = __hash( song_path );
+    if ( hash.size() != 20 ) return false;
+
+    // the notes are stored as records, the document keeps the rest of the song
+    QDomDocument head = doc.cloneNode( true ).toDocument();
+    QDomElement pattern_list = head.documentElement().firstChildElement( "patternList" );
+    QDomElement pattern_node = pattern_list.firstChildElement( "pattern" );
+    while ( !pattern_node.isNull() ) {
+        QDomElement next = pattern_node.nextSiblingElement( "pattern" );
+        pattern_list.removeChild( pattern_node );
+        pattern_node = next;
+    }
+    QByteArray head_data = head.toByteArray( 0 );
+
+    memcpy( header.magic, BINARY_MAGIC, sizeof( header.magic ) );
+    header.version = BINARY_VERSION;
+    header.order = BINARY_ORDER;
+    memcpy( header.hash, hash.constData(), sizeof( header.hash ) );
+    header.head_size = head_data.size();
+    header.pattern_count = patterns->size();
+
+    QByteArray data( ( const char* )&header, sizeof( BinaryHeader ) );
+    data.append( head_data );
+    data.append( QByteArray( aligned( data.size() ) - data.size(), 0 ) );
+    for ( int i = 0; i < patterns->size(); i++ ) {
+        Pattern* pattern = patterns->get( i );
+        QByteArray name = pattern->get_name().toUtf8();
+        QByteArray category = pattern->get_category().toUtf8();
+        const Pattern::notes_t* notes = pattern->get_notes();
+        PatternHeader pattern_header;
+        pattern_header.length = pattern->get_length();
+        pattern_header.note_count = notes->size();
+        pattern_header.name_size = name.size();
+        pattern_header.category_size = category.size();
+        data.append( ( const char* )&pattern_header, sizeof( PatternHeader ) );
+        data.append( name );
+        data.append( category );
+        data.append( QByteArray( aligned( data.size() ) - data.size(), 0 ) );
+        FOREACH_NOTE_CST_IT_BEGIN_END( notes, it ) {
+            Note* note = it->second;
+            NoteRecord record;
+            memset( &record, 0, sizeof( NoteRecord ) );
+            record.instrument = note->get_instrument()->get_id();
+            record.position = note->get_position();
+            record.length = note->get_length();
+            record.velocity = note->get_velocity();
+            record.pan_l = note->get_pan_l();
+            record.pan_r = note->get_pan_r();
+            record.lead_lag = note->get_lead_lag();
+            record.pitch = note->get_pitch();
+            record.key = note->get_key();
+            record.octave = note->get_octave();
+            record.note_off = note->get_note_off();
+            data.append( ( const char* )&record, sizeof( NoteRecord ) );
+        }
+        data.append( QByteArray( aligned( data.size() ) - data.size(), 0 ) );
+    }
+
+    // written aside then renamed, a partial file is never loaded
+    QString path = get_path( song_path );
+    QFile file( path + ".part" );
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) {
+        WARNINGLOG( QString( "unable to write %1" ).arg( file.fileName() ) );
+        return false;
+    }
+    bool ok = file.write( data ) == data.size() && file.flush();
+    file.close();
+    if ( !ok || ( QFile::exists( path ) && !QFile::remove( path ) ) || !QFile::rename( file.fileName(), path ) ) {
+        WARNINGLOG( QString( "unable to write %1" ).arg( path ) );
+        QFile::remove( file.fileName() );
+        return false;
+    }
+    return true;
+}
+
+};
+
+/* vim: set softtabstop=4 expandtab: */
@@ -0,0 +1,230 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/basics/stretch_scheduler.h>
+
+#include <hydrogen/audio_engine.h>
+#include <hydrogen/hydrogen.h>
+#include <hydrogen/Preferences.h>
+#include <hydrogen/basics/song.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_list.h>
+#include <hydrogen/basics/instrument_layer.h>
+#include <hydrogen/sampler/Sampler.h>
+#include <hydrogen/sampler/layer_resampler.h>
+#include <hydrogen/IO/AudioOutput.h>
+
+#include <QtCore/QMutexLocker>
+#include <QtCore/QThread>
+
+namespace H2Core
+{
+
+const char* StretchScheduler::__class_name = "StretchScheduler";
+
+StretchScheduler::StretchScheduler( int threads )
+    : Object( __class_name ),
+      __bpm( 0 ),
+      __next( 0 ),
+      __done( 0 ),
+      __swapping( 0 ),
+      __generation( 0 ),
+      __quit( false )
+{
+    if ( threads <= 0 ) threads = QThread::idealThreadCount();
+    if ( threads <= 0 ) threads = 1;
+    for ( int i = 0; i < threads; i++ ) {
+        pthread_t thread;
+        if ( pthread_create( &thread, 0, StretchScheduler::__thread_main, this ) != 0 ) {
+            ERRORLOG( "unable to start a stretching thread" );
+            break;
+        }
+        __threads.push_back( thread );
+    }
+}
+
+StretchScheduler::~StretchScheduler()
+{
+    __mutex.lock();
+    __quit = true;
+    __generation++;
+    __clear();
+    __queued.wakeAll();
+    __mutex.unlock();
+    for ( unsigned i = 0; i < __threads.size(); i++ ) pthread_join( __threads[i], 0 );
+}
+
+void StretchScheduler::schedule( Song* song, float bpm )
+{
+    std::vector<Job> jobs;
+    if ( song && bpm > 0 ) {
+        AudioEngine::get_instance()->lock( RIGHT_HERE );
+        InstrumentList* instruments = song->get_instrument_list();
+        for ( unsigned i = 0; i < instruments->size(); i++ ) {
+            Instrument* instrument = instruments->get( i );
+            for ( int n = 0; n < MAX_LAYERS; n++ ) {
+                InstrumentLayer* layer = instrument->get_layer( n );
+                if ( !layer ) continue;
+                Sample* sample = layer->get_sample();
+                if ( !sample || !sample->get_rubberband().use ) continue;
+                Job job;
+                job.layer = layer;
+                job.source = sample;
+                job.filepath = sample->get_filepath();
+                job.loops = sample->get_loops();
+                job.rubberband = sample->get_rubberband();
+                job.velocity = *sample->get_velocity_envelope();
+                job.pan = *sample->get_pan_envelope();
+                job.result = 0;
+                jobs.push_back( job );
+            }
+        }
+        AudioEngine::get_instance()->unlock();
+    }
+
+    QMutexLocker lock( &__mutex );
+    // the tempo being processed is outdated, the running stretches are dropped once done
+    __generation++;
+    __clear();
+    if ( jobs.empty() ) {
+        __finished.wakeAll();
+        return;
+    }
+    INFOLOG( QString( "stretching %1 layers to %2 bpm" ).arg( jobs.size() ).arg( bpm ) );
+    __jobs = jobs;
+    __bpm = bpm;
+    if ( __threads.empty() ) {
+        // no thread could be started, stretch right away
+        lock.unlock();
+        __run();
+        return;
+    }
+    __queued.wakeAll();
+}
+
+void StretchScheduler::wait()
+{
+    QMutexLocker lock( &__mutex );
+    while ( !__jobs.empty() || __swapping > 0 ) __finished.wait( &__mutex );
+}
+
+int StretchScheduler::get_pending() const
+{
+    QMutexLocker lock( &__mutex );
+    return __jobs.size() - __done;
+}
+
+void StretchScheduler::__clear()
+{
+    for ( unsigned i = 0; i < __jobs.size(); i++ ) delete __jobs[i].result;
+    __jobs.clear();
+    __next = 0;
+    __done = 0;
+}
+
+void StretchScheduler::__swap( int generation, std::vector<Job>& jobs )
+{
+    std::vector<Sample*> replaced;
+    AudioEngine::get_instance()->lock( RIGHT_HERE );
+    __mutex.lock();
+    bool current = ( generation == __generation );
+    __mutex.unlock();
+    Song* song = Hydrogen::get_instance()->getSong();
+    if ( current && song ) {
+        Preferences* pref = Preferences::get_instance();
+        AudioOutput* output = Hydrogen::get_instance()->getAudioOutput();
+        LayerResampler* resampler = AudioEngine::get_instance()->get_sampler()->get_layer_resampler();
+        InstrumentList* instruments = song->get_instrument_list();
+        for ( unsigned j = 0; j < jobs.size(); j++ ) {
+            if ( !jobs[j].result ) continue;
+            // the layer may have been deleted or given another sample meanwhile
+            bool found = false;
+            for ( unsigned i = 0; i < instruments->size() && !found; i++ ) {
+                for ( int n = 0; n < MAX_LAYERS && !found; n++ ) {
+                    found = ( instruments->get( i )->get_layer( n ) == jobs[j].layer );
+                }
+            }
+            if ( !found || jobs[j].layer->get_sample() != jobs[j].source ) continue;
+            jobs[j].layer->set_sample( jobs[j].result );
+            jobs[j].result = 0;
+            replaced.push_back( jobs[j].source );
+            if ( pref->m_bResampleLayers && output ) resampler->add( jobs[j].layer, output->getSampleRate() );
+        }
+    }
+    AudioEngine::get_instance()->unlock();
+
+    // the sampler does not use the replaced samples anymore
+    for ( unsigned i = 0; i < replaced.size(); i++ ) delete replaced[i];
+    for ( unsigned j = 0; j < jobs.size(); j++ ) delete jobs[j].result;
+    INFOLOG( QString( "%1 stretched layers swapped in" ).arg( replaced.size() ) );
+}
+
+void StretchScheduler::__run()
+{
+    QMutexLocker lock( &__mutex );
+    while ( true ) {
+        if ( __quit ) return;
+        if ( __next == ( int )__jobs.size() ) {
+            if ( __threads.empty() ) return;
+            __queued.wait( &__mutex );
+            continue;
+        }
+        int job = __next++;
+        int generation = __generation;
+        float bpm = __bpm;
+        Job todo = __jobs[ job ];
+        lock.unlock();
+
+        // stretching runs unlocked, concurrently with the other threads
+        Sample* result = Sample::load( todo.filepath, todo.loops, todo.rubberband, todo.velocity, todo.pan, bpm );
+
+        lock.relock();
+        if ( generation != __generation ) {
+            // another tempo has been scheduled meanwhile
+            delete result;
+            continue;
+        }
+        __jobs[ job ].result = result;
+        if ( ++__done < ( int )__jobs.size() ) continue;
+
+        // the last stretch of the tempo swaps them all in
+        std::vector<Job> jobs;
+        jobs.swap( __jobs );
+        __next = __done = 0;
+        __swapping++;
+        lock.unlock();
+        __swap( generation, jobs );
+        lock.relock();
+        __swapping--;
+        __finished.wakeAll();
+    }
+}
+
+void* StretchScheduler::__thread_main( void* param )
+{
+    static_cast<StretchScheduler*>( param )->__run();
+    return 0;
+}
+
+};
+
+/* vim: set softtabstop=4 expandtab: */
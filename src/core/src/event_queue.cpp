@@ -38,14 +38,26 @@ const char* EventQueue::__class_name = "EventQueue";
 
 EventQueue::EventQueue()
 		: Object( __class_name )
-		, __read_index( 0 )
 		, __write_index( 0 )
+		, __read_index( 0 )
+		, __dropped_events( 0 )
+		, __reported_dropped_events( 0 )
+		, __progress_pending( 0 )
+		, __progress_value( 0 )
+		, __midi_notes( MAX_EVENTS )
 {
 	__instance = this;
 
 	for ( int i = 0; i < MAX_EVENTS; ++i ) {
-		__events_buffer[ i ].type = EVENT_NONE;
-		__events_buffer[ i ].value = 0;
+		__events_buffer[ i ].sequence = i;
+		__events_buffer[ i ].event.type = EVENT_NONE;
+		__events_buffer[ i ].event.value = 0;
+	}
+	for ( int i = 0; i < MAX_INSTRUMENTS; ++i ) {
+		__noteon_pending[ i ] = 0;
+	}
+	for ( int i = 0; i < EVENT_METRONOME_VALUES; ++i ) {
+		__metronome_pending[ i ] = 0;
 	}
 }
 
@@ -56,30 +68,123 @@ EventQueue::~EventQueue()
 }
 
 
-void EventQueue::push_event( EventType type, int nValue )
+QAtomicInt* EventQueue::__pending_flag( EventType type, int nValue )
+{
+	switch ( type ) {
+	case EVENT_NOTEON:
+		if ( nValue >= 0 && nValue < MAX_INSTRUMENTS ) {
+			return &__noteon_pending[ nValue ];
+		}
+		break;
+	case EVENT_METRONOME:
+		if ( nValue >= 0 && nValue < EVENT_METRONOME_VALUES ) {
+			return &__metronome_pending[ nValue ];
+		}
+		break;
+	case EVENT_PROGRESS:
+		return &__progress_pending;
+	default:
+		break;
+	}
+	return NULL;
+}
+
+
+bool EventQueue::push_event( EventType type, int nValue )
 {
-	int nIndex = ++__write_index;
-	nIndex = nIndex % MAX_EVENTS;
-//	infoLog( "[pushEvent] " + toString( nIndex ) );
-	Event ev;
-	ev.type = type;
-	ev.value = nValue;
-	__events_buffer[ nIndex ] = ev;
+	if ( type == EVENT_PROGRESS ) {
+		__progress_value.fetchAndStoreRelease( nValue );
+	}
+	QAtomicInt* pPending = __pending_flag( type, nValue );
+	if ( pPending == NULL ) {
+		return __push( type, nValue );
+	}
+	if ( !pPending->testAndSetOrdered( 0, 1 ) ) {
+		// the same event is already waiting
+		return true;
+	}
+	if ( !__push( type, nValue ) ) {
+		pPending->fetchAndStoreRelease( 0 );
+		return false;
+	}
+	return true;
+}
+
+
+bool EventQueue::__push( EventType type, int nValue )
+{
+	unsigned nIndex = ( int )__write_index;
+	Slot* pSlot;
+	while ( true ) {
+		pSlot = &__events_buffer[ nIndex & ( MAX_EVENTS - 1 ) ];
+		int nDiff = ( unsigned )pSlot->sequence.fetchAndAddAcquire( 0 ) - nIndex;
+		if ( nDiff == 0 ) {
+			// the slot is free, claim it
+			if ( __write_index.testAndSetRelaxed( nIndex, nIndex + 1 ) ) {
+				break;
+			}
+			nIndex = ( int )__write_index;
+		} else if ( nDiff < 0 ) {
+			// a lap ahead of the reader, the queue is full
+			__dropped_events.fetchAndAddRelaxed( 1 );
+			return false;
+		} else {
+			// another thread claimed it
+			nIndex = ( int )__write_index;
+		}
+	}
+	pSlot->event.type = type;
+	pSlot->event.value = nValue;
+	pSlot->sequence.fetchAndStoreRelease( nIndex + 1 );
+	return true;
 }
 
 
 Event EventQueue::pop_event()
 {
-	if ( __read_index == __write_index ) {
+	int nDropped = __dropped_events;
+	if ( nDropped != __reported_dropped_events ) {
+		WARNINGLOG( QString( "%1 events dropped, the queue was full" ).arg( nDropped - __reported_dropped_events ) );
+		__reported_dropped_events = nDropped;
+	}
+
+	unsigned nIndex = ( int )__read_index;
+	Slot* pSlot = &__events_buffer[ nIndex & ( MAX_EVENTS - 1 ) ];
+	if ( ( int )( ( unsigned )pSlot->sequence.fetchAndAddAcquire( 0 ) - ( nIndex + 1 ) ) < 0 ) {
 		Event ev;
 		ev.type = EVENT_NONE;
 		ev.value = 0;
 		return ev;
 	}
-	int nIndex = ++__read_index;
-	nIndex = nIndex % MAX_EVENTS;
-//	infoLog( "[popEvent] " + toString( nIndex ) );
-	return __events_buffer[ nIndex ];
+	Event ev = pSlot->event;
+	// hand the slot over to the writers of the next lap
+	pSlot->sequence.fetchAndStoreRelease( nIndex + MAX_EVENTS );
+	__read_index.fetchAndStoreRelease( nIndex + 1 );
+
+	QAtomicInt* pPending = __pending_flag( ev.type, ev.value );
+	if ( pPending != NULL ) {
+		pPending->fetchAndStoreOrdered( 0 );
+		if ( ev.type == EVENT_PROGRESS ) {
+			ev.value = __progress_value.fetchAndAddAcquire( 0 );
+		}
+	}
+	return ev;
+}
+
+
+bool EventQueue::push_midi_note( const AddMidiNoteVector& note )
+{
+	if ( !__midi_notes.push( note ) ) {
+		__dropped_events.fetchAndAddRelaxed( 1 );
+		return false;
+	}
+	return true;
+}
+
+
+bool EventQueue::pop_midi_note( AddMidiNoteVector& note )
+{
+	return __midi_notes.pop( note );
 }
 
 };
@@ -25,10 +25,10 @@
 
 #include <hydrogen/Preferences.h>
 #include <hydrogen/fx/LadspaFX.h>
-#include <hydrogen/audio_engine.h>
 
 #include <algorithm>
 #include <QDir>
+#include <QMutexLocker>
 #include <QLibrary>
 #include <cassert>
 
@@ -49,12 +49,15 @@ Effects::Effects()
 		: Object( __class_name )
 		, m_pRootGroup( NULL )
 		, m_pRecentGroup( NULL )
+		, m_pPlayingChain( NULL )
 {
 	__instance = this;
 
+	LadspaFXChain *pChain = new LadspaFXChain;
 	for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
-		m_FXList[ nFX ] = NULL;
+		pChain->m_FX[ nFX ] = NULL;
 	}
+	m_pChain = pChain;
 
 	getPluginList();
 }
@@ -82,9 +85,11 @@ Effects::~Effects()
 	}
 	m_pluginList.clear();
 
+	LadspaFXChain *pChain = m_pChain;
 	for ( int nFX = 0; nFX < MAX_FX; ++nFX ) {
-		delete m_FXList[ nFX ];
+		delete pChain->m_FX[ nFX ];
 	}
+	delete pChain;
 }
 
 
@@ -92,7 +97,15 @@ Effects::~Effects()
 LadspaFX* Effects::getLadspaFX( int nFX )
 {
 	assert( nFX < MAX_FX );
-	return m_FXList[ nFX ];
+	return ( ( LadspaFXChain* )m_pChain )->m_FX[ nFX ];
+}
+
+
+
+static void destroyLadspaFX( void* pFX )
+{
+	static_cast<LadspaFX*>( pFX )->deactivate();
+	delete static_cast<LadspaFX*>( pFX );
 }
 
 
@@ -102,23 +115,40 @@ void  Effects::setLadspaFX( LadspaFX* pFX, int nFX )
 	assert( nFX < MAX_FX );
 	//INFOLOG( "[setLadspaFX] FX: " + pFX->getPluginLabel() + ", " + to_string( nFX ) );
 
-	AudioEngine::get_instance()->lock( RIGHT_HERE );
+	QMutexLocker lock( &m_chainMutex );
 
+	LadspaFXChain *pOldChain = m_pChain;
+	LadspaFXChain *pNewChain = new LadspaFXChain( *pOldChain );
+	pNewChain->m_FX[ nFX ] = pFX;
+	m_pChain.fetchAndStoreOrdered( pNewChain );
 
-	if ( m_FXList[ nFX ] ) {
-		( m_FXList[ nFX ] )->deactivate();
-		delete m_FXList[ nFX ];
+	// the audio thread may still be playing the previous effect
+	if ( pOldChain->m_FX[ nFX ] ) {
+		m_reclaimer.retire( pOldChain->m_FX[ nFX ], destroyLadspaFX );
 	}
+	m_reclaimer.retire( pOldChain );
+	m_reclaimer.collect();
 
-	m_FXList[ nFX ] = pFX;
-	
 	if ( pFX != NULL ) {
 		Preferences::get_instance()->setMostRecentFX( pFX->getPluginName() );
 		updateRecentGroup();
 	}
+}
 
 
-	AudioEngine::get_instance()->unlock();
+
+void Effects::beginProcess()
+{
+	m_reclaimer.enter();
+	m_pPlayingChain = m_pChain;
+}
+
+
+
+void Effects::endProcess()
+{
+	m_pPlayingChain = NULL;
+	m_reclaimer.leave();
 }
 
 
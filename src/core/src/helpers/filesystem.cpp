@@ -19,6 +19,7 @@
 #define DEMOS           "/demo_songs"
 #define XSD             "/xsd"
 #define TMP             "/hydrogen"
+#define CACHE           "/cache"
 
 // files
 #define GUI_CONFIG      "/gui.conf"
@@ -376,6 +377,10 @@ QString Filesystem::xsd_dir()
 {
     return __sys_data_path + XSD;
 }
+QString Filesystem::cache_dir()
+{
+    return __usr_data_path + CACHE;
+}
 QString Filesystem::tmp_dir()
 {
     return QDir::tempPath() + TMP;
@@ -462,6 +467,7 @@ bool Filesystem::song_exists( const QString& sg_name )
 void Filesystem::info()
 {
     INFOLOG( QString( "Tmp dir                    : %1" ).arg( tmp_dir() ) );
+    INFOLOG( QString( "Cache dir                  : %1" ).arg( cache_dir() ) );
     INFOLOG( QString( "Images dir                 : %1" ).arg( img_dir() ) );
     INFOLOG( QString( "Documentation dir          : %1" ).arg( doc_dir() ) );
     INFOLOG( QString( "Internationalization dir   : %1" ).arg( i18n_dir() ) );
@@ -0,0 +1,368 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/helpers/library_index.h>
+#include <hydrogen/helpers/filesystem.h>
+#include <hydrogen/basics/drumkit.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_layer.h>
+#include <hydrogen/basics/instrument_list.h>
+#include <hydrogen/basics/sample.h>
+#include <hydrogen/LocalFileMng.h>
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QSet>
+#include <QtXml/QDomDocument>
+
+#include <sndfile.h>
+
+#define INDEX_MAGIC     0x4832494e
+#define INDEX_VERSION   1
+
+namespace H2Core
+{
+
+/**
+ * return the modification time of a file or a directory, -1 if it does not exist
+ * A time in the current or the previous second is not trusted, another change may
+ * follow within the same second, -2 is returned then so that it never matches.
+ */
+static qint64 modification_time( const QFileInfo& info )
+{
+    if ( !info.exists() ) return -1;
+    qint64 mtime = info.lastModified().toTime_t();
+    if ( mtime >= ( qint64 )QDateTime::currentDateTime().toTime_t() - 1 ) return -2;
+    return mtime;
+}
+
+const char* LibraryIndex::__class_name = "LibraryIndex";
+LibraryIndex* LibraryIndex::__instance = 0;
+
+void LibraryIndex::create_instance( const QString& path )
+{
+    if ( __instance == 0 ) {
+        __instance = new LibraryIndex( path );
+    }
+}
+
+LibraryIndex::LibraryIndex( const QString& path )
+    : Object( __class_name ),
+      __path( path ),
+      __modified( false )
+{
+    __load();
+}
+
+LibraryIndex::~LibraryIndex()
+{
+    save();
+    if ( __instance == this ) __instance = 0;
+}
+
+std::vector<LibraryIndex::DrumkitInfo> LibraryIndex::get_drumkits( const QString& dir )
+{
+    QMutexLocker lock( &__mutex );
+    std::vector<DrumkitInfo> drumkits;
+    QString prefix = QDir::cleanPath( dir ) + "/";
+    QStringList entries = __list( QDir::cleanPath( dir ), true );
+    QSet<QString> paths;
+    for ( int i = 0; i < entries.size(); i++ ) {
+        paths.insert( prefix + entries[i] );
+    }
+    // the drumkits removed
+    QMap<QString, DrumkitInfo>::iterator it = __drumkits.begin();
+    while ( it != __drumkits.end() ) {
+        if ( it.key().startsWith( prefix ) && !paths.contains( it.key() ) ) {
+            it = __drumkits.erase( it );
+            __modified = true;
+        } else {
+            ++it;
+        }
+    }
+    for ( int i = 0; i < entries.size(); i++ ) {
+        QString path = prefix + entries[i];
+        if ( __update_drumkit( path ) ) drumkits.push_back( __drumkits[ path ] );
+    }
+    if ( __modified ) __save();
+    return drumkits;
+}
+
+std::vector<LibraryIndex::PatternInfo> LibraryIndex::get_patterns()
+{
+    QMutexLocker lock( &__mutex );
+    std::vector<PatternInfo> patterns;
+    QString dir = QDir::cleanPath( Filesystem::patterns_dir() );
+    // the patterns are stored by drumkit, as LocalFileMng lists them
+    QStringList paths;
+    QStringList subdirs = __list( dir, true );
+    for ( int i = 0; i < subdirs.size(); i++ ) {
+        QString subdir = dir + "/" + subdirs[i];
+        QStringList files = __list( subdir, false );
+        for ( int j = 0; j < files.size(); j++ ) {
+            paths << subdir + "/" + files[j];
+        }
+    }
+    QSet<QString> known;
+    for ( int i = 0; i < paths.size(); i++ ) {
+        known.insert( paths[i] );
+    }
+    // the patterns removed
+    QMap<QString, PatternInfo>::iterator it = __patterns.begin();
+    while ( it != __patterns.end() ) {
+        if ( it.key().startsWith( dir + "/" ) && !known.contains( it.key() ) ) {
+            it = __patterns.erase( it );
+            __modified = true;
+        } else {
+            ++it;
+        }
+    }
+    for ( int i = 0; i < paths.size(); i++ ) {
+        if ( __update_pattern( paths[i] ) ) patterns.push_back( __patterns[ paths[i] ] );
+    }
+    if ( __modified ) __save();
+    return patterns;
+}
+
+bool LibraryIndex::get_pattern( const QString& path, PatternInfo* info )
+{
+    QMutexLocker lock( &__mutex );
+    QString key = QDir::cleanPath( path );
+    if ( !__update_pattern( key ) ) return false;
+    *info = __patterns[ key ];
+    return true;
+}
+
+void LibraryIndex::save()
+{
+    QMutexLocker lock( &__mutex );
+    if ( __modified ) __save();
+}
+
+QStringList LibraryIndex::__list( const QString& dir, bool dirs )
+{
+    QString key = dir + ( dirs ? "|dirs" : "|patterns" );
+    qint64 mtime = modification_time( QFileInfo( dir ) );
+    QMap<QString, Listing>::const_iterator it = __listings.find( key );
+    if ( it != __listings.end() && it->mtime == mtime && mtime >= 0 ) return it->entries;
+
+    Listing listing;
+    listing.mtime = mtime;
+    if ( mtime != -1 ) {
+        if ( dirs ) {
+            listing.entries = QDir( dir ).entryList( QDir::Dirs | QDir::NoDotAndDotDot );
+        } else {
+            listing.entries = QDir( dir ).entryList( QStringList( "*.h2pattern" ), QDir::Files );
+        }
+    }
+    __listings[ key ] = listing;
+    __modified = true;
+    return listing.entries;
+}
+
+bool LibraryIndex::__update_drumkit( const QString& dk_path )
+{
+    QFileInfo file( Filesystem::drumkit_file( dk_path ) );
+    qint64 mtime = modification_time( file );
+    QMap<QString, DrumkitInfo>::iterator it = __drumkits.find( dk_path );
+    if ( it != __drumkits.end() && it->mtime == mtime && it->size == file.size() && mtime >= 0 ) return true;
+
+    Drumkit* drumkit = ( mtime != -1 ) ? Drumkit::load_file( file.filePath() ) : 0;
+    if ( drumkit == 0 ) {
+        if ( it != __drumkits.end() ) {
+            __drumkits.erase( it );
+            __modified = true;
+        }
+        return false;
+    }
+    INFOLOG( QString( "indexing drumkit %1" ).arg( dk_path ) );
+    DrumkitInfo info;
+    info.path = dk_path;
+    info.name = drumkit->get_name();
+    info.author = drumkit->get_author();
+    info.info = drumkit->get_info();
+    info.license = drumkit->get_license();
+    info.mtime = mtime;
+    info.size = file.size();
+    InstrumentList* instruments = drumkit->get_instruments();
+    for ( int i = 0; i < instruments->size(); i++ ) {
+        Instrument* instrument = instruments->get( i );
+        float length = -1;
+        for ( int n = 0; n < MAX_LAYERS; n++ ) {
+            InstrumentLayer* layer = instrument->get_layer( n );
+            if ( layer ) length = std::max( length, __sample_length( layer->get_sample()->get_filepath() ) );
+        }
+        info.instruments << instrument->get_name();
+        info.lengths.push_back( length );
+    }
+    delete drumkit;
+    __drumkits[ dk_path ] = info;
+    __modified = true;
+    return true;
+}
+
+bool LibraryIndex::__update_pattern( const QString& path )
+{
+    QFileInfo file( path );
+    qint64 mtime = modification_time( file );
+    QMap<QString, PatternInfo>::iterator it = __patterns.find( path );
+    if ( it != __patterns.end() && it->mtime == mtime && it->size == file.size() && mtime >= 0 ) return true;
+
+    QDomNode root;
+    QDomDocument doc;
+    if ( mtime != -1 ) {
+        doc = LocalFileMng::openXmlDocument( path );
+        root = doc.firstChildElement( "drumkit_pattern" );
+    }
+    if ( root.isNull() ) {
+        if ( it != __patterns.end() ) {
+            __patterns.erase( it );
+            __modified = true;
+        }
+        return false;
+    }
+    // as read by LocalFileMng
+    QDomNode pattern_node = root.firstChildElement( "pattern" );
+    PatternInfo info;
+    info.path = path;
+    info.name = LocalFileMng::readXmlString( pattern_node, "pattern_name", "" );
+    info.category = LocalFileMng::readXmlString( pattern_node, "category", "" );
+    info.drumkit = LocalFileMng::readXmlString( root, "pattern_for_drumkit", "" );
+    info.mtime = mtime;
+    info.size = file.size();
+    __patterns[ path ] = info;
+    __modified = true;
+    return true;
+}
+
+float LibraryIndex::__sample_length( const QString& path )
+{
+    SF_INFO sound_info;
+    SNDFILE* file = sf_open( path.toLocal8Bit(), SFM_READ, &sound_info );
+    if ( !file ) return -1;
+    sf_close( file );
+    if ( sound_info.samplerate <= 0 ) return -1;
+    return ( float )sound_info.frames / sound_info.samplerate;
+}
+
+void LibraryIndex::__load()
+{
+    QFile file( __path );
+    if ( !file.open( QIODevice::ReadOnly ) ) return;
+    QDataStream in( &file );
+    in.setVersion( QDataStream::Qt_4_0 );
+    quint32 magic;
+    qint32 version;
+    in >> magic >> version;
+    if ( magic != INDEX_MAGIC || version != INDEX_VERSION ) {
+        WARNINGLOG( QString( "ignoring the outdated library index %1" ).arg( __path ) );
+        return;
+    }
+    qint32 count;
+    in >> count;
+    for ( int i = 0; i < count && in.status() == QDataStream::Ok; i++ ) {
+        QString key;
+        Listing listing;
+        qint32 entries;
+        in >> key >> listing.mtime >> entries;
+        for ( int j = 0; j < entries && in.status() == QDataStream::Ok; j++ ) {
+            QString entry;
+            in >> entry;
+            listing.entries << entry;
+        }
+        __listings[ key ] = listing;
+    }
+    in >> count;
+    for ( int i = 0; i < count && in.status() == QDataStream::Ok; i++ ) {
+        DrumkitInfo info;
+        qint32 instruments;
+        in >> info.path >> info.name >> info.author >> info.info >> info.license >> info.mtime >> info.size >> instruments;
+        for ( int j = 0; j < instruments && in.status() == QDataStream::Ok; j++ ) {
+            QString name;
+            float length;
+            in >> name >> length;
+            info.instruments << name;
+            info.lengths.push_back( length );
+        }
+        __drumkits[ info.path ] = info;
+    }
+    in >> count;
+    for ( int i = 0; i < count && in.status() == QDataStream::Ok; i++ ) {
+        PatternInfo info;
+        in >> info.path >> info.name >> info.category >> info.drumkit >> info.mtime >> info.size;
+        __patterns[ info.path ] = info;
+    }
+    if ( in.status() != QDataStream::Ok ) {
+        WARNINGLOG( QString( "ignoring the truncated library index %1" ).arg( __path ) );
+        __listings.clear();
+        __drumkits.clear();
+        __patterns.clear();
+    }
+    file.close();
+}
+
+void LibraryIndex::__save()
+{
+    Filesystem::path_usable( QFileInfo( __path ).path(), true, true );
+    // written aside then renamed, a partial index is never read
+    QFile file( __path + ".part" );
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) {
+        WARNINGLOG( QString( "unable to write %1" ).arg( file.fileName() ) );
+        return;
+    }
+    QDataStream out( &file );
+    out.setVersion( QDataStream::Qt_4_0 );
+    out << ( quint32 )INDEX_MAGIC << ( qint32 )INDEX_VERSION;
+    out << ( qint32 )__listings.size();
+    for ( QMap<QString, Listing>::const_iterator it = __listings.begin(); it != __listings.end(); ++it ) {
+        out << it.key() << it->mtime << ( qint32 )it->entries.size();
+        for ( int j = 0; j < it->entries.size(); j++ ) {
+            out << it->entries[j];
+        }
+    }
+    out << ( qint32 )__drumkits.size();
+    for ( QMap<QString, DrumkitInfo>::const_iterator it = __drumkits.begin(); it != __drumkits.end(); ++it ) {
+        out << it->path << it->name << it->author << it->info << it->license << it->mtime << it->size << ( qint32 )it->instruments.size();
+        for ( int j = 0; j < it->instruments.size(); j++ ) {
+            out << it->instruments[j] << it->lengths[j];
+        }
+    }
+    out << ( qint32 )__patterns.size();
+    for ( QMap<QString, PatternInfo>::const_iterator it = __patterns.begin(); it != __patterns.end(); ++it ) {
+        out << it->path << it->name << it->category << it->drumkit << it->mtime << it->size;
+    }
+    file.close();
+    if ( out.status() != QDataStream::Ok || ( QFile::exists( __path ) && !QFile::remove( __path ) ) || !QFile::rename( file.fileName(), __path ) ) {
+        WARNINGLOG( QString( "unable to write %1" ).arg( __path ) );
+        QFile::remove( file.fileName() );
+        return;
+    }
+    __modified = false;
+}
+
+};
+
+/* vim: set softtabstop=4 expandtab: */
@@ -0,0 +1,142 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/helpers/reclaimer.h>
+
+#include <algorithm>
+#include <pthread.h>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QWaitCondition>
+
+#define RECLAIM_PERIOD  100         // ms between two collections
+
+namespace H2Core
+{
+
+const char* Reclaimer::__class_name = "Reclaimer";
+
+// the living reclaimers, collected by a single thread started with the first one,
+// allocated once and never freed so that the thread can outlive the static destructors
+static QMutex* reclaimers_mutex = 0;
+static std::vector<Reclaimer*>* reclaimers = 0;
+
+/** collecting thread, writers which stop retiring still get their objects destroyed */
+static void* collector_main( void* param )
+{
+    QWaitCondition period;
+    QMutexLocker lock( reclaimers_mutex );
+    while ( true ) {
+        for ( unsigned i = 0; i < reclaimers->size(); i++ ) ( *reclaimers )[i]->collect();
+        period.wait( reclaimers_mutex, RECLAIM_PERIOD );
+    }
+    return 0;
+}
+
+Reclaimer::Reclaimer( bool periodic )
+    : Object( __class_name ),
+      __epoch( 0 ),
+      __reader( -1 ),
+      __periodic( periodic )
+{
+    if ( !__periodic ) return;
+    static pthread_once_t once = PTHREAD_ONCE_INIT;
+    pthread_once( &once, &Reclaimer::__start_collector );
+    QMutexLocker lock( reclaimers_mutex );
+    reclaimers->push_back( this );
+}
+
+void Reclaimer::__start_collector()
+{
+    reclaimers_mutex = new QMutex;
+    reclaimers = new std::vector<Reclaimer*>;
+    pthread_t thread;
+    if ( pthread_create( &thread, 0, collector_main, 0 ) != 0 ) {
+        _ERRORLOG( "unable to start the collecting thread" );
+        return;
+    }
+    pthread_detach( thread );
+}
+
+Reclaimer::~Reclaimer()
+{
+    if ( __periodic ) {
+        reclaimers_mutex->lock();
+        reclaimers->erase( std::find( reclaimers->begin(), reclaimers->end(), this ) );
+        reclaimers_mutex->unlock();
+    }
+    if ( ( int )__reader != -1 ) {
+        ERRORLOG( "destroyed while the audio thread is in its cycle" );
+    }
+    QMutexLocker lock( &__mutex );
+    for ( unsigned i = 0; i < __retired.size(); i++ ) {
+        __retired[i].destroy( __retired[i].object );
+    }
+    __retired.clear();
+}
+
+void Reclaimer::retire( void* object, void ( *destroy )( void* ) )
+{
+    if ( object == 0 ) return;
+    QMutexLocker lock( &__mutex );
+    Retired retired;
+    retired.object = object;
+    retired.destroy = destroy;
+    // the new snapshot is published, a cycle entered at a later epoch reads it
+    retired.epoch = __epoch.fetchAndAddOrdered( 1 );
+    __retired.push_back( retired );
+}
+
+void Reclaimer::collect()
+{
+    QMutexLocker lock( &__mutex );
+    if ( __retired.empty() ) return;
+    int reader = __reader.fetchAndAddOrdered( 0 );
+    if ( reader == -1 ) {
+        // out of a cycle, the next one will only see the current snapshots
+        __destroy_before( __epoch );
+    } else {
+        __destroy_before( reader );
+    }
+}
+
+void Reclaimer::__destroy_before( int epoch )
+{
+    unsigned kept = 0;
+    for ( unsigned i = 0; i < __retired.size(); i++ ) {
+        if ( __retired[i].epoch < epoch ) {
+            __retired[i].destroy( __retired[i].object );
+        } else {
+            __retired[ kept++ ] = __retired[i];
+        }
+    }
+    __retired.resize( kept );
+}
+
+int Reclaimer::get_pending() const
+{
+    QMutexLocker lock( &__mutex );
+    return __retired.size();
+}
+
+};
+
+/* vim: set softtabstop=4 expandtab: */
@@ -1,19 +1,84 @@
 
 #include <hydrogen/helpers/xml.h>
+#include <hydrogen/helpers/filesystem.h>
 
+#include <QtCore/QDateTime>
 #include <QtCore/QFile>
+#include <QtCore/QFileInfo>
 #include <QtCore/QLocale>
+#include <QtCore/QMap>
+#include <QtCore/QMutex>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QSet>
 #include <QtCore/QString>
+#include <QtCore/QStringList>
 #include <QtCore/QTextStream>
+#include <QtCore/QXmlStreamReader>
 #include <QtXmlPatterns/QXmlSchema>
 #include <QtXmlPatterns/QXmlSchemaValidator>
 
 #define XMLNS_BASE "http://www.hydrogen-music.org/"
 #define XMLNS_XSI "http://www.w3.org/2001/XMLSchema-instance"
 
+#define VALIDATION_CACHE        "/xml_validation"
+#define VALIDATION_CACHE_MAX    4096
+
 namespace H2Core
 {
 
+/** guards the validation cache and the schemas, the loader threads read drumkits too */
+static QMutex validation_mutex;
+/** keys of the files known to be valid, loaded from the cache file on first use */
+static QSet<QString>* validated_files = 0;
+/** the schemas loaded so far by path, an invalid one is kept as such */
+static QMap<QString, QXmlSchema>* schemas = 0;
+
+/** return the key recording that a file is valid against a schema, empty if one of them is missing */
+static QString validation_key( const QString& filepath, const QString& schemapath )
+{
+    QFileInfo file( filepath );
+    QFileInfo schema( schemapath );
+    if ( !file.exists() || !schema.exists() ) return QString();
+    return QString( "%1\t%2\t%3\t%4\t%5" )
+           .arg( file.lastModified().toTime_t() ).arg( file.size() )
+           .arg( schema.lastModified().toTime_t() )
+           .arg( schema.canonicalFilePath() ).arg( file.canonicalFilePath() );
+}
+
+/** load the keys of the cache file, called with validation_mutex locked */
+static void load_validated_files()
+{
+    validated_files = new QSet<QString>();
+    QFile file( Filesystem::cache_dir() + VALIDATION_CACHE );
+    if ( !file.open( QIODevice::ReadOnly | QIODevice::Text ) ) return;
+    QTextStream in( &file );
+    in.setCodec( "UTF-8" );
+    while ( !in.atEnd() ) {
+        QString key = in.readLine();
+        if ( !key.isEmpty() ) validated_files->insert( key );
+    }
+    file.close();
+    // the keys of modified files pile up, start again once too many
+    if ( validated_files->size() > VALIDATION_CACHE_MAX ) {
+        validated_files->clear();
+        QFile::remove( file.fileName() );
+    }
+}
+
+/** record a valid file in the cache file, called with validation_mutex locked */
+static void add_validated_file( const QString& key )
+{
+    validated_files->insert( key );
+    if ( !Filesystem::path_usable( Filesystem::cache_dir(), true, true ) ) return;
+    QFile file( Filesystem::cache_dir() + VALIDATION_CACHE );
+    if ( !file.open( QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text ) ) return;
+    QTextStream out( &file );
+    out.setCodec( "UTF-8" );
+    out << key << "\n";
+    out.flush();
+    file.close();
+}
+
 const char* XMLNode::__class_name ="XMLNode";
 
 XMLNode::XMLNode() : Object( __class_name ) { }
@@ -25,7 +90,24 @@ QString XMLNode::read_child_node( const QString& node, bool inexistent_ok, bool
         DEBUGLOG( QString( "try to read %1 XML node from an empty parent %2." ).arg( node ).arg( nodeName() ) );
         return 0;
     }
-    QDomElement el = firstChildElement( node );
+    QDomElement el;
+    if( __walked.contains( node ) ) {
+        // the first one lies before the cursor
+        el = firstChildElement( node );
+    } else {
+        // none before the cursor, the first one after it is the first one
+        QStringList names;
+        el = ( __cursor.isNull() ? firstChildElement() : __cursor.nextSiblingElement() );
+        while( !el.isNull() ) {
+            names << el.tagName();
+            if( el.tagName()==node ) break;
+            el = el.nextSiblingElement();
+        }
+        if( !el.isNull() ) {
+            __cursor = el;
+            for( int i=0; i<names.size(); i++ ) __walked.insert( names[i] );
+        }
+    }
     if( el.isNull() ) {
         if( !inexistent_ok ) DEBUGLOG( QString( "XML node %1->%2 should exists." ).arg( nodeName() ).arg( node ) );
         return 0;
@@ -112,41 +194,62 @@ const char* XMLDoc::__class_name ="XMLDoc";
 
 XMLDoc::XMLDoc( ) : Object( __class_name ) { }
 
-bool XMLDoc::read( const QString& filepath, const QString& schemapath )
+bool XMLDoc::is_validated( const QString& filepath, const QString& schemapath )
 {
-    QXmlSchema schema;
-    bool schema_usable = false;
-    if( schemapath!=0 ) {
-        QFile file( schemapath );
-        if ( !file.open( QIODevice::ReadOnly ) ) {
+    QString key = validation_key( filepath, schemapath );
+    if ( key.isEmpty() ) return false;
+    QMutexLocker lock( &validation_mutex );
+    if ( validated_files==0 ) load_validated_files();
+    return validated_files->contains( key );
+}
+
+bool XMLDoc::__validate( QFile* file, const QString& schemapath )
+{
+    QString key = validation_key( file->fileName(), schemapath );
+    QMutexLocker lock( &validation_mutex );
+    if ( validated_files==0 ) load_validated_files();
+    if ( !key.isEmpty() && validated_files->contains( key ) ) return true;
+
+    if ( schemas==0 ) schemas = new QMap<QString, QXmlSchema>();
+    if ( !schemas->contains( schemapath ) ) {
+        QXmlSchema schema;
+        QFile schema_file( schemapath );
+        if ( !schema_file.open( QIODevice::ReadOnly ) ) {
             ERRORLOG( QString( "Unable to open XML schema %1 for reading" ).arg( schemapath ) );
         } else {
-            schema.load( &file, QUrl::fromLocalFile( file.fileName() ) );
-            file.close();
-            if ( schema.isValid() ) {
-                schema_usable = true;
-            } else {
-                ERRORLOG( QString( "%2 XML schema is not valid" ).arg( schemapath ) );
-            }
+            schema.load( &schema_file, QUrl::fromLocalFile( schema_file.fileName() ) );
+            schema_file.close();
+            if ( !schema.isValid() ) ERRORLOG( QString( "%2 XML schema is not valid" ).arg( schemapath ) );
         }
+        schemas->insert( schemapath, schema );
+    }
+    const QXmlSchema& schema = ( *schemas )[ schemapath ];
+    if ( !schema.isValid() ) return true;
+
+    QXmlSchemaValidator validator( schema );
+    if ( !validator.validate( file, QUrl::fromLocalFile( file->fileName() ) ) ) {
+        ERRORLOG( QString( "XML document %1 is not valid (%2), loading may fail" ).arg( file->fileName() ).arg( schemapath ) );
+        return false;
     }
+    INFOLOG( QString( "XML document %1 is valid (%2)" ).arg( file->fileName() ).arg( schemapath ) );
+    file->seek( 0 );
+    if ( !key.isEmpty() ) add_validated_file( key );
+    return true;
+}
+
+bool XMLDoc::read( const QString& filepath, const QString& schemapath )
+{
     QFile file( filepath );
     if ( !file.open( QIODevice::ReadOnly ) ) {
         ERRORLOG( QString( "Unable to open %1 for reading" ).arg( filepath ) );
         return false;
     }
-    if ( schema_usable ) {
-        QXmlSchemaValidator validator( schema );
-        if ( !validator.validate( &file, QUrl::fromLocalFile( file.fileName() ) ) ) {
-            ERRORLOG( QString( "XML document %1 is not valid (%2), loading may fail" ).arg( filepath ).arg( schemapath ) );
-            file.close();
-            return false;
-        } else {
-            INFOLOG( QString( "XML document %1 is valid (%2)" ).arg( filepath ).arg( schemapath ) );
-        }
-        file.seek( 0 );
+    if ( schemapath!=0 && !__validate( &file, schemapath ) ) {
+        file.close();
+        return false;
     }
-    if( !setContent( &file ) ) {
+    XMLReader reader;
+    if( !reader.read( &file, this ) ) {
         ERRORLOG( QString( "Unable to read XML document %1" ).arg( filepath ) );
         file.close();
         return false;
@@ -185,6 +288,63 @@ void XMLDoc::set_root( const QString& node_name, const QString& xmlns )
     appendChild( root );
 }
 
+const char* XMLReader::__class_name ="XMLReader";
+
+XMLReader::XMLReader( ) : Object( __class_name ) { }
+
+bool XMLReader::read( QIODevice* device, QDomDocument* doc )
+{
+    QXmlStreamReader reader( device );
+    return __read( &reader, doc );
+}
+
+bool XMLReader::read( const QByteArray& data, QDomDocument* doc )
+{
+    QXmlStreamReader reader( data );
+    return __read( &reader, doc );
+}
+
+bool XMLReader::__read( QXmlStreamReader* reader, QDomDocument* doc )
+{
+    // as QDomDocument::setContent, the xmlns declarations are plain attributes
+    reader->setNamespaceProcessing( false );
+    QDomNode parent;
+    while ( !reader->atEnd() ) {
+        switch( reader->readNext() ) {
+        case QXmlStreamReader::StartElement: {
+            QDomElement el = doc->createElement( reader->qualifiedName().toString() );
+            QXmlStreamAttributes attributes = reader->attributes();
+            for ( int i=0; i<attributes.size(); i++ ) {
+                el.setAttribute( attributes[i].qualifiedName().toString(), attributes[i].value().toString() );
+            }
+            if ( parent.isNull() ) {
+                doc->appendChild( el );
+            } else {
+                parent.appendChild( el );
+            }
+            parent = el;
+            break;
+        }
+        case QXmlStreamReader::EndElement:
+            parent = parent.parentNode();
+            break;
+        case QXmlStreamReader::Characters:
+            if ( !parent.isNull() && !reader->isWhitespace() ) {
+                parent.appendChild( doc->createTextNode( reader->text().toString() ) );
+            }
+            break;
+        default:
+            // comments, processing instructions and dtd are not read back
+            break;
+        }
+    }
+    if ( reader->hasError() ) {
+        ERRORLOG( QString( "%1 at line %2, column %3" ).arg( reader->errorString() ).arg( reader->lineNumber() ).arg( reader->columnNumber() ) );
+        return false;
+    }
+    return true;
+}
+
 };
 
 /* vim: set softtabstop=4 expandtab: */
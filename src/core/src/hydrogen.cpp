@@ -33,7 +33,7 @@
 #include <cassert>
 #include <cstdio>
 #include <deque>
-#include <queue>
+#include <vector>
 #include <iostream>
 #include <ctime>
 #include <cmath>
@@ -45,6 +45,7 @@
 #include <hydrogen/LocalFileMng.h>
 #include <hydrogen/event_queue.h>
 #include <hydrogen/basics/adsr.h>
+#include <hydrogen/basics/automation_lane.h>
 #include <hydrogen/basics/drumkit.h>
 #include <hydrogen/h2_exception.h>
 #include <hydrogen/audio_engine.h>
@@ -52,11 +53,18 @@
 #include <hydrogen/basics/instrument_list.h>
 #include <hydrogen/basics/instrument_layer.h>
 #include <hydrogen/basics/sample.h>
+#include <hydrogen/basics/sample_loader.h>
+#include <hydrogen/basics/stretch_scheduler.h>
 #include <hydrogen/hydrogen.h>
 #include <hydrogen/basics/pattern.h>
 #include <hydrogen/basics/pattern_list.h>
 #include <hydrogen/basics/note.h>
+#include <hydrogen/basics/note_queue.h>
+#include <hydrogen/basics/sample_cache.h>
+#include <hydrogen/basics/sample_store.h>
 #include <hydrogen/helpers/filesystem.h>
+#include <hydrogen/helpers/library_index.h>
+#include <hydrogen/helpers/ring_buffer.h>
 #include <hydrogen/fx/LadspaFX.h>
 #include <hydrogen/fx/Effects.h>
 #include <hydrogen/IO/AudioOutput.h>
@@ -68,6 +76,7 @@
 #include <hydrogen/IO/TransportInfo.h>
 #include <hydrogen/Preferences.h>
 #include <hydrogen/sampler/Sampler.h>
+#include <hydrogen/sampler/layer_resampler.h>
 #include <hydrogen/midi_map.h>
 #include <hydrogen/playlist.h>
 
@@ -123,21 +132,54 @@ QMutex mutex_OutputPointer;     ///< Mutex for audio output pointer, allows mult
 MidiInput *m_pMidiDriver = NULL;	///< MIDI input
 MidiOutput *m_pMidiDriverOut = NULL;	///< MIDI output
 
-// overload the the > operator of Note objects for priority_queue
-struct compare_pNotes {
-       bool operator() (Note* pNote1, Note* pNote2) {
-              return (pNote1->get_humanize_delay()
-                      + pNote1->get_position() * m_pAudioDriver->m_transport.m_nTickSize)
-                            >
-                            (pNote2->get_humanize_delay()
-                             + pNote2->get_position() * m_pAudioDriver->m_transport.m_nTickSize);
+// start frame of a queued note.  if there is a negative Humanize delay,
+// take it into account so we don't miss the time slice.  positive delays
+// are handled by the sampler.
+static long long audioEngine_noteStartFrame( Note* pNote )
+{
+       long long nStart = ( long long )( pNote->get_position() * m_pAudioDriver->m_transport.m_nTickSize );
+       if ( pNote->get_humanize_delay() < 0 ) {
+              nStart += pNote->get_humanize_delay();
        }
-};
+       return nStart;
+}
 
-/// Song Note FIFO
-std::priority_queue<Note*, std::deque<Note*>, compare_pNotes > m_songNoteQueue;
+/// Create the notes of a pattern about to be played and of its virtual
+/// patterns, so that the audio thread does not have to. Called by the gui
+/// and the midi threads, see Pattern::set_pending_notes()
+static void createPatternNotes( Pattern* pPattern )
+{
+       if ( pPattern == NULL ) {
+              return;
+       }
+       pPattern->get_notes();
+       const Pattern::virtual_patterns_t* pVirtuals = pPattern->get_flattened_virtual_patterns();
+       for ( Pattern::virtual_patterns_cst_it_t it = pVirtuals->begin(); it != pVirtuals->end(); ++it ) {
+              ( *it )->get_notes();
+       }
+}
+
+/// Song Note FIFO, scheduled on the start frame of the notes
+NoteQueue m_songNoteQueue;
+/// tick size the start frames of the notes in m_songNoteQueue were computed with
+float m_fNoteQueueTickSize = 0;
 std::deque<Note*> m_midiNoteQueue;	///< Midi Note FIFO
 
+/// A note played from the GUI, waiting for the audio thread
+struct RealtimeNote {
+       int instrument;
+       float velocity;
+       float pan_L;
+       float pan_R;
+       float pitch;
+       bool noteOff;
+       bool forcePlay;
+       int msg1;
+       timeval time;		///< when the note was played
+};
+/// Notes played from the GUI, see Hydrogen::addRealtimeNote()
+RingBuffer<RealtimeNote> m_realtimeNoteQueue( MIDI_INPUT_NOTE_QUEUE_SIZE );
+
 Song *m_pSong;				///< Current song
 PatternList* m_pNextPatterns;		///< Next pattern (used only in Pattern mode)
 bool m_bAppendNextPattern;		///< Add the next pattern to the list instead
@@ -181,6 +223,8 @@ int m_nLookaheadFrames = 0;
 int m_nSongSizeInTicks = 0;
 
 struct timeval m_currentTickTime;
+/// Start of the current audio cycle, refreshed by every audioEngine_process()
+timespec m_currentCycleTime;
 
 unsigned long m_nRealtimeFrames = 0;
 unsigned int m_naddrealtimenotetickposition = 0;
@@ -202,6 +246,7 @@ inline void audioEngine_clearNoteQueue();
 inline void audioEngine_process_checkBPMChanged();
 inline void audioEngine_process_playNotes( unsigned long nframes );
 inline void audioEngine_process_transport();
+inline void audioEngine_process_automation();
 
 inline unsigned audioEngine_renderNote( Note* pNote, const unsigned& nBufferSize );
 inline int audioEngine_updateNoteQueue( unsigned nFrames );
@@ -214,6 +259,7 @@ void audioEngine_seek( long long nFrames, bool bLoopMode = false );
 void audioEngine_restartAudioDrivers();
 void audioEngine_startAudioDrivers();
 void audioEngine_stopAudioDrivers();
+void audioEngine_resampleLayers();
 
 
 inline timeval currentTime2()
@@ -287,6 +333,8 @@ void audioEngine_init()
        m_pMainBuffer_L = NULL;
        m_pMainBuffer_R = NULL;
 
+       m_songNoteQueue.reserve( Preferences::get_instance()->m_nMaxNotes + NOTE_POOL_LOOKAHEAD );
+
        srand( time( NULL ) );
 
        // Create metronome instrument
@@ -326,15 +374,14 @@ void audioEngine_destroy()
        ___INFOLOG( "*** Hydrogen audio engine shutdown ***" );
 
        // delete all copied notes in the song notes queue
-       while ( !m_songNoteQueue.empty() ) {
-              m_songNoteQueue.top()->get_instrument()->dequeue();
-              delete m_songNoteQueue.top();
-              m_songNoteQueue.pop();
+       while ( Note *pQueuedNote = m_songNoteQueue.pop_any() ) {
+              pQueuedNote->get_instrument()->dequeue();
+              AudioEngine::get_instance()->get_note_pool()->release( pQueuedNote );
        }
        // delete all copied notes in the midi notes queue
        for ( unsigned i = 0; i < m_midiNoteQueue.size(); ++i ) {
               Note *note = m_midiNoteQueue[i];
-              delete note;
+              AudioEngine::get_instance()->get_note_pool()->release( note );
               note = NULL;
        }
        m_midiNoteQueue.clear();
@@ -430,10 +477,9 @@ void audioEngine_stop( bool bLockEngine )
        m_nPatternStartTick = -1;
 
        // delete all copied notes in the song notes queue
-       while(!m_songNoteQueue.empty()){
-              m_songNoteQueue.top()->get_instrument()->dequeue();
-              delete m_songNoteQueue.top();
-              m_songNoteQueue.pop();
+       while ( Note *pQueuedNote = m_songNoteQueue.pop_any() ) {
+              pQueuedNote->get_instrument()->dequeue();
+              AudioEngine::get_instance()->get_note_pool()->release( pQueuedNote );
        }
        /*	// delete all copied notes in the playing notes queue
   for (unsigned i = 0; i < m_playingNotesQueue.size(); ++i) {
@@ -446,7 +492,7 @@ void audioEngine_stop( bool bLockEngine )
        // delete all copied notes in the midi notes queue
        for ( unsigned i = 0; i < m_midiNoteQueue.size(); ++i ) {
               Note *note = m_midiNoteQueue[i];
-              delete note;
+              AudioEngine::get_instance()->get_note_pool()->release( note );
        }
        m_midiNoteQueue.clear();
 
@@ -492,7 +538,10 @@ inline void audioEngine_process_checkBPMChanged()
                                           ->calculateFrameOffset();
                      }
 #endif
-                     EventQueue::get_instance()->push_event( EVENT_RECALCULATERUBBERBAND, -1);
+                     // the export recomputes the rubberband samples itself, before rendering
+                     if ( m_pAudioDriver->class_name() != DiskWriterDriver::class_name() ) {
+                            EventQueue::get_instance()->push_event( EVENT_RECALCULATERUBBERBAND, -1);
+                     }
               }
        }
 }
@@ -508,75 +557,54 @@ inline void audioEngine_process_playNotes( unsigned long nframes )
               framepos = m_nRealtimeFrames;
        }
 
-       // reading from m_songNoteQueue
-       while ( !m_songNoteQueue.empty() ) {
-              Note *pNote = m_songNoteQueue.top();
-
-              // verifico se la nota rientra in questo ciclo
-              unsigned int noteStartInFrames =
-                            (int)( pNote->get_position() * m_pAudioDriver->m_transport.m_nTickSize );
-
-              // if there is a negative Humanize delay, take into account so
-              // we don't miss the time slice.  ignore positive delay, or we
-              // might end the queue processing prematurely based on NoteQueue
-              // placement.  the sampler handles positive delay.
-              if (pNote->get_humanize_delay() < 0) {
-                     noteStartInFrames += pNote->get_humanize_delay();
-              }
-
-              // m_nTotalFrames <= NotePos < m_nTotalFrames + bufferSize
-              bool isNoteStart = ( ( noteStartInFrames >= framepos )
-                                   && ( noteStartInFrames < ( framepos + nframes ) ) );
-              bool isOldNote = noteStartInFrames < framepos;
-              if ( isNoteStart || isOldNote ) {
-                     // Humanize - Velocity parameter
-                     if ( m_pSong->get_humanize_velocity_value() != 0 ) {
-                            float random = m_pSong->get_humanize_velocity_value()
-                                          * getGaussian( 0.2 );
-                            pNote->set_velocity(
-                                                 pNote->get_velocity()
-                                                 + ( random
-                                                     - ( m_pSong->get_humanize_velocity_value() / 2.0 ) )
-                                                 );
-                            if ( pNote->get_velocity() > 1.0 ) {
-                                   pNote->set_velocity( 1.0 );
-                            } else if ( pNote->get_velocity() < 0.0 ) {
-                                   pNote->set_velocity( 0.0 );
-                            }
+       // the queued notes start at new frames once the tick size changed,
+       // whether by a tempo change, a jack relocation or the export
+       float fTickSize = m_pAudioDriver->m_transport.m_nTickSize;
+       if ( fTickSize != m_fNoteQueueTickSize && fTickSize != 0 ) {
+              m_songNoteQueue.reschedule( audioEngine_noteStartFrame );
+              m_fNoteQueueTickSize = fTickSize;
+       }
+
+       // reading from m_songNoteQueue the notes starting before the end of
+       // this cycle, late ones included: NotePos < m_nTotalFrames + bufferSize
+       Note *pNote;
+       while ( ( pNote = m_songNoteQueue.pop( ( long long )framepos + nframes ) ) ) {
+              // Humanize - Velocity parameter
+              if ( m_pSong->get_humanize_velocity_value() != 0 ) {
+                     float random = m_pSong->get_humanize_velocity_value()
+                                   * getGaussian( 0.2 );
+                     pNote->set_velocity(
+                                          pNote->get_velocity()
+                                          + ( random
+                                              - ( m_pSong->get_humanize_velocity_value() / 2.0 ) )
+                                          );
+                     if ( pNote->get_velocity() > 1.0 ) {
+                            pNote->set_velocity( 1.0 );
+                     } else if ( pNote->get_velocity() < 0.0 ) {
+                            pNote->set_velocity( 0.0 );
                      }
+              }
 
-                     // Random Pitch ;)
-                     const float fMaxPitchDeviation = 2.0;
-                     pNote->set_pitch( pNote->get_pitch()
-                                       + ( fMaxPitchDeviation * getGaussian( 0.2 )
-                                           - fMaxPitchDeviation / 2.0 )
-                                       * pNote->get_instrument()->get_random_pitch_factor() );
-
-                     Instrument * noteInstrument = pNote->get_instrument();
-                     if ( noteInstrument->is_stop_notes() ){
-                            Note *pOffNote = new Note( noteInstrument,
-                                                       0.0,
-                                                       0.0,
-                                                       0.0,
-                                                       0.0,
-                                                       -1,
-                                                       0 );
-                            pOffNote->set_note_off( true );
-                            AudioEngine::get_instance()->get_sampler()->note_on( pOffNote );
-                     }
+              // Random Pitch ;)
+              const float fMaxPitchDeviation = 2.0;
+              pNote->set_pitch( pNote->get_pitch()
+                                + ( fMaxPitchDeviation * getGaussian( 0.2 )
+                                    - fMaxPitchDeviation / 2.0 )
+                                * pNote->get_instrument()->get_random_pitch_factor() );
+
+              Instrument * noteInstrument = pNote->get_instrument();
+              if ( noteInstrument->is_stop_notes() ){
+                     Note *pOffNote = AudioEngine::get_instance()->get_note_pool()->get( noteInstrument, 0.0, 0.0, 0.0, 0.0, -1, 0 );
+                     pOffNote->set_note_off( true );
+                     AudioEngine::get_instance()->get_sampler()->note_on( pOffNote );
+              }
 
-                     AudioEngine::get_instance()->get_sampler()->note_on( pNote );
+              AudioEngine::get_instance()->get_sampler()->note_on( pNote );
 
-                     m_songNoteQueue.pop(); // rimuovo la nota dalla lista di note
-                     pNote->get_instrument()->dequeue();
-                     // raise noteOn event
-                     int nInstrument = m_pSong->get_instrument_list()->index( pNote->get_instrument() );
-                     EventQueue::get_instance()->push_event( EVENT_NOTEON, nInstrument );
-                     continue;
-              } else {
-                     // this note will not be played
-                     break;
-              }
+              pNote->get_instrument()->dequeue();
+              // raise noteOn event
+              int nInstrument = m_pSong->get_instrument_list()->index( pNote->get_instrument() );
+              EventQueue::get_instance()->push_event( EVENT_NOTEON, nInstrument );
        }
 }
 
@@ -675,17 +703,16 @@ void audioEngine_clearNoteQueue()
        //___INFOLOG( "clear notes...");
 
        // delete all copied notes in the song notes queue
-       while (!m_songNoteQueue.empty()) {
-              m_songNoteQueue.top()->get_instrument()->dequeue();
-              delete m_songNoteQueue.top();
-              m_songNoteQueue.pop();
+       while ( Note *pQueuedNote = m_songNoteQueue.pop_any() ) {
+              pQueuedNote->get_instrument()->dequeue();
+              AudioEngine::get_instance()->get_note_pool()->release( pQueuedNote );
        }
 
        AudioEngine::get_instance()->get_sampler()->stop_playing_notes();
 
        // delete all copied notes in the midi notes queue
        for ( unsigned i = 0; i < m_midiNoteQueue.size(); ++i ) {
-              delete m_midiNoteQueue[i];
+              AudioEngine::get_instance()->get_note_pool()->release( m_midiNoteQueue[i] );
        }
        m_midiNoteQueue.clear();
 
@@ -712,23 +739,20 @@ inline void audioEngine_process_clearAudioBuffers( uint32_t nFrames )
               memset( m_pMainBuffer_R, 0, nFrames * sizeof( float ) );
        }
 
-#ifdef H2CORE_HAVE_JACK
-       JackOutput* jo = dynamic_cast<JackOutput*>(m_pAudioDriver);
-       if( jo && jo->has_track_outs() ) {
+       if( m_pAudioDriver && m_pAudioDriver->has_track_outs() ) {
               float* buf;
               int k;
-              for( k=0 ; k<jo->getNumTracks() ; ++k ) {
-                     buf = jo->getTrackOut_L(k);
+              for( k=0 ; k<m_pAudioDriver->getNumTracks() ; ++k ) {
+                     buf = m_pAudioDriver->getTrackOut_L(k);
                      if( buf ) {
                             memset( buf, 0, nFrames * sizeof( float ) );
                      }
-                     buf = jo->getTrackOut_R(k);
+                     buf = m_pAudioDriver->getTrackOut_R(k);
                      if( buf ) {
                             memset( buf, 0, nFrames * sizeof( float ) );
                      }
               }
        }
-#endif
 
        mx.unlock();
 
@@ -736,7 +760,7 @@ inline void audioEngine_process_clearAudioBuffers( uint32_t nFrames )
        if ( m_audioEngineState >= STATE_READY ) {
               Effects* pEffects = Effects::get_instance();
               for ( unsigned i = 0; i < MAX_FX; ++i ) {	// clear FX buffers
-                     LadspaFX* pFX = pEffects->getLadspaFX( i );
+                     LadspaFX* pFX = pEffects->getPlayingLadspaFX( i );
                      if ( pFX ) {
                             assert( pFX->m_pBuffer_L );
                             assert( pFX->m_pBuffer_R );
@@ -748,10 +772,56 @@ inline void audioEngine_process_clearAudioBuffers( uint32_t nFrames )
 #endif
 }
 
+/// Play the notes queued by the MIDI driver and the GUI
+inline void audioEngine_process_realtimeNotes()
+{
+       if ( m_pMidiDriver ) {
+              m_pMidiDriver->processQueuedNotes();
+       }
+
+       Hydrogen* pEngine = Hydrogen::get_instance();
+       RealtimeNote note;
+       while ( m_realtimeNoteQueue.pop( note ) ) {
+              pEngine->__playRealtimeNote( note.instrument, note.velocity, note.pan_L, note.pan_R,
+                                           note.pitch, note.noteOff, note.forcePlay, note.msg1, note.time );
+       }
+}
+
+/// Set the targets of the automated instrument parameters at the position of the song
+inline void audioEngine_process_automation()
+{
+       if ( m_audioEngineState != STATE_PLAYING || m_pSong->get_mode() != Song::SONG_MODE ) {
+              return;
+       }
+       std::vector<AutomationLane*>* pLanes = m_pSong->get_automation_lanes();
+       if ( pLanes->empty() ) {
+              return;
+       }
+       double fTick = m_pAudioDriver->m_transport.m_nFrames / ( double )m_pAudioDriver->m_transport.m_nTickSize;
+       InstrumentList* pInstruments = m_pSong->get_instrument_list();
+       for ( unsigned i = 0; i < pLanes->size(); ++i ) {
+              ( *pLanes )[ i ]->process( fTick, pInstruments );
+       }
+}
+
+#ifdef H2CORE_HAVE_LADSPA
+/// Holds the snapshot of the LADSPA effects for the length of an audio cycle
+struct LadspaFXCycle
+{
+       LadspaFXCycle() { Effects::get_instance()->beginProcess(); }
+       ~LadspaFXCycle() { Effects::get_instance()->endProcess(); }
+};
+#endif
+
 /// Main audio processing function. Called by audio drivers.
 int audioEngine_process( uint32_t nframes, void* /*arg*/ )
 {
        timeval startTimeval = currentTime2();
+       clock_gettime( CLOCK_MONOTONIC, &m_currentCycleTime );
+
+#ifdef H2CORE_HAVE_LADSPA
+       LadspaFXCycle fxCycle;
+#endif
 
        audioEngine_process_clearAudioBuffers( nframes );
 
@@ -780,6 +850,10 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
        audioEngine_process_transport();
        audioEngine_process_checkBPMChanged(); // m_pSong->__bpm decides tick size
 
+       // notes played live since the last cycle, before they are taken
+       // from the midi note queue
+       audioEngine_process_realtimeNotes();
+
        bool sendPatternChange = false;
        // always update note queue.. could come from pattern or realtime input
        // (midi, keyboard)
@@ -807,6 +881,9 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
               sendPatternChange = true;
        }
 
+       // automated parameters follow the song position
+       audioEngine_process_automation();
+
        // play all notes
        audioEngine_process_playNotes( nframes );
 
@@ -838,7 +915,7 @@ int audioEngine_process( uint32_t nframes, void* /*arg*/ )
        // Process LADSPA FX
        if ( m_audioEngineState >= STATE_READY ) {
               for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
-                     LadspaFX *pFX = Effects::get_instance()->getLadspaFX( nFX );
+                     LadspaFX *pFX = Effects::get_instance()->getPlayingLadspaFX( nFX );
                      if ( ( pFX ) && ( pFX->isEnabled() ) ) {
                             pFX->processFX( nframes );
                             float *buf_L = NULL;
@@ -986,6 +1063,18 @@ void audioEngine_renameJackPorts()
 
 
 
+/// Convert the layers of the song to the driver sample rate, or drop the converted ones
+void audioEngine_resampleLayers()
+{
+       int nSampleRate = 0;
+       if ( Preferences::get_instance()->m_bResampleLayers && m_pAudioDriver ) {
+              nSampleRate = m_pAudioDriver->getSampleRate();
+       }
+       AudioEngine::get_instance()->get_sampler()->get_layer_resampler()->update( m_pSong, nSampleRate );
+}
+
+
+
 void audioEngine_setSong( Song *newSong )
 {
        ___WARNINGLOG( QString( "Set song: %1" ).arg( newSong->__name ) );
@@ -1039,6 +1128,8 @@ void audioEngine_setSong( Song *newSong )
 
        AudioEngine::get_instance()->unlock();
 
+       audioEngine_resampleLayers();
+
        EventQueue::get_instance()->push_event( EVENT_STATE, STATE_READY );
 }
 
@@ -1070,6 +1161,9 @@ void audioEngine_removeSong()
        m_audioEngineState = STATE_PREPARED;
        AudioEngine::get_instance()->unlock();
 
+       // drops the conversions of the song
+       audioEngine_resampleLayers();
+
        EventQueue::get_instance()->push_event( EVENT_STATE, STATE_PREPARED );
 }
 
@@ -1140,7 +1234,7 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
                             // printf ("tick=%d  pos=%d\n", tick, note->getPosition());
                             m_midiNoteQueue.pop_front();
                             note->get_instrument()->enqueue();
-                            m_songNoteQueue.push( note );
+                            m_songNoteQueue.push( note, audioEngine_noteStartFrame( note ) );
                      } else {
                             break;
                      }
@@ -1198,7 +1292,7 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
                                    ___INFOLOG( "End of Song" );
 
                                    if( Hydrogen::get_instance()->getMidiOutput() != NULL ){
-                                          Hydrogen::get_instance()->getMidiOutput()->handleQueueAllNoteOff();
+                                          Hydrogen::get_instance()->getMidiOutput()->handleQueueAllNoteOffFromAudio();
                                    }
 
                                    return -1;
@@ -1296,16 +1390,9 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
                             m_pMetronomeInstrument->set_volume(
                                                  Preferences::get_instance()->m_fMetronomeVolume
                                                  );
-                            Note *pMetronomeNote = new Note( m_pMetronomeInstrument,
-                                                             tick,
-                                                             fVelocity,
-                                                             0.5,
-                                                             0.5,
-                                                             -1,
-                                                             fPitch
-                                                             );
+                            Note *pMetronomeNote = AudioEngine::get_instance()->get_note_pool()->get( m_pMetronomeInstrument, tick, fVelocity, 0.5, 0.5, -1, fPitch );
                             m_pMetronomeInstrument->enqueue();
-                            m_songNoteQueue.push( pMetronomeNote );
+                            m_songNoteQueue.push( pMetronomeNote, audioEngine_noteStartFrame( pMetronomeNote ) );
                      }
               }
 
@@ -1316,7 +1403,9 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
                            ++nPat ) {
                             Pattern *pPattern = m_pPlayingPatterns->get( nPat );
                             assert( pPattern != NULL );
-                            Pattern::notes_t* notes = (Pattern::notes_t*)pPattern->get_notes();
+                            // the notes of a pattern loaded from a compiled song are
+                            // created off the audio thread, see createPatternNotes()
+                            Pattern::notes_t* notes = (Pattern::notes_t*)pPattern->get_created_notes();
                             // Delete notes before attempting to play them
                             if ( doErase ) {
                                    FOREACH_NOTE_IT_BOUND(notes,it,m_nPatternTickPosition) {
@@ -1336,7 +1425,7 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
                                                  noteAction.b_isInstrumentMode = false;
                                                  noteAction.b_isMidi = false;
                                                  noteAction.b_noteExist = false;
-                                                 EventQueue::get_instance()->m_addMidiNoteVector.push_back(noteAction);
+                                                 EventQueue::get_instance()->push_midi_note(noteAction);
                                           }
                                    }
                             }
@@ -1378,13 +1467,13 @@ inline int audioEngine_updateNoteQueue( unsigned nFrames )
                                           if((tick == 0) && (nOffset < 0)) {
                                                  nOffset = 0;
                                           }
-                                          Note *pCopiedNote = new Note( pNote );
+                                          Note *pCopiedNote = AudioEngine::get_instance()->get_note_pool()->copy( pNote );
                                           pCopiedNote->set_position( tick );
 
                                           // humanize time
                                           pCopiedNote->set_humanize_delay( nOffset );
                                           pNote->get_instrument()->enqueue();
-                                          m_songNoteQueue.push( pCopiedNote );
+                                          m_songNoteQueue.push( pCopiedNote, audioEngine_noteStartFrame( pCopiedNote ) );
                                           //pCopiedNote->dumpInfo();
                                    }
                             }
@@ -1466,13 +1555,48 @@ inline int findPatternInTick( int nTick, bool bLoopMode, int *pPatternStartTick
 
 
 
+/// Realtime tick position of an event happened at the given time
+unsigned long audioEngine_getRealtimeTickPosition( const timeval& time )
+{
+       //unsigned long initTick = audioEngine_getTickPosition();
+       unsigned int initTick = ( unsigned int )( m_nRealtimeFrames
+                                                 / m_pAudioDriver->m_transport.m_nTickSize );
+       unsigned long retTick;
+
+       struct timeval deltatime;
+
+       double sampleRate = ( double ) m_pAudioDriver->getSampleRate();
+
+       timersub( &time, &m_currentTickTime, &deltatime );
+
+       // add a buffers worth for jitter resistance
+       double deltaSec =
+                     ( double ) deltatime.tv_sec
+                     + ( deltatime.tv_usec / 1000000.0 )
+                     + ( m_pAudioDriver->getBufferSize() / ( double )sampleRate );
+       // events queued before the current tick time are played at once
+       if ( deltaSec < 0 ) {
+              deltaSec = 0;
+       }
+
+       retTick = ( unsigned long ) ( ( sampleRate
+                                       / ( double ) m_pAudioDriver->m_transport.m_nTickSize )
+                                     * deltaSec );
+
+       retTick = initTick + retTick;
+
+       return retTick;
+}
+
+
+
 void audioEngine_noteOn( Note *note )
 {
        // check current state
        if ( ( m_audioEngineState != STATE_READY )
                      && ( m_audioEngineState != STATE_PLAYING ) ) {
               ___ERRORLOG( "Error the audio engine is not in READY state" );
-              delete note;
+              AudioEngine::get_instance()->get_note_pool()->release( note );
               return;
        }
 
@@ -1724,7 +1848,8 @@ void audioEngine_startAudioDrivers()
               audioEngine_setupLadspaFX( m_pAudioDriver->getBufferSize() );
        }
 
-
+       // the sample rate may have changed
+       audioEngine_resampleLayers();
 }
 
 
@@ -1799,6 +1924,7 @@ const char* Hydrogen::__class_name = "Hydrogen";
 
 Hydrogen::Hydrogen()
        : Object( __class_name )
+       , m_pStretchScheduler( NULL )
 {
        if ( __instance ) {
               ERRORLOG( "Hydrogen audio engine is already running" );
@@ -1816,6 +1942,7 @@ Hydrogen::Hydrogen()
        for(int i = 0; i<128; i++){
               m_nInstrumentLookupTable[i] = i;
        }
+       m_pStretchScheduler = new StretchScheduler();
 
 }
 
@@ -1828,6 +1955,8 @@ Hydrogen::~Hydrogen()
               audioEngine_stop();
        }
        removeSong();
+       delete m_pStretchScheduler;
+       m_pStretchScheduler = NULL;
        audioEngine_stopAudioDrivers();
        audioEngine_destroy();
        __kill_instruments();
@@ -1843,6 +1972,24 @@ void Hydrogen::create_instance()
        Logger::create_instance();
        MidiMap::create_instance();
        Preferences::create_instance();
+       SampleCache::create_instance();
+       SampleCache::get_instance()->set_budget( ( long long )Preferences::get_instance()->m_nSampleCacheSize << 20 );
+       if ( Preferences::get_instance()->m_bUseSampleStore ) {
+              SampleStore::create_instance( Filesystem::cache_dir() + "/samples" );
+              SampleStore::get_instance()->set_budget( ( long long )Preferences::get_instance()->m_nSampleStoreSize << 20 );
+       }
+       LibraryIndex::create_instance( Filesystem::cache_dir() + "/library_index" );
+       Sample::set_stream_threshold( Preferences::get_instance()->m_nStreamThreshold );
+       switch ( Preferences::get_instance()->m_nSampleBits ) {
+       case 16:
+              Sample::set_storage_format( Sample::INT16 );
+              break;
+       case 24:
+              Sample::set_storage_format( Sample::INT24 );
+              break;
+       default:
+              Sample::set_storage_format( Sample::FLOAT );
+       }
        EventQueue::create_instance();
        MidiActionManager::create_instance();
 
@@ -1880,6 +2027,8 @@ void Hydrogen::sequencer_stop()
 
 void Hydrogen::setSong( Song *pSong )
 {
+       // the stretches of the previous song are outdated
+       m_pStretchScheduler->schedule( NULL, 0 );
        audioEngine_setSong( pSong );
 }
 
@@ -1887,6 +2036,7 @@ void Hydrogen::setSong( Song *pSong )
 
 void Hydrogen::removeSong()
 {
+       m_pStretchScheduler->schedule( NULL, 0 );
        audioEngine_removeSong();
 }
 
@@ -1914,6 +2064,35 @@ void Hydrogen::addRealtimeNote( int instrument,
 				bool noteOff,
 				bool forcePlay,
 				int msg1 )
+{
+       RealtimeNote note;
+       note.instrument = instrument;
+       note.velocity = velocity;
+       note.pan_L = pan_L;
+       note.pan_R = pan_R;
+       note.pitch = pitch;
+       note.noteOff = noteOff;
+       note.forcePlay = forcePlay;
+       note.msg1 = msg1;
+       gettimeofday( &note.time, NULL );
+
+       if ( !m_realtimeNoteQueue.push( note ) ) {
+              ERRORLOG( QString( "Realtime note queue full, note dropped" ) );
+       }
+}
+
+
+
+void Hydrogen::__playRealtimeNote( int instrument,
+				   float velocity,
+				   float pan_L,
+				   float pan_R,
+				   float pitch,
+				   bool noteOff,
+				   bool forcePlay,
+				   int msg1,
+				   const timeval& time,
+				   int nFrameOffset )
 {
        UNUSED( pitch );
 
@@ -1925,14 +2104,10 @@ void Hydrogen::addRealtimeNote( int instrument,
        bool hearnote = forcePlay;
        int currentPatternNumber;
 
-       AudioEngine::get_instance()->lock( RIGHT_HERE );
-
-
        Song *song = getSong();
        if ( !pref->__playselectedinstrument ){
               if ( instrument >= ( int )song->get_instrument_list()->size() ) {
                      // unused instrument
-                     AudioEngine::get_instance()->unlock();
                      return;
               }
        }
@@ -1949,7 +2124,6 @@ void Hydrogen::addRealtimeNote( int instrument,
               PatternList *pPatternList = m_pSong->get_pattern_list();
               int ipattern = getPatternPos(); // playlist index
               if ( ipattern < 0 || ipattern >= (int) pPatternList->size() ) {
-                     AudioEngine::get_instance()->unlock(); // unlock the audio engine
                      return;
               }
               // Locate column -- may need to jump back in the pattern list
@@ -1957,7 +2131,6 @@ void Hydrogen::addRealtimeNote( int instrument,
               while ( column < lookaheadTicks ) {
                      ipattern -= 1;
                      if ( ipattern < 0 || ipattern >= (int) pPatternList->size() ) {
-                            AudioEngine::get_instance()->unlock(); // unlock the audio engine
                             return;
                      }
                      // Convert from playlist index to actual pattern index
@@ -1997,7 +2170,6 @@ void Hydrogen::addRealtimeNote( int instrument,
                      currentPatternNumber = m_nSelectedPatternNumber;
               }
               if( currentPattern == NULL ){
-                     AudioEngine::get_instance()->unlock(); // unlock the audio engine
                      return;
               }
               // Locate column -- may need to wrap around end of pattern
@@ -2012,7 +2184,15 @@ void Hydrogen::addRealtimeNote( int instrument,
 
        }
 
-       realcolumn = getRealtimeTickPosition();
+       long long nStartFrame = -1;
+       if ( nFrameOffset >= 0 ) {
+              // the driver told the frame of the event within its period, the
+              // note keeps it within the cycle instead of the tick of the cycle
+              nStartFrame = m_nRealtimeFrames + std::min( nFrameOffset, ( int )m_nBufferSize - 1 );
+              realcolumn = ( unsigned int )( nStartFrame / m_pAudioDriver->m_transport.m_nTickSize );
+       } else {
+              realcolumn = audioEngine_getRealtimeTickPosition( time );
+       }
 
        if ( pref->getQuantizeEvents() ) {
               // quantize it to scale
@@ -2112,7 +2292,7 @@ void Hydrogen::addRealtimeNote( int instrument,
                                                  noteAction.b_isInstrumentMode = replaceExisting;
                                                  noteAction.b_isMidi = true;
                                                  noteAction.b_noteExist = replaceExisting;
-                                                 EventQueue::get_instance()->m_addMidiNoteVector.push_back(noteAction);
+                                                 EventQueue::get_instance()->push_midi_note(noteAction);
                                                  continue;
                                           }
                                           if( ( pNote->get_just_recorded() == false ) && (static_cast<int>( pNote->get_position() ) >= postdelete && pNote->get_position() < column + predelete +1 )){
@@ -2134,7 +2314,7 @@ void Hydrogen::addRealtimeNote( int instrument,
                                                  noteAction.b_isInstrumentMode = replaceExisting;
                                                  noteAction.b_isMidi = true;
                                                  noteAction.b_noteExist = replaceExisting;
-                                                 EventQueue::get_instance()->m_addMidiNoteVector.push_back(noteAction);
+                                                 EventQueue::get_instance()->push_midi_note(noteAction);
                                           }
                                    }
                                    continue;
@@ -2165,7 +2345,7 @@ void Hydrogen::addRealtimeNote( int instrument,
                                    noteAction.b_isInstrumentMode = false;
                                    noteAction.b_isMidi = false;
                                    noteAction.b_noteExist = replaceExisting;
-                                   EventQueue::get_instance()->m_addMidiNoteVector.push_back(noteAction);
+                                   EventQueue::get_instance()->push_midi_note(noteAction);
                                    continue;
                             }
 
@@ -2186,7 +2366,7 @@ void Hydrogen::addRealtimeNote( int instrument,
                                    noteAction.b_isInstrumentMode = false;
                                    noteAction.b_isMidi = false;
                                    noteAction.b_noteExist = replaceExisting;
-                                   EventQueue::get_instance()->m_addMidiNoteVector.push_back(noteAction);
+                                   EventQueue::get_instance()->push_midi_note(noteAction);
                             }
                      }
               }
@@ -2226,7 +2406,7 @@ void Hydrogen::addRealtimeNote( int instrument,
                             noteAction.b_isInstrumentMode = false;
                             noteAction.b_isMidi = true;
                             noteAction.b_noteExist = bNoteAlreadyExist;
-                            EventQueue::get_instance()->m_addMidiNoteVector.push_back(noteAction);
+                            EventQueue::get_instance()->push_midi_note(noteAction);
 
                             // hear note if its not in the future
                             if ( pref->getHearNewNotes()
@@ -2251,7 +2431,7 @@ void Hydrogen::addRealtimeNote( int instrument,
                             noteAction.b_isInstrumentMode = true;
                             noteAction.b_isMidi = true;
                             noteAction.b_noteExist = bNoteAlreadyExist;
-                            EventQueue::get_instance()->m_addMidiNoteVector.push_back(noteAction);
+                            EventQueue::get_instance()->push_midi_note(noteAction);
 
                             // hear note if its not in the future
                             if ( pref->getHearNewNotes()
@@ -2266,25 +2446,16 @@ void Hydrogen::addRealtimeNote( int instrument,
 
        if ( !pref->__playselectedinstrument ){
               if ( hearnote && instrRef ) {
-                     Note *note2 = new Note( instrRef,
-                                             realcolumn,
-                                             velocity,
-                                             pan_L,
-                                             pan_R,
-                                             -1,
-                                             0 );
+                     Note *note2 = AudioEngine::get_instance()->get_note_pool()->get( instrRef, realcolumn, velocity, pan_L, pan_R, -1, 0 );
+                     if ( nStartFrame >= 0 ) {
+                            note2->set_start_frame( nStartFrame, m_pAudioDriver->m_transport.m_nTickSize );
+                     }
                      midi_noteOn( note2 );
               }
        }else
        {
               if ( hearnote  ) {
-                     Note *note2 = new Note( song->get_instrument_list()->get( getSelectedInstrumentNumber()),
-                                             realcolumn,
-                                             velocity,
-                                             pan_L,
-                                             pan_R,
-                                             -1,
-                                             0 );
+                     Note *note2 = AudioEngine::get_instance()->get_note_pool()->get( song->get_instrument_list()->get( getSelectedInstrumentNumber()), realcolumn, velocity, pan_L, pan_R, -1, 0 );
 
                      int divider = msg1 / 12;
                      Note::Octave octave = (Note::Octave)(divider -3);
@@ -2292,13 +2463,13 @@ void Hydrogen::addRealtimeNote( int instrument,
 
                      //ERRORLOG( QString( "octave: %1, note: %2, instrument %3" ).arg( octave ).arg(notehigh).arg(instrument));
                      note2->set_midi_info( notehigh, octave, msg1 );
+                     if ( nStartFrame >= 0 ) {
+                            note2->set_start_frame( nStartFrame, m_pAudioDriver->m_transport.m_nTickSize );
+                     }
                      midi_noteOn( note2 );
               }
 
        }
-
-
-       AudioEngine::get_instance()->unlock(); // unlock the audio engine
 }
 
 
@@ -2326,32 +2497,7 @@ unsigned long Hydrogen::getTickPosition()
 
 unsigned long Hydrogen::getRealtimeTickPosition()
 {
-       //unsigned long initTick = audioEngine_getTickPosition();
-       unsigned int initTick = ( unsigned int )( m_nRealtimeFrames
-                                                 / m_pAudioDriver->m_transport.m_nTickSize );
-       unsigned long retTick;
-
-       struct timeval currtime;
-       struct timeval deltatime;
-
-       double sampleRate = ( double ) m_pAudioDriver->getSampleRate();
-       gettimeofday ( &currtime, NULL );
-
-       timersub( &currtime, &m_currentTickTime, &deltatime );
-
-       // add a buffers worth for jitter resistance
-       double deltaSec =
-                     ( double ) deltatime.tv_sec
-                     + ( deltatime.tv_usec / 1000000.0 )
-                     + ( m_pAudioDriver->getBufferSize() / ( double )sampleRate );
-
-       retTick = ( unsigned long ) ( ( sampleRate
-                                       / ( double ) m_pAudioDriver->m_transport.m_nTickSize )
-                                     * deltaSec );
-
-       retTick = initTick + retTick;
-
-       return retTick;
+       return audioEngine_getRealtimeTickPosition( currentTime2() );
 }
 
 
@@ -2372,6 +2518,10 @@ void Hydrogen::sequencer_setNextPattern( int pos, bool appendPattern, bool delet
        m_bAppendNextPattern = appendPattern;
        m_bDeleteNextPattern = deletePattern;
 
+       if ( m_pSong && pos >= 0 && pos < ( int )m_pSong->get_pattern_list()->size() ) {
+              createPatternNotes( m_pSong->get_pattern_list()->get( pos ) );
+       }
+
        AudioEngine::get_instance()->lock( RIGHT_HERE );
 
        if ( m_pSong && m_pSong->get_mode() == Song::PATTERN_MODE ) {
@@ -2416,7 +2566,7 @@ void Hydrogen::restartDrivers()
 
 
 /// Export a song to a wav file, returns the elapsed time in mSec
-void Hydrogen::startExportSong( const QString& filename, int rate, int depth )
+void Hydrogen::startExportSong( const QString& filename, int rate, int depth, bool bStems, bool bMix )
 {
        if ( getState() == STATE_PLAYING ) {
               sequencer_stop();
@@ -2439,7 +2589,7 @@ void Hydrogen::startExportSong( const QString& filename, int rate, int depth )
  */
 
 
-       m_pAudioDriver = new DiskWriterDriver( audioEngine_process, nSamplerate, filename, depth);
+       m_pAudioDriver = new DiskWriterDriver( audioEngine_process, nSamplerate, filename, depth, bStems, bMix );
 
 
        // reset
@@ -2572,11 +2722,6 @@ float Hydrogen::getMaxProcessTime()
 
 int Hydrogen::loadDrumkit( Drumkit *drumkitInfo )
 {
-       int old_ae_state = m_audioEngineState;
-       if( m_audioEngineState >= STATE_READY ) {
-              m_audioEngineState = STATE_PREPARED;
-       }
-
        INFOLOG( drumkitInfo->get_name() );
        m_currentDrumkit = drumkitInfo->get_name();
        LocalFileMng fileMng;
@@ -2614,21 +2759,18 @@ int Hydrogen::loadDrumkit( Drumkit *drumkitInfo )
        //needed for the new delete function
        int instrumentDiff =  songInstrList->size() - pDrumkitInstrList->size();
 
+       // every sample of the kit is decoded in the background, the old kit
+       // keeps playing until the whole new one is ready
+       SampleLoader::create_instance();
+       SampleLoader *pLoader = SampleLoader::get_instance();
+       std::vector<int> jobs( pDrumkitInstrList->size() * MAX_LAYERS );
        for ( unsigned nInstr = 0; nInstr < pDrumkitInstrList->size(); ++nInstr ) {
-              Instrument *pInstr = NULL;
-              if ( nInstr < songInstrList->size() ) {
-                     //instrument exists already
-                     pInstr = songInstrList->get( nInstr );
-                     assert( pInstr );
-              } else {
-                     pInstr = new Instrument();
-                     // The instrument isn't playing yet; no need for locking
-                     // :-) - Jakob Lund.  AudioEngine::get_instance()->lock(
-                     // "Hydrogen::loadDrumkit" );
-                     songInstrList->add( pInstr );
-                     // AudioEngine::get_instance()->unlock();
-              }
+              Instrument::queue_samples( pLoader, drumkitInfo, pDrumkitInstrList->get( nInstr ), &jobs[ nInstr * MAX_LAYERS ] );
+       }
+       EventQueue::get_instance()->push_event( EVENT_DRUMKIT_LOADING, 0 );
 
+       std::vector<Instrument*> staged( pDrumkitInstrList->size() );
+       for ( unsigned nInstr = 0; nInstr < pDrumkitInstrList->size(); ++nInstr ) {
               Instrument *pNewInstr = pDrumkitInstrList->get( nInstr );
               assert( pNewInstr );
               INFOLOG( QString( "Loading instrument (%1 of %2) [%3]" )
@@ -2636,9 +2778,27 @@ int Hydrogen::loadDrumkit( Drumkit *drumkitInfo )
                        .arg( pDrumkitInstrList->size() )
                        .arg( pNewInstr->get_name() ) );
 
-              // creo i nuovi layer in base al nuovo strumento
-              // Moved code from here right into the Instrument class - Jakob Lund.
-              pInstr->load_from( drumkitInfo, pNewInstr );
+              staged[ nInstr ] = Instrument::stage( drumkitInfo, pNewInstr, pLoader, &jobs[ nInstr * MAX_LAYERS ] );
+
+              EventQueue::get_instance()->push_event( EVENT_DRUMKIT_LOADING, ( nInstr + 1 ) * 100 / pDrumkitInstrList->size() );
+       }
+
+       // the whole kit is swapped at once, the notes keep pointing to the same instruments
+       AudioEngine::get_instance()->lock( RIGHT_HERE );
+       for ( unsigned nInstr = 0; nInstr < staged.size(); ++nInstr ) {
+              if ( nInstr < songInstrList->size() ) {
+                     //instrument exists already
+                     songInstrList->get( nInstr )->take_from( staged[ nInstr ] );
+              } else {
+                     songInstrList->add( staged[ nInstr ] );
+                     staged[ nInstr ] = NULL;
+              }
+       }
+       AudioEngine::get_instance()->unlock();
+
+       // the old layers are not reachable anymore
+       for ( unsigned nInstr = 0; nInstr < staged.size(); ++nInstr ) {
+              delete staged[ nInstr ];
        }
 
 
@@ -2658,7 +2818,7 @@ int Hydrogen::loadDrumkit( Drumkit *drumkitInfo )
        AudioEngine::get_instance()->unlock();
 #endif
 
-       m_audioEngineState = old_ae_state;
+       audioEngine_resampleLayers();
 
        return 0;	//ok
 }
@@ -2753,6 +2913,11 @@ unsigned long Hydrogen::getRealtimeFrames()
        return m_nRealtimeFrames;
 }
 
+timespec Hydrogen::getCurrentCycleTime()
+{
+       return m_currentCycleTime;
+}
+
 /**
  * Get the ticks for pattern at pattern pos
  * @a int pos -- position in song
@@ -2972,6 +3137,7 @@ void Hydrogen::setSelectedPatternNumberWithoutGuiEvent( int nPat )
               return;
 
        if ( Preferences::get_instance()->patternModePlaysSelected() ) {
+              createPatternNotes( m_pSong->get_pattern_list()->get( nPat ) );
               AudioEngine::get_instance()->lock( RIGHT_HERE );
 
               m_nSelectedPatternNumber = nPat;
@@ -2988,6 +3154,9 @@ void Hydrogen::setSelectedPatternNumber( int nPat )
 
 
        if ( Preferences::get_instance()->patternModePlaysSelected() ) {
+              if ( nPat >= 0 && nPat < ( int )m_pSong->get_pattern_list()->size() ) {
+                     createPatternNotes( m_pSong->get_pattern_list()->get( nPat ) );
+              }
               AudioEngine::get_instance()->lock( RIGHT_HERE );
 
               m_nSelectedPatternNumber = nPat;
@@ -3288,6 +3457,24 @@ void Hydrogen::setNewBpmJTM( float bpmJTM )
 }
 
 
+void Hydrogen::recalculateRubberband( float fBpm, bool bWait )
+{
+       m_nNewBpmJTM = fBpm;
+       // the stretched layers are converted to the driver sample rate once swapped in
+       m_pStretchScheduler->schedule( m_pSong, fBpm );
+       if ( bWait ) {
+              m_pStretchScheduler->wait();
+       }
+}
+
+
+
+void Hydrogen::resampleLayers()
+{
+       audioEngine_resampleLayers();
+}
+
+
 void Hydrogen::ComputeHumantimeFrames(uint32_t nFrames)
 {
        if ( ( m_audioEngineState == STATE_PLAYING ) )
@@ -3310,6 +3497,8 @@ void Hydrogen::togglePlaysSelected()
               return;
        Preferences * P = Preferences::get_instance();
 
+       createPatternNotes( m_pSong->get_pattern_list()->get( m_nSelectedPatternNumber ) );
+
        AudioEngine::get_instance()->lock( RIGHT_HERE );
 
        bool isPlaysSelected = P->patternModePlaysSelected();
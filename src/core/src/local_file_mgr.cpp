@@ -24,6 +24,7 @@
 
 
 #include <hydrogen/basics/adsr.h>
+#include <hydrogen/basics/automation_lane.h>
 #include <hydrogen/hydrogen.h>
 #include <hydrogen/h2_exception.h>
 #include <hydrogen/basics/instrument.h>
@@ -35,9 +36,12 @@
 #include <hydrogen/basics/pattern_list.h>
 #include <hydrogen/Preferences.h>
 #include <hydrogen/basics/song.h>
+#include <hydrogen/basics/song_binary.h>
 #include <hydrogen/basics/drumkit.h>
 #include <hydrogen/basics/sample.h>
 #include <hydrogen/fx/Effects.h>
+#include <hydrogen/helpers/xml.h>
+#include <hydrogen/helpers/library_index.h>
 
 
 #include <cstdlib>
@@ -74,51 +78,65 @@ LocalFileMng::~LocalFileMng()
 //	infoLog("DESTROY");
 }
 
-QString LocalFileMng::getDrumkitNameForPattern( const QString& patternDir )
+/**
+ * Read the name, the category and the drumkit of a pattern file, through the
+ * library index when it exists, parsing the file otherwise.
+ */
+static bool readPatternInfo( const QString& sPatternPath, LibraryIndex::PatternInfo* pInfo )
 {
-	QDomDocument doc = LocalFileMng::openXmlDocument( patternDir );
+	LibraryIndex* pIndex = LibraryIndex::get_instance();
+	if ( pIndex ) {
+		return pIndex->get_pattern( sPatternPath, pInfo );
+	}
+
+	QDomDocument doc = LocalFileMng::openXmlDocument( sPatternPath );
 
 	QDomNode rootNode = doc.firstChildElement( "drumkit_pattern" );	// root element
-	if (  rootNode.isNull() ) {
+	if ( rootNode.isNull() ) {
+		return false;
+	}
+
+	QDomNode patternNode = rootNode.firstChildElement( "pattern" );
+	pInfo->path = sPatternPath;
+	pInfo->name = LocalFileMng::readXmlString( patternNode,"pattern_name", "" );
+	pInfo->category = LocalFileMng::readXmlString( patternNode,"category", "" );
+	pInfo->drumkit = LocalFileMng::readXmlString( rootNode,"pattern_for_drumkit", "" );
+	return true;
+}
+
+QString LocalFileMng::getDrumkitNameForPattern( const QString& patternDir )
+{
+	LibraryIndex::PatternInfo info;
+	if ( !readPatternInfo( patternDir, &info ) ) {
 		ERRORLOG( "Error reading Pattern: Pattern_drumkit_infonode not found " + patternDir); 
 		return NULL;
 	}
 
-	return LocalFileMng::readXmlString( rootNode,"pattern_for_drumkit", "" );	
+	return info.drumkit;
 }
 
 
 QString LocalFileMng::getCategoryFromPatternName( const QString& patternPathName )
 {
-	QDomDocument doc = LocalFileMng::openXmlDocument( patternPathName ); 
-
-
-	QDomNode rootNode = doc.firstChildElement( "drumkit_pattern" );	// root element
-	if ( rootNode.isNull() ) {
+	LibraryIndex::PatternInfo info;
+	if ( !readPatternInfo( patternPathName, &info ) ) {
 		ERRORLOG( "Error reading Pattern: Pattern_drumkit_info node not found "); 
 		return NULL;
 	}
 
-	QDomNode patternNode = rootNode.firstChildElement( "pattern" );
-
-	return LocalFileMng::readXmlString( patternNode,"category", "" );
+	return info.category;
 	
 }
 
 QString LocalFileMng::getPatternNameFromPatternDir( const QString& patternDirName)
 {
-	QDomDocument doc = LocalFileMng::openXmlDocument( patternDirName );
-
-
-	QDomNode rootNode =doc.firstChildElement( "drumkit_pattern" );	// root element
-	if ( rootNode.isNull() ) {
+	LibraryIndex::PatternInfo info;
+	if ( !readPatternInfo( patternDirName, &info ) ) {
 		ERRORLOG( "Error reading Pattern: Pattern_drumkit_info node not found "); 
 		 return NULL;
 	}
 
-	QDomNode patternNode = rootNode.firstChildElement( "pattern" );
-
-	return LocalFileMng::readXmlString( patternNode,"pattern_name", "" );
+	return info.name;
 	
 }
 
@@ -432,19 +450,17 @@ std::vector<QString> LocalFileMng::getAllPatternNames()
 	for (uint i = 0; i < m_allPatternList.size(); ++i) {
 		QString patternInfoFile =  m_allPatternList[i];
 
-		QDomDocument doc  = LocalFileMng::openXmlDocument( patternInfoFile );
-
-		QDomNode rootNode =  doc.firstChildElement( "drumkit_pattern" );	// root element
-		if ( rootNode.isNull() ) {
+		LibraryIndex::PatternInfo info;
+		if ( !readPatternInfo( patternInfoFile, &info ) ) {
 			ERRORLOG( "Error reading Pattern: Pattern_drumkit_info node not found "); 
 		}else{
-			QDomNode patternNode = rootNode.firstChildElement( "pattern" );
-
-			QString sPatternName( LocalFileMng::readXmlString( patternNode,"pattern_name", "" ) );
-			alllist.push_back(sPatternName);
+			alllist.push_back( info.name );
 		}
 
 	}
+	if ( LibraryIndex::get_instance() ) {
+		LibraryIndex::get_instance()->save();
+	}
 	return alllist;
 }
 
@@ -462,15 +478,12 @@ std::vector<QString> LocalFileMng::getAllCategoriesFromPattern()
 	std::vector<QString> categorylist;
 	for (uint i = 0; i < m_allPatternList.size(); ++i) {
 		QString patternInfoFile =  m_allPatternList[i];
-		QDomDocument doc  = LocalFileMng::openXmlDocument( patternInfoFile );
 
-
-		QDomNode rootNode = doc.firstChildElement( "drumkit_pattern" );	// root element
-		if ( rootNode.isNull() ) {
+		LibraryIndex::PatternInfo info;
+		if ( !readPatternInfo( patternInfoFile, &info ) ) {
 			ERRORLOG( "Error reading Pattern: Pattern_drumkit_info node not found "); 
 		}else{
-			QDomNode patternNode = rootNode.firstChildElement( "pattern" );
-			QString sCategoryName( LocalFileMng::readXmlString( patternNode,"category", "" ) );
+			QString sCategoryName( info.category );
 
 
                         if ( sCategoryName.isEmpty() ){
@@ -502,6 +515,10 @@ std::vector<QString> LocalFileMng::getAllCategoriesFromPattern()
 		}
 	}
 
+	if ( LibraryIndex::get_instance() ) {
+		LibraryIndex::get_instance()->save();
+	}
+
 	std::sort(categorylist.begin(), categorylist.end());
 	return categorylist;
 }
@@ -921,6 +938,7 @@ QDomDocument LocalFileMng::openXmlDocument( const QString& filename )
 
 	QDomDocument doc;
 	QFile file( filename );
+	XMLReader reader;
 
 	if ( !file.open(QIODevice::ReadOnly) )
 		return QDomDocument();
@@ -941,13 +959,13 @@ QDomDocument LocalFileMng::openXmlDocument( const QString& filename )
 			buf += line;
 	    }
 
-	    if( ! doc.setContent( buf ) ) {
+	    if( ! reader.read( buf, &doc ) ) {
 			file.close();
 			return QDomDocument();
 	    }
 
 	} else {
-	    if( ! doc.setContent( &file ) ) {
+	    if( ! reader.read( &file, &doc ) ) {
 			file.close();
 			return QDomDocument();
 	    }
@@ -1295,6 +1313,28 @@ int SongWriter::writeSong( Song *song, const QString& filename )
 	}
 
 	songNode.appendChild( ladspaFxNode );
+
+	// Automation
+	std::vector<AutomationLane*>* pLanes = song->get_automation_lanes();
+	if ( !pLanes->empty() ) {
+		QDomNode automationNode = doc.createElement( "automation" );
+		for ( unsigned nLane = 0; nLane < pLanes->size(); nLane++ ) {
+			AutomationLane *pLane = ( *pLanes )[ nLane ];
+			QDomNode laneNode = doc.createElement( "lane" );
+			LocalFileMng::writeXmlString( laneNode, "instrument", QString("%1").arg( pLane->get_instrument_id() ) );
+			LocalFileMng::writeXmlString( laneNode, "parameter", AutomationLane::get_parameter_name( pLane->get_parameter() ) );
+			for ( int nPoint = 0; nPoint < pLane->size(); nPoint++ ) {
+				const AutomationLane::Point& point = pLane->get_point( nPoint );
+				QDomNode pointNode = doc.createElement( "point" );
+				LocalFileMng::writeXmlString( pointNode, "tick", QString("%1").arg( point.tick ) );
+				LocalFileMng::writeXmlString( pointNode, "value", QString("%1").arg( point.value ) );
+				laneNode.appendChild( pointNode );
+			}
+			automationNode.appendChild( laneNode );
+		}
+		songNode.appendChild( automationNode );
+	}
+
 	doc.appendChild( songNode );
 
 
@@ -1339,6 +1379,9 @@ int SongWriter::writeSong( Song *song, const QString& filename )
 	} else {
 		song->__is_modified = false;
 		INFOLOG("Save was successful.");
+		if ( Preferences::get_instance()->m_bCompiledSongs ) {
+			SongBinary::save( filename, doc, song->get_pattern_list() );
+		}
 	}
 
 	song->set_filename( filename );
@@ -88,11 +88,76 @@ bool setAbsoluteFXLevel( int nLine, int fx_channel , int fx_param)
 
 const char* MidiAction::__class_name = "MidiAction";
 
+/* Names of the action types, indexed by MidiAction::ActionType */
+static const char* __action_names[] = {
+	"",
+	"PLAY",
+	"PLAY/STOP_TOGGLE",
+	"PLAY/PAUSE_TOGGLE",
+	"STOP",
+	"PAUSE",
+	"RECORD_READY",
+	"RECORD/STROBE_TOGGLE",
+	"RECORD_STROBE",
+	"RECORD_EXIT",
+	"MUTE",
+	"UNMUTE",
+	"MUTE_TOGGLE",
+	">>_NEXT_BAR",
+	"<<_PREVIOUS_BAR",
+	"BPM_INCR",
+	"BPM_DECR",
+	"BPM_CC_RELATIVE",
+	"BPM_FINE_CC_RELATIVE",
+	"MASTER_VOLUME_RELATIVE",
+	"MASTER_VOLUME_ABSOLUTE",
+	"STRIP_VOLUME_RELATIVE",
+	"STRIP_VOLUME_ABSOLUTE",
+	"EFFECT1_LEVEL_RELATIVE",
+	"EFFECT2_LEVEL_RELATIVE",
+	"EFFECT3_LEVEL_RELATIVE",
+	"EFFECT4_LEVEL_RELATIVE",
+	"EFFECT1_LEVEL_ABSOLUTE",
+	"EFFECT2_LEVEL_ABSOLUTE",
+	"EFFECT3_LEVEL_ABSOLUTE",
+	"EFFECT4_LEVEL_ABSOLUTE",
+	"SELECT_NEXT_PATTERN",
+	"SELECT_NEXT_PATTERN_CC_ABSOLUT",
+	"SELECT_NEXT_PATTERN_PROMPTLY",
+	"SELECT_NEXT_PATTERN_RELATIVE",
+	"SELECT_AND_PLAY_PATTERN",
+	"PAN_RELATIVE",
+	"PAN_ABSOLUTE",
+	"BEATCOUNTER",
+	"TAP_TEMPO",
+	"PLAYLIST_NEXT_SONG",
+	"PLAYLIST_PREV_SONG",
+	"TOGGLE_METRONOME",
+	"SELECT_INSTRUMENT",
+	"UNDO_ACTION",
+	"REDO_ACTION"
+};
+
+/* fails to compile when a name is missing */
+typedef char __action_names_check[ sizeof( __action_names ) / sizeof( __action_names[0] ) == MidiAction::ACTION_TYPE_COUNT ? 1 : -1 ];
+
 MidiAction::MidiAction( QString typeString ) : Object( __class_name ) {
 
 	type = typeString;
-	QString parameter1 = "0";
-	QString parameter2 = "0" ;
+	nType = NOTHING;
+	for ( int i = NOTHING + 1; i < ACTION_TYPE_COUNT; i++ ) {
+		if ( typeString == __action_names[ i ] ) {
+			nType = ( ActionType )i;
+			break;
+		}
+	}
+	nParameter1 = 0;
+	nParameter2 = 0;
+}
+
+const char* MidiAction::getTypeName( ActionType nType )
+{
+	return __action_names[ nType ];
 }
 
 
@@ -106,6 +171,8 @@ MidiAction::MidiAction( QString typeString ) : Object( __class_name ) {
 * The MidiActionManager handles the execution of midi actions. The class
 * includes the names and implementations of all possible actions.
 *
+* The type of an action is resolved when the action is created, its
+* execution is a lookup in a table of the implementations.
 *
 * @author Sebastian Moors
 *
@@ -113,61 +180,67 @@ MidiAction::MidiAction( QString typeString ) : Object( __class_name ) {
 MidiActionManager* MidiActionManager::__instance = NULL;
 const char* MidiActionManager::__class_name = "ActionManager";
 
+const MidiActionManager::action_t MidiActionManager::__actions[ MidiAction::ACTION_TYPE_COUNT ] = {
+	NULL,
+	&MidiActionManager::play,
+	&MidiActionManager::playStopToggle,
+	&MidiActionManager::playPauseToggle,
+	&MidiActionManager::stop,
+	&MidiActionManager::pause,
+	&MidiActionManager::recordReady,
+	&MidiActionManager::recordStrobeToggle,
+	&MidiActionManager::recordStrobe,
+	&MidiActionManager::recordExit,
+	&MidiActionManager::mute,
+	&MidiActionManager::unmute,
+	&MidiActionManager::muteToggle,
+	&MidiActionManager::nextBar,
+	&MidiActionManager::previousBar,
+	&MidiActionManager::bpmIncr,
+	&MidiActionManager::bpmDecr,
+	&MidiActionManager::bpmCcRelative,
+	&MidiActionManager::bpmFineCcRelative,
+	&MidiActionManager::masterVolumeRelative,
+	&MidiActionManager::masterVolumeAbsolute,
+	&MidiActionManager::stripVolumeRelative,
+	&MidiActionManager::stripVolumeAbsolute,
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	&MidiActionManager::effect1LevelAbsolute,
+	&MidiActionManager::effect2LevelAbsolute,
+	&MidiActionManager::effect3LevelAbsolute,
+	&MidiActionManager::effect4LevelAbsolute,
+	&MidiActionManager::selectNextPattern,
+	&MidiActionManager::selectNextPatternCcAbsolute,
+	&MidiActionManager::selectNextPatternPromptly,
+	&MidiActionManager::selectNextPatternRelative,
+	&MidiActionManager::selectAndPlayPattern,
+	&MidiActionManager::panRelative,
+	&MidiActionManager::panAbsolute,
+	&MidiActionManager::beatcounter,
+	&MidiActionManager::tapTempo,
+	&MidiActionManager::playlistNextSong,
+	&MidiActionManager::playlistPrevSong,
+	&MidiActionManager::toggleMetronome,
+	&MidiActionManager::selectInstrument,
+	&MidiActionManager::undoAction,
+	&MidiActionManager::redoAction
+};
+
 MidiActionManager::MidiActionManager() : Object( __class_name )
 {
 	__instance = this;
 
-	int lastBpmChangeCCParameter = -1;
+	lastBpmChangeCCParameter = -1;
 	
 	/*
 	    the actionList holds all Action identfiers which hydrogen is able to interpret.
 	*/
-	actionList <<""
-	<< "PLAY" 
-	<< "PLAY/STOP_TOGGLE"
-	<< "PLAY/PAUSE_TOGGLE"
-	<< "STOP"
-	<< "PAUSE"
-        << "RECORD_READY"
-        << "RECORD/STROBE_TOGGLE"
-        << "RECORD_STROBE"
-        << "RECORD_EXIT"
-	<< "MUTE"
-	<< "UNMUTE"
-	<< "MUTE_TOGGLE"
-	<< ">>_NEXT_BAR"
-	<< "<<_PREVIOUS_BAR"
-	<< "BPM_INCR"
-	<< "BPM_DECR"
-	<< "BPM_CC_RELATIVE"
-        << "BPM_FINE_CC_RELATIVE"
-	<< "MASTER_VOLUME_RELATIVE"
-	<< "MASTER_VOLUME_ABSOLUTE"
-	<< "STRIP_VOLUME_RELATIVE"
-	<< "STRIP_VOLUME_ABSOLUTE"
-	<< "EFFECT1_LEVEL_RELATIVE"
-	<< "EFFECT2_LEVEL_RELATIVE"
-	<< "EFFECT3_LEVEL_RELATIVE"
-	<< "EFFECT4_LEVEL_RELATIVE"
-	<< "EFFECT1_LEVEL_ABSOLUTE"
-	<< "EFFECT2_LEVEL_ABSOLUTE"
-	<< "EFFECT3_LEVEL_ABSOLUTE"
-	<< "EFFECT4_LEVEL_ABSOLUTE"
-	<< "SELECT_NEXT_PATTERN"
-        << "SELECT_NEXT_PATTERN_CC_ABSOLUT"
-        << "SELECT_NEXT_PATTERN_PROMPTLY"
-	<< "SELECT_NEXT_PATTERN_RELATIVE"
-        << "SELECT_AND_PLAY_PATTERN"
-	<< "PAN_RELATIVE"
-	<< "PAN_ABSOLUTE"
-	<< "BEATCOUNTER"
-	<< "TAP_TEMPO"
-        << "PLAYLIST_NEXT_SONG"
-        << "PLAYLIST_PREV_SONG"
-        << "TOGGLE_METRONOME"
-        << "SELECT_INSTRUMENT"
-        << "UNDO_ACTION"
-        << "REDO_ACTION";
+	for ( int i = 0; i < MidiAction::ACTION_TYPE_COUNT; i++ ) {
+		actionList << MidiAction::getTypeName( ( MidiAction::ActionType )i );
+	}
 
 	eventList << ""
 	<< "MMC_PLAY"
@@ -205,616 +278,512 @@ void MidiActionManager::create_instance()
 
 bool MidiActionManager::handleAction( MidiAction * pAction ){
 
-	Hydrogen *pEngine = Hydrogen::get_instance();
-
 	/* 
 		return false if action is null 
 		(for example if no Action exists for an event)
 	*/
 	if( pAction == NULL )	return false;
 
-	QString sActionString = pAction->getType();
+	return handleAction( pAction, pAction->getIntParameter2() );
+}
 
-	
-	if( sActionString == "PLAY" )
-	{
-		int nState = pEngine->getState();
-		if ( nState == STATE_READY ){
-			pEngine->sequencer_play();
-		}
-		return true;
-	}
+/**
+ * Same as handleAction( MidiAction* ), the value of a cc message is given
+ * instead of being set as the second parameter of the action: the actions
+ * of the midi map are shared and not modified by the midi input thread.
+ */
+bool MidiActionManager::handleAction( MidiAction * pAction, int nValue ){
 
-	if( sActionString == "PLAY/STOP_TOGGLE" || sActionString == "PLAY/PAUSE_TOGGLE" )
-	{
-		int nState = pEngine->getState();
-		switch ( nState ) 
-		{
-			case STATE_READY:
-				pEngine->sequencer_play();
-				break;
-
-			case STATE_PLAYING:
-				if( sActionString == "PLAY/STOP_TOGGLE" ) pEngine->setPatternPos( 0 );
-				pEngine->sequencer_stop();
-				pEngine->setTimelineBpm();
-				break;
-
-			default:
-				ERRORLOG( "[Hydrogen::ActionManager(PLAY): Unhandled case" );
-		}
+	if( pAction == NULL )	return false;
 
-		return true;
-	}
-	
+	action_t action = __actions[ pAction->getTypeId() ];
+	if( action == NULL )	return false;
 
-	if( sActionString == "PAUSE" )
-	{	
-		pEngine->sequencer_stop();
-		return true;
-	}
+	return ( this->*action )( pAction->getIntParameter1(), nValue );
+}
 
-	if( sActionString == "STOP" )
-	{	
-		pEngine->sequencer_stop();
-		pEngine->setPatternPos( 0 );
-		pEngine->setTimelineBpm();
-		return true;
-	}
 
-	if( sActionString == "MUTE" ){
-		//mutes the master, not a single strip
-		pEngine->getSong()->__is_muted = true;
-		return true;
+bool MidiActionManager::play( int, int )
+{
+	Hydrogen *pEngine = Hydrogen::get_instance();
+	int nState = pEngine->getState();
+	if ( nState == STATE_READY ){
+		pEngine->sequencer_play();
 	}
+	return true;
+}
 
-	if( sActionString == "UNMUTE" ){
-		pEngine->getSong()->__is_muted = false;
-		return true;
-	}
+bool MidiActionManager::playStopToggle( int, int )
+{
+	return playToggle( true );
+}
 
-	if( sActionString == "MUTE_TOGGLE" ){
-		pEngine->getSong()->__is_muted = !Hydrogen::get_instance()->getSong()->__is_muted;
-		return true;
-	}
+bool MidiActionManager::playPauseToggle( int, int )
+{
+	return playToggle( false );
+}
 
-	if( sActionString == "BEATCOUNTER" ){
-		pEngine->handleBeatCounter();
-		return true;
-	}
+bool MidiActionManager::playToggle( bool bRewind )
+{
+	Hydrogen *pEngine = Hydrogen::get_instance();
+	int nState = pEngine->getState();
+	switch ( nState ) 
+	{
+		case STATE_READY:
+			pEngine->sequencer_play();
+			break;
 
-	if( sActionString == "TAP_TEMPO" ){
-		pEngine->onTapTempoAccelEvent();
-		return true;
+		case STATE_PLAYING:
+			if( bRewind ) pEngine->setPatternPos( 0 );
+			pEngine->sequencer_stop();
+			pEngine->setTimelineBpm();
+			break;
+
+		default:
+			ERRORLOG( "[Hydrogen::ActionManager(PLAY): Unhandled case" );
 	}
 
-        if( sActionString == "SELECT_NEXT_PATTERN" ){
-		bool ok;
-		int row = pAction->getParameter1().toInt(&ok,10);
-                if( row> pEngine->getSong()->get_pattern_list()->size() -1 )
-                    return false;
-                if(Preferences::get_instance()->patternModePlaysSelected())
-                        pEngine->setSelectedPatternNumber( row );
-                else
-                        pEngine->sequencer_setNextPattern( row, false, true );
-                return true;
-        }
+	return true;
+}
 
-        if( sActionString == "SELECT_NEXT_PATTERN_RELATIVE" ){
-		bool ok;
-                if(!Preferences::get_instance()->patternModePlaysSelected())
-		    return true;
-		int row = pEngine->getSelectedPatternNumber() + pAction->getParameter1().toInt(&ok,10);
-                if( row> pEngine->getSong()->get_pattern_list()->size() -1 )
-                    return false;
+bool MidiActionManager::pause( int, int )
+{
+	Hydrogen::get_instance()->sequencer_stop();
+	return true;
+}
 
-		pEngine->setSelectedPatternNumber( row );
-		return true;
-        }
+bool MidiActionManager::stop( int, int )
+{
+	Hydrogen *pEngine = Hydrogen::get_instance();
+	pEngine->sequencer_stop();
+	pEngine->setPatternPos( 0 );
+	pEngine->setTimelineBpm();
+	return true;
+}
 
-        if( sActionString == "SELECT_NEXT_PATTERN_CC_ABSOLUT" ){
-                bool ok;
-                int row = pAction->getParameter2().toInt(&ok,10);
-                if( row> pEngine->getSong()->get_pattern_list()->size() -1 )
-                    return false;
-                if(Preferences::get_instance()->patternModePlaysSelected())
-                        pEngine->setSelectedPatternNumber( row );
-                else
-                        return true;// only usefully in normal pattern mode
-                return true;
-        }
+bool MidiActionManager::mute( int, int )
+{
+	//mutes the master, not a single strip
+	Hydrogen::get_instance()->getSong()->__is_muted = true;
+	return true;
+}
 
-        if( sActionString == "SELECT_NEXT_PATTERN_PROMPTLY" ){// obsolete, use SELECT_NEXT_PATTERN_CC_ABSOLUT instead
-              bool ok;
-              int row = pAction->getParameter2().toInt(&ok,10);
-              pEngine->setSelectedPatternNumberWithoutGuiEvent( row );
-              return true;
-        }
+bool MidiActionManager::unmute( int, int )
+{
+	Hydrogen::get_instance()->getSong()->__is_muted = false;
+	return true;
+}
 
-          if( sActionString == "SELECT_AND_PLAY_PATTERN"){
-                bool ok;
-                int row = pAction->getParameter1().toInt(&ok,10);
-                pEngine->setSelectedPatternNumber( row );
-                pEngine->sequencer_setNextPattern( row, false, true );
+bool MidiActionManager::muteToggle( int, int )
+{
+	Song *pSong = Hydrogen::get_instance()->getSong();
+	pSong->__is_muted = !pSong->__is_muted;
+	return true;
+}
 
-                int nState = pEngine->getState();
-                if ( nState == STATE_READY ){
-                        pEngine->sequencer_play();
-                }
+bool MidiActionManager::beatcounter( int, int )
+{
+	Hydrogen::get_instance()->handleBeatCounter();
+	return true;
+}
 
-                return true;
-        }
+bool MidiActionManager::tapTempo( int, int )
+{
+	Hydrogen::get_instance()->onTapTempoAccelEvent();
+	return true;
+}
 
-	if( sActionString == "SELECT_INSTRUMENT" ){
-		bool ok;
-		int  instrument_number = pAction->getParameter2().toInt(&ok,10) ;
-		if ( pEngine->getSong()->get_instrument_list()->size() < instrument_number ) 
-			instrument_number = pEngine->getSong()->get_instrument_list()->size() -1;	
-		pEngine->setSelectedInstrumentNumber( instrument_number );
-		return true;
-	}
+bool MidiActionManager::selectNextPattern( int nRow, int )
+{
+	Hydrogen *pEngine = Hydrogen::get_instance();
+	if( nRow > pEngine->getSong()->get_pattern_list()->size() -1 )
+		return false;
+	if(Preferences::get_instance()->patternModePlaysSelected())
+		pEngine->setSelectedPatternNumber( nRow );
+	else
+		pEngine->sequencer_setNextPattern( nRow, false, true );
+	return true;
+}
 
+bool MidiActionManager::selectNextPatternRelative( int nStep, int )
+{
+	Hydrogen *pEngine = Hydrogen::get_instance();
+	if(!Preferences::get_instance()->patternModePlaysSelected())
+		return true;
+	int nRow = pEngine->getSelectedPatternNumber() + nStep;
+	if( nRow > pEngine->getSong()->get_pattern_list()->size() -1 )
+		return false;
 
+	pEngine->setSelectedPatternNumber( nRow );
+	return true;
+}
 
-	
-	if( sActionString == "EFFECT1_LEVEL_ABSOLUTE" ){
-		bool ok;
-		int nLine = pAction->getParameter1().toInt(&ok,10);
-		int fx_param = pAction->getParameter2().toInt(&ok,10);
-		setAbsoluteFXLevel( nLine, 0 , fx_param );
-	}
+bool MidiActionManager::selectNextPatternCcAbsolute( int, int nRow )
+{
+	Hydrogen *pEngine = Hydrogen::get_instance();
+	if( nRow > pEngine->getSong()->get_pattern_list()->size() -1 )
+		return false;
+	if(Preferences::get_instance()->patternModePlaysSelected())
+		pEngine->setSelectedPatternNumber( nRow );
+	// only usefully in normal pattern mode
+	return true;
+}
 
-	if( sActionString == "EFFECT2_LEVEL_ABSOLUTE" ){
-		bool ok;
-		int nLine = pAction->getParameter1().toInt(&ok,10);
-		int fx_param = pAction->getParameter2().toInt(&ok,10);
-		setAbsoluteFXLevel( nLine, 1 , fx_param );
-	}
+// obsolete, use SELECT_NEXT_PATTERN_CC_ABSOLUT instead
+bool MidiActionManager::selectNextPatternPromptly( int, int nRow )
+{
+	Hydrogen::get_instance()->setSelectedPatternNumberWithoutGuiEvent( nRow );
+	return true;
+}
 
-	if( sActionString == "EFFECT3_LEVEL_ABSOLUTE" ){
-		bool ok;
-		int nLine = pAction->getParameter1().toInt(&ok,10);
-		int fx_param = pAction->getParameter2().toInt(&ok,10);
-		setAbsoluteFXLevel( nLine, 2 , fx_param );
-	}
+bool MidiActionManager::selectAndPlayPattern( int nRow, int )
+{
+	Hydrogen *pEngine = Hydrogen::get_instance();
+	pEngine->setSelectedPatternNumber( nRow );
+	pEngine->sequencer_setNextPattern( nRow, false, true );
 
-	if( sActionString == "EFFECT4_LEVEL_ABSOLUTE" ){
-		bool ok;
-		int nLine = pAction->getParameter1().toInt(&ok,10);
-		int fx_param = pAction->getParameter2().toInt(&ok,10);
-		setAbsoluteFXLevel( nLine, 3 , fx_param );
+	int nState = pEngine->getState();
+	if ( nState == STATE_READY ){
+		pEngine->sequencer_play();
 	}
-	
-
-	
-	
-
-	if( sActionString == "MASTER_VOLUME_RELATIVE" ){
-		//increments/decrements the volume of the whole song	
-		
-		bool ok;
-		int vol_param = pAction->getParameter2().toInt(&ok,10);
-			
-		Hydrogen *engine = Hydrogen::get_instance();
-		Song *song = engine->getSong();
-
-
-
-		if( vol_param != 0 ){
-				if ( vol_param == 1 && song->get_volume() < 1.5 ){
-					song->set_volume( song->get_volume() + 0.05 );  
-				}  else  {
-					if( song->get_volume() >= 0.0 ){
-						song->set_volume( song->get_volume() - 0.05 );
-					}
-				}
-		} else {
-			song->set_volume( 0 );
-		}
 
-	}
+	return true;
+}
 
-	
+bool MidiActionManager::selectInstrument( int, int nInstrument )
+{
+	Hydrogen *pEngine = Hydrogen::get_instance();
+	if ( pEngine->getSong()->get_instrument_list()->size() < nInstrument ) 
+		nInstrument = pEngine->getSong()->get_instrument_list()->size() -1;	
+	pEngine->setSelectedInstrumentNumber( nInstrument );
+	return true;
+}
 
-	if( sActionString == "MASTER_VOLUME_ABSOLUTE" ){
-		//sets the volume of a master output to a given level (percentage)
+bool MidiActionManager::effect1LevelAbsolute( int nLine, int nValue )
+{
+	setAbsoluteFXLevel( nLine, 0 , nValue );
+	return false;
+}
 
-		bool ok;
-		int vol_param = pAction->getParameter2().toInt(&ok,10);
-			
+bool MidiActionManager::effect2LevelAbsolute( int nLine, int nValue )
+{
+	setAbsoluteFXLevel( nLine, 1 , nValue );
+	return false;
+}
 
-		Hydrogen *engine = Hydrogen::get_instance();
-		Song *song = engine->getSong();
+bool MidiActionManager::effect3LevelAbsolute( int nLine, int nValue )
+{
+	setAbsoluteFXLevel( nLine, 2 , nValue );
+	return false;
+}
 
+bool MidiActionManager::effect4LevelAbsolute( int nLine, int nValue )
+{
+	setAbsoluteFXLevel( nLine, 3 , nValue );
+	return false;
+}
 
-		if( vol_param != 0 ){
-				song->set_volume( 1.5* ( (float) (vol_param / 127.0 ) ));
-		} else {
-				song->set_volume( 0 );
+bool MidiActionManager::masterVolumeRelative( int, int nValue )
+{
+	//increments/decrements the volume of the whole song	
+	Song *song = Hydrogen::get_instance()->getSong();
+
+	if( nValue != 0 ){
+		if ( nValue == 1 && song->get_volume() < 1.5 ){
+			song->set_volume( song->get_volume() + 0.05 );  
+		}  else  {
+			if( song->get_volume() >= 0.0 ){
+				song->set_volume( song->get_volume() - 0.05 );
+			}
 		}
-
+	} else {
+		song->set_volume( 0 );
 	}
 
-	
+	return false;
+}
 
-	if( sActionString == "STRIP_VOLUME_RELATIVE" ){
-		//increments/decrements the volume of one mixer strip	
-		
-		bool ok;
-		int nLine = pAction->getParameter1().toInt(&ok,10);
-		int vol_param = pAction->getParameter2().toInt(&ok,10);
-			
-		Hydrogen::get_instance()->setSelectedInstrumentNumber( nLine );
-
-		Hydrogen *engine = Hydrogen::get_instance();
-		Song *song = engine->getSong();
-		InstrumentList *instrList = song->get_instrument_list();
-
-		Instrument *instr = instrList->get( nLine );
-
-		if ( instr == NULL) return 0;
-
-		if( vol_param != 0 ){
-				if ( vol_param == 1 && instr->get_volume() < 1.5 ){
-					instr->set_volume( instr->get_volume() + 0.1 );  
-				}  else  {
-					if( instr->get_volume() >= 0.0 ){
-						instr->set_volume( instr->get_volume() - 0.1 );
-					}
-				}
-		} else {
-			instr->set_volume( 0 );
-		}
+bool MidiActionManager::masterVolumeAbsolute( int, int nValue )
+{
+	//sets the volume of a master output to a given level (percentage)
+	Song *song = Hydrogen::get_instance()->getSong();
 
-		Hydrogen::get_instance()->setSelectedInstrumentNumber(nLine);
+	if( nValue != 0 ){
+		song->set_volume( 1.5* ( (float) (nValue / 127.0 ) ));
+	} else {
+		song->set_volume( 0 );
 	}
 
-	if( sActionString == "STRIP_VOLUME_ABSOLUTE" ){
-		//sets the volume of a mixer strip to a given level (percentage)
-
-		bool ok;
-		int nLine = pAction->getParameter1().toInt(&ok,10);
-		int vol_param = pAction->getParameter2().toInt(&ok,10);
-			
-		Hydrogen::get_instance()->setSelectedInstrumentNumber( nLine );
+	return false;
+}
 
-		Hydrogen *engine = Hydrogen::get_instance();
-		Song *song = engine->getSong();
-		InstrumentList *instrList = song->get_instrument_list();
+bool MidiActionManager::stripVolumeRelative( int nLine, int nValue )
+{
+	//increments/decrements the volume of one mixer strip	
+	Hydrogen *engine = Hydrogen::get_instance();
+	engine->setSelectedInstrumentNumber( nLine );
 
-		Instrument *instr = instrList->get( nLine );
+	Instrument *instr = engine->getSong()->get_instrument_list()->get( nLine );
 
-		if ( instr == NULL) return 0;
+	if ( instr == NULL) return false;
 
-		if( vol_param != 0 ){
-				instr->set_volume( 1.5* ( (float) (vol_param / 127.0 ) ));
-		} else {
-				instr->set_volume( 0 );
+	if( nValue != 0 ){
+		if ( nValue == 1 && instr->get_volume() < 1.5 ){
+			instr->set_volume( instr->get_volume() + 0.1 );  
+		}  else  {
+			if( instr->get_volume() >= 0.0 ){
+				instr->set_volume( instr->get_volume() - 0.1 );
+			}
 		}
-
-		Hydrogen::get_instance()->setSelectedInstrumentNumber(nLine);
+	} else {
+		instr->set_volume( 0 );
 	}
 
-	
-	if( sActionString == "PAN_ABSOLUTE" ){
-		
-		 // sets the absolute panning of a given mixer channel
-		
-		
-		bool ok;
-		int nLine = pAction->getParameter1().toInt(&ok,10);
-		int pan_param = pAction->getParameter2().toInt(&ok,10);
-
-		
-		float pan_L;
-		float pan_R;
-
-		Hydrogen *engine = Hydrogen::get_instance();
-		engine->setSelectedInstrumentNumber( nLine );
-		Song *song = engine->getSong();
-		InstrumentList *instrList = song->get_instrument_list();
-
-		Instrument *instr = instrList->get( nLine );
-		
-		if( instr == NULL )
-			return false;
-		
-		pan_L = instr->get_pan_l();
-		pan_R = instr->get_pan_r();
-
-		// pan
-		float fPanValue = 0.0;
-		if (pan_R == 1.0) {
-			fPanValue = 1.0 - (pan_L / 2.0);
-		}
-		else {
-			fPanValue = pan_R / 2.0;
-		}
-
-		
-		fPanValue = 1 * ( ((float) pan_param) / 127.0 );
-
-
-		if (fPanValue >= 0.5) {
-			pan_L = (1.0 - fPanValue) * 2;
-			pan_R = 1.0;
-		}
-		else {
-			pan_L = 1.0;
-			pan_R = fPanValue * 2;
-		}
+	return false;
+}
 
+bool MidiActionManager::stripVolumeAbsolute( int nLine, int nValue )
+{
+	//sets the volume of a mixer strip to a given level (percentage)
+	Hydrogen *engine = Hydrogen::get_instance();
+	engine->setSelectedInstrumentNumber( nLine );
 
-		instr->set_pan_l( pan_L );
-		instr->set_pan_r( pan_R );
+	Instrument *instr = engine->getSong()->get_instrument_list()->get( nLine );
 
-		Hydrogen::get_instance()->setSelectedInstrumentNumber(nLine);
+	if ( instr == NULL) return false;
 
-		return true;
+	if( nValue != 0 ){
+		instr->set_volume( 1.5* ( (float) (nValue / 127.0 ) ));
+	} else {
+		instr->set_volume( 0 );
 	}
 
-	if( sActionString == "PAN_RELATIVE" ){
-		
-		 // changes the panning of a given mixer channel
-		// this is useful if the panning is set by a rotary control knob
-		
-		
-		bool ok;
-		int nLine = pAction->getParameter1().toInt(&ok,10);
-		int pan_param = pAction->getParameter2().toInt(&ok,10);
-
-		
-		float pan_L;
-		float pan_R;
-
-		Hydrogen *engine = Hydrogen::get_instance();
-		engine->setSelectedInstrumentNumber( nLine );
-		Song *song = engine->getSong();
-		InstrumentList *instrList = song->get_instrument_list();
-
-		Instrument *instr = instrList->get( nLine );
-		
-		if( instr == NULL )
-			return false;
-		
-		pan_L = instr->get_pan_l();
-		pan_R = instr->get_pan_r();
-
-		// pan
-		float fPanValue = 0.0;
-		if (pan_R == 1.0) {
-			fPanValue = 1.0 - (pan_L / 2.0);
-		}
-		else {
-			fPanValue = pan_R / 2.0;
-		}
-
-		if( pan_param == 1 && fPanValue < 1 ){
-			fPanValue += 0.05;
-		}
-
-		if( pan_param != 1 && fPanValue > 0 ){
-			fPanValue -= 0.05;
-		}
-
-		if (fPanValue >= 0.5) {
-			pan_L = (1.0 - fPanValue) * 2;
-			pan_R = 1.0;
-		}
-		else {
-			pan_L = 1.0;
-			pan_R = fPanValue * 2;
-		}
-
-
-		instr->set_pan_l( pan_L );
-		instr->set_pan_r( pan_R );
+	return false;
+}
 
-		Hydrogen::get_instance()->setSelectedInstrumentNumber(nLine);
+bool MidiActionManager::panAbsolute( int nLine, int nValue )
+{
+	// sets the absolute panning of a given mixer channel
+	Hydrogen *engine = Hydrogen::get_instance();
+	engine->setSelectedInstrumentNumber( nLine );
 
-		return true;
-	}
+	Instrument *instr = engine->getSong()->get_instrument_list()->get( nLine );
 	
+	if( instr == NULL )
+		return false;
 
-	if( sActionString == "BPM_CC_RELATIVE" ){
-		/*
-		 * increments/decrements the BPM
-		 * this is useful if the bpm is set by a rotary control knob
-		*/
-
-		AudioEngine::get_instance()->lock( RIGHT_HERE );
+	float fPanValue = 1 * ( ((float) nValue) / 127.0 );
 
-		int mult = 1;	
-
-		//second parameter of cc command
-		//this value should be 1 to decrement and something other then 1 to increment the bpm
-		int cc_param = 1;
-
-		//this Action should be triggered only by CC commands
-
-		bool ok;
-		mult = pAction->getParameter1().toInt(&ok,10);
-		cc_param = pAction->getParameter2().toInt(&ok,10);
-			
-		if( lastBpmChangeCCParameter == -1)
-		{
-			lastBpmChangeCCParameter = cc_param;	
-		}
-
-		Song* pSong = pEngine->getSong();
-
-		if ( lastBpmChangeCCParameter >= cc_param && pSong->__bpm  < 300) {
-			pEngine->setBPM( pSong->__bpm - 1*mult );
-		}
+	if (fPanValue >= 0.5) {
+		instr->set_pan_l( (1.0 - fPanValue) * 2 );
+		instr->set_pan_r( 1.0 );
+	}
+	else {
+		instr->set_pan_l( 1.0 );
+		instr->set_pan_r( fPanValue * 2 );
+	}
 
-		if ( lastBpmChangeCCParameter < cc_param && pSong->__bpm  > 40 ) {
-			pEngine->setBPM( pSong->__bpm + 1*mult );
-		}
+	return true;
+}
 
-		lastBpmChangeCCParameter = cc_param;
+bool MidiActionManager::panRelative( int nLine, int nValue )
+{
+	// changes the panning of a given mixer channel
+	// this is useful if the panning is set by a rotary control knob
+	Hydrogen *engine = Hydrogen::get_instance();
+	engine->setSelectedInstrumentNumber( nLine );
 
-		AudioEngine::get_instance()->unlock();
+	Instrument *instr = engine->getSong()->get_instrument_list()->get( nLine );
+	
+	if( instr == NULL )
+		return false;
+	
+	float pan_L = instr->get_pan_l();
+	float pan_R = instr->get_pan_r();
 
-		return true;
+	// pan
+	float fPanValue = 0.0;
+	if (pan_R == 1.0) {
+		fPanValue = 1.0 - (pan_L / 2.0);
+	}
+	else {
+		fPanValue = pan_R / 2.0;
 	}
 
-        if( sActionString == "BPM_FINE_CC_RELATIVE" ){
-               /*
-                * increments/decrements the BPM
-                * this is useful if the bpm is set by a rotary control knob
-               */
+	if( nValue == 1 && fPanValue < 1 ){
+		fPanValue += 0.05;
+	}
 
-               AudioEngine::get_instance()->lock( RIGHT_HERE );
+	if( nValue != 1 && fPanValue > 0 ){
+		fPanValue -= 0.05;
+	}
 
-               int mult = 1;
+	if (fPanValue >= 0.5) {
+		pan_L = (1.0 - fPanValue) * 2;
+		pan_R = 1.0;
+	}
+	else {
+		pan_L = 1.0;
+		pan_R = fPanValue * 2;
+	}
 
-               //second parameter of cc command
-               //this value should be 1 to decrement and something other then 1 to increment the bpm
-               int cc_param = 1;
+	instr->set_pan_l( pan_L );
+	instr->set_pan_r( pan_R );
 
-               //this Action should be triggered only by CC commands
+	return true;
+}
 
-               bool ok;
-               mult = pAction->getParameter1().toInt(&ok,10);
-               cc_param = pAction->getParameter2().toInt(&ok,10);
+bool MidiActionManager::bpmCcRelative( int nMult, int nValue )
+{
+	/*
+	 * increments/decrements the BPM
+	 * this is useful if the bpm is set by a rotary control knob
+	 * the value of the cc should be 1 to decrement and something other then 1 to increment the bpm
+	 */
+	return bpmChangeRelative( 1 * nMult, nValue );
+}
 
-               if( lastBpmChangeCCParameter == -1)
-               {
-                       lastBpmChangeCCParameter = cc_param;
-               }
+bool MidiActionManager::bpmFineCcRelative( int nMult, int nValue )
+{
+	return bpmChangeRelative( 0.01 * nMult, nValue );
+}
 
-               Song* pSong = pEngine->getSong();
+bool MidiActionManager::bpmChangeRelative( float fStep, int nValue )
+{
+	//this Action should be triggered only by CC commands
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
 
-               if ( lastBpmChangeCCParameter >= cc_param && pSong->__bpm  < 300) {
-                       pEngine->setBPM( pSong->__bpm - 0.01*mult );
-               }
+	if( lastBpmChangeCCParameter == -1)
+	{
+		lastBpmChangeCCParameter = nValue;	
+	}
 
-               if ( lastBpmChangeCCParameter < cc_param && pSong->__bpm  > 40 ) {
-                       pEngine->setBPM( pSong->__bpm + 0.01*mult );
-               }
+	Hydrogen *pEngine = Hydrogen::get_instance();
+	Song* pSong = pEngine->getSong();
 
-               lastBpmChangeCCParameter = cc_param;
+	if ( lastBpmChangeCCParameter >= nValue && pSong->__bpm  < 300) {
+		pEngine->setBPM( pSong->__bpm - fStep );
+	}
 
-               AudioEngine::get_instance()->unlock();
+	if ( lastBpmChangeCCParameter < nValue && pSong->__bpm  > 40 ) {
+		pEngine->setBPM( pSong->__bpm + fStep );
+	}
 
-               return true;
-        }
+	lastBpmChangeCCParameter = nValue;
 
+	AudioEngine::get_instance()->unlock();
 
-	if( sActionString == "BPM_INCR" ){
-		AudioEngine::get_instance()->lock( RIGHT_HERE );
+	return true;
+}
 
-		int mult = 1;	
+bool MidiActionManager::bpmIncr( int nMult, int )
+{
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
 
-		bool ok;
-		mult = pAction->getParameter1().toInt(&ok,10);
+	Hydrogen *pEngine = Hydrogen::get_instance();
+	Song* pSong = pEngine->getSong();
+	if (pSong->__bpm  < 300) {
+		pEngine->setBPM( pSong->__bpm + 1*nMult );
+	}
+	AudioEngine::get_instance()->unlock();
 
+	return true;
+}
 
-		Song* pSong = pEngine->getSong();
-		if (pSong->__bpm  < 300) {
-			pEngine->setBPM( pSong->__bpm + 1*mult );
-		}
-		AudioEngine::get_instance()->unlock();
+bool MidiActionManager::bpmDecr( int nMult, int )
+{
+	AudioEngine::get_instance()->lock( RIGHT_HERE );
 
-		return true;
+	Hydrogen *pEngine = Hydrogen::get_instance();
+	Song* pSong = pEngine->getSong();
+	if (pSong->__bpm  > 40 ) {
+		pEngine->setBPM( pSong->__bpm - 1*nMult );
 	}
+	AudioEngine::get_instance()->unlock();
+	
+	return true;
+}
 
-	if( sActionString == "BPM_DECR" ){
-		AudioEngine::get_instance()->lock( RIGHT_HERE );
-
-		int mult = 1;	
+bool MidiActionManager::nextBar( int, int )
+{
+	Hydrogen *pEngine = Hydrogen::get_instance();
+	pEngine->setPatternPos(pEngine->getPatternPos() +1 );
+	pEngine->setTimelineBpm();
+	return true;
+}
 
-		bool ok;
-		mult = pAction->getParameter1().toInt(&ok,10);
+bool MidiActionManager::previousBar( int, int )
+{
+	Hydrogen *pEngine = Hydrogen::get_instance();
+	pEngine->setPatternPos(pEngine->getPatternPos() -1 );
+	pEngine->setTimelineBpm();
+	return true;
+}
 
-		Song* pSong = pEngine->getSong();
-		if (pSong->__bpm  > 40 ) {
-			pEngine->setBPM( pSong->__bpm - 1*mult );
-		}
-		AudioEngine::get_instance()->unlock();
-		
-		return true;
+bool MidiActionManager::playlistNextSong( int, int )
+{
+	int songnumber = Playlist::get_instance()->getActiveSongNumber();
+	if(songnumber+1 >= 0 && songnumber+1 <= Hydrogen::get_instance()->m_PlayList.size()-1){
+		Playlist::get_instance()->setNextSongByNumber( songnumber + 1 );
 	}
+	return true;
+}
 
-	if( sActionString == ">>_NEXT_BAR"){
-		pEngine->setPatternPos(pEngine->getPatternPos() +1 );
-		pEngine->setTimelineBpm();
-		return true;
+bool MidiActionManager::playlistPrevSong( int, int )
+{
+	int songnumber = Playlist::get_instance()->getActiveSongNumber();
+	if(songnumber-1 >= 0 && songnumber-1 <= Hydrogen::get_instance()->m_PlayList.size()-1){
+		Playlist::get_instance()->setNextSongByNumber( songnumber - 1 );
 	}
+	return true;
+}
 
-	if( sActionString == "<<_PREVIOUS_BAR"){
-		pEngine->setPatternPos(pEngine->getPatternPos() -1 );
-		pEngine->setTimelineBpm();
-		return true;
+bool MidiActionManager::recordReady( int, int )
+{
+	if ( Hydrogen::get_instance()->getState() != STATE_PLAYING ) {
+		Preferences *pPref = Preferences::get_instance();
+		pPref->setRecordEvents( !pPref->getRecordEvents() );
 	}
+	return true;
+}
 
-        if( sActionString == "PLAYLIST_NEXT_SONG"){
-                int songnumber = Playlist::get_instance()->getActiveSongNumber();
-                if(songnumber+1 >= 0 && songnumber+1 <= pEngine->m_PlayList.size()-1){
-                        Playlist::get_instance()->setNextSongByNumber( songnumber + 1 );
-                }
-                return true;
-        }
-
-        if( sActionString == "PLAYLIST_PREV_SONG"){
-                int songnumber = Playlist::get_instance()->getActiveSongNumber();
-                if(songnumber-1 >= 0 && songnumber-1 <= pEngine->m_PlayList.size()-1){
-                        Playlist::get_instance()->setNextSongByNumber( songnumber - 1 );
-                }
-                return true;
-        }
-
-        if( sActionString == "RECORD_READY"){
-               if ( pEngine->getState() != STATE_PLAYING ) {
-                       if (!Preferences::get_instance()->getRecordEvents()) {
-                               Preferences::get_instance()->setRecordEvents(true);
-                       }
-                       else {
-                               Preferences::get_instance()->setRecordEvents(false);
-                       }
-               }
-               return true;
-        }
-        if( sActionString == "RECORD/STROBE_TOGGLE"){
-               if (!Preferences::get_instance()->getRecordEvents()) {
-                      Preferences::get_instance()->setRecordEvents(true);
-               }
-               else {
-                      Preferences::get_instance()->setRecordEvents(false);
-               }
-               return true;
-        }
-
-        if( sActionString == "RECORD_STROBE"){
-
-               if (!Preferences::get_instance()->getRecordEvents()) {
-                      Preferences::get_instance()->setRecordEvents(true);
-               }
-               return true;
-        }
-
-        if( sActionString == "RECORD_EXIT"){
+bool MidiActionManager::recordStrobeToggle( int, int )
+{
+	Preferences *pPref = Preferences::get_instance();
+	pPref->setRecordEvents( !pPref->getRecordEvents() );
+	return true;
+}
 
-               if (Preferences::get_instance()->getRecordEvents()) {
-                      Preferences::get_instance()->setRecordEvents(false);
-               }
-               return true;
-        }
+bool MidiActionManager::recordStrobe( int, int )
+{
+	if (!Preferences::get_instance()->getRecordEvents()) {
+		Preferences::get_instance()->setRecordEvents(true);
+	}
+	return true;
+}
 
-        if( sActionString == "TOGGLE_METRONOME"){
+bool MidiActionManager::recordExit( int, int )
+{
+	if (Preferences::get_instance()->getRecordEvents()) {
+		Preferences::get_instance()->setRecordEvents(false);
+	}
+	return true;
+}
 
-               Preferences::get_instance()->m_bUseMetronome = !Preferences::get_instance()->m_bUseMetronome;
-               return true;
-        }
+bool MidiActionManager::toggleMetronome( int, int )
+{
+	Preferences::get_instance()->m_bUseMetronome = !Preferences::get_instance()->m_bUseMetronome;
+	return true;
+}
 
-        if( sActionString == "UNDO_ACTION"){
-                EventQueue::get_instance()->push_event( EVENT_UNDO_REDO, 0);// 0 = undo
-                return true;
-        }
+bool MidiActionManager::undoAction( int, int )
+{
+	EventQueue::get_instance()->push_event( EVENT_UNDO_REDO, 0);// 0 = undo
+	return true;
+}
 
-        if( sActionString == "REDO_ACTION"){
-                EventQueue::get_instance()->push_event( EVENT_UNDO_REDO, 1);// 1 = redo
-                return true;
-        }
-        return false;
+bool MidiActionManager::redoAction( int, int )
+{
+	EventQueue::get_instance()->push_event( EVENT_UNDO_REDO, 1);// 1 = redo
+	return true;
 }
@@ -37,6 +37,10 @@
 * midi action. Several events can relate to the same action.
 * Midi events are note, mmc or cc messages.
 *
+* The midi input thread looks the actions up without locking: each change
+* publishes a new table of the actions, the replaced table and actions
+* being deleted once the thread is done with its current message.
+*
 *
 * @author Sebastian Moors
 *
@@ -53,26 +57,30 @@ MidiMap::MidiMap()
 	QMutexLocker mx(&__mutex);
 
 	//constructor
+	Table *pTable = new Table;
 	for(int note = 0; note < 128; note++ ) {
-                __note_array[ note ] = new MidiAction("NOTHING");
-                __cc_array[ note ] = new MidiAction("NOTHING");
+		pTable->note_array[ note ] = new MidiAction("NOTHING");
+		pTable->cc_array[ note ] = new MidiAction("NOTHING");
 	}
+	__table = pTable;
 }
 
 MidiMap::~MidiMap()
 {
 	QMutexLocker mx(&__mutex);
 
-	map_t::iterator dIter( mmcMap.begin() );
+	Table *pTable = __table;
+	map_t::iterator dIter( pTable->mmcMap.begin() );
 
-	for( dIter = mmcMap.begin(); dIter != mmcMap.end(); dIter++ ) {
+	for( dIter = pTable->mmcMap.begin(); dIter != pTable->mmcMap.end(); dIter++ ) {
 		delete dIter->second;
 	}
 
 	for( int i = 0; i < 128; i++ ) {
-		delete __note_array[ i ];
-		delete __cc_array[ i ];
+		delete pTable->note_array[ i ];
+		delete pTable->cc_array[ i ];
 	}
+	delete pTable;
 
 	__instance = NULL;
 }
@@ -91,6 +99,20 @@ void MidiMap::reset_instance()
 }
 
 
+/**
+ * Replaces the current table, the midi input thread may still be
+ * looking up the old one: it is deleted once the thread is done with it.
+ * Called with the mutex locked.
+ */
+void MidiMap::publish( Table* pTable )
+{
+	Table *pOldTable = __table;
+	__table.fetchAndStoreOrdered( pTable );
+	__reclaimer.retire( pOldTable );
+	__reclaimer.collect();
+}
+
+
 /**
  * Clears the complete midi map and releases the memory
  * of the contained actions
@@ -99,26 +121,30 @@ void MidiMap::reset()
 {
 	QMutexLocker mx(&__mutex);
 
+	Table *pOldTable = __table;
+	Table *pTable = new Table;
+
 	map_t::iterator iter;
-	for( iter = mmcMap.begin() ; iter != mmcMap.end() ; ++iter ) {
-		delete iter->second;
+	for( iter = pOldTable->mmcMap.begin() ; iter != pOldTable->mmcMap.end() ; ++iter ) {
+		__reclaimer.retire( iter->second );
 	}
-	mmcMap.clear();
 
 	int i;
 	for( i = 0 ; i < 128 ; ++i ) {
-		delete __note_array[ i ];
-		delete __cc_array[ i ];
-                __note_array[ i ] = new MidiAction("NOTHING");
-                __cc_array[ i ] = new MidiAction("NOTHING");
+		__reclaimer.retire( pOldTable->note_array[ i ] );
+		__reclaimer.retire( pOldTable->cc_array[ i ] );
+		pTable->note_array[ i ] = new MidiAction("NOTHING");
+		pTable->cc_array[ i ] = new MidiAction("NOTHING");
 	}
 
+	publish( pTable );
 }
 
 
 std::map< QString, MidiAction* > MidiMap::getMMCMap()
 {
-	return mmcMap;
+	Table *pTable = __table;
+	return pTable->mmcMap;
 }
 
 
@@ -129,10 +155,13 @@ void MidiMap::registerMMCEvent( QString eventString , MidiAction* pAction )
 {
 	QMutexLocker mx(&__mutex);
 
-	if( mmcMap[ eventString ] != NULL){
-	    delete mmcMap[ eventString ];
+	Table *pTable = new Table( *( ( Table* )__table ) );
+	map_t::iterator dIter = pTable->mmcMap.find( eventString );
+	if( dIter != pTable->mmcMap.end() ){
+		__reclaimer.retire( dIter->second );
 	}
-	mmcMap[ eventString ] = pAction;
+	pTable->mmcMap[ eventString ] = pAction;
+	publish( pTable );
 }
 
 
@@ -143,8 +172,10 @@ void MidiMap::registerNoteEvent( int note, MidiAction* pAction )
 {
 	QMutexLocker mx(&__mutex);
 	if( note >= 0 && note < 128 ) {
-		delete __note_array[ note ];
-		__note_array[ note ] = pAction;
+		Table *pTable = new Table( *( ( Table* )__table ) );
+		__reclaimer.retire( pTable->note_array[ note ] );
+		pTable->note_array[ note ] = pAction;
+		publish( pTable );
 	}
 }
 
@@ -156,41 +187,46 @@ void MidiMap::registerCCEvent( int parameter , MidiAction * pAction ){
 	QMutexLocker mx(&__mutex);
 	if( parameter >= 0 and parameter < 128 )
 	{
-		delete __cc_array[ parameter ];
-		__cc_array[ parameter ] = pAction;
+		Table *pTable = new Table( *( ( Table* )__table ) );
+		__reclaimer.retire( pTable->cc_array[ parameter ] );
+		pTable->cc_array[ parameter ] = pAction;
+		publish( pTable );
 	}
 }
 
 
 /**
  * Returns the mmc action which was linked to the given event.
+ * The midi input thread calls it between beginLookup() and endLookup().
  */
 MidiAction* MidiMap::getMMCAction( QString eventString )
 {
-	QMutexLocker mx(&__mutex);
-        std::map< QString, MidiAction *>::iterator dIter = mmcMap.find( eventString );
-	if ( dIter == mmcMap.end() ){
+	Table *pTable = __table;
+	map_t::const_iterator dIter = pTable->mmcMap.find( eventString );
+	if ( dIter == pTable->mmcMap.end() ){
 		return NULL;
 	}
 
-	return mmcMap[eventString];
+	return dIter->second;
 }
 
 /**
  * Returns the note action which was linked to the given event.
+ * The midi input thread calls it between beginLookup() and endLookup().
  */
 MidiAction* MidiMap::getNoteAction( int note )
 {
-	QMutexLocker mx(&__mutex);
-	return __note_array[ note ];
+	Table *pTable = __table;
+	return pTable->note_array[ note ];
 }
 
 /**
  * Returns the cc action which was linked to the given event.
+ * The midi input thread calls it between beginLookup() and endLookup().
  */
 MidiAction * MidiMap::getCCAction( int parameter )
 {
-	QMutexLocker mx(&__mutex);
-	return __cc_array[ parameter ];
+	Table *pTable = __table;
+	return pTable->cc_array[ parameter ];
 }
 
@@ -185,6 +185,13 @@ Preferences::Preferences()
 	m_bUseMetronome = false;
 	m_fMetronomeVolume = 0.5;
 	m_nMaxNotes = 256;
+	m_nRenderThreads = 0;
+	m_nSampleCacheSize = 512;
+	m_bUseSampleStore = true;
+	m_nSampleStoreSize = 1024;
+	m_nStreamThreshold = 0;
+	m_nSampleBits = 32;
+	m_bResampleLayers = false;
 	m_nBufferSize = 1024;
 	m_nSampleRate = 44100;
 
@@ -223,6 +230,7 @@ Preferences::Preferences()
 	m_bShowExportWarning = false; 
 	// NONE: lastSongFilename;
 	hearNewNotes = true;
+	m_bCompiledSongs = false;
 	// NONE: m_recentFiles;
 	// NONE: m_recentFX;
 	// NONE: m_ladspaPathVect;
@@ -396,6 +404,7 @@ void Preferences::loadPreferences( bool bGlobal )
 			m_nRecPostDelete = LocalFileMng::readXmlInt( rootNode, "postDelete", 0 );
 
 			hearNewNotes = LocalFileMng::readXmlBool( rootNode, "hearNewNotes", hearNewNotes );
+			m_bCompiledSongs = LocalFileMng::readXmlBool( rootNode, "compiledSongs", m_bCompiledSongs );
 			quantizeEvents = LocalFileMng::readXmlBool( rootNode, "quantizeEvents", quantizeEvents );
 			
 			//rubberband
@@ -471,6 +480,13 @@ void Preferences::loadPreferences( bool bGlobal )
 				m_bUseMetronome = LocalFileMng::readXmlBool( audioEngineNode, "use_metronome", m_bUseMetronome );
 				m_fMetronomeVolume = LocalFileMng::readXmlFloat( audioEngineNode, "metronome_volume", 0.5f );
 				m_nMaxNotes = LocalFileMng::readXmlInt( audioEngineNode, "maxNotes", m_nMaxNotes );
+				m_nRenderThreads = LocalFileMng::readXmlInt( audioEngineNode, "renderThreads", m_nRenderThreads );
+				m_nSampleCacheSize = LocalFileMng::readXmlInt( audioEngineNode, "sampleCacheSize", m_nSampleCacheSize );
+				m_bUseSampleStore = LocalFileMng::readXmlBool( audioEngineNode, "sampleStore", m_bUseSampleStore );
+				m_nSampleStoreSize = LocalFileMng::readXmlInt( audioEngineNode, "sampleStoreSize", m_nSampleStoreSize );
+				m_nStreamThreshold = LocalFileMng::readXmlInt( audioEngineNode, "streamThreshold", m_nStreamThreshold );
+				m_nSampleBits = LocalFileMng::readXmlInt( audioEngineNode, "sampleBits", m_nSampleBits );
+				m_bResampleLayers = LocalFileMng::readXmlBool( audioEngineNode, "resampleLayers", m_bResampleLayers );
 				m_nBufferSize = LocalFileMng::readXmlInt( audioEngineNode, "buffer_size", m_nBufferSize );
 				m_nSampleRate = LocalFileMng::readXmlInt( audioEngineNode, "samplerate", m_nSampleRate );
 
@@ -755,6 +771,9 @@ void Preferences::savePreferences()
 	// hear new notes in the pattern editor
 	LocalFileMng::writeXmlString( rootNode, "hearNewNotes", hearNewNotes ? "true": "false" );
 
+	// compiled copy of the songs
+	LocalFileMng::writeXmlString( rootNode, "compiledSongs", m_bCompiledSongs ? "true": "false" );
+
 	// key/midi event prefs
 	//LocalFileMng::writeXmlString( rootNode, "recordEvents", recordEvents ? "true": "false" );
 	LocalFileMng::writeXmlString( rootNode, "quantizeEvents", quantizeEvents ? "true": "false" );
@@ -823,6 +842,13 @@ void Preferences::savePreferences()
 		LocalFileMng::writeXmlString( audioEngineNode, "use_metronome", m_bUseMetronome ? "true": "false" );
 		LocalFileMng::writeXmlString( audioEngineNode, "metronome_volume", QString("%1").arg( m_fMetronomeVolume ) );
 		LocalFileMng::writeXmlString( audioEngineNode, "maxNotes", QString("%1").arg( m_nMaxNotes ) );
+		LocalFileMng::writeXmlString( audioEngineNode, "renderThreads", QString("%1").arg( m_nRenderThreads ) );
+		LocalFileMng::writeXmlString( audioEngineNode, "sampleCacheSize", QString("%1").arg( m_nSampleCacheSize ) );
+		LocalFileMng::writeXmlBool( audioEngineNode, "sampleStore", m_bUseSampleStore );
+		LocalFileMng::writeXmlString( audioEngineNode, "sampleStoreSize", QString("%1").arg( m_nSampleStoreSize ) );
+		LocalFileMng::writeXmlString( audioEngineNode, "streamThreshold", QString("%1").arg( m_nStreamThreshold ) );
+		LocalFileMng::writeXmlString( audioEngineNode, "sampleBits", QString("%1").arg( m_nSampleBits ) );
+		LocalFileMng::writeXmlBool( audioEngineNode, "resampleLayers", m_bResampleLayers );
 		LocalFileMng::writeXmlString( audioEngineNode, "buffer_size", QString("%1").arg( m_nBufferSize ) );
 		LocalFileMng::writeXmlString( audioEngineNode, "samplerate", QString("%1").arg( m_nSampleRate ) );
 
@@ -0,0 +1,310 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/sampler/disk_streamer.h>
+#include <hydrogen/basics/sample.h>
+
+#include <algorithm>
+#include <ctime>
+#include <cstring>
+#include <sndfile.h>
+
+/** number of frames the disk thread reads at once */
+#define DISK_STREAMER_CHUNK_FRAMES  4096
+/** time the disk thread sleeps between two passes, in ms */
+#define DISK_STREAMER_PERIOD        10
+
+namespace H2Core
+{
+
+/** a playing streamed sample */
+struct DiskStreamer::Stream {
+    QAtomicInt state;                   ///< one of State
+    RingBuffer<Frame>* ring;            ///< frames read ahead, pushed by the disk thread
+    // set by open()
+    Sample* sample;                     ///< the streamed sample, only used by the audio thread
+    int serial;                         ///< serial of the streamed sample
+    QString filepath;                   ///< file of the streamed sample, released by the disk thread
+    int head_frames;                    ///< number of frames held by the sample
+    int total_frames;                   ///< number of frames of the file
+    // owned by the disk thread
+    SNDFILE* file;                      ///< the file being read
+    int channels;                       ///< number of channels of the file
+    bool eof;                           ///< the whole file has been read
+    // owned by the audio thread
+    long long ring_frame;               ///< frame of the next frame popped out of the ring
+    int stale;                          ///< number of frames still queued for frames already rendered
+    long long window_start;             ///< first frame held by the window
+    int window_frames;                  ///< number of frames held by the window
+    float window_l[ DISK_STREAMER_WINDOW_FRAMES ];
+    float window_r[ DISK_STREAMER_WINDOW_FRAMES ];
+};
+
+const char* DiskStreamer::__class_name = "DiskStreamer";
+
+void* diskStreamer_thread( void* param )
+{
+    ( ( DiskStreamer* )param )->__run();
+    return 0;
+}
+
+DiskStreamer::DiskStreamer()
+    : Object( __class_name ),
+      __running( true ),
+      __active( 0 ),
+      __underruns( 0 )
+{
+    __streams = new Stream[ DISK_STREAMER_STREAMS ];
+    for ( int i = 0; i < DISK_STREAMER_STREAMS; i++ ) {
+        __streams[i].state = Free;
+        __streams[i].ring = new RingBuffer<Frame>( DISK_STREAMER_RING_FRAMES );
+        __streams[i].file = 0;
+        __streams[i].serial = -1;
+    }
+    __frames.resize( DISK_STREAMER_CHUNK_FRAMES );
+    sem_init( &__wake, 0, 0 );
+    pthread_create( &__disk_thread, 0, diskStreamer_thread, this );
+}
+
+DiskStreamer::~DiskStreamer()
+{
+    __running = false;
+    sem_post( &__wake );
+    pthread_join( __disk_thread, 0 );
+    sem_destroy( &__wake );
+    for ( int i = 0; i < DISK_STREAMER_STREAMS; i++ ) {
+        if ( __streams[i].file ) sf_close( __streams[i].file );
+        delete __streams[i].ring;
+    }
+    delete[] __streams;
+}
+
+int DiskStreamer::open( Sample* sample )
+{
+    for ( int i = 0; i < DISK_STREAMER_STREAMS; i++ ) {
+        Stream* stream = &__streams[i];
+        if ( !stream->state.testAndSetAcquire( Free, Claimed ) ) continue;
+        // the disk thread left the stream, nothing is pushed until Opening
+        stream->ring->clear();
+        stream->sample = sample;
+        stream->serial = sample->get_serial();
+        stream->filepath = sample->get_filepath();  // shared, not copied
+        stream->head_frames = sample->get_frames();
+        stream->total_frames = sample->get_total_frames();
+        stream->ring_frame = stream->head_frames;
+        stream->stale = 0;
+        stream->window_start = 0;
+        stream->window_frames = 0;
+        stream->state.fetchAndStoreRelease( Opening );
+        __active.fetchAndAddRelaxed( 1 );
+        sem_post( &__wake );
+        return i;
+    }
+    return -1;
+}
+
+bool DiskStreamer::is_open_on( int stream, const Sample* sample ) const
+{
+    return __streams[ stream ].serial == sample->get_serial();
+}
+
+void DiskStreamer::close( int stream )
+{
+    __streams[ stream ].state.fetchAndStoreRelease( Closing );
+    __active.fetchAndAddRelaxed( -1 );
+    sem_post( &__wake );
+}
+
+int DiskStreamer::fetch( int idx, long long first, int count, const float** data_l, const float** data_r )
+{
+    Stream* stream = &__streams[ idx ];
+    if ( count > DISK_STREAMER_WINDOW_FRAMES ) count = DISK_STREAMER_WINDOW_FRAMES;
+    long long end = first + count;
+    long long window_end = stream->window_start + stream->window_frames;
+    if ( first < stream->window_start || first > window_end ) {
+        // out of the window, start it over
+        stream->window_start = first;
+        stream->window_frames = 0;
+        window_end = first;
+    } else if ( first > stream->window_start ) {
+        // keep the frames still wanted at the front of the window
+        int drop = first - stream->window_start;
+        stream->window_frames -= drop;
+        memmove( stream->window_l, stream->window_l + drop, stream->window_frames * sizeof( float ) );
+        memmove( stream->window_r, stream->window_r + drop, stream->window_frames * sizeof( float ) );
+        stream->window_start = first;
+    }
+    if ( end > window_end ) __pull( stream, window_end, end - window_end );
+    *data_l = stream->window_l;
+    *data_r = stream->window_r;
+    if ( stream->ring->size() < DISK_STREAMER_RING_FRAMES / 2 ) sem_post( &__wake );
+    return count;
+}
+
+void DiskStreamer::__pull( Stream* stream, long long frame, int count )
+{
+    float* out_l = stream->window_l + stream->window_frames;
+    float* out_r = stream->window_r + stream->window_frames;
+    stream->window_frames += count;
+
+    // from the head held by the sample
+    if ( frame < stream->head_frames ) {
+        int n = std::min( ( long long )count, stream->head_frames - frame );
+        stream->sample->read( ( int )frame, n, out_l, out_r );
+        out_l += n;
+        out_r += n;
+        frame += n;
+        count -= n;
+    }
+
+    // from the ring
+    if ( count > 0 && frame < stream->total_frames ) {
+        int n = std::min( ( long long )count, stream->total_frames - frame );
+        int missing = 0;
+        if ( frame < stream->ring_frame ) {
+            // already popped, not to be read again
+            missing = std::min( ( long long )n, stream->ring_frame - frame );
+        } else if ( frame > stream->ring_frame ) {
+            // jumped forward, the frames in between are dropped
+            stream->stale += frame - stream->ring_frame;
+            stream->ring_frame = frame;
+        }
+        memset( out_l, 0, missing * sizeof( float ) );
+        memset( out_r, 0, missing * sizeof( float ) );
+        int wanted = n - missing;
+        if ( stream->stale > 0 ) stream->stale -= stream->ring->read( 0, stream->stale );
+        int got = 0;
+        if ( stream->stale == 0 ) {
+            Frame frames[ 256 ];
+            while ( got < wanted ) {
+                int read = stream->ring->read( frames, std::min( wanted - got, 256 ) );
+                if ( read == 0 ) break;
+                for ( int i = 0; i < read; i++ ) {
+                    out_l[ missing + got + i ] = frames[i].l;
+                    out_r[ missing + got + i ] = frames[i].r;
+                }
+                got += read;
+            }
+        }
+        if ( got < wanted ) {
+            // not read in time, those frames will be dropped once they come
+            memset( out_l + missing + got, 0, ( wanted - got ) * sizeof( float ) );
+            memset( out_r + missing + got, 0, ( wanted - got ) * sizeof( float ) );
+            stream->stale += wanted - got;
+            __underruns.fetchAndAddRelaxed( 1 );
+        }
+        stream->ring_frame += wanted;
+        out_l += n;
+        out_r += n;
+        count -= n;
+    }
+
+    // past the end of the file
+    memset( out_l, 0, count * sizeof( float ) );
+    memset( out_r, 0, count * sizeof( float ) );
+}
+
+void DiskStreamer::__run()
+{
+    while ( __running ) {
+        struct timespec timeout;
+        clock_gettime( CLOCK_REALTIME, &timeout );
+        timeout.tv_nsec += DISK_STREAMER_PERIOD * 1000000;
+        if ( timeout.tv_nsec >= 1000000000 ) {
+            timeout.tv_sec++;
+            timeout.tv_nsec -= 1000000000;
+        }
+        sem_timedwait( &__wake, &timeout );
+
+        // go over the streams as long as some ring is not full
+        bool busy = true;
+        while ( busy && __running ) {
+            busy = false;
+            for ( int i = 0; i < DISK_STREAMER_STREAMS; i++ ) {
+                Stream* stream = &__streams[i];
+                switch ( stream->state.fetchAndAddAcquire( 0 ) ) {
+                case Opening: {
+                    SF_INFO info;
+                    memset( &info, 0, sizeof( info ) );
+                    stream->file = sf_open( stream->filepath.toLocal8Bit(), SFM_READ, &info );
+                    stream->eof = true;
+                    if ( !stream->file ) {
+                        ERRORLOG( QString( "unable to open %1, it will be played silent" ).arg( stream->filepath ) );
+                    } else if ( sf_seek( stream->file, stream->head_frames, SEEK_SET ) == -1 ) {
+                        ERRORLOG( QString( "unable to seek into %1, it will be played silent" ).arg( stream->filepath ) );
+                    } else {
+                        stream->channels = info.channels;
+                        stream->eof = false;
+                    }
+                    // closed meanwhile, left to the next pass
+                    stream->state.testAndSetOrdered( Opening, Playing );
+                    busy = true;
+                    break;
+                }
+                case Playing:
+                    if ( __fill( stream ) ) busy = true;
+                    break;
+                case Closing:
+                    if ( stream->file ) sf_close( stream->file );
+                    stream->file = 0;
+                    // the last reference to the path might be freed, not by the audio thread
+                    stream->filepath = QString();
+                    stream->state.fetchAndStoreRelease( Free );
+                    break;
+                }
+            }
+        }
+    }
+}
+
+bool DiskStreamer::__fill( Stream* stream )
+{
+    if ( stream->eof ) return false;
+    int room = stream->ring->get_capacity() - stream->ring->size();
+    if ( room < DISK_STREAMER_CHUNK_FRAMES ) return false;
+    __interleaved.resize( DISK_STREAMER_CHUNK_FRAMES * stream->channels );
+    sf_count_t read = sf_readf_float( stream->file, &__interleaved[0], DISK_STREAMER_CHUNK_FRAMES );
+    if ( read < DISK_STREAMER_CHUNK_FRAMES ) stream->eof = true;
+    if ( read <= 0 ) return false;
+    // same channel mapping as Sample::load
+    int right = ( stream->channels > 1 ? 1 : 0 );
+    for ( int i = 0; i < read; i++ ) {
+        __frames[i].l = __interleaved[ i * stream->channels ];
+        __frames[i].r = __interleaved[ i * stream->channels + right ];
+    }
+    stream->ring->write( &__frames[0], read );
+    return true;
+}
+
+int DiskStreamer::get_active() const
+{
+    return __active;
+}
+
+int DiskStreamer::get_underruns() const
+{
+    return __underruns;
+}
+
+};
+
+/* vim: set softtabstop=4 expandtab: */
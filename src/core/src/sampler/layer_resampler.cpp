@@ -0,0 +1,179 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/sampler/layer_resampler.h>
+
+#include <hydrogen/audio_engine.h>
+#include <hydrogen/hydrogen.h>
+#include <hydrogen/basics/song.h>
+#include <hydrogen/basics/sample.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_list.h>
+#include <hydrogen/basics/instrument_layer.h>
+#include <hydrogen/sampler/Sampler.h>
+#include <hydrogen/IO/AudioOutput.h>
+
+#include <QtCore/QMutexLocker>
+
+namespace H2Core
+{
+
+const char* LayerResampler::__class_name = "LayerResampler";
+
+LayerResampler::LayerResampler()
+    : Object( __class_name ),
+      __generation( 0 ),
+      __quit( false ),
+      __started( false )
+{
+    if ( pthread_create( &__worker, 0, LayerResampler::__thread_main, this ) == 0 ) {
+        __started = true;
+    } else {
+        ERRORLOG( "unable to start the conversion thread, the layers are resampled while playing" );
+    }
+}
+
+LayerResampler::~LayerResampler()
+{
+    __mutex.lock();
+    __quit = true;
+    __clear();
+    __queued.wakeAll();
+    __mutex.unlock();
+    if ( __started ) pthread_join( __worker, 0 );
+}
+
+void LayerResampler::update( Song* song, int sample_rate )
+{
+    __mutex.lock();
+    __clear();
+    // a conversion running meanwhile is not installed
+    ++__generation;
+    __mutex.unlock();
+    if ( !song || !__started ) return;
+
+    std::vector<Sample*> dropped;
+    AudioEngine::get_instance()->lock( RIGHT_HERE );
+    Sampler* sampler = AudioEngine::get_instance()->get_sampler();
+    InstrumentList* instruments = song->get_instrument_list();
+    for ( unsigned i = 0; i < instruments->size(); i++ ) {
+        Instrument* instrument = instruments->get( i );
+        for ( int n = 0; n < MAX_LAYERS; n++ ) {
+            InstrumentLayer* layer = instrument->get_layer( n );
+            if ( !layer ) continue;
+            Sample* resampled = layer->get_resampled();
+            if ( resampled && resampled->get_sample_rate() != sample_rate ) {
+                dropped.push_back( sampler->set_resampled( layer, 0 ) );
+                resampled = 0;
+            }
+            if ( !resampled ) add( layer, sample_rate );
+        }
+    }
+    AudioEngine::get_instance()->unlock();
+
+    for ( unsigned i = 0; i < dropped.size(); i++ ) delete dropped[i];
+    if ( sample_rate > 0 ) INFOLOG( QString( "converting %1 layers to %2 Hz" ).arg( get_pending() ).arg( sample_rate ) );
+}
+
+void LayerResampler::add( InstrumentLayer* layer, int sample_rate )
+{
+    Sample* sample = layer->get_sample();
+    if ( !__started || sample_rate <= 0 || !sample || sample->is_empty() || sample->is_streamed()
+            || sample->get_sample_rate() == sample_rate ) return;
+    Job job;
+    job.layer = layer;
+    job.source = sample;
+    job.copy = new Sample( sample );
+    job.sample_rate = sample_rate;
+    QMutexLocker lock( &__mutex );
+    job.generation = __generation;
+    __jobs.push_back( job );
+    __queued.wakeOne();
+}
+
+int LayerResampler::get_pending() const
+{
+    QMutexLocker lock( &__mutex );
+    return __jobs.size();
+}
+
+void LayerResampler::__clear()
+{
+    for ( unsigned i = 0; i < __jobs.size(); i++ ) delete __jobs[i].copy;
+    __jobs.clear();
+}
+
+bool LayerResampler::__install( const Job& job, Sample* resampled )
+{
+    AudioEngine::get_instance()->lock( RIGHT_HERE );
+    bool current = false;
+    __mutex.lock();
+    if ( job.generation == __generation ) {
+        // the layer may have been deleted or given another sample meanwhile
+        Song* song = Hydrogen::get_instance()->getSong();
+        AudioOutput* output = Hydrogen::get_instance()->getAudioOutput();
+        InstrumentList* instruments = ( song ? song->get_instrument_list() : 0 );
+        for ( unsigned i = 0; instruments && i < instruments->size() && !current; i++ ) {
+            for ( int n = 0; n < MAX_LAYERS && !current; n++ ) {
+                current = ( instruments->get( i )->get_layer( n ) == job.layer );
+            }
+        }
+        current = current && job.layer->get_sample() == job.source && !job.layer->get_resampled()
+                  && output && ( int )output->getSampleRate() == job.sample_rate;
+    }
+    __mutex.unlock();
+    if ( current ) AudioEngine::get_instance()->get_sampler()->set_resampled( job.layer, resampled );
+    AudioEngine::get_instance()->unlock();
+    return current;
+}
+
+void LayerResampler::__run()
+{
+    QMutexLocker lock( &__mutex );
+    while ( true ) {
+        if ( __quit ) return;
+        if ( __jobs.empty() ) {
+            __queued.wait( &__mutex );
+            continue;
+        }
+        Job job = __jobs.front();
+        __jobs.erase( __jobs.begin() );
+        lock.unlock();
+
+        // the conversion runs unlocked, the layer keeps playing its sample meanwhile
+        Sample* resampled = job.copy->resample( job.sample_rate );
+        delete job.copy;
+        if ( resampled && !__install( job, resampled ) ) delete resampled;
+
+        lock.relock();
+    }
+}
+
+void* LayerResampler::__thread_main( void* param )
+{
+    static_cast<LayerResampler*>( param )->__run();
+    return 0;
+}
+
+};
+
+/* vim: set softtabstop=4 expandtab: */
@@ -22,9 +22,14 @@
 
 #include <cassert>
 #include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <unistd.h>
 
 #include <hydrogen/IO/AudioOutput.h>
-#include <hydrogen/IO/JackOutput.h>
 
 #include <hydrogen/basics/adsr.h>
 #include <hydrogen/audio_engine.h>
@@ -44,6 +49,9 @@
 
 #include <hydrogen/fx/Effects.h>
 #include <hydrogen/sampler/Sampler.h>
+#include <hydrogen/sampler/sampler_kernels.h>
+#include <hydrogen/sampler/disk_streamer.h>
+#include <hydrogen/sampler/layer_resampler.h>
 
 #include <iostream>
 #include <QDebug>
@@ -53,13 +61,150 @@ namespace H2Core
 
 const char* Sampler::__class_name = "Sampler";
 
+/// max number of voice rendering threads
+#define MAX_RENDER_THREADS	16
+
+/// length of the smoothing of the instrument parameters, in milliseconds
+#define SMOOTHING_TIME		10
+
+/// share of the period, in percent, the audio thread waits for the render workers
+/// before rendering the tracks of the late ones itself
+#define RENDER_DEADLINE		50
+
+/// number of tracks a render worker takes per period, each one with its own track outputs
+#define RENDER_WORKER_TRACKS	8
+
+/// owner of a track of __render_groups: the period in the upper bits, the thread in the lower
+/// 8 bits, 0 while unclaimed, 1 for the audio thread, 2 and more for the render workers
+#define RENDER_OWNER( nPeriod, nThread )	( ( ( nPeriod ) << 8 ) | ( nThread ) )
+#define RENDER_PERIOD_MASK	0x7fffff
+#define RENDER_UNCLAIMED	0
+#define RENDER_AUDIO_THREAD	1
+
+/// states of a render worker within a period
+enum RenderState {
+	RENDER_IDLE,		///< nothing to render, the audio thread may post it
+	RENDER_POSTED,		///< woken up by the audio thread
+	RENDER_WORKING,		///< rendering tracks
+	RENDER_DONE,		///< done with the period, its work is committed by the audio thread
+	RENDER_SKIPPED,		///< woken up too late, the audio thread rendered every track
+	RENDER_ABANDONED	///< too late, the audio thread rendered its tracks, its work is dropped
+};
+
+/// A voice rendering thread with its private accumulation buffers.
+/// It renders copies of the notes, which the audio thread commits, so that
+/// a late worker can be given up on and its tracks rendered again.
+struct Sampler::RenderWorker {
+	Sampler* sampler;
+	int index;			///< position in __render_workers
+	pthread_t thread;
+	sem_t start;			///< posted by the audio thread when there is something to render
+	volatile bool running;
+	volatile bool realtime;		///< the thread got real time scheduling, it is not woken up otherwise
+	QAtomicInt state;		///< one of RenderState
+	uint32_t nFrames;
+	Song* song;
+	int nPeriod;			///< period the worker has been posted for
+	int nGroups;			///< number of tracks in __render_groups for that period
+	bool bTrackOuts;		///< the driver has track outputs
+	RenderBuffers buffers;
+	std::vector<Note*> shadows;	///< copies of the notes rendered
+	std::vector<int> notes;		///< index in the playing notes of each copy
+	std::vector<unsigned> results;	///< __render_note() result of each copy
+	std::vector<int> streams;	///< stream of each note when copied
+	std::vector<float> peak_L;	///< peak of the instrument of each copy
+	std::vector<float> peak_R;
+	unsigned nShadows;
+	int nTracks;
+	int tracks[ RENDER_WORKER_TRACKS ];	///< tracks of __render_groups rendered
+	float main_L[ MAX_BUFFER_SIZE ];
+	float main_R[ MAX_BUFFER_SIZE ];
+	float fx_L[ MAX_FX ][ MAX_BUFFER_SIZE ];
+	float fx_R[ MAX_FX ][ MAX_BUFFER_SIZE ];
+	float track_L[ RENDER_WORKER_TRACKS ][ MAX_BUFFER_SIZE ];
+	float track_R[ RENDER_WORKER_TRACKS ][ MAX_BUFFER_SIZE ];
+};
+
+/// sort the playing notes by track
+struct compare_render_track {
+	const std::vector<int>* tracks;
+	bool operator()( int a, int b ) const {
+		return ( *tracks )[ a ] < ( *tracks )[ b ];
+	}
+};
+
+void* samplerWorker_processCaller( void* param )
+{
+	Sampler::RenderWorker* pWorker = ( Sampler::RenderWorker* )param;
+	Object* __object = pWorker->sampler;
+
+	// same priority as the ALSA driver thread
+	struct sched_param sched;
+	sched.sched_priority = 50;
+	int nErr = pthread_setschedparam( pthread_self(), SCHED_FIFO, &sched );
+	if ( nErr ) {
+		// it could be preempted for long while the audio thread waits for it
+		__ERRORLOG( QString( "Can't set realtime scheduling for render thread (%1), it won't be used" ).arg( strerror( nErr ) ) );
+	} else {
+		pWorker->realtime = true;
+	}
+
+	// one cpu per worker, the first cpu of the process being left to the
+	// audio thread as long as there are cpus enough
+	cpu_set_t cpus;
+	if ( pthread_getaffinity_np( pthread_self(), sizeof( cpus ), &cpus ) == 0 ) {
+		int nCPUs = CPU_COUNT( &cpus );
+		int nTarget = ( pWorker->index + 1 ) % nCPUs;
+		int nCPU = 0;
+		for ( ; nCPU < CPU_SETSIZE; ++nCPU ) {
+			if ( CPU_ISSET( nCPU, &cpus ) && nTarget-- == 0 ) break;
+		}
+		CPU_ZERO( &cpus );
+		CPU_SET( nCPU, &cpus );
+		nErr = pthread_setaffinity_np( pthread_self(), sizeof( cpus ), &cpus );
+		if ( nErr ) {
+			__WARNINGLOG( QString( "Can't pin render thread to cpu %1 (%2)" ).arg( nCPU ).arg( strerror( nErr ) ) );
+		}
+	}
+
+	while ( true ) {
+		while ( sem_wait( &pWorker->start ) != 0 ) {}
+		if ( !pWorker->running ) break;
+		// the period might be over, the audio thread having rendered every track
+		if ( !pWorker->state.testAndSetAcquire( RENDER_POSTED, RENDER_WORKING ) ) continue;
+
+		memset( pWorker->main_L, 0, pWorker->nFrames * sizeof( float ) );
+		memset( pWorker->main_R, 0, pWorker->nFrames * sizeof( float ) );
+		for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
+			if ( pWorker->buffers.fx_L[ nFX ] ) {
+				memset( pWorker->fx_L[ nFX ], 0, pWorker->nFrames * sizeof( float ) );
+				memset( pWorker->fx_R[ nFX ], 0, pWorker->nFrames * sizeof( float ) );
+			}
+		}
+		pWorker->sampler->__render_worker( pWorker );
+		// hand the work to the audio thread, unless it gave up waiting for it
+		if ( !pWorker->state.testAndSetOrdered( RENDER_WORKING, RENDER_DONE ) ) {
+			pWorker->sampler->__drop_worker( pWorker );
+			pWorker->state.fetchAndStoreRelease( RENDER_IDLE );
+		}
+	}
+	return 0;
+}
+
 Sampler::Sampler()
 		: Object( __class_name )
 		, __main_out_L( NULL )
 		, __main_out_R( NULL )
 		, __preview_instrument( NULL )
+		, __disk_streamer( NULL )
+		, __layer_resampler( NULL )
+		, __frames( 0 )
+		, __render_owners( NULL )
+		, __render_capacity( 0 )
+		, __render_period( 0 )
 {
 	INFOLOG( "INIT" );
+	INFOLOG( QString( "render kernels built for %1" ).arg( SamplerKernels::simd_name() ) );
         __interpolateMode = LINEAR;
 	__main_out_L = new float[ MAX_BUFFER_SIZE ];
 	__main_out_R = new float[ MAX_BUFFER_SIZE ];
@@ -70,6 +215,18 @@ Sampler::Sampler()
 	__preview_instrument->set_volume( 0.8 );
 	__preview_instrument->set_layer( new InstrumentLayer( Sample::load( sEmptySampleFilename ) ), 0 );
 
+	int nMaxNotes = Preferences::get_instance()->m_nMaxNotes * 2;
+	__playing_notes_queue.reserve( nMaxNotes );
+	__queuedNoteOffs.reserve( nMaxNotes );
+	__render_results.reserve( nMaxNotes );
+	__render_order.reserve( nMaxNotes );
+	__render_track.reserve( nMaxNotes );
+	__render_groups.reserve( nMaxNotes + 1 );
+	__render_capacity = nMaxNotes;
+	__render_owners = new QAtomicInt[ nMaxNotes ];
+	set_render_threads( Preferences::get_instance()->m_nRenderThreads );
+	__disk_streamer = new DiskStreamer();
+	__layer_resampler = new LayerResampler();
 }
 
 
@@ -77,11 +234,29 @@ Sampler::~Sampler()
 {
 	INFOLOG( "DESTROY" );
 
+	// its thread installs the converted samples through the sampler
+	delete __layer_resampler;
+	__layer_resampler = NULL;
+
+	set_render_threads( 0 );
+	delete[] __render_owners;
+
 	delete[] __main_out_L;
 	delete[] __main_out_R;
 
 	delete __preview_instrument;
 	__preview_instrument = NULL;
+
+	delete __disk_streamer;
+}
+
+void Sampler::__release_note( Note* pNote )
+{
+	if ( pNote->get_stream() != -1 ) {
+		__disk_streamer->close( pNote->get_stream() );
+		pNote->set_stream( -1 );
+	}
+	AudioEngine::get_instance()->get_note_pool()->release( pNote );
 }
 
 // perche' viene passata anche la canzone? E' davvero necessaria?
@@ -103,26 +278,61 @@ void Sampler::process( uint32_t nFrames, Song* pSong )
 		Note *oldNote = __playing_notes_queue[ 0 ];
 		__playing_notes_queue.erase( __playing_notes_queue.begin() );
 		oldNote->get_instrument()->dequeue();
-		delete oldNote;	// FIXME: send note-off instead of removing the note from the list?
+		__release_note( oldNote );	// FIXME: send note-off instead of removing the note from the list?
+	}
+
+	// the smoothed parameters of the instruments playing move on
+	int nSmoothing = audio_output->getSampleRate() * SMOOTHING_TIME / 1000;
+	for ( unsigned i = 0; i < __playing_notes_queue.size(); ++i ) {
+		Instrument *pInstr = __playing_notes_queue[ i ]->get_instrument();
+		if ( pInstr ) {
+			pInstr->update_parameters( __frames, nSmoothing );
+		}
 	}
 
 
+	RenderBuffers buffers;
+	buffers.main_L = __main_out_L;
+	buffers.main_R = __main_out_R;
+	buffers.track_L = NULL;
+	buffers.track_R = NULL;
+	buffers.peak_L = NULL;
+	buffers.peak_R = NULL;
+	for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
+		buffers.fx_L[ nFX ] = NULL;
+		buffers.fx_R[ nFX ] = NULL;
+#ifdef H2CORE_HAVE_LADSPA
+		LadspaFX *pFX = Effects::get_instance()->getPlayingLadspaFX( nFX );
+		if ( pFX ) {
+			buffers.fx_L[ nFX ] = pFX->m_pBuffer_L;
+			buffers.fx_R[ nFX ] = pFX->m_pBuffer_R;
+		}
+#endif
+	}
+
 	// eseguo tutte le note nella lista di note in esecuzione
-	unsigned i = 0;
 	Note* pNote;
-	while ( i < __playing_notes_queue.size() ) {
-		pNote = __playing_notes_queue[ i ];		// recupero una nuova nota
-		unsigned res = __render_note( pNote, nFrames, pSong );
-		if ( res == 1 ) {	// la nota e' finita
-			__playing_notes_queue.erase( __playing_notes_queue.begin() + i );
+	if ( !__render_workers.empty() && __playing_notes_queue.size() > 1
+	     && __playing_notes_queue.size() <= __render_capacity ) {
+		__render_parallel( nFrames, pSong, &buffers );
+	} else {
+		__render_results.resize( __playing_notes_queue.size() );
+		for ( unsigned i = 0; i < __playing_notes_queue.size(); ++i ) {
+			__render_results[ i ] = __render_note( __playing_notes_queue[ i ], nFrames, pSong, &buffers );
+		}
+	}
+
+	unsigned nPlaying = 0;
+	for ( unsigned i = 0; i < __playing_notes_queue.size(); ++i ) {
+		pNote = __playing_notes_queue[ i ];
+		if ( __render_results[ i ] == 1 ) {	// la nota e' finita
 			pNote->get_instrument()->dequeue();
 			__queuedNoteOffs.push_back( pNote );
-//			delete pNote;
-//			pNote = NULL;
 		} else {
-			++i; // carico la prox nota
+			__playing_notes_queue[ nPlaying++ ] = pNote;
 		}
 	}
+	__playing_notes_queue.resize( nPlaying );
 	
 	//Queue midi note off messages for notes that have a length specified for them
 
@@ -134,13 +344,277 @@ void Sampler::process( uint32_t nFrames, Song* pSong )
 
 		}
 		__queuedNoteOffs.erase( __queuedNoteOffs.begin() );
-		if( pNote != NULL) delete pNote;
+		__release_note( pNote );
 		pNote = NULL;
 	}//while
 
+	__frames += nFrames;
+}
+
+
+
+void Sampler::__render_parallel( uint32_t nFrames, Song* pSong, RenderBuffers* pBuffers )
+{
+	unsigned nNotes = __playing_notes_queue.size();
+	int nWorkers = __render_workers.size();
+	AudioOutput* pAudioOutput = Hydrogen::get_instance()->getAudioOutput();
+	__render_results.resize( nNotes );
+	__render_track.resize( nNotes );
+	__render_order.resize( nNotes );
+
+	// notes of the same track are rendered by the same thread, so that instrument
+	// peaks and JACK track outs are never written by two threads at once
+	InstrumentList* pInstrList = pSong->get_instrument_list();
+	for ( unsigned i = 0; i < nNotes; ++i ) {
+		int nTrack = pInstrList->index( __playing_notes_queue[ i ]->get_instrument() );
+		__render_track[ i ] = ( nTrack < 0 ? 0 : nTrack );	// see __render_note_no_resample
+		__render_order[ i ] = i;
+	}
+	compare_render_track cmp;
+	cmp.tracks = &__render_track;
+	std::sort( __render_order.begin(), __render_order.end(), cmp );
+
+	// the tracks are taken in turn by the threads, the audio thread included
+	__render_groups.clear();
+	for ( unsigned i = 0; i < nNotes; ++i ) {
+		if ( i == 0 || __render_track[ __render_order[ i ] ] != __render_track[ __render_order[ i - 1 ] ] ) {
+			__render_groups.push_back( i );
+		}
+	}
+	__render_groups.push_back( nNotes );
+	int nGroups = __render_groups.size() - 1;
+	// a worker late from a previous period can't take a track of this one
+	__render_period = ( __render_period + 1 ) & RENDER_PERIOD_MASK;
+	for ( int g = 0; g < nGroups; ++g ) {
+		__render_owners[ g ].fetchAndStoreRelaxed( RENDER_OWNER( __render_period, RENDER_UNCLAIMED ) );
+	}
+	__render_next.fetchAndStoreRelease( 0 );
+
+	// wake up the workers, no more than there are tracks besides the one of the audio thread
+	bool bPosted[ MAX_RENDER_THREADS ];
+	for ( int w = 0; w < nWorkers; ++w ) {
+		RenderWorker* pWorker = __render_workers[ w ];
+		bPosted[ w ] = false;
+		// a worker given up on in a previous period may still be rendering
+		if ( w >= nGroups - 1 || !pWorker->realtime || pWorker->state.fetchAndAddAcquire( 0 ) != RENDER_IDLE ) continue;
+		pWorker->nFrames = nFrames;
+		pWorker->song = pSong;
+		pWorker->nPeriod = __render_period;
+		pWorker->nGroups = nGroups;
+		pWorker->bTrackOuts = pAudioOutput->has_track_outs();
+		for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
+			pWorker->buffers.fx_L[ nFX ] = ( pBuffers->fx_L[ nFX ] ? pWorker->fx_L[ nFX ] : NULL );
+			pWorker->buffers.fx_R[ nFX ] = ( pBuffers->fx_R[ nFX ] ? pWorker->fx_R[ nFX ] : NULL );
+		}
+		pWorker->state.fetchAndStoreRelease( RENDER_POSTED );
+		sem_post( &pWorker->start );
+		bPosted[ w ] = true;
+	}
+
+	// a worker not scheduled in time leaves its share to the audio thread
+	int nAudioThread = RENDER_OWNER( __render_period, RENDER_AUDIO_THREAD );
+	int nGroup;
+	while ( ( nGroup = __render_next.fetchAndAddRelaxed( 1 ) ) < nGroups ) {
+		if ( __render_owners[ nGroup ].testAndSetAcquire( RENDER_OWNER( __render_period, RENDER_UNCLAIMED ), nAudioThread ) ) {
+			__render_group( nGroup, nFrames, pSong, pBuffers );
+		}
+	}
+	// the tracks a worker got the turn of but did not take yet
+	for ( int g = 0; g < nGroups; ++g ) {
+		if ( __render_owners[ g ].testAndSetAcquire( RENDER_OWNER( __render_period, RENDER_UNCLAIMED ), nAudioThread ) ) {
+			__render_group( g, nFrames, pSong, pBuffers );
+		}
+	}
+
+	// every track is taken, wait for the workers still rendering theirs, up to a
+	// deadline in the period. The tracks of a worker still late then are
+	// rendered again from the notes, which the worker only has copies of
+	timespec deadline = Hydrogen::get_instance()->getCurrentCycleTime();
+	long long nNsec = deadline.tv_nsec + ( long long )nFrames * 10000000LL * RENDER_DEADLINE / pAudioOutput->getSampleRate();
+	deadline.tv_sec += nNsec / 1000000000LL;
+	deadline.tv_nsec = nNsec % 1000000000LL;
+	for ( int w = 0; w < nWorkers; ++w ) {
+		RenderWorker* pWorker = __render_workers[ w ];
+		if ( !bPosted[ w ] || pWorker->state.testAndSetRelaxed( RENDER_POSTED, RENDER_SKIPPED ) ) continue;
+		while ( pWorker->state.fetchAndAddAcquire( 0 ) == RENDER_WORKING ) {
+			timespec now;
+			clock_gettime( CLOCK_MONOTONIC, &now );
+			if ( now.tv_sec < deadline.tv_sec || ( now.tv_sec == deadline.tv_sec && now.tv_nsec < deadline.tv_nsec ) ) continue;
+			if ( pWorker->state.testAndSetOrdered( RENDER_WORKING, RENDER_ABANDONED ) ) {
+				int nWorker = RENDER_OWNER( __render_period, w + 2 );
+				for ( int g = 0; g < nGroups; ++g ) {
+					if ( __render_owners[ g ].fetchAndAddAcquire( 0 ) == nWorker ) {
+						__render_group( g, nFrames, pSong, pBuffers );
+					}
+				}
+			}
+			break;
+		}
+	}
+
+	// commit the work of the workers in time
+	for ( int w = 0; w < nWorkers; ++w ) {
+		RenderWorker* pWorker = __render_workers[ w ];
+		if ( !bPosted[ w ] ) continue;
+		if ( pWorker->state.testAndSetAcquire( RENDER_SKIPPED, RENDER_IDLE )
+		     || !pWorker->state.testAndSetAcquire( RENDER_DONE, RENDER_IDLE ) ) {
+			continue;
+		}
+		for ( unsigned k = 0; k < pWorker->nShadows; ++k ) {
+			Note* pNote = __playing_notes_queue[ pWorker->notes[ k ] ];
+			*pNote = *pWorker->shadows[ k ];
+			__render_results[ pWorker->notes[ k ] ] = pWorker->results[ k ];
+			Instrument* pInstr = pNote->get_instrument();
+			if ( pInstr ) {
+				pInstr->set_peak_l( std::max( pInstr->get_peak_l(), pWorker->peak_L[ k ] ) );
+				pInstr->set_peak_r( std::max( pInstr->get_peak_r(), pWorker->peak_R[ k ] ) );
+			}
+		}
+		if ( pWorker->bTrackOuts ) {
+			for ( int t = 0; t < pWorker->nTracks; ++t ) {
+				int nTrack = __render_track[ __render_order[ __render_groups[ pWorker->tracks[ t ] ] ] ];
+				SamplerKernels::mac( pAudioOutput->getTrackOut_L( nTrack ), pWorker->track_L[ t ], 1.0f, nFrames );
+				SamplerKernels::mac( pAudioOutput->getTrackOut_R( nTrack ), pWorker->track_R[ t ], 1.0f, nFrames );
+			}
+		}
+		SamplerKernels::mac( pBuffers->main_L, pWorker->main_L, 1.0f, nFrames );
+		SamplerKernels::mac( pBuffers->main_R, pWorker->main_R, 1.0f, nFrames );
+		for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
+			if ( pBuffers->fx_L[ nFX ] ) {
+				SamplerKernels::mac( pBuffers->fx_L[ nFX ], pWorker->fx_L[ nFX ], 1.0f, nFrames );
+				SamplerKernels::mac( pBuffers->fx_R[ nFX ], pWorker->fx_R[ nFX ], 1.0f, nFrames );
+			}
+		}
+	}
+}
+
+void Sampler::__render_group( int nGroup, uint32_t nFrames, Song* pSong, RenderBuffers* pBuffers )
+{
+	for ( int i = __render_groups[ nGroup ]; i < __render_groups[ nGroup + 1 ]; ++i ) {
+		int nNote = __render_order[ i ];
+		__render_results[ nNote ] = __render_note( __playing_notes_queue[ nNote ], nFrames, pSong, pBuffers );
+	}
+}
+
+void Sampler::__render_worker( RenderWorker* pWorker )
+{
+	RenderBuffers buffers = pWorker->buffers;
+	int nUnclaimed = RENDER_OWNER( pWorker->nPeriod, RENDER_UNCLAIMED );
+	int nOwner = RENDER_OWNER( pWorker->nPeriod, pWorker->index + 2 );
+	int nGroup;
+	pWorker->nShadows = 0;
+	pWorker->nTracks = 0;
+	while ( pWorker->nTracks < RENDER_WORKER_TRACKS
+		&& ( nGroup = __render_next.fetchAndAddRelaxed( 1 ) ) < pWorker->nGroups ) {
+		// taken by the audio thread, or from a period the worker was given up on in
+		if ( !__render_owners[ nGroup ].testAndSetAcquire( nUnclaimed, nOwner ) ) continue;
+		int nTrack = pWorker->nTracks++;
+		pWorker->tracks[ nTrack ] = nGroup;
+		buffers.track_L = NULL;
+		buffers.track_R = NULL;
+		if ( pWorker->bTrackOuts ) {
+			memset( pWorker->track_L[ nTrack ], 0, pWorker->nFrames * sizeof( float ) );
+			memset( pWorker->track_R[ nTrack ], 0, pWorker->nFrames * sizeof( float ) );
+			buffers.track_L = pWorker->track_L[ nTrack ];
+			buffers.track_R = pWorker->track_R[ nTrack ];
+		}
+		for ( int i = __render_groups[ nGroup ]; i < __render_groups[ nGroup + 1 ]; ++i ) {
+			if ( pWorker->state.fetchAndAddRelaxed( 0 ) != RENDER_WORKING ) return;
+			unsigned k = pWorker->nShadows;
+			int nNote = __render_order[ i ];
+			Note* pShadow = pWorker->shadows[ k ];
+			*pShadow = *__playing_notes_queue[ nNote ];
+			pWorker->notes[ k ] = nNote;
+			pWorker->streams[ k ] = pShadow->get_stream();
+			pWorker->peak_L[ k ] = 0.0f;
+			pWorker->peak_R[ k ] = 0.0f;
+			buffers.peak_L = &pWorker->peak_L[ k ];
+			buffers.peak_R = &pWorker->peak_R[ k ];
+			pWorker->results[ k ] = __render_note( pShadow, pWorker->nFrames, pWorker->song, &buffers );
+			pWorker->nShadows = k + 1;
+		}
+	}
+}
+
+void Sampler::__drop_worker( RenderWorker* pWorker )
+{
+	// the streams opened for the copies would never be closed
+	for ( unsigned k = 0; k < pWorker->nShadows; ++k ) {
+		int nStream = pWorker->shadows[ k ]->get_stream();
+		if ( nStream != -1 && nStream != pWorker->streams[ k ] ) {
+			__disk_streamer->close( nStream );
+		}
+	}
+	pWorker->nShadows = 0;
+}
+
+void Sampler::__delete_worker( RenderWorker* pWorker )
+{
+	for ( unsigned k = 0; k < pWorker->shadows.size(); ++k ) {
+		delete pWorker->shadows[ k ];
+	}
+	delete pWorker;
 }
 
+void Sampler::set_render_threads( int nThreads )
+{
+	if ( nThreads < 0 ) nThreads = 0;
+	if ( nThreads > MAX_RENDER_THREADS ) nThreads = MAX_RENDER_THREADS;
+	if ( nThreads == ( int )__render_workers.size() ) return;
+
+	// stop the running threads
+	for ( unsigned w = 0; w < __render_workers.size(); ++w ) {
+		RenderWorker* pWorker = __render_workers[ w ];
+		pWorker->running = false;
+		sem_post( &pWorker->start );
+		pthread_join( pWorker->thread, NULL );
+		sem_destroy( &pWorker->start );
+		__delete_worker( pWorker );
+	}
+	__render_workers.clear();
 
+	// the workers would only take turns with the audio thread on a single cpu
+	long nCPUs = sysconf( _SC_NPROCESSORS_ONLN );
+	if ( nCPUs < 2 ) {
+		if ( nThreads > 0 ) INFOLOG( "Single cpu, the notes are rendered by the audio thread" );
+		nThreads = 0;
+	}
+	for ( int w = 0; w < nThreads; ++w ) {
+		RenderWorker* pWorker = new RenderWorker;
+		pWorker->sampler = this;
+		pWorker->index = w;
+		pWorker->running = true;
+		pWorker->realtime = false;
+		pWorker->state = RENDER_IDLE;
+		pWorker->nFrames = 0;
+		pWorker->song = NULL;
+		pWorker->nPeriod = 0;
+		pWorker->nGroups = 0;
+		pWorker->bTrackOuts = false;
+		pWorker->nShadows = 0;
+		pWorker->nTracks = 0;
+		pWorker->buffers.main_L = pWorker->main_L;
+		pWorker->buffers.main_R = pWorker->main_R;
+		// a copy for each note the sampler may play, never allocated while rendering
+		for ( unsigned k = 0; k < __render_capacity; ++k ) {
+			pWorker->shadows.push_back( new Note( NULL, 0, 0.0f, 0.5f, 0.5f, -1, 0.0f ) );
+		}
+		pWorker->notes.resize( __render_capacity );
+		pWorker->results.resize( __render_capacity );
+		pWorker->streams.resize( __render_capacity );
+		pWorker->peak_L.resize( __render_capacity );
+		pWorker->peak_R.resize( __render_capacity );
+		sem_init( &pWorker->start, 0, 0 );
+		if ( pthread_create( &pWorker->thread, NULL, samplerWorker_processCaller, pWorker ) ) {
+			ERRORLOG( "Can't create render thread" );
+			sem_destroy( &pWorker->start );
+			__delete_worker( pWorker );
+			break;
+		}
+		__render_workers.push_back( pWorker );
+	}
+	INFOLOG( QString( "%1 render threads" ).arg( __render_workers.size() ) );
+}
 
 void Sampler::note_on( Note *note )
 {
@@ -177,13 +651,15 @@ void Sampler::note_on( Note *note )
 	pInstr->enqueue();
 	if( !note->get_note_off() ){
 		__playing_notes_queue.push_back( note );
-	} else {
-		delete note;
 	}
 	
         if( Hydrogen::get_instance()->getMidiOutput() != NULL ){
 		Hydrogen::get_instance()->getMidiOutput()->handleQueueNote( note );
 	}
+
+	if( note->get_note_off() ){
+		AudioEngine::get_instance()->get_note_pool()->release( note );
+	}
 	
 }
 
@@ -218,10 +694,52 @@ void Sampler::note_off( Note* note )
 }
 
 
+InstrumentLayer* Sampler::__get_layer( Note* pNote )
+{
+	Instrument *pInstr = pNote->get_instrument();
+	if ( !pInstr ) return NULL;
+	for ( unsigned nLayer = 0; nLayer < MAX_LAYERS; ++nLayer ) {
+		InstrumentLayer *pLayer = pInstr->get_layer( nLayer );
+		if ( pLayer == NULL ) continue;
+
+		if ( ( pNote->get_velocity() >= pLayer->get_start_velocity() ) && ( pNote->get_velocity() <= pLayer->get_end_velocity() ) ) {
+			return pLayer;
+		}
+	}
+	return NULL;
+}
+
+Sample* Sampler::__get_render_sample( InstrumentLayer* pLayer )
+{
+	Sample *pResampled = pLayer->get_resampled();
+	AudioOutput* audio_output = Hydrogen::get_instance()->getAudioOutput();
+	if ( pResampled && audio_output && pResampled->get_sample_rate() == ( int )audio_output->getSampleRate() ) {
+		return pResampled;
+	}
+	return pLayer->get_sample();
+}
+
+Sample* Sampler::set_resampled( InstrumentLayer* pLayer, Sample* pResampled )
+{
+	Sample *pFrom = __get_render_sample( pLayer );
+	Sample *pOld = pLayer->set_resampled( pResampled );
+	Sample *pTo = __get_render_sample( pLayer );
+	if ( pFrom && pTo && pFrom != pTo && pFrom->get_sample_rate() > 0 ) {
+		// the positions of the notes are counted in frames of the sample they play
+		double fRatio = ( double )pTo->get_sample_rate() / pFrom->get_sample_rate();
+		for ( unsigned i = 0; i < __playing_notes_queue.size(); ++i ) {
+			Note *pNote = __playing_notes_queue[ i ];
+			if ( __get_layer( pNote ) != pLayer ) continue;
+			pNote->update_sample_position( pNote->get_sample_position() * ( fRatio - 1.0 ) );
+		}
+	}
+	return pOld;
+}
+
 /// Render a note
 /// Return 0: the note is not ended
 /// Return 1: the note is ended
-unsigned Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong )
+unsigned Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong, RenderBuffers* pBuffers )
 {
 	//infoLog( "[renderNote] instr: " + pNote->getInstrument()->m_sName );
 	assert( pSong );
@@ -247,16 +765,11 @@ unsigned Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong
 
 	// scelgo il sample da usare in base alla velocity
 	Sample *pSample = NULL;
-	for ( unsigned nLayer = 0; nLayer < MAX_LAYERS; ++nLayer ) {
-		InstrumentLayer *pLayer = pInstr->get_layer( nLayer );
-		if ( pLayer == NULL ) continue;
-
-		if ( ( pNote->get_velocity() >= pLayer->get_start_velocity() ) && ( pNote->get_velocity() <= pLayer->get_end_velocity() ) ) {
-			pSample = pLayer->get_sample();
-			fLayerGain = pLayer->get_gain();
-			fLayerPitch = pLayer->get_pitch();
-			break;
-		}
+	InstrumentLayer *pLayer = __get_layer( pNote );
+	if ( pLayer ) {
+		pSample = __get_render_sample( pLayer );
+		fLayerGain = pLayer->get_gain();
+		fLayerPitch = pLayer->get_pitch();
 	}
 	if ( !pSample ) {
 		QString dummy = QString( "NULL sample for instrument %1. Note velocity: %2" ).arg( pInstr->get_name() ).arg( pNote->get_velocity() );
@@ -264,7 +777,28 @@ unsigned Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong
 		return 1;
 	}
 
-	if ( pNote->get_sample_position() >= pSample->get_frames() ) {
+	// the layer got another sample while the note was playing, the previous
+	// one, which the stream reads the head of, might be deleted already
+	if ( pNote->get_stream() != -1 && !__disk_streamer->is_open_on( pNote->get_stream(), pSample ) ) {
+		__disk_streamer->close( pNote->get_stream() );
+		pNote->set_stream( -1 );
+	}
+
+	// the frames of a streamed sample past its head are read from the disk
+	int nSampleFrames = pSample->get_frames();
+	if ( pSample->is_streamed() ) {
+		if ( pNote->get_stream() == -1 ) {
+			pNote->set_stream( __disk_streamer->open( pSample ) );
+			if ( pNote->get_stream() == -1 ) {
+				WARNINGLOG( QString( "every stream is in use, only the head of %1 is played" ).arg( pSample->get_filename() ) );
+			}
+		}
+		if ( pNote->get_stream() != -1 ) {
+			nSampleFrames = pSample->get_total_frames();
+		}
+	}
+
+	if ( pNote->get_sample_position() >= nSampleFrames ) {
 		WARNINGLOG( "sample position out of bounds. The layer has been resized during note play?" );
 		return 1;
 	}
@@ -294,6 +828,23 @@ unsigned Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong
 	float cost_track_L = 1.0f;
         float cost_track_R = 1.0f;
 
+	// while the instrument volume, gain or pan move, they are applied frame
+	// by frame by the render functions instead of being part of the costs
+	bool bSmoothing = !( pInstr->get_parameter( Instrument::VOLUME )->is_settled()
+			     && pInstr->get_parameter( Instrument::GAIN )->is_settled()
+			     && pInstr->get_parameter( Instrument::PAN_L )->is_settled()
+			     && pInstr->get_parameter( Instrument::PAN_R )->is_settled() );
+	float fInstrPan_L = 1.0f;
+	float fInstrPan_R = 1.0f;
+	float fInstrGain = 1.0f;
+	float fInstrVolume = 1.0f;
+	if ( !bSmoothing ) {
+		fInstrPan_L = pInstr->get_parameter( Instrument::PAN_L )->get_value();
+		fInstrPan_R = pInstr->get_parameter( Instrument::PAN_R )->get_value();
+		fInstrGain = pInstr->get_parameter( Instrument::GAIN )->get_value();
+		fInstrVolume = pInstr->get_parameter( Instrument::VOLUME )->get_value();
+	}
+
 	if ( pInstr->is_muted() || pSong->__is_muted ) {	// is instrument muted?
 		cost_L = 0.0;
 		cost_R = 0.0;
@@ -307,10 +858,10 @@ unsigned Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong
 		cost_L = cost_L * pNote->get_velocity();		// note velocity
 		cost_L = cost_L * pNote->get_pan_l();		// note pan
 		cost_L = cost_L * fLayerGain;				// layer gain
-		cost_L = cost_L * pInstr->get_pan_l();		// instrument pan
-                cost_L = cost_L * pInstr->get_gain();		// instrument gain
+		cost_L = cost_L * fInstrPan_L;			// instrument pan
+                cost_L = cost_L * fInstrGain;			// instrument gain
 
-		cost_L = cost_L * pInstr->get_volume();		// instrument volume
+		cost_L = cost_L * fInstrVolume;			// instrument volume
                 if ( Preferences::get_instance()->m_nJackTrackOutputMode == 0 ) {
 		// Post-Fader
 			cost_track_L = cost_L * 2;
@@ -322,10 +873,10 @@ unsigned Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong
 		cost_R = cost_R * pNote->get_velocity();		// note velocity
 		cost_R = cost_R * pNote->get_pan_r();		// note pan
 		cost_R = cost_R * fLayerGain;				// layer gain
-		cost_R = cost_R * pInstr->get_pan_r();		// instrument pan
-                cost_R = cost_R * pInstr->get_gain();		// instrument gain
+		cost_R = cost_R * fInstrPan_R;			// instrument pan
+                cost_R = cost_R * fInstrGain;			// instrument gain
 
-		cost_R = cost_R * pInstr->get_volume();		// instrument volume
+		cost_R = cost_R * fInstrVolume;			// instrument volume
                 if ( Preferences::get_instance()->m_nJackTrackOutputMode == 0 ) {
 		// Post-Fader
 			cost_track_R = cost_R * 2;
@@ -351,9 +902,9 @@ unsigned Sampler::__render_note( Note* pNote, unsigned nBufferSize, Song* pSong
 	//_INFOLOG( "total pitch: " + to_string( fTotalPitch ) );
 
 	if ( fTotalPitch == 0.0 && pSample->get_sample_rate() == audio_output->getSampleRate() ) {	// NO RESAMPLE
-                return __render_note_no_resample( pSample, pNote, nBufferSize, nInitialSilence, cost_L, cost_R, cost_track_L, cost_track_R, pSong );
+                return __render_note_no_resample( pSample, pNote, nBufferSize, nInitialSilence, cost_L, cost_R, cost_track_L, cost_track_R, bSmoothing, nSampleFrames, pSong, pBuffers );
 	} else {	// RESAMPLE
-                return __render_note_resample( pSample, pNote, nBufferSize, nInitialSilence, cost_L, cost_R, cost_track_L, cost_track_R, fLayerPitch, pSong );
+                return __render_note_resample( pSample, pNote, nBufferSize, nInitialSilence, cost_L, cost_R, cost_track_L, cost_track_R, bSmoothing, fLayerPitch, nSampleFrames, pSong, pBuffers );
 	}
 }
 
@@ -366,7 +917,10 @@ int Sampler::__render_note_no_resample(
     float cost_R,
     float cost_track_L,
     float cost_track_R,
-    Song* pSong
+    bool bSmoothing,
+    int nSampleFrames,
+    Song* pSong,
+    RenderBuffers* pBuffers
 )
 {
 	AudioOutput* audio_output = Hydrogen::get_instance()->getAudioOutput();
@@ -377,7 +931,7 @@ int Sampler::__render_note_no_resample(
 		nNoteLength = ( int )( pNote->get_length() * audio_output->m_transport.m_nTickSize );
 	}
 
-	int nAvail_bytes = pSample->get_frames() - ( int )pNote->get_sample_position();	// verifico il numero di frame disponibili ancora da eseguire
+	int nAvail_bytes = nSampleFrames - ( int )pNote->get_sample_position();	// verifico il numero di frame disponibili ancora da eseguire
 
 	if ( nAvail_bytes > nBufferSize - nInitialSilence ) {	// il sample e' piu' grande del buffersize
 		// imposto il numero dei bytes disponibili uguale al buffersize
@@ -389,20 +943,19 @@ int Sampler::__render_note_no_resample(
 	//ADSR *pADSR = pNote->m_pADSR;
 
 	int nInitialBufferPos = nInitialSilence;
-	int nInitialSamplePos = ( int )pNote->get_sample_position();
-	int nSamplePos = nInitialSamplePos;
+	int nSamplePos = ( int )pNote->get_sample_position();
+	int nStream = pNote->get_stream();
 	int nTimes = nInitialBufferPos + nAvail_bytes;
 	int nInstrument = pSong->get_instrument_list()->index( pNote->get_instrument() );
 
+	// 0 if the sample data is packed
 	float *pSample_data_L = pSample->get_data_l();
 	float *pSample_data_R = pSample->get_data_r();
+	bool bMono = pSample->is_mono();
 
-	float fInstrPeak_L = pNote->get_instrument()->get_peak_l(); // this value will be reset to 0 by the mixer..
-	float fInstrPeak_R = pNote->get_instrument()->get_peak_r(); // this value will be reset to 0 by the mixer..
-
-	float fADSRValue;
-	float fVal_L;
-	float fVal_R;
+	// this value will be reset to 0 by the mixer.., a render worker keeps its own
+	float fInstrPeak_L = ( pBuffers->peak_L ? *pBuffers->peak_L : pNote->get_instrument()->get_peak_l() );
+	float fInstrPeak_R = ( pBuffers->peak_R ? *pBuffers->peak_R : pNote->get_instrument()->get_peak_r() );
 
 	/*
 	 * nInstrument could be -1 if the instrument is not found in the current drumset.
@@ -413,95 +966,123 @@ int Sampler::__render_note_no_resample(
 		nInstrument = 0;
 	}
 
-#ifdef H2CORE_HAVE_JACK 
-	JackOutput* jao = 0; 
-	float *track_out_L = 0; 
-	float *track_out_R = 0; 
-	if( audio_output->has_track_outs() 
-	&& (jao = dynamic_cast<JackOutput*>(audio_output)) ) { 
-		track_out_L = jao->getTrackOut_L( nInstrument ); 
-		track_out_R = jao->getTrackOut_R( nInstrument ); 
-	} 
-#endif 
+	float *track_out_L = pBuffers->track_L;
+	float *track_out_R = pBuffers->track_R;
+	if( !track_out_L && audio_output->has_track_outs() ) {
+		track_out_L = audio_output->getTrackOut_L( nInstrument );
+		track_out_R = audio_output->getTrackOut_R( nInstrument );
+	}
 	
-	for ( int nBufferPos = nInitialBufferPos; nBufferPos < nTimes; ++nBufferPos ) {
-		if ( ( nNoteLength != -1 ) && ( nNoteLength <= pNote->get_sample_position() )  ) {
-                        if ( pNote->get_adsr()->release() == 0 ) {
-				retValue = 1;	// the note is ended
-			}
+#ifdef H2CORE_HAVE_LADSPA
+	// LADSPA sends are fed with the sample data, before ADSR and filter
+	float masterVol = pSong->get_volume();
+	LadspaFX* pFX[ MAX_FX ];
+	float fFXCost[ MAX_FX ];
+	for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
+		pFX[ nFX ] = Effects::get_instance()->getPlayingLadspaFX( nFX );
+		float fLevel = pNote->get_instrument()->get_fx_level( nFX );
+		if ( ( pFX[ nFX ] ) && ( fLevel != 0.0 ) ) {
+			fFXCost[ nFX ] = fLevel * pFX[ nFX ]->getVolume() * masterVol;
+		} else {
+			pFX[ nFX ] = NULL;
 		}
-
-                fADSRValue = pNote->get_adsr()->get_value( 1 );
-                fVal_L = pSample_data_L[ nSamplePos ] * fADSRValue;
-                fVal_R = pSample_data_R[ nSamplePos ] * fADSRValue;
-
-                // Low pass resonant filter
-		if ( pNote->get_instrument()->is_filter_active() ) {
-                     pNote->compute_lr_values( &fVal_L, &fVal_R );
-                }
-
-#ifdef H2CORE_HAVE_JACK
-	if( track_out_L ) { 
-		track_out_L[nBufferPos] += fVal_L * cost_track_L; 
-	} 
-	if( track_out_R ) { 
-		track_out_R[nBufferPos] += fVal_R * cost_track_R; 
 	}
 #endif
 
-                fVal_L = fVal_L * cost_L;
-		fVal_R = fVal_R * cost_R;
+	bool bRelease = ( nNoteLength != -1 ) && ( nNoteLength <= pNote->get_sample_position() );
+	bool bFilterActive = pNote->get_instrument()->is_filter_active();
+	bool bPostFader = ( Preferences::get_instance()->m_nJackTrackOutputMode == 0 );
+	ADSR* pADSR = pNote->get_adsr();
+
+	// the note is rendered in blocks: envelope first, then vectorized mixing of the whole block
+	float pRaw_L[ SAMPLER_BLOCK_SIZE ];
+	float pRaw_R[ SAMPLER_BLOCK_SIZE ];
+	float pADSRValues[ SAMPLER_BLOCK_SIZE ];
+	float pVal_L[ SAMPLER_BLOCK_SIZE ];
+	float pVal_R[ SAMPLER_BLOCK_SIZE ];
+	float pGain_L[ SAMPLER_BLOCK_SIZE ];
+	float pGain_R[ SAMPLER_BLOCK_SIZE ];
+
+	int nBufferPos = nInitialBufferPos;
+	while ( nBufferPos < nTimes ) {
+		int nBlock = nTimes - nBufferPos;
+		if ( nBlock > SAMPLER_BLOCK_SIZE ) {
+			nBlock = SAMPLER_BLOCK_SIZE;
+		}
 
-		// update instr peak
-		if ( fVal_L > fInstrPeak_L ) {
-			fInstrPeak_L = fVal_L;
+		// ADSR envelope
+		for ( int i = 0; i < nBlock; ++i ) {
+			if ( bRelease ) {
+				if ( pADSR->release() == 0 ) {
+					retValue = 1;	// the note is ended
+				}
+			}
+			pADSRValues[ i ] = pADSR->get_value( 1 );
 		}
-		if ( fVal_R > fInstrPeak_R ) {
-			fInstrPeak_R = fVal_R;
+		const float *pData_L;
+		const float *pData_R;
+		if ( nStream != -1 ) {
+			__disk_streamer->fetch( nStream, nSamplePos, nBlock, &pData_L, &pData_R );
+		} else if ( pSample_data_L ) {
+			pData_L = pSample_data_L + nSamplePos;
+			pData_R = pSample_data_R + nSamplePos;
+		} else {
+			// packed data, converted to floats block by block
+			pSample->read( nSamplePos, nBlock, pRaw_L, bMono ? 0 : pRaw_R );
+			pData_L = pRaw_L;
+			pData_R = ( bMono ? pRaw_L : pRaw_R );
 		}
+		SamplerKernels::mul( pVal_L, pData_L, pADSRValues, nBlock );
+		SamplerKernels::mul( pVal_R, pData_R, pADSRValues, nBlock );
 
-		// to main mix
-		__main_out_L[nBufferPos] += fVal_L;
-		__main_out_R[nBufferPos] += fVal_R;
-
-		++nSamplePos;
-	}
-	pNote->update_sample_position( nAvail_bytes );
-	pNote->get_instrument()->set_peak_l( fInstrPeak_L );
-	pNote->get_instrument()->set_peak_r( fInstrPeak_R );
+		// Low pass resonant filter, the envelope values are not needed anymore
+		if ( bFilterActive ) {
+			__filter_block( pNote, pVal_L, pVal_R, pADSRValues, pGain_L, nBufferPos, nBlock );
+		}
 
+		// the moving instrument gains, past the direct track outs
+		const float *pMix_L = pVal_L;
+		const float *pMix_R = pVal_R;
+		if ( bSmoothing ) {
+			__instrument_gains( pNote->get_instrument(), pGain_L, pGain_R, pADSRValues, nBufferPos, nBlock );
+			SamplerKernels::mul( pGain_L, pVal_L, pGain_L, nBlock );
+			SamplerKernels::mul( pGain_R, pVal_R, pGain_R, nBlock );
+			pMix_L = pGain_L;
+			pMix_R = pGain_R;
+		}
 
-#ifdef H2CORE_HAVE_LADSPA
-        float masterVol =  pSong->get_volume();
-	// LADSPA
-	for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
-		LadspaFX *pFX = Effects::get_instance()->getLadspaFX( nFX );
+		if( track_out_L ) {
+			SamplerKernels::mac( track_out_L + nBufferPos, bPostFader ? pMix_L : pVal_L, cost_track_L, nBlock );
+		}
+		if( track_out_R ) {
+			SamplerKernels::mac( track_out_R + nBufferPos, bPostFader ? pMix_R : pVal_R, cost_track_R, nBlock );
+		}
 
-		float fLevel = pNote->get_instrument()->get_fx_level( nFX );
+		// to main mix, updating the instr peak
+		fInstrPeak_L = SamplerKernels::mac_peak( pBuffers->main_L + nBufferPos, pMix_L, cost_L, fInstrPeak_L, nBlock );
+		fInstrPeak_R = SamplerKernels::mac_peak( pBuffers->main_R + nBufferPos, pMix_R, cost_R, fInstrPeak_R, nBlock );
 
-		if ( ( pFX ) && ( fLevel != 0.0 ) ) {
-			fLevel = fLevel * pFX->getVolume();
-			float *pBuf_L = pFX->m_pBuffer_L;
-			float *pBuf_R = pFX->m_pBuffer_R;
-
-//			float fFXCost_L = cost_L * fLevel;
-//			float fFXCost_R = cost_R * fLevel;
-                        float fFXCost_L = fLevel * masterVol;
-                        float fFXCost_R = fLevel * masterVol;
-
-			int nBufferPos = nInitialBufferPos;
-			int nSamplePos = nInitialSamplePos;
-			for ( int i = 0; i < nAvail_bytes; ++i ) {
-                                pBuf_L[ nBufferPos ] += pSample_data_L[ nSamplePos ] * fFXCost_L;
-                                pBuf_R[ nBufferPos ] += pSample_data_R[ nSamplePos ] * fFXCost_R;
-				++nSamplePos;
-				++nBufferPos;
+#ifdef H2CORE_HAVE_LADSPA
+		for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
+			if ( pFX[ nFX ] ) {
+				SamplerKernels::mac( pBuffers->fx_L[ nFX ] + nBufferPos, pData_L, fFXCost[ nFX ], nBlock );
+				SamplerKernels::mac( pBuffers->fx_R[ nFX ] + nBufferPos, pData_R, fFXCost[ nFX ], nBlock );
 			}
 		}
-	}
-	// ~LADSPA
 #endif
 
+		nBufferPos += nBlock;
+		nSamplePos += nBlock;
+	}
+	pNote->update_sample_position( nAvail_bytes );
+	if ( pBuffers->peak_L ) {
+		*pBuffers->peak_L = fInstrPeak_L;
+		*pBuffers->peak_R = fInstrPeak_R;
+	} else {
+		pNote->get_instrument()->set_peak_l( fInstrPeak_L );
+		pNote->get_instrument()->set_peak_r( fInstrPeak_R );
+	}
+
 	return retValue;
 }
 
@@ -516,8 +1097,11 @@ int Sampler::__render_note_resample(
     float cost_R,
     float cost_track_L,
     float cost_track_R,
+    bool bSmoothing,
     float fLayerPitch,
-    Song* pSong
+    int nSampleFrames,
+    Song* pSong,
+    RenderBuffers* pBuffers
 )
 {
 	AudioOutput* audio_output = Hydrogen::get_instance()->getAudioOutput();
@@ -531,7 +1115,7 @@ int Sampler::__render_note_resample(
 //	_ERRORLOG( QString("pitch: %1, step: %2" ).arg(fNotePitch).arg( fStep) );
 	fStep *= ( float )pSample->get_sample_rate() / audio_output->getSampleRate(); // Adjust for audio driver sample rate
 
-	int nAvail_bytes = ( int )( ( float )( pSample->get_frames() - pNote->get_sample_position() ) / fStep );	// verifico il numero di frame disponibili ancora da eseguire
+	int nAvail_bytes = ( int )( ( nSampleFrames - pNote->get_sample_position() ) / fStep );	// verifico il numero di frame disponibili ancora da eseguire
 
 	int retValue = 1; // the note is ended
 	if ( nAvail_bytes > nBufferSize - nInitialSilence ) {	// il sample e' piu' grande del buffersize
@@ -540,24 +1124,14 @@ int Sampler::__render_note_resample(
 		retValue = 0; // the note is not ended yet
 	}
 
-//	ADSR *pADSR = pNote->m_pADSR;
-
 	int nInitialBufferPos = nInitialSilence;
-	float fInitialSamplePos = pNote->get_sample_position();
 	double fSamplePos = pNote->get_sample_position();
 	int nTimes = nInitialBufferPos + nAvail_bytes;
 	int nInstrument = pSong->get_instrument_list()->index( pNote->get_instrument() );
 
-	float *pSample_data_L = pSample->get_data_l();
-	float *pSample_data_R = pSample->get_data_r();
-
-	float fInstrPeak_L = pNote->get_instrument()->get_peak_l(); // this value will be reset to 0 by the mixer..
-	float fInstrPeak_R = pNote->get_instrument()->get_peak_r(); // this value will be reset to 0 by the mixer..
-
-        float fADSRValue = 1.0;
-	float fVal_L;
-	float fVal_R;
-	int nSampleFrames = pSample->get_frames();
+	// this value will be reset to 0 by the mixer.., a render worker keeps its own
+	float fInstrPeak_L = ( pBuffers->peak_L ? *pBuffers->peak_L : pNote->get_instrument()->get_peak_l() );
+	float fInstrPeak_R = ( pBuffers->peak_R ? *pBuffers->peak_R : pNote->get_instrument()->get_peak_r() );
 
 	/*
 	 * nInstrument could be -1 if the instrument is not found in the current drumset.
@@ -568,196 +1142,202 @@ int Sampler::__render_note_resample(
 		nInstrument = 0;
 	}
 
-#ifdef H2CORE_HAVE_JACK 
-	JackOutput* jao = 0; 
-	float *track_out_L = 0; 
-	float *track_out_R = 0; 
-	if( audio_output->has_track_outs() 
-	&& (jao = dynamic_cast<JackOutput*>(audio_output)) ) { 
-		track_out_L = jao->getTrackOut_L( nInstrument ); 
-		track_out_R = jao->getTrackOut_R( nInstrument ); 
-	} 
+	float *track_out_L = pBuffers->track_L;
+	float *track_out_R = pBuffers->track_R;
+	if( !track_out_L && audio_output->has_track_outs() ) {
+		track_out_L = audio_output->getTrackOut_L( nInstrument );
+		track_out_R = audio_output->getTrackOut_R( nInstrument );
+	}
+
+#ifdef H2CORE_HAVE_LADSPA
+	// LADSPA sends are fed with the interpolated block, before ADSR and filter
+	float masterVol = pSong->get_volume();
+	LadspaFX* pFX[ MAX_FX ];
+	float fFXCost[ MAX_FX ];
+	for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
+		pFX[ nFX ] = Effects::get_instance()->getPlayingLadspaFX( nFX );
+		float fLevel = pNote->get_instrument()->get_fx_level( nFX );
+		if ( ( pFX[ nFX ] ) && ( fLevel != 0.0 ) ) {
+			fFXCost[ nFX ] = fLevel * pFX[ nFX ]->getVolume() * masterVol;
+		} else {
+			pFX[ nFX ] = NULL;
+		}
+	}
 #endif
 
-	for ( int nBufferPos = nInitialBufferPos; nBufferPos < nTimes; ++nBufferPos ) {
-		if ( ( nNoteLength != -1 ) && ( nNoteLength <= pNote->get_sample_position() )  ) {
-                        if ( pNote->get_adsr()->release() == 0 ) {
-				retValue = 1;	// the note is ended
-			}
+	bool bRelease = ( nNoteLength != -1 ) && ( nNoteLength <= pNote->get_sample_position() );
+	bool bFilterActive = pNote->get_instrument()->is_filter_active();
+	bool bPostFader = ( Preferences::get_instance()->m_nJackTrackOutputMode == 0 );
+	ADSR* pADSR = pNote->get_adsr();
+
+	// the block is interpolated once, then shared by the main mix, the track outs and the sends
+	float pRaw_L[ SAMPLER_BLOCK_SIZE ];
+	float pRaw_R[ SAMPLER_BLOCK_SIZE ];
+	float pADSRValues[ SAMPLER_BLOCK_SIZE ];
+	float pVal_L[ SAMPLER_BLOCK_SIZE ];
+	float pVal_R[ SAMPLER_BLOCK_SIZE ];
+	float pGain_L[ SAMPLER_BLOCK_SIZE ];
+	float pGain_R[ SAMPLER_BLOCK_SIZE ];
+
+	int nBufferPos = nInitialBufferPos;
+	while ( nBufferPos < nTimes ) {
+		int nBlock = nTimes - nBufferPos;
+		if ( nBlock > SAMPLER_BLOCK_SIZE ) {
+			nBlock = SAMPLER_BLOCK_SIZE;
 		}
 
-                int nSamplePos = ( int )fSamplePos;
-                double fDiff = fSamplePos - nSamplePos;
-                if ( ( nSamplePos + 1 ) >= nSampleFrames ) {
-                        //we reach the last audioframe.
-			//set this last frame to zero do nothin wrong.
-                        fVal_L = 0.0;
-                        fVal_R = 0.0;
-                } else {
-                       // some interpolation methods need 4 frames data.
-                       float last_l;
-                       float last_r;
-                       if ( ( nSamplePos + 2 ) >= nSampleFrames ) {
-                              last_l = 0.0;
-                              last_r = 0.0;
-                       }else
-                       {
-                             last_l =  pSample_data_L[nSamplePos + 2];
-                             last_r =  pSample_data_R[nSamplePos + 2];
-                       }
-
-                        switch( __interpolateMode ){
-                                
-                        case LINEAR:
-                                fVal_L = pSample_data_L[nSamplePos] * (1 - fDiff ) + pSample_data_L[nSamplePos + 1] * fDiff;
-                                fVal_R = pSample_data_R[nSamplePos] * (1 - fDiff ) + pSample_data_R[nSamplePos + 1] * fDiff;
-                                //fVal_L = linear_Interpolate( pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], fDiff);
-                                //fVal_R = linear_Interpolate( pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], fDiff);
-                                break;
-                        case COSINE:
-                                fVal_L = cosine_Interpolate( pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], fDiff);
-                                fVal_R = cosine_Interpolate( pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], fDiff);
-                                break;
-                        case THIRD:
-                                fVal_L = third_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-                                fVal_R = third_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-                                break;
-                        case CUBIC:
-                                fVal_L = cubic_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-                                fVal_R = cubic_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-                                break;
-                        case HERMITE:
-                                fVal_L = hermite_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-                                fVal_R = hermite_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-                                break;
-                        }
-                }
+		__resample_block( pRaw_L, pRaw_R, pSample, pNote->get_stream(), nSampleFrames, fSamplePos, fStep, nBlock );
 
 		// ADSR envelope
-                fADSRValue = pNote->get_adsr()->get_value( fStep );
-                fVal_L = fVal_L * fADSRValue;
-                fVal_R = fVal_R * fADSRValue;
-		// Low pass resonant filter
-		if ( pNote->get_instrument()->is_filter_active() ) {
-                     pNote->compute_lr_values( &fVal_L, &fVal_R );
-                }
-
-
+		for ( int i = 0; i < nBlock; ++i ) {
+			if ( bRelease ) {
+				if ( pADSR->release() == 0 ) {
+					retValue = 1;	// the note is ended
+				}
+			}
+			pADSRValues[ i ] = pADSR->get_value( fStep );
+		}
+		SamplerKernels::mul( pVal_L, pRaw_L, pADSRValues, nBlock );
+		SamplerKernels::mul( pVal_R, pRaw_R, pADSRValues, nBlock );
 
-#ifdef H2CORE_HAVE_JACK
-	if( track_out_L ) { 
-		track_out_L[nBufferPos] += fVal_L * cost_track_L; 
-	} 
-	if( track_out_R ) { 
-		track_out_R[nBufferPos] += fVal_R * cost_track_R; 
-	}
-#endif
+		// Low pass resonant filter, the envelope values are not needed anymore
+		if ( bFilterActive ) {
+			__filter_block( pNote, pVal_L, pVal_R, pADSRValues, pGain_L, nBufferPos, nBlock );
+		}
 
-		fVal_L = fVal_L * cost_L;
-		fVal_R = fVal_R * cost_R;
+		// the moving instrument gains, past the direct track outs
+		const float *pMix_L = pVal_L;
+		const float *pMix_R = pVal_R;
+		if ( bSmoothing ) {
+			__instrument_gains( pNote->get_instrument(), pGain_L, pGain_R, pADSRValues, nBufferPos, nBlock );
+			SamplerKernels::mul( pGain_L, pVal_L, pGain_L, nBlock );
+			SamplerKernels::mul( pGain_R, pVal_R, pGain_R, nBlock );
+			pMix_L = pGain_L;
+			pMix_R = pGain_R;
+		}
 
-		// update instr peak
-		if ( fVal_L > fInstrPeak_L ) {
-			fInstrPeak_L = fVal_L;
+		if( track_out_L ) {
+			SamplerKernels::mac( track_out_L + nBufferPos, bPostFader ? pMix_L : pVal_L, cost_track_L, nBlock );
 		}
-		if ( fVal_R > fInstrPeak_R ) {
-			fInstrPeak_R = fVal_R;
+		if( track_out_R ) {
+			SamplerKernels::mac( track_out_R + nBufferPos, bPostFader ? pMix_R : pVal_R, cost_track_R, nBlock );
 		}
 
-		// to main mix
-		__main_out_L[nBufferPos] += fVal_L;
-		__main_out_R[nBufferPos] += fVal_R;
+		// to main mix, updating the instr peak
+		fInstrPeak_L = SamplerKernels::mac_peak( pBuffers->main_L + nBufferPos, pMix_L, cost_L, fInstrPeak_L, nBlock );
+		fInstrPeak_R = SamplerKernels::mac_peak( pBuffers->main_R + nBufferPos, pMix_R, cost_R, fInstrPeak_R, nBlock );
 
-		fSamplePos += fStep;
+#ifdef H2CORE_HAVE_LADSPA
+		for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
+			if ( pFX[ nFX ] ) {
+				SamplerKernels::mac( pBuffers->fx_L[ nFX ] + nBufferPos, pRaw_L, fFXCost[ nFX ], nBlock );
+				SamplerKernels::mac( pBuffers->fx_R[ nFX ] + nBufferPos, pRaw_R, fFXCost[ nFX ], nBlock );
+			}
+		}
+#endif
+
+		nBufferPos += nBlock;
 	}
 	pNote->update_sample_position( nAvail_bytes * fStep );
-	pNote->get_instrument()->set_peak_l( fInstrPeak_L );
-	pNote->get_instrument()->set_peak_r( fInstrPeak_R );
+	if ( pBuffers->peak_L ) {
+		*pBuffers->peak_L = fInstrPeak_L;
+		*pBuffers->peak_R = fInstrPeak_R;
+	} else {
+		pNote->get_instrument()->set_peak_l( fInstrPeak_L );
+		pNote->get_instrument()->set_peak_r( fInstrPeak_R );
+	}
 
+	return retValue;
+}
 
+void Sampler::__instrument_gains( Instrument* pInstr, float* pGain_L, float* pGain_R, float* pTemp, int nOffset, int nFrames )
+{
+	pInstr->get_parameter( Instrument::VOLUME )->get_values( pGain_L, nOffset, nFrames );
+	pInstr->get_parameter( Instrument::GAIN )->get_values( pTemp, nOffset, nFrames );
+	SamplerKernels::mul( pGain_L, pGain_L, pTemp, nFrames );
+	memcpy( pGain_R, pGain_L, nFrames * sizeof( float ) );
+	pInstr->get_parameter( Instrument::PAN_L )->get_values( pTemp, nOffset, nFrames );
+	SamplerKernels::mul( pGain_L, pGain_L, pTemp, nFrames );
+	pInstr->get_parameter( Instrument::PAN_R )->get_values( pTemp, nOffset, nFrames );
+	SamplerKernels::mul( pGain_R, pGain_R, pTemp, nFrames );
+}
 
-#ifdef H2CORE_HAVE_LADSPA
-	// LADSPA
-        float masterVol = pSong->get_volume();
-	for ( unsigned nFX = 0; nFX < MAX_FX; ++nFX ) {
-		LadspaFX *pFX = Effects::get_instance()->getLadspaFX( nFX );
-		float fLevel = pNote->get_instrument()->get_fx_level( nFX );
-		if ( ( pFX ) && ( fLevel != 0.0 ) ) {
-			fLevel = fLevel * pFX->getVolume();
-
-			float *pBuf_L = pFX->m_pBuffer_L;
-			float *pBuf_R = pFX->m_pBuffer_R;
-
-//			float fFXCost_L = cost_L * fLevel;
-//			float fFXCost_R = cost_R * fLevel;
-                        float fFXCost_L = fLevel * masterVol;
-                        float fFXCost_R = fLevel * masterVol;
-
-			int nBufferPos = nInitialBufferPos;
-			float fSamplePos = fInitialSamplePos;
-			for ( int i = 0; i < nAvail_bytes; ++i ) {
-				int nSamplePos = ( int )fSamplePos;
-				double fDiff = fSamplePos - nSamplePos;
-
-                                if ( ( nSamplePos + 1 ) >= nSampleFrames ) {
-                                        //we reach the last audioframe.
-					//set this last frame to zero do nothin wrong.
-					fVal_L = 0.0;
-					fVal_R = 0.0;
-                                } else {
-                                       // some interpolation methods need 4 frames data.
-                                       float last_l;
-                                       float last_r;
-                                       if ( ( nSamplePos + 2 ) >= nSampleFrames ) {
-                                              last_l = 0.0;
-                                              last_r = 0.0;
-                                       }else
-                                       {
-                                             last_l =  pSample_data_L[nSamplePos + 2];
-                                             last_r =  pSample_data_R[nSamplePos + 2];
-                                       }
-
-                                        switch( __interpolateMode ){
-
-                                        case LINEAR:
-                                                fVal_L = pSample_data_L[nSamplePos] * (1 - fDiff ) + pSample_data_L[nSamplePos + 1] * fDiff;
-                                                fVal_R = pSample_data_R[nSamplePos] * (1 - fDiff ) + pSample_data_R[nSamplePos + 1] * fDiff;
-                                                //fVal_L = linear_Interpolate( pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], fDiff);
-                                                //fVal_R = linear_Interpolate( pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], fDiff);
-                                                break;
-                                        case COSINE:
-                                                fVal_L = cosine_Interpolate( pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], fDiff);
-                                                fVal_R = cosine_Interpolate( pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], fDiff);
-                                                break;
-                                        case THIRD:
-                                                fVal_L = third_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-                                                fVal_R = third_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-                                                break;
-                                        case CUBIC:
-                                                fVal_L = cubic_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-                                                fVal_R = cubic_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-                                                break;
-                                        case HERMITE:
-                                                fVal_L = hermite_Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], last_l, fDiff);
-                                                fVal_R = hermite_Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], last_r, fDiff);
-                                                break;
-                                        }
-                                        // methode Interpolate produce an extra function call and eat much more time here.
-                                        // so i deside to code the switch direct in the resampler methode
-                                        //fVal_L = Interpolate( pSample_data_L[ nSamplePos -1], pSample_data_L[nSamplePos], pSample_data_L[nSamplePos + 1], pSample_data_L[nSamplePos + 2] ,fDiff);
-                                        //fVal_L = Interpolate( pSample_data_R[ nSamplePos -1], pSample_data_R[nSamplePos], pSample_data_R[nSamplePos + 1], pSample_data_R[nSamplePos + 2] ,fDiff);
-				}
+void Sampler::__filter_block( Note* pNote, float* pVal_L, float* pVal_R, float* pTemp1, float* pTemp2, int nOffset, int nFrames )
+{
+	SmoothedValue *pCutoff = pNote->get_instrument()->get_parameter( Instrument::FILTER_CUTOFF );
+	SmoothedValue *pResonance = pNote->get_instrument()->get_parameter( Instrument::FILTER_RESONANCE );
+	if ( pCutoff->is_settled() && pResonance->is_settled() ) {
+		float fCutoff = pCutoff->get_value();
+		float fResonance = pResonance->get_value();
+		for ( int i = 0; i < nFrames; ++i ) {
+			pNote->compute_lr_values( &pVal_L[ i ], &pVal_R[ i ], fCutoff, fResonance );
+		}
+	} else {
+		pCutoff->get_values( pTemp1, nOffset, nFrames );
+		pResonance->get_values( pTemp2, nOffset, nFrames );
+		for ( int i = 0; i < nFrames; ++i ) {
+			pNote->compute_lr_values( &pVal_L[ i ], &pVal_R[ i ], pTemp1[ i ], pTemp2[ i ] );
+		}
+	}
+}
 
-                                pBuf_L[ nBufferPos ] += fVal_L * fFXCost_L;
-                                pBuf_R[ nBufferPos ] += fVal_R * fFXCost_R;
-				fSamplePos += fStep;
-				++nBufferPos;
-			}
+void Sampler::__resample_block( float* pOut_L, float* pOut_R, Sample* pSample, int nStream, int nSampleFrames, double& fSamplePos, float fStep, int nFrames )
+{
+	if ( nStream == -1 && pSample->get_format() != Sample::FLOAT ) {
+		// packed data, converted to floats window by window, each one holding the points read for a part of the block
+		float pWindow_L[ SAMPLER_WINDOW_SIZE ];
+		float pWindow_R[ SAMPLER_WINDOW_SIZE ];
+		bool bMono = pSample->is_mono();
+		int nPart = std::max( ( int )( ( SAMPLER_WINDOW_SIZE - 5 ) / fStep ), 1 );
+		while ( nFrames > 0 ) {
+			int n = std::min( nFrames, nPart );
+			long long nFirst = std::max( ( long long )fSamplePos - 1, 0LL );
+			long long nLast = std::min( ( long long )( fSamplePos + n * fStep ) + 3, ( long long )nSampleFrames );
+			int nCount = ( int )std::min( std::max( nLast - nFirst, 0LL ), ( long long )SAMPLER_WINDOW_SIZE );
+			pSample->read( ( int )nFirst, nCount, pWindow_L, bMono ? 0 : pWindow_R );
+			fSamplePos -= nFirst;
+			__resample( pOut_L, pOut_R, pWindow_L, bMono ? pWindow_L : pWindow_R, nCount, fSamplePos, fStep, n );
+			fSamplePos += nFirst;
+			pOut_L += n;
+			pOut_R += n;
+			nFrames -= n;
 		}
+		return;
 	}
-#endif
 
-	return retValue;
+	const float *pSample_data_L = pSample->get_data_l();
+	const float *pSample_data_R = pSample->get_data_r();
+	long long nFirst = 0;
+	if ( nStream != -1 ) {
+		// fetch from the frame before the first one to the second one after the last one, the points the interpolations read
+		nFirst = std::max( ( long long )fSamplePos - 1, 0LL );
+		long long nLast = std::min( ( long long )( fSamplePos + nFrames * fStep ) + 3, ( long long )nSampleFrames );
+		nSampleFrames = __disk_streamer->fetch( nStream, nFirst, ( int )std::max( nLast - nFirst, 0LL ), &pSample_data_L, &pSample_data_R );
+		fSamplePos -= nFirst;
+	}
+	__resample( pOut_L, pOut_R, pSample_data_L, pSample_data_R, nSampleFrames, fSamplePos, fStep, nFrames );
+	fSamplePos += nFirst;
+}
+
+void Sampler::__resample( float* pOut_L, float* pOut_R, const float* pData_L, const float* pData_R, int nDataFrames, double& fPos, float fStep, int nFrames )
+{
+	switch( __interpolateMode ) {
+	case LINEAR:
+		SamplerKernels::resample<SamplerKernels::Linear>( pOut_L, pOut_R, pData_L, pData_R, nDataFrames, fPos, fStep, nFrames );
+		break;
+	case COSINE:
+		SamplerKernels::resample<SamplerKernels::Cosine>( pOut_L, pOut_R, pData_L, pData_R, nDataFrames, fPos, fStep, nFrames );
+		break;
+	case THIRD:
+		SamplerKernels::resample<SamplerKernels::Third>( pOut_L, pOut_R, pData_L, pData_R, nDataFrames, fPos, fStep, nFrames );
+		break;
+	case CUBIC:
+		SamplerKernels::resample<SamplerKernels::Cubic>( pOut_L, pOut_R, pData_L, pData_R, nDataFrames, fPos, fStep, nFrames );
+		break;
+	case HERMITE:
+		SamplerKernels::resample<SamplerKernels::Hermite>( pOut_L, pOut_R, pData_L, pData_R, nDataFrames, fPos, fStep, nFrames );
+		break;
+	}
 }
 
 
@@ -776,7 +1356,7 @@ void Sampler::stop_playing_notes( Instrument* instrument )
 			Note *pNote = __playing_notes_queue[ i ];
 			assert( pNote );
 			if ( pNote->get_instrument() == instrument ) {
-				delete pNote;
+				__release_note( pNote );
 				instrument->dequeue();
 				__playing_notes_queue.erase( __playing_notes_queue.begin() + i );
 			}
@@ -787,7 +1367,7 @@ void Sampler::stop_playing_notes( Instrument* instrument )
 		for ( unsigned i = 0; i < __playing_notes_queue.size(); ++i ) {
 			Note *pNote = __playing_notes_queue[i];
 			pNote->get_instrument()->dequeue();
-			delete pNote;
+			__release_note( pNote );
 		}
 		__playing_notes_queue.clear();
 	}
@@ -805,7 +1385,7 @@ void Sampler::preview_sample( Sample* sample, int length )
 	Sample *pOldSample = pLayer->get_sample();
 	pLayer->set_sample( sample );
 
-	Note *previewNote = new Note( __preview_instrument, 0, 1.0, 0.5, 0.5, length, 0 );
+	Note *previewNote = AudioEngine::get_instance()->get_note_pool()->get( __preview_instrument, 0, 1.0, 0.5, 0.5, length, 0 );
 
 	stop_playing_notes( __preview_instrument );
 	note_on( previewNote );
@@ -826,7 +1406,7 @@ void Sampler::preview_instrument( Instrument* instr )
 	old_preview = __preview_instrument;
 	__preview_instrument = instr;
 
-	Note *previewNote = new Note( __preview_instrument, 0, 1.0, 0.5, 0.5, MAX_NOTES, 0 );
+	Note *previewNote = AudioEngine::get_instance()->get_note_pool()->get( __preview_instrument, 0, 1.0, 0.5, 0.5, MAX_NOTES, 0 );
 
 	note_on( previewNote );	// exclusive note
 	AudioEngine::get_instance()->unlock();
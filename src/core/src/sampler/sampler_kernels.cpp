@@ -0,0 +1,248 @@
+/*
+ * Hydrogen
+ * Copyright(c) 2002-2008 by Alex >Comix< Cominu [comix@users.sourceforge.net]
+ *
+ * http://www.hydrogen-music.org
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY, without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#include <hydrogen/sampler/sampler_kernels.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#define H2_SIMD_SSE
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#include <arm_neon.h>
+#define H2_SIMD_NEON
+#endif
+
+// the integer conversions need SSE2
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace H2Core
+{
+
+const char* SamplerKernels::simd_name()
+{
+#if defined(H2_SIMD_SSE)
+    return "SSE";
+#elif defined(H2_SIMD_NEON)
+    return "NEON";
+#else
+    return "none";
+#endif
+}
+
+// SCALAR REFERENCE
+
+void SamplerKernels::mul_ref( float* dst, const float* src, const float* gain, int n )
+{
+    for ( int i = 0; i < n; i++ ) {
+        dst[i] = src[i] * gain[i];
+    }
+}
+
+void SamplerKernels::mac_ref( float* dst, const float* src, float k, int n )
+{
+    for ( int i = 0; i < n; i++ ) {
+        dst[i] += src[i] * k;
+    }
+}
+
+float SamplerKernels::mac_peak_ref( float* dst, const float* src, float k, float peak, int n )
+{
+    for ( int i = 0; i < n; i++ ) {
+        float val = src[i] * k;
+        if ( val > peak ) {
+            peak = val;
+        }
+        dst[i] += val;
+    }
+    return peak;
+}
+
+void SamplerKernels::s16_to_float_ref( float* dst, const short* src, int n )
+{
+    for ( int i = 0; i < n; i++ ) {
+        dst[i] = src[i] * ( 1.0f / 32768.0f );
+    }
+}
+
+void SamplerKernels::s24_to_float_ref( float* dst, const unsigned char* src, int n )
+{
+    for ( int i = 0; i < n; i++ ) {
+        // the value in the upper 24 bits of an int, exactly representable as a float
+        int value = ( int )( ( unsigned )src[ i*3 ] << 8 | ( unsigned )src[ i*3 + 1 ] << 16 | ( unsigned )src[ i*3 + 2 ] << 24 );
+        dst[i] = value * ( 1.0f / 2147483648.0f );
+    }
+}
+
+// VECTORIZED
+
+#if defined(H2_SIMD_SSE)
+
+void SamplerKernels::mul( float* dst, const float* src, const float* gain, int n )
+{
+    int i = 0;
+    for ( ; i + 4 <= n; i += 4 ) {
+        _mm_storeu_ps( dst + i, _mm_mul_ps( _mm_loadu_ps( src + i ), _mm_loadu_ps( gain + i ) ) );
+    }
+    mul_ref( dst + i, src + i, gain + i, n - i );
+}
+
+void SamplerKernels::mac( float* dst, const float* src, float k, int n )
+{
+    __m128 vk = _mm_set1_ps( k );
+    int i = 0;
+    for ( ; i + 4 <= n; i += 4 ) {
+        __m128 val = _mm_mul_ps( _mm_loadu_ps( src + i ), vk );
+        _mm_storeu_ps( dst + i, _mm_add_ps( _mm_loadu_ps( dst + i ), val ) );
+    }
+    mac_ref( dst + i, src + i, k, n - i );
+}
+
+float SamplerKernels::mac_peak( float* dst, const float* src, float k, float peak, int n )
+{
+    __m128 vk = _mm_set1_ps( k );
+    __m128 vpeak = _mm_set1_ps( peak );
+    int i = 0;
+    for ( ; i + 4 <= n; i += 4 ) {
+        __m128 val = _mm_mul_ps( _mm_loadu_ps( src + i ), vk );
+        // max( val, vpeak ) keeps vpeak unless val is strictly greater, like the scalar test
+        vpeak = _mm_max_ps( val, vpeak );
+        _mm_storeu_ps( dst + i, _mm_add_ps( _mm_loadu_ps( dst + i ), val ) );
+    }
+    float lanes[4];
+    _mm_storeu_ps( lanes, vpeak );
+    for ( int l = 0; l < 4; l++ ) {
+        if ( lanes[l] > peak ) peak = lanes[l];
+    }
+    return mac_peak_ref( dst + i, src + i, k, peak, n - i );
+}
+
+#elif defined(H2_SIMD_NEON)
+
+void SamplerKernels::mul( float* dst, const float* src, const float* gain, int n )
+{
+    int i = 0;
+    for ( ; i + 4 <= n; i += 4 ) {
+        vst1q_f32( dst + i, vmulq_f32( vld1q_f32( src + i ), vld1q_f32( gain + i ) ) );
+    }
+    mul_ref( dst + i, src + i, gain + i, n - i );
+}
+
+void SamplerKernels::mac( float* dst, const float* src, float k, int n )
+{
+    float32x4_t vk = vdupq_n_f32( k );
+    int i = 0;
+    for ( ; i + 4 <= n; i += 4 ) {
+        // no vmlaq_f32 here, a fused multiply add would round differently from the scalar path
+        float32x4_t val = vmulq_f32( vld1q_f32( src + i ), vk );
+        vst1q_f32( dst + i, vaddq_f32( vld1q_f32( dst + i ), val ) );
+    }
+    mac_ref( dst + i, src + i, k, n - i );
+}
+
+float SamplerKernels::mac_peak( float* dst, const float* src, float k, float peak, int n )
+{
+    float32x4_t vk = vdupq_n_f32( k );
+    float32x4_t vpeak = vdupq_n_f32( peak );
+    int i = 0;
+    for ( ; i + 4 <= n; i += 4 ) {
+        float32x4_t val = vmulq_f32( vld1q_f32( src + i ), vk );
+        vpeak = vmaxq_f32( val, vpeak );
+        vst1q_f32( dst + i, vaddq_f32( vld1q_f32( dst + i ), val ) );
+    }
+    float lanes[4];
+    vst1q_f32( lanes, vpeak );
+    for ( int l = 0; l < 4; l++ ) {
+        if ( lanes[l] > peak ) peak = lanes[l];
+    }
+    return mac_peak_ref( dst + i, src + i, k, peak, n - i );
+}
+
+#else
+
+void SamplerKernels::mul( float* dst, const float* src, const float* gain, int n )
+{
+    mul_ref( dst, src, gain, n );
+}
+
+void SamplerKernels::mac( float* dst, const float* src, float k, int n )
+{
+    mac_ref( dst, src, k, n );
+}
+
+float SamplerKernels::mac_peak( float* dst, const float* src, float k, float peak, int n )
+{
+    return mac_peak_ref( dst, src, k, peak, n );
+}
+
+#endif
+
+// INTEGER CONVERSIONS
+
+#if defined(__SSE2__)
+
+void SamplerKernels::s16_to_float( float* dst, const short* src, int n )
+{
+    __m128 k = _mm_set1_ps( 1.0f / 32768.0f );
+    int i = 0;
+    for ( ; i + 8 <= n; i += 8 ) {
+        __m128i val = _mm_loadu_si128( ( const __m128i* )( src + i ) );
+        // each value in both halves of an int, shifted back to extend its sign
+        __m128i lo = _mm_srai_epi32( _mm_unpacklo_epi16( val, val ), 16 );
+        __m128i hi = _mm_srai_epi32( _mm_unpackhi_epi16( val, val ), 16 );
+        _mm_storeu_ps( dst + i, _mm_mul_ps( _mm_cvtepi32_ps( lo ), k ) );
+        _mm_storeu_ps( dst + i + 4, _mm_mul_ps( _mm_cvtepi32_ps( hi ), k ) );
+    }
+    s16_to_float_ref( dst + i, src + i, n - i );
+}
+
+#elif defined(H2_SIMD_NEON)
+
+void SamplerKernels::s16_to_float( float* dst, const short* src, int n )
+{
+    float32x4_t k = vdupq_n_f32( 1.0f / 32768.0f );
+    int i = 0;
+    for ( ; i + 4 <= n; i += 4 ) {
+        float32x4_t val = vcvtq_f32_s32( vmovl_s16( vld1_s16( src + i ) ) );
+        vst1q_f32( dst + i, vmulq_f32( val, k ) );
+    }
+    s16_to_float_ref( dst + i, src + i, n - i );
+}
+
+#else
+
+void SamplerKernels::s16_to_float( float* dst, const short* src, int n )
+{
+    s16_to_float_ref( dst, src, n );
+}
+
+#endif
+
+// the 24 bit values would need SSSE3 shuffles, which the baseline x86 targets lack
+void SamplerKernels::s24_to_float( float* dst, const unsigned char* src, int n )
+{
+    s24_to_float_ref( dst, src, n );
+}
+
+};
+
+/* vim: set softtabstop=4 expandtab: */
@@ -28,6 +28,11 @@
 
 #include <hydrogen/basics/pattern.h>
 #include <hydrogen/basics/pattern_list.h>
+#include <hydrogen/basics/song.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_list.h>
+#include <hydrogen/basics/instrument_layer.h>
+#include <hydrogen/basics/sample.h>
 #include <hydrogen/Preferences.h>
 #include <hydrogen/hydrogen.h>
 #include <hydrogen/IO/MidiInput.h>
@@ -207,6 +212,27 @@ void AudioEngineInfoForm::updateInfo()
 	// SAMPLER
 	Sampler *pSampler = AudioEngine::get_instance()->get_sampler();
 	sampler_playingNotesLbl->setText(QString( "%1 / %2" ).arg(pSampler->get_playing_notes_number()).arg(Preferences::get_instance()->m_nMaxNotes));
+	NotePool *pNotePool = AudioEngine::get_instance()->get_note_pool();
+	sampler_notePoolLbl->setText( QString( "%1 / %2, %3 from heap" ).arg( pNotePool->get_in_use() ).arg( pNotePool->get_capacity() ).arg( pNotePool->get_heap_allocations() ) );
+
+	// memory held by the samples of the song, and saved by the compact storage and the mono samples
+	long long nSampleBytes = 0;
+	long long nFloatBytes = 0;
+	Song *pSong = Hydrogen::get_instance()->getSong();
+	if ( pSong ) {
+		InstrumentList *pInstrList = pSong->get_instrument_list();
+		for ( int i = 0; i < pInstrList->size(); i++ ) {
+			Instrument *pInstr = pInstrList->get( i );
+			for ( int nLayer = 0; nLayer < MAX_LAYERS; nLayer++ ) {
+				InstrumentLayer *pLayer = pInstr->get_layer( nLayer );
+				if ( pLayer && pLayer->get_sample() ) {
+					nSampleBytes += pLayer->get_sample()->get_size();
+					nFloatBytes += ( long long )pLayer->get_sample()->get_frames() * sizeof( float ) * 2;
+				}
+			}
+		}
+	}
+	sampler_sampleMemoryLbl->setText( QString( "%1 MB, %2 MB saved" ).arg( nSampleBytes >> 20 ).arg( ( nFloatBytes - nSampleBytes ) >> 20 ) );
 
 	// Synth
 	Synth *pSynth = AudioEngine::get_instance()->get_synth();
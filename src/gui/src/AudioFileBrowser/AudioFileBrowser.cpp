@@ -257,10 +257,12 @@ void AudioFileBrowser::browseTree( const QModelIndex& index )
             if ( pNewSample ) {
                 m_pNBytesLable->setText( trUtf8( "Size: %1 bytes" ).arg( pNewSample->get_size() / 2 ) );
                 m_pSamplerateLable->setText( trUtf8( "Samplerate: %1" ).arg( pNewSample->get_sample_rate() ) );
-                float sec = ( float )( pNewSample->get_frames() / (float)pNewSample->get_sample_rate() );
+                float sec = ( float )( pNewSample->get_total_frames() / (float)pNewSample->get_sample_rate() );
                 QString qsec;
                 qsec.sprintf( "%2.2f", sec );
                 m_pLengthLable->setText( trUtf8( "Sample length: " ) + qsec + trUtf8( " s" ) );
+                // streamed samples are not held in memory, whatever their length
+                bool bStreamed = pNewSample->is_streamed();
 
                 delete pNewSample;
                 m_psamplefilename = path2;
@@ -272,7 +274,7 @@ void AudioFileBrowser::browseTree( const QModelIndex& index )
                 //important this will only working correct if m_pSampleWaveDisplay->updateDisplay( file )
                 //is ready with painting the wav file. else the playing sample get crackled sound!!
                 if (playSamplescheckBox->isChecked()){
-                    if ( sec <= 600.00){
+                    if ( sec <= 600.00 || bStreamed ){
                         on_m_pPlayBtn_clicked();
                     }else
                     {
@@ -306,7 +308,7 @@ void AudioFileBrowser::browseTree( const QModelIndex& index )
          m_pStopBtn->setEnabled( true );
          Sample *pNewSample = Sample::load( m_psamplefilename );
          if ( pNewSample ){
-                 int length = ( ( pNewSample->get_frames() / pNewSample->get_sample_rate() + 1) * 100 );
+                 int length = ( ( pNewSample->get_total_frames() / pNewSample->get_sample_rate() + 1) * 100 );
                  AudioEngine::get_instance()->get_sampler()->preview_sample( pNewSample, length );
          }
  }
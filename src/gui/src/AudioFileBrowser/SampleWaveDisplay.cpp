@@ -109,7 +109,6 @@ void SampleWaveDisplay::updateDisplay( QString filename )
 
 		float fGain = height() / 2.0 * 1.0;
 
-		float *pSampleData = pNewSample->get_data_l();
 
 		int nSamplePos =0;
 		int nVal;
@@ -117,7 +116,7 @@ void SampleWaveDisplay::updateDisplay( QString filename )
 			nVal = 0;
 			for ( int j = 0; j < nScaleFactor; ++j ) {
 				if ( j < nSampleLength ) {
-					int newVal = static_cast<int>( pSampleData[ nSamplePos ] * fGain );
+					int newVal = static_cast<int>( pNewSample->get_value_l( nSamplePos ) * fGain );
 					if ( newVal > nVal ) {
 						nVal = newVal;
 					}
@@ -28,7 +28,6 @@
 #include "ExportSongDialog.h"
 #include "Skin.h"
 #include "HydrogenApp.h"
-#include "Mixer/Mixer.h"
 
 #include <hydrogen/basics/note.h>
 #include <hydrogen/basics/pattern.h>
@@ -77,10 +76,7 @@ ExportSongDialog::ExportSongDialog(QWidget* parent)
 	defaultFilename += ".wav";
 	exportNameTxt->setText(defaultFilename);
 	b_QfileDialog = false;
-	m_bExportTrackouts = false;
-        m_nInstrument = 0;
         m_sExtension = ".wav";
-        m_bOverwriteFiles = false;
 
         // use of rubberband batch
         if(checkUseOfRubberband()){
@@ -186,8 +182,6 @@ void ExportSongDialog::on_okBtn_clicked()
 		return;
         }
 
-        m_bOverwriteFiles = false;
-
 	/* If the song has a tempo change, notify the user 
 	 *  that hydrogen is unable export songs with 
 	 *  tempo changes correctly 
@@ -201,104 +195,43 @@ void ExportSongDialog::on_okBtn_clicked()
 	/* 0: Export to single track
         *  1: Export to multiple tracks
         *  2: Export to both
+        * every track is rendered in a single pass
         */
+        bool bMix = exportTypeCombo->currentIndex() != 1;
+        bool bStems = exportTypeCombo->currentIndex() != 0;
 
-        if( exportTypeCombo->currentIndex() == 0 || exportTypeCombo->currentIndex() == 2 ){
-                m_bExportTrackouts = false;
-
-                QString filename = exportNameTxt->text();
-                if ( QFile( filename ).exists() == true && b_QfileDialog == false ) {
-
-                    int res;
-                    if( exportTypeCombo->currentIndex() == 0 ){
-                        res = QMessageBox::information( this, "Hydrogen", tr( "The file %1 exists. \nOverwrite the existing file?").arg(filename), QMessageBox::Yes | QMessageBox::No );
-                    } else {
-                        res = QMessageBox::information( this, "Hydrogen", tr( "The file %1 exists. \nOverwrite the existing file?").arg(filename), QMessageBox::Yes | QMessageBox::No | QMessageBox::YesToAll);
-                    }
-
-                    if (res == QMessageBox::YesToAll ) m_bOverwriteFiles = true;
-                    if (res == QMessageBox::No ) return;
+        QString filename = exportNameTxt->text();
+        if ( bMix && QFile( filename ).exists() == true && b_QfileDialog == false ) {
+                int res = QMessageBox::information( this, "Hydrogen", tr( "The file %1 exists. \nOverwrite the existing file?").arg(filename), QMessageBox::Yes | QMessageBox::No );
+                if (res == QMessageBox::No ) return;
+        }
 
+        if ( bStems ) {
+                QString trackFilename = existingTrackFile( filename );
+                if ( !trackFilename.isEmpty() && b_QfileDialog == false ) {
+                        int res = QMessageBox::information( this, "Hydrogen", tr( "The file %1 exists. \nOverwrite the existing file?").arg(trackFilename), QMessageBox::Yes | QMessageBox::No );
+                        if (res == QMessageBox::No ) return;
                 }
-
-                if( exportTypeCombo->currentIndex() == 2 ) m_bExportTrackouts = true;
-                Hydrogen::get_instance()->startExportSong( filename, sampleRateCombo->currentText().toInt(), sampleDepthCombo->currentText().toInt() );
-
-                return;
         }
 
-        if( exportTypeCombo->currentIndex() == 1 ){
-                m_bExportTrackouts = true;
-                exportTracks();
-                return;
-	}
-
+        Hydrogen::get_instance()->startExportSong( filename, sampleRateCombo->currentText().toInt(), sampleDepthCombo->currentText().toInt(), bStems, bMix );
 }
 
-void ExportSongDialog::exportTracks()
+QString ExportSongDialog::existingTrackFile( const QString& filename )
 {
-        Song *pSong = Hydrogen::get_instance()->getSong();
-        if( m_nInstrument <= pSong->get_instrument_list()->size() -1 ){
-
-                bool instrumentexists = false;
-                //if a instrument contains no notes we jump to the next instrument
-                unsigned nPatterns = pSong->get_pattern_list()->size();
-                for ( unsigned i = 0; i < nPatterns; i++ ) {
-                        Pattern *pat = pSong->get_pattern_list()->get( i );
-                        const Pattern::notes_t* notes = pat->get_notes();
-                        FOREACH_NOTE_CST_IT_BEGIN_END(notes,it) {
-                                Note *pNote = it->second;
-                                assert( pNote );
-
-                                if( pNote->get_instrument()->get_name() == Hydrogen::get_instance()->getSong()->get_instrument_list()->get(m_nInstrument)->get_name() ){
-                                        instrumentexists = true;
-                                        break;
-                                }
-
-                        }
-                }
-
-                if( !instrumentexists ){
-                        if( m_nInstrument == Hydrogen::get_instance()->getSong()->get_instrument_list()->size() -1 ){
-                                m_bExportTrackouts = false;
-                                HydrogenApp::get_instance()->getMixer()->unmuteAll( true );
-                                m_nInstrument = 0;
-                                return;
-                        }else {
-                                m_nInstrument++;
-                                exportTracks();
-                                return;
-                        }
-                }
-
-                QStringList filenameList =  exportNameTxt->text().split( m_sExtension );
-
-                QString firstItem;
-                if( !filenameList.isEmpty() ){
-                        firstItem = filenameList.first();
-                }
-                QString newItem =  firstItem + "-" + Hydrogen::get_instance()->getSong()->get_instrument_list()->get(m_nInstrument)->get_name();
-
-                QString filename =  newItem.append(m_sExtension);
-
-                if ( QFile( filename ).exists() == true && b_QfileDialog == false && !m_bOverwriteFiles) {
-                        int res = QMessageBox::information( this, "Hydrogen", tr( "The file %1 exists. \nOverwrite the existing file?").arg(filename), QMessageBox::Yes | QMessageBox::No | QMessageBox::YesToAll );
-                        if (res == QMessageBox::No ) return;
-                        if (res == QMessageBox::YesToAll ) m_bOverwriteFiles = true;
-                }
-
-                //Hydrogen::get_instance()->stopExportSong();
-                Hydrogen::get_instance()->stopExportSong( false );
-                m_bExporting = false;
-                HydrogenApp::get_instance()->getMixer()->soloClicked( m_nInstrument );
-
-                Hydrogen::get_instance()->startExportSong( filename, sampleRateCombo->currentText().toInt(), sampleDepthCombo->currentText().toInt() );
-
-                if(! (m_nInstrument == Hydrogen::get_instance()->getSong()->get_instrument_list()->size() -1 )){
-                        m_nInstrument++;
+        // the disk writer names the track files after the song file and the instrument
+        int nDot = filename.lastIndexOf( '.' );
+        QString base = ( nDot == -1 ) ? filename : filename.left( nDot );
+        QString extension = ( nDot == -1 ) ? QString() : filename.mid( nDot );
+
+        InstrumentList *pInstruments = Hydrogen::get_instance()->getSong()->get_instrument_list();
+        for ( int i = 0; i < pInstruments->size(); i++ ) {
+                QString trackFilename = base + "-" + pInstruments->get( i )->get_name() + extension;
+                if ( QFile( trackFilename ).exists() ) {
+                        return trackFilename;
                 }
         }
-
+        return QString();
 }
 
 void ExportSongDialog::on_closeBtn_clicked()
@@ -481,17 +414,6 @@ void ExportSongDialog::progressEvent( int nValue )
         if ( nValue == 100 ) {
 
                 m_bExporting = false;
-
-                if( m_nInstrument == Hydrogen::get_instance()->getSong()->get_instrument_list()->size() -1 ){
-                        HydrogenApp::get_instance()->getMixer()->unmuteAll( false );
-                        m_nInstrument = 0;
-                        m_bExportTrackouts = false;
-
-                }
-
-                if( m_bExportTrackouts ){
-                        exportTracks();
-                }
         }
 
         if ( nValue < 100 ) {
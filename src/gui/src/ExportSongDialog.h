@@ -63,10 +63,8 @@ class ExportSongDialog : public QDialog, public Ui_ExportSongDialog_UI, public E
                 bool checkUseOfRubberband();
 
                 bool m_bExporting;
-		void exportTracks();
-		bool m_bExportTrackouts;
-                bool m_bOverwriteFiles;
-                uint m_nInstrument;
+                /// first track file of a stem export which would be overwritten, empty if none
+                QString existingTrackFile( const QString& filename );
                 QString m_sExtension;
                 bool b_oldRubberbandBatchMode;
                 bool b_oldTimeLineBPMMode;
@@ -566,6 +566,10 @@ void HydrogenApp::onEventQueueTimer()
                                         pListener->undoRedoActionEvent( event.value );
                                         break;
 
+                                case EVENT_DRUMKIT_LOADING:
+                                        pListener->drumkitLoadingEvent( event.value );
+                                        break;
+
                                 default:
 					ERRORLOG( QString("[onEventQueueTimer] Unhandled event: %1").arg( event.type ) );
 			}
@@ -574,30 +578,30 @@ void HydrogenApp::onEventQueueTimer()
         }
 
         // midi notes
-        while(!pQueue->m_addMidiNoteVector.empty()){
+        EventQueue::AddMidiNoteVector noteAction;
+        while(pQueue->pop_midi_note( noteAction )){
 
                int rounds = 1;
-               if(pQueue->m_addMidiNoteVector[0].b_noteExist)// runn twice, delete old note and add new note. this let the undo stack consistent
+               if(noteAction.b_noteExist)// runn twice, delete old note and add new note. this let the undo stack consistent
                       rounds = 2;
                for(int i = 0; i<rounds; i++){
-                      SE_addNoteAction *action = new SE_addNoteAction( pQueue->m_addMidiNoteVector[0].m_column,
-                                                                       pQueue->m_addMidiNoteVector[0].m_row,
-                                                                       pQueue->m_addMidiNoteVector[0].m_pattern,
-                                                                       pQueue->m_addMidiNoteVector[0].m_length,
-                                                                       pQueue->m_addMidiNoteVector[0].f_velocity,
-                                                                       pQueue->m_addMidiNoteVector[0].f_pan_L,
-                                                                       pQueue->m_addMidiNoteVector[0].f_pan_R,
+                      SE_addNoteAction *action = new SE_addNoteAction( noteAction.m_column,
+                                                                       noteAction.m_row,
+                                                                       noteAction.m_pattern,
+                                                                       noteAction.m_length,
+                                                                       noteAction.f_velocity,
+                                                                       noteAction.f_pan_L,
+                                                                       noteAction.f_pan_R,
                                                                        0.0,
-                                                                       pQueue->m_addMidiNoteVector[0].nk_noteKeyVal,
-                                                                       pQueue->m_addMidiNoteVector[0].no_octaveKeyVal,
+                                                                       noteAction.nk_noteKeyVal,
+                                                                       noteAction.no_octaveKeyVal,
                                                                        false,
                                                                        false,
-                                                                       pQueue->m_addMidiNoteVector[0].b_isMidi,
-                                                                       pQueue->m_addMidiNoteVector[0].b_isInstrumentMode);
+                                                                       noteAction.b_isMidi,
+                                                                       noteAction.b_isInstrumentMode);
 
                       HydrogenApp::get_instance()->m_undoStack->push( action );
                }
-               pQueue->m_addMidiNoteVector.erase(pQueue->m_addMidiNoteVector.begin());
 
         }
 }
@@ -644,6 +644,7 @@ void InstrumentEditor::loadLayer()
 			Sample *newSample = Sample::load( filename[i] );
 	
 			H2Core::Instrument *pInstr = NULL;
+			Sample *oldSample = NULL;
 	
 			AudioEngine::get_instance()->lock( RIGHT_HERE );
 			Song *song = engine->getSong();
@@ -657,9 +658,8 @@ void InstrumentEditor::loadLayer()
 			
 			H2Core::InstrumentLayer *pLayer = pInstr->get_layer( selectedLayer );
 			if (pLayer != NULL) {
-				// delete old sample
-				Sample *oldSample = pLayer->get_sample();
-				delete oldSample;
+				// the old sample is deleted once the engine is unlocked
+				oldSample = pLayer->get_sample();
 	
 				// insert new sample from newInstrument
 				pLayer->set_sample( newSample );
@@ -683,8 +683,10 @@ void InstrumentEditor::loadLayer()
 			//pInstr->set_drumkit_name( "" );   // external sample, no drumkit info
 	
 			AudioEngine::get_instance()->unlock();
+			delete oldSample;
 
 		}
+		Hydrogen::get_instance()->resampleLayers();
 	}
 
 	selectedInstrumentChangedEvent();    // update all
@@ -854,44 +856,5 @@ void InstrumentEditor::midiOutNoteBtnClicked(Button *pRef)
 	}
 //	INFOLOG( "Tempo change: Recomputing rubberband samples." );
 	Hydrogen *pEngine = Hydrogen::get_instance();
-	Song *song = pEngine->getSong();
-	assert(song);
-	if(song){
-		InstrumentList *songInstrList = song->get_instrument_list();
-		assert(songInstrList);
-		for ( unsigned nInstr = 0; nInstr < songInstrList->size(); ++nInstr ) {
-			Instrument *pInstr = songInstrList->get( nInstr );
-			assert( pInstr );
-			if ( pInstr ){
-				for ( int nLayer = 0; nLayer < MAX_LAYERS; nLayer++ ) {
-					InstrumentLayer *pLayer = pInstr->get_layer( nLayer );
-					if ( pLayer ) {
-						Sample *pSample = pLayer->get_sample();
-						if ( pSample ) {
-                            if( pSample->get_rubberband().use ) {
-								//INFOLOG( QString("Instrument %1 Layer %2" ).arg(nInstr).arg(nLayer));
-                                Sample *newSample = Sample::load(
-                                        pSample->get_filepath(),
-                                        pSample->get_loops(),
-                                        pSample->get_rubberband(),
-                                        *pSample->get_velocity_envelope(),
-                                        *pSample->get_pan_envelope()
-                                        );
-								if( !newSample  ){
-									continue;
-								}	
-								delete pSample;
-								// insert new sample from newInstrument
-								AudioEngine::get_instance()->lock( RIGHT_HERE );
-								pLayer->set_sample( newSample );
-								AudioEngine::get_instance()->unlock();
-	
-							}
-						}
-					}
-				}
-			}
-		}
-        }
-
+	pEngine->recalculateRubberband( pEngine->getNewBpmJTM() );
 }
@@ -206,7 +206,7 @@ void LayerPreview::mousePressEvent(QMouseEvent *ev)
 	if ( ev->y() < 20 ) {
 		float fVelocity = (float)ev->x() / (float)width();
 
-		Note *note = new Note( m_pInstrument, nPosition, fVelocity, fPan_L, fPan_R, nLength, fPitch );
+		Note *note = AudioEngine::get_instance()->get_note_pool()->get( m_pInstrument, nPosition, fVelocity, fPan_L, fPan_R, nLength, fPitch );
 		AudioEngine::get_instance()->get_sampler()->note_on(note);
 
 		for ( int i = 0; i < MAX_LAYERS; i++ ) {
@@ -231,7 +231,7 @@ void LayerPreview::mousePressEvent(QMouseEvent *ev)
 		InstrumentEditorPanel::get_instance()->selectLayer( m_nSelectedLayer );
 
 		if ( m_pInstrument->get_layer( m_nSelectedLayer ) ) {
-			Note *note = new Note( m_pInstrument , nPosition, m_pInstrument->get_layer( m_nSelectedLayer )->get_end_velocity() - 0.01, fPan_L, fPan_R, nLength, fPitch );
+			Note *note = AudioEngine::get_instance()->get_note_pool()->get( m_pInstrument , nPosition, m_pInstrument->get_layer( m_nSelectedLayer )->get_end_velocity() - 0.01, fPan_L, fPan_R, nLength, fPitch );
 			AudioEngine::get_instance()->get_sampler()->note_on(note);
 		}
 
@@ -98,7 +98,7 @@ void WaveDisplay::updateDisplay( H2Core::InstrumentLayer *pLayer )
 
 		float fGain = height() / 2.0 * pLayer->get_gain();
 
-		float *pSampleData = pLayer->get_sample()->get_data_l();
+		Sample *pSample = pLayer->get_sample();
 
 		int nSamplePos =0;
 		int nVal;
@@ -106,7 +106,7 @@ void WaveDisplay::updateDisplay( H2Core::InstrumentLayer *pLayer )
 			nVal = 0;
 			for ( int j = 0; j < nScaleFactor; ++j ) {
 				if ( j < nSampleLength ) {
-					int newVal = (int)( pSampleData[ nSamplePos ] * fGain );
+					int newVal = (int)( pSample->get_value_l( nSamplePos ) * fGain );
 					if ( newVal > nVal ) {
 						nVal = newVal;
 					}
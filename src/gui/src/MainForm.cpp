@@ -1690,6 +1690,10 @@ void MainForm::undoRedoActionEvent( int nEvent ){
               h2app->m_undoStack->redo();
 }
 
+void MainForm::drumkitLoadingEvent( int nPercent ){
+       h2app->setStatusBarMessage( trUtf8( "Loading drumkit [%1%]" ).arg( nPercent ), 2000 );
+}
+
 bool MainForm::handleSelectNextPrevSongOnPlaylist( int step )
 {
         int playlistSize= Hydrogen::get_instance()->m_PlayList.size();
@@ -57,6 +57,7 @@ class MainForm : public QMainWindow, public EventListener, public H2Core::Object
                 virtual void jacksessionEvent( int nValue);
                 virtual void playlistLoadSongEvent(int nIndex);
                 virtual void undoRedoActionEvent( int nEvent );
+                virtual void drumkitLoadingEvent( int nPercent );
 		static void usr1SignalHandler(int unused);
 
 
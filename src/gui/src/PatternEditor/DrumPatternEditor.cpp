@@ -322,7 +322,7 @@ void DrumPatternEditor::addOrDeleteNoteAction(  int nColumn,
                }
                 // hear note
                 if ( listen && !isNoteOff ) {
-			Note *pNote2 = new Note( pSelectedInstrument, 0, fVelocity, fPan_L, fPan_R, nLength, fPitch);
+			Note *pNote2 = AudioEngine::get_instance()->get_note_pool()->get( pSelectedInstrument, 0, fVelocity, fPan_L, fPan_R, nLength, fPitch);
 			AudioEngine::get_instance()->get_sampler()->note_on(pNote2);
 		}
 	}
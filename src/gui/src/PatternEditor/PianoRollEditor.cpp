@@ -683,7 +683,7 @@ void PianoRollEditor::addOrDeleteNoteAction( int nColumn,
               // hear note
               Preferences *pref = Preferences::get_instance();
               if ( pref->getHearNewNotes() && !noteOff ) {
-                     Note *pNote2 = new Note( pSelectedInstrument, 0, fVelocity, fPan_L, fPan_R, nLength, fPitch);
+                     Note *pNote2 = AudioEngine::get_instance()->get_note_pool()->get( pSelectedInstrument, 0, fVelocity, fPan_L, fPan_R, nLength, fPitch);
                      pNote2->set_key_octave( pressednotekey, pressedoctave );
                      AudioEngine::get_instance()->get_sampler()->note_on(pNote2);
               }
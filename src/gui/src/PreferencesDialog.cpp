@@ -124,6 +124,7 @@ PreferencesDialog::PreferencesDialog(QWidget* parent)
 
 	// max voices
 	maxVoicesTxt->setValue( pPref->m_nMaxNotes );
+	renderThreadsSpinBox->setValue( pPref->m_nRenderThreads );
 
 	// JACK
         trackOutsCheckBox->setChecked( pPref->m_bJackTrackOuts );
@@ -361,6 +362,14 @@ void PreferencesDialog::on_okBtn_clicked()
 	// maxVoices
 	pPref->m_nMaxNotes = maxVoicesTxt->value();
 
+	// render threads
+	if ( pPref->m_nRenderThreads != (unsigned)renderThreadsSpinBox->value() ) {
+		pPref->m_nRenderThreads = renderThreadsSpinBox->value();
+		AudioEngine::get_instance()->lock( RIGHT_HERE );
+		AudioEngine::get_instance()->get_sampler()->set_render_threads( pPref->m_nRenderThreads );
+		AudioEngine::get_instance()->unlock();
+	}
+
 	if ( m_pMidiDriverComboBox->currentText() == "ALSA" ) {
 		pPref->m_sMidiDriver = "ALSA";
 	}
@@ -167,8 +167,6 @@ void MainSampleWaveDisplay::updateDisplay( const QString& filename )
 
 		float fGain = height() / 4.0 * 1.0;
 
-		float *pSampleDatal = pNewSample->get_data_l();
-		float *pSampleDatar = pNewSample->get_data_r();
 
 		unsigned nSamplePos = 0;
 		int nVall = 0;
@@ -178,9 +176,9 @@ void MainSampleWaveDisplay::updateDisplay( const QString& filename )
 		for ( int i = 0; i < width(); ++i ){
 			for ( int j = 0; j < nScaleFactor; ++j ) {
 				if ( j < nSampleLength && nSamplePos < nSampleLength) {
-					if ( pSampleDatal[ nSamplePos ] && pSampleDatar[ nSamplePos ] ){
-						newVall = static_cast<int>( pSampleDatal[ nSamplePos ] * fGain );
-						newValr = static_cast<int>( pSampleDatar[ nSamplePos ] * fGain );
+					if ( pNewSample->get_value_l( nSamplePos ) && pNewSample->get_value_r( nSamplePos ) ){
+						newVall = static_cast<int>( pNewSample->get_value_l( nSamplePos ) * fGain );
+						newValr = static_cast<int>( pNewSample->get_value_r( nSamplePos ) * fGain );
 						nVall = newVall;
 						nValr = newValr;
 					}else
@@ -385,6 +385,7 @@ void SampleEditor::createNewLayer()
 		pLayer->set_sample( editSample );
 
                 AudioEngine::get_instance()->unlock();
+		Hydrogen::get_instance()->resampleLayers();
 		m_pTargetSampleView->updateDisplay( pLayer );
 		}
 		
@@ -518,7 +519,7 @@ void SampleEditor::on_PlayPushButton_clicked()
 	
 	Instrument *pInstr = pSong->get_instrument_list()->get( Hydrogen::get_instance()->getSelectedInstrumentNumber() );
 	
-	Note *pNote = new Note( pInstr, 0, pInstr->get_layer( selectedlayer )->get_end_velocity() - 0.01, pan_L, pan_R, nLength, fPitch);
+	Note *pNote = AudioEngine::get_instance()->get_note_pool()->get( pInstr, 0, pInstr->get_layer( selectedlayer )->get_end_velocity() - 0.01, pan_L, pan_R, nLength, fPitch);
 	AudioEngine::get_instance()->get_sampler()->note_on(pNote);
 
 	setSamplelengthFrames();
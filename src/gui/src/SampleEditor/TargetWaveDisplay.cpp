@@ -197,8 +197,7 @@ void TargetWaveDisplay::updateDisplay( H2Core::InstrumentLayer *pLayer )
 
 		float fGain = (height() - 8) / 2.0 * pLayer->get_gain();
 
-		float *pSampleDatal = pLayer->get_sample()->get_data_l();
-		float *pSampleDatar = pLayer->get_sample()->get_data_r();
+		Sample *pSample = pLayer->get_sample();
 		int nSamplePos = 0;
 		int nVall;
 		int nValr;
@@ -207,20 +206,22 @@ void TargetWaveDisplay::updateDisplay( H2Core::InstrumentLayer *pLayer )
 			nValr = 0;
 			for ( int j = 0; j < nScaleFactor; ++j ) {
 				if ( j < nSampleLength ) {
-					if ( pSampleDatal[ nSamplePos ] < 0 ){
-						int newVal = static_cast<int>( pSampleDatal[ nSamplePos ] * -fGain );
+					float fValue_L = pSample->get_value_l( nSamplePos );
+					float fValue_R = pSample->get_value_r( nSamplePos );
+					if ( fValue_L < 0 ){
+						int newVal = static_cast<int>( fValue_L * -fGain );
 						nVall = newVal;
 					}else
 					{
-						int newVal = static_cast<int>( pSampleDatal[ nSamplePos ] * fGain );
+						int newVal = static_cast<int>( fValue_L * fGain );
 						nVall = newVal;
 					}
-					if ( pSampleDatar[ nSamplePos ] > 0 ){
-						int newVal = static_cast<int>( pSampleDatar[ nSamplePos ] * -fGain );
+					if ( fValue_R > 0 ){
+						int newVal = static_cast<int>( fValue_R * -fGain );
 						nValr = newVal;
 					}else
 					{
-						int newVal = static_cast<int>( pSampleDatar[ nSamplePos ] * fGain );
+						int newVal = static_cast<int>( fValue_R * fGain );
 						nValr = newVal;
 					}
 				}
@@ -76,6 +76,8 @@ SoundLibraryPanel::SoundLibraryPanel( QWidget *pParent )
  , __song_item( NULL )
  , __pattern_item( NULL )
  , __pattern_item_list( NULL )
+ , __library_watcher( NULL )
+ , __library_update_pending( false )
 {
 	//INFOLOG( "INIT" );
 	__drumkit_menu = new QMenu( this );
@@ -124,6 +126,10 @@ SoundLibraryPanel::SoundLibraryPanel( QWidget *pParent )
 	__expand_pattern_list = Preferences::get_instance()->__expandPatternItem;
 	__expand_songs_list = Preferences::get_instance()->__expandSongItem;
 
+	// the list follows the changes made on disk, by Hydrogen or not
+	__library_watcher = new QFileSystemWatcher( this );
+	connect( __library_watcher, SIGNAL( directoryChanged( const QString& ) ), this, SLOT( on_libraryChanged( const QString& ) ) );
+
 	updateDrumkitList();
 }
 
@@ -175,46 +181,53 @@ void SoundLibraryPanel::updateDrumkitList()
 	}
 	__user_drumkit_info_list.clear();
 
+	LibraryIndex* pIndex = LibraryIndex::get_instance();
+	if ( pIndex == NULL ) {
+		ERRORLOG( "The library index has not been created, the drumkits are not listed" );
+	}
+
 	//User drumkit list
-    QStringList usr_dks = Filesystem::usr_drumkits_list();
-    for (int i = 0; i < usr_dks.size(); ++i) {
-		QString absPath = Filesystem::usr_drumkits_dir() + "/" + usr_dks[i];
-		Drumkit *pInfo = Drumkit::load( absPath );
-		if (pInfo) {
-			__user_drumkit_info_list.push_back( pInfo );
-			QTreeWidgetItem* pDrumkitItem = new QTreeWidgetItem( __user_drumkits_item );
-			pDrumkitItem->setText( 0, pInfo->get_name() );
-			if ( QString(pInfo->get_name() ) == currentSL ){
-				pDrumkitItem->setBackgroundColor( 0, QColor( 50, 50, 50) );
-			}
-			InstrumentList *pInstrList = pInfo->get_instruments();
-			for ( uint nInstr = 0; nInstr < pInstrList->size(); ++nInstr ) {
-				Instrument *pInstr = pInstrList->get( nInstr );
-				QTreeWidgetItem* pInstrumentItem = new QTreeWidgetItem( pDrumkitItem );
-				pInstrumentItem->setText( 0, QString( "[%1] " ).arg( nInstr + 1 ) + pInstr->get_name() );
-				pInstrumentItem->setToolTip( 0, pInstr->get_name() );
+	__user_drumkits.clear();
+	if ( pIndex ) {
+		__user_drumkits = pIndex->get_drumkits( Filesystem::usr_drumkits_dir() );
+	}
+	for ( uint i = 0; i < __user_drumkits.size(); ++i ) {
+		const LibraryIndex::DrumkitInfo& info = __user_drumkits[i];
+		QTreeWidgetItem* pDrumkitItem = new QTreeWidgetItem( __user_drumkits_item );
+		pDrumkitItem->setText( 0, info.name );
+		if ( info.name == currentSL ){
+			pDrumkitItem->setBackgroundColor( 0, QColor( 50, 50, 50) );
+		}
+		for ( int nInstr = 0; nInstr < info.instruments.size(); ++nInstr ) {
+			QTreeWidgetItem* pInstrumentItem = new QTreeWidgetItem( pDrumkitItem );
+			pInstrumentItem->setText( 0, QString( "[%1] " ).arg( nInstr + 1 ) + info.instruments[ nInstr ] );
+			if ( info.lengths[ nInstr ] >= 0 ) {
+				pInstrumentItem->setToolTip( 0, QString( "%1 (%2 s)" ).arg( info.instruments[ nInstr ] ).arg( info.lengths[ nInstr ], 0, 'f', 2 ) );
+			} else {
+				pInstrumentItem->setToolTip( 0, info.instruments[ nInstr ] );
 			}
 		}
 	}
 
 	//System drumkit list
-    QStringList sys_dks = Filesystem::sys_drumkits_list();
-    for (int i = 0; i < sys_dks.size(); ++i) {
-		QString absPath = Filesystem::sys_drumkits_dir() + "/" + sys_dks[i];
-		Drumkit *pInfo = Drumkit::load( absPath );
-		if (pInfo) {
-			__system_drumkit_info_list.push_back( pInfo );
-			QTreeWidgetItem* pDrumkitItem = new QTreeWidgetItem( __system_drumkits_item );
-			pDrumkitItem->setText( 0, pInfo->get_name() );
-			if ( QString( pInfo->get_name() ) == currentSL ){
-				pDrumkitItem->setBackgroundColor( 0, QColor( 50, 50, 50) );
-			}
-			InstrumentList *pInstrList = pInfo->get_instruments();
-			for ( uint nInstr = 0; nInstr < pInstrList->size(); ++nInstr ) {
-				Instrument *pInstr = pInstrList->get( nInstr );
-				QTreeWidgetItem* pInstrumentItem = new QTreeWidgetItem( pDrumkitItem );
-				pInstrumentItem->setText( 0, QString( "[%1] " ).arg( nInstr + 1 ) + pInstr->get_name() );
-				pInstrumentItem->setToolTip( 0, pInstr->get_name() );
+	__system_drumkits.clear();
+	if ( pIndex ) {
+		__system_drumkits = pIndex->get_drumkits( Filesystem::sys_drumkits_dir() );
+	}
+	for ( uint i = 0; i < __system_drumkits.size(); ++i ) {
+		const LibraryIndex::DrumkitInfo& info = __system_drumkits[i];
+		QTreeWidgetItem* pDrumkitItem = new QTreeWidgetItem( __system_drumkits_item );
+		pDrumkitItem->setText( 0, info.name );
+		if ( info.name == currentSL ){
+			pDrumkitItem->setBackgroundColor( 0, QColor( 50, 50, 50) );
+		}
+		for ( int nInstr = 0; nInstr < info.instruments.size(); ++nInstr ) {
+			QTreeWidgetItem* pInstrumentItem = new QTreeWidgetItem( pDrumkitItem );
+			pInstrumentItem->setText( 0, QString( "[%1] " ).arg( nInstr + 1 ) + info.instruments[ nInstr ] );
+			if ( info.lengths[ nInstr ] >= 0 ) {
+				pInstrumentItem->setToolTip( 0, QString( "%1 (%2 s)" ).arg( info.instruments[ nInstr ] ).arg( info.lengths[ nInstr ], 0, 'f', 2 ) );
+			} else {
+				pInstrumentItem->setToolTip( 0, info.instruments[ nInstr ] );
 			}
 		}
 	}
@@ -252,8 +265,21 @@ void SoundLibraryPanel::updateDrumkitList()
 		}
 		
 		//this is the second step to push the mng.funktion 
-		std::vector<QString> allPatternDirList = mng.getallPatternList();
 		std::vector<QString> allCategoryNameList = mng.getAllCategoriesFromPattern();
+		std::vector<LibraryIndex::PatternInfo> allPatterns;
+		if ( pIndex ) {
+			allPatterns = pIndex->get_patterns();
+		} else {
+			std::vector<QString> allPatternDirList = mng.getallPatternList();
+			for ( uint i = 0; i < allPatternDirList.size(); ++i ) {
+				LibraryIndex::PatternInfo info;
+				info.path = allPatternDirList[i];
+				info.name = mng.getPatternNameFromPatternDir( allPatternDirList[i] );
+				info.category = mng.getCategoryFromPatternName( allPatternDirList[i] );
+				info.drumkit = mng.getDrumkitNameForPattern( allPatternDirList[i] );
+				allPatterns.push_back( info );
+			}
+		}
 
 		//now sorting via category
 		if ( allCategoryNameList.size() > 0 ){
@@ -262,13 +288,13 @@ void SoundLibraryPanel::updateDrumkitList()
 	
 				QTreeWidgetItem* pCategoryItem = new QTreeWidgetItem( __pattern_item );
 				pCategoryItem->setText( 0, categoryName  );
-				for (uint i = 0; i < allPatternDirList.size(); ++i) {
-					QString patternCategory = mng.getCategoryFromPatternName( allPatternDirList[i]);
+				for (uint i = 0; i < allPatterns.size(); ++i) {
+					QString patternCategory = allPatterns[i].category;
 
                                         if ( patternCategory == categoryName || patternCategory.isEmpty() && categoryName == "No category" ){
 						QTreeWidgetItem* pPatternItem = new QTreeWidgetItem( pCategoryItem );
-						pPatternItem->setText( 0, mng.getPatternNameFromPatternDir( allPatternDirList[i] ));
-						pPatternItem->setToolTip( 0, mng.getDrumkitNameForPattern( allPatternDirList[i] ));
+						pPatternItem->setText( 0, allPatterns[i].name );
+						pPatternItem->setToolTip( 0, allPatterns[i].drumkit );
 
 					}
 				}
@@ -276,7 +302,93 @@ void SoundLibraryPanel::updateDrumkitList()
 		}
 	}
 
+	watch_library();
+}
 
+
+
+/**
+ * Return the drumkit named sDrumkitName, loaded from the directory
+ * the library index knows it in the first time it is asked for.
+ */
+Drumkit* SoundLibraryPanel::get_drumkit( const QString& sDrumkitName )
+{
+	// a user drumkit overrides a system one of the same name
+	for ( uint i = 0; i < __user_drumkit_info_list.size(); i++ ) {
+		if ( __user_drumkit_info_list[i]->get_name() == sDrumkitName ) {
+			return __user_drumkit_info_list[i];
+		}
+	}
+	for ( uint i = 0; i < __system_drumkit_info_list.size(); i++ ) {
+		if ( __system_drumkit_info_list[i]->get_name() == sDrumkitName ) {
+			return __system_drumkit_info_list[i];
+		}
+	}
+
+	for ( uint i = 0; i < __user_drumkits.size(); i++ ) {
+		if ( __user_drumkits[i].name == sDrumkitName ) {
+			Drumkit *pInfo = Drumkit::load( __user_drumkits[i].path );
+			if ( pInfo ) {
+				__user_drumkit_info_list.push_back( pInfo );
+			}
+			return pInfo;
+		}
+	}
+	for ( uint i = 0; i < __system_drumkits.size(); i++ ) {
+		if ( __system_drumkits[i].name == sDrumkitName ) {
+			Drumkit *pInfo = Drumkit::load( __system_drumkits[i].path );
+			if ( pInfo ) {
+				__system_drumkit_info_list.push_back( pInfo );
+			}
+			return pInfo;
+		}
+	}
+	return NULL;
+}
+
+
+
+/**
+ * Watch the directories the list is made of, replacing the previous ones
+ * as drumkits and pattern directories come and go.
+ */
+void SoundLibraryPanel::watch_library()
+{
+	if ( !__library_watcher->directories().isEmpty() ) {
+		__library_watcher->removePaths( __library_watcher->directories() );
+	}
+
+	QStringList dirs;
+	dirs << Filesystem::sys_drumkits_dir() << Filesystem::usr_drumkits_dir() << Filesystem::songs_dir() << Filesystem::patterns_dir();
+	QStringList patternDirs = QDir( Filesystem::patterns_dir() ).entryList( QDir::Dirs | QDir::NoDotAndDotDot );
+	for ( int i = 0; i < patternDirs.size(); ++i ) {
+		dirs << Filesystem::patterns_dir() + "/" + patternDirs[i];
+	}
+	for ( int i = 0; i < dirs.size(); ++i ) {
+		if ( QDir( dirs[i] ).exists() ) {
+			__library_watcher->addPath( dirs[i] );
+		}
+	}
+}
+
+
+
+void SoundLibraryPanel::on_libraryChanged( const QString& )
+{
+	// a copy or an extraction changes a directory many times in a row
+	if ( !__library_update_pending ) {
+		__library_update_pending = true;
+		QTimer::singleShot( 500, this, SLOT( on_libraryUpdate() ) );
+	}
+}
+
+
+
+void SoundLibraryPanel::on_libraryUpdate()
+{
+	__library_update_pending = false;
+	test_expandedItems();
+	updateDrumkitList();
 }
 
 
@@ -486,24 +598,11 @@ void SoundLibraryPanel::on_drumkitLoadAction()
 
 	QString sDrumkitName = __sound_library_tree->currentItem()->text(0);
 
-	Drumkit *drumkitInfo = NULL;
-
-	// find the drumkit in the list
-	for ( uint i = 0; i < __system_drumkit_info_list.size(); i++ ) {
-		Drumkit *pInfo = __system_drumkit_info_list[i];
-		if ( pInfo->get_name() == sDrumkitName ) {
-			drumkitInfo = pInfo;
-			break;
-		}
-	}
-	for ( uint i = 0; i < __user_drumkit_info_list.size(); i++ ) {
-		Drumkit *pInfo = __user_drumkit_info_list[i];
-		if ( pInfo->get_name() == sDrumkitName ) {
-			drumkitInfo = pInfo;
-			break;
-		}
+	Drumkit *drumkitInfo = get_drumkit( sDrumkitName );
+	if ( drumkitInfo == NULL ) {
+		QMessageBox::warning( this, "Hydrogen", trUtf8( "Unable to load the drumkit %1" ).arg( sDrumkitName ) );
+		return;
 	}
-	assert( drumkitInfo );
 
 	QApplication::setOverrideCursor(Qt::WaitCursor);
 
@@ -607,46 +706,15 @@ void SoundLibraryPanel::on_drumkitPropertiesAction()
 {
 	QString sDrumkitName = __sound_library_tree->currentItem()->text(0);
 
-	Drumkit *drumkitInfo = NULL;
-
-	// find the drumkit in the list
-	for ( uint i = 0; i < __system_drumkit_info_list.size(); i++ ) {
-		Drumkit *pInfo = __system_drumkit_info_list[i];
-		if ( pInfo->get_name() == sDrumkitName ) {
-			drumkitInfo = pInfo;
-			break;
-		}
-	}
-	for ( uint i = 0; i < __user_drumkit_info_list.size(); i++ ) {
-		Drumkit*pInfo = __user_drumkit_info_list[i];
-		if ( pInfo->get_name() == sDrumkitName ) {
-			drumkitInfo = pInfo;
-			break;
-		}
+	Drumkit *drumkitInfo = get_drumkit( sDrumkitName );
+	if ( drumkitInfo == NULL ) {
+		QMessageBox::warning( this, "Hydrogen", trUtf8( "Unable to load the drumkit %1" ).arg( sDrumkitName ) );
+		return;
 	}
 
-	assert( drumkitInfo );
-
 	QString sPreDrumkitName = Hydrogen::get_instance()->getCurrentDrumkitname();
 
-	Drumkit *preDrumkitInfo = NULL;
-	
-
-	// find the drumkit in the list
-	for ( uint i = 0; i < __system_drumkit_info_list.size(); i++ ) {
-		Drumkit *prInfo = __system_drumkit_info_list[i];
-		if ( prInfo->get_name() == sPreDrumkitName ) {
-			preDrumkitInfo = prInfo;
-			break;
-		}
-	}
-	for ( uint i = 0; i < __user_drumkit_info_list.size(); i++ ) {
-		Drumkit *prInfo = __user_drumkit_info_list[i];
-		if ( prInfo->get_name() == sPreDrumkitName ) {
-			preDrumkitInfo = prInfo;
-			break;
-		}
-	}
+	Drumkit *preDrumkitInfo = get_drumkit( sPreDrumkitName );
 
 	if ( preDrumkitInfo == NULL ){
 		QMessageBox::warning( this, "Hydrogen", QString( "The current loaded song missing his soundlibrary.\nPlease load a existing soundlibrary first") );
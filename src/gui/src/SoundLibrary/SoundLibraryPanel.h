@@ -29,6 +29,7 @@
 #include <vector>
 
 #include <hydrogen/object.h>
+#include <hydrogen/helpers/library_index.h>
 
 namespace H2Core
 {
@@ -68,6 +69,9 @@ private slots:
 	void on_patternLoadAction();
 	void on_patternDeleteAction();
 
+	void on_libraryChanged( const QString& path );
+	void on_libraryUpdate();
+
 private:
 	SoundLibraryTree *__sound_library_tree;
 	//FileBrowser *m_pFileBrowser;
@@ -85,12 +89,18 @@ private:
 	QTreeWidgetItem* __pattern_item;
 	QTreeWidgetItem* __pattern_item_list;
 
-	std::vector<H2Core::Drumkit*> __system_drumkit_info_list;
-	std::vector<H2Core::Drumkit*> __user_drumkit_info_list;
+	std::vector<H2Core::LibraryIndex::DrumkitInfo> __system_drumkits;	///< listed from the library index
+	std::vector<H2Core::LibraryIndex::DrumkitInfo> __user_drumkits;		///< listed from the library index
+	std::vector<H2Core::Drumkit*> __system_drumkit_info_list;		///< loaded when first needed
+	std::vector<H2Core::Drumkit*> __user_drumkit_info_list;			///< loaded when first needed
+	QFileSystemWatcher* __library_watcher;
+	bool __library_update_pending;
 	bool __expand_pattern_list;
 	bool __expand_songs_list;
 	void restore_background_color();
 	void change_background_color();
+	H2Core::Drumkit* get_drumkit( const QString& sDrumkitName );
+	void watch_library();
 
 };
 
@@ -0,0 +1,93 @@
+#include <unistd.h>
+#include <cstdlib>
+#include <cmath>
+
+#include <hydrogen/helpers/smoothed_value.h>
+#include <hydrogen/basics/automation_lane.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_list.h>
+
+using namespace H2Core;
+
+static void spec( bool cond, const char* msg )
+{
+    if( !cond ) {
+        ___ERRORLOG( QString( " ** SPEC : %1" ).arg( msg ) );
+        sleep( 1 );
+        exit( EXIT_FAILURE );
+    }
+}
+
+static bool near( float a, float b )
+{
+    return fabs( a - b ) < 1e-4;
+}
+
+int automation( int log_level )
+{
+    ___INFOLOG( "test the smoothed values and the automation lanes" );
+
+    float values[32];
+
+    SmoothedValue linear( 0.0 );
+    linear.update( 0, 8 );
+    spec( linear.is_settled(), "a value at its target should be settled" );
+    linear.set_target( 1.0 );
+    spec( linear.get_value()==0.0, "the value should not move before the next update" );
+    linear.update( 16, 8 );
+    spec( !linear.is_settled(), "a new target should start a ramp" );
+    linear.get_values( values, 0, 16 );
+    spec( values[0]==0.0 && near( values[4], 0.5 ), "the linear ramp should move by constant steps" );
+    spec( values[8]==1.0 && values[15]==1.0, "the linear ramp should reach the target after the smoothing length" );
+    linear.update( 16, 8 );
+    spec( linear.is_settled() && linear.get_value()==1.0, "the ramp should be done after the period" );
+
+    SmoothedValue exponential( 1.0, SmoothedValue::EXPONENTIAL );
+    exponential.set_target( 0.0 );
+    exponential.update( 0, 8 );
+    exponential.get_values( values, 0, 32 );
+    spec( values[4] < 0.5 && values[4] > 0.0, "the exponential ramp should move faster at first" );
+    spec( near( values[8], exp( -4.0 ) ), "98% of the distance should be done after the smoothing length" );
+    spec( values[16]==0.0, "the exponential ramp should stop after twice the smoothing length" );
+
+    SmoothedValue copy( exponential );
+    spec( copy.is_settled() && copy.get_value()==0.0, "a copy should start at the target" );
+
+    AutomationLane lane( 3, Instrument::VOLUME );
+    lane.add_point( 96, 0.0 );
+    lane.add_point( 0, 1.0 );
+    lane.add_point( 192, 0.5 );
+    lane.add_point( 96, 0.2 );
+    spec( lane.size()==3 && lane.get_point( 1 ).tick==96, "the points should be sorted and unique by tick" );
+    spec( lane.get_value( -10 )==1.0 && lane.get_value( 1000 )==0.5, "the lane should be constant beyond its points" );
+    spec( near( lane.get_value( 48 ), 0.6 ), "the lane should be interpolated between two points" );
+    spec( near( lane.evaluate( 48 ), 0.6 ) && near( lane.evaluate( 144 ), 0.35 ), "the evaluation should follow the song" );
+    spec( near( lane.evaluate( 24 ), 0.8 ), "the evaluation should follow the song jumping back" );
+
+    spec( AutomationLane::get_parameter_from_name( AutomationLane::get_parameter_name( Instrument::FILTER_CUTOFF ) )==Instrument::FILTER_CUTOFF, "the parameter names should be read back" );
+    spec( AutomationLane::get_parameter_from_name( "tempo" )==Instrument::PARAMETER_COUNT, "unknown names should be rejected" );
+
+    InstrumentList* pInstruments = new InstrumentList();
+    Instrument* pInstrument = new Instrument( 3, "automated" );
+    pInstruments->add( pInstrument );
+    lane.process( 0, pInstruments );
+    spec( pInstrument->get_volume()==1.0, "the lane should set the target of the parameter" );
+    pInstrument->set_volume( 0.7 );
+    lane.process( 0, pInstruments );
+    spec( pInstrument->get_volume()==0.7, "a flat lane should let the parameter be changed" );
+    lane.process( 48, pInstruments );
+    spec( near( pInstrument->get_volume(), 0.6 ), "a moving lane should set the target again" );
+
+    SmoothedValue* pVolume = pInstrument->get_parameter( Instrument::VOLUME );
+    pInstrument->update_parameters( 0, 64 );
+    spec( pVolume->is_settled() && pVolume->get_value()==pInstrument->get_volume(), "the first update should start at the target" );
+    pInstrument->set_volume( 0.2 );
+    pInstrument->update_parameters( 32, 64 );
+    spec( !pVolume->is_settled(), "a new target should be ramped to while playing" );
+    pInstrument->set_volume( 0.9 );
+    pInstrument->update_parameters( 96, 64 );
+    spec( pVolume->is_settled() && near( pVolume->get_value(), 0.9 ), "an instrument idle for the smoothing length should snap to its target" );
+    delete pInstruments;
+
+    return EXIT_SUCCESS;
+}
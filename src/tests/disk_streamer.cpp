@@ -0,0 +1,108 @@
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include <hydrogen/basics/sample.h>
+#include <hydrogen/basics/instrument_layer.h>
+#include <hydrogen/sampler/disk_streamer.h>
+
+#define BASE_DIR    "./src/tests/data/drumkit"
+#define BLOCK       1000
+
+static void spec( bool cond, const char* msg )
+{
+    if( !cond ) {
+        ___ERRORLOG( QString( " ** SPEC : %1" ).arg( msg ) );
+        sleep( 1 );
+        exit( EXIT_FAILURE );
+    }
+}
+
+int disk_streamer( int log_level )
+{
+    ___INFOLOG( "test the streaming of long samples against loading them in memory" );
+
+    // streamed first, the whole data would be shared through the cache otherwise
+    H2Core::Sample::set_stream_threshold( 1 );
+    H2Core::Sample* streamed = H2Core::Sample::load( BASE_DIR"/crash.wav" );
+    H2Core::Sample::set_stream_threshold( 0 );
+    H2Core::Sample* loaded = H2Core::Sample::load( BASE_DIR"/crash.wav" );
+    spec( loaded!=0 && streamed!=0, "load should succeed" );
+    spec( !loaded->is_streamed() && loaded->get_total_frames()==loaded->get_frames(), "a short sample should be held in memory" );
+    spec( streamed->is_streamed(), "a long sample should be streamed" );
+    spec( streamed->get_frames()==SAMPLE_STREAM_HEAD * streamed->get_sample_rate(), "only the head should be held in memory" );
+    spec( streamed->get_total_frames()==loaded->get_frames(), "the length of a streamed sample should be the file length" );
+
+    // the transformations need the whole data, such a sample is never streamed
+    H2Core::Sample::Loops loops;
+    loops.end_frame = loaded->get_frames() - 1;
+    loops.count = 1;
+    H2Core::Sample::set_stream_threshold( 1 );
+    H2Core::Sample* looped = H2Core::Sample::load( BASE_DIR"/crash.wav", loops, H2Core::Sample::Rubberband(),
+                                                   H2Core::Sample::VelocityEnvelope(), H2Core::Sample::PanEnvelope() );
+    H2Core::Sample::set_stream_threshold( 0 );
+    spec( looped!=0 && !looped->is_streamed(), "a looped sample should not be streamed" );
+    spec( looped->get_frames()>loaded->get_frames(), "the loop should be applied" );
+    delete looped;
+
+    H2Core::DiskStreamer* streamer = new H2Core::DiskStreamer();
+    int stream = streamer->open( streamed );
+    spec( stream!=-1 && streamer->get_active()==1, "a stream should be opened" );
+    // let the disk thread read ahead
+    usleep( 200000 );
+    for( int pos=0; pos<loaded->get_frames(); pos+=BLOCK ) {
+        const float* data_l;
+        const float* data_r;
+        int n = streamer->fetch( stream, pos, BLOCK, &data_l, &data_r );
+        spec( n==BLOCK, "the frames asked for should be given" );
+        int valid = std::min( BLOCK, loaded->get_frames() - pos );
+        spec( memcmp( data_l, loaded->get_data_l() + pos, valid * sizeof( float ) )==0
+              && memcmp( data_r, loaded->get_data_r() + pos, valid * sizeof( float ) )==0, "streamed data should be the file data" );
+        for( int i=valid; i<BLOCK; i++ ) spec( data_l[i]==0 && data_r[i]==0, "frames past the end should be silent" );
+    }
+    spec( streamer->get_underruns()==0, "nothing should be missed once read ahead" );
+
+    // overlapping fetches, as the resample path does
+    streamer->close( stream );
+    usleep( 50000 );
+    stream = streamer->open( streamed );
+    usleep( 200000 );
+    for( int pos=0; pos<loaded->get_frames()-BLOCK; pos+=BLOCK/2 ) {
+        const float* data_l;
+        const float* data_r;
+        streamer->fetch( stream, pos, BLOCK, &data_l, &data_r );
+        spec( memcmp( data_l, loaded->get_data_l() + pos, BLOCK * sizeof( float ) )==0, "overlapping fetches should give the file data" );
+    }
+    streamer->close( stream );
+
+    // the layer gets another sample while its note plays, as when stretched or converted
+    H2Core::Sample::set_stream_threshold( 1 );
+    H2Core::InstrumentLayer* layer = new H2Core::InstrumentLayer( H2Core::Sample::load( BASE_DIR"/crash.wav" ) );
+    stream = streamer->open( layer->get_sample() );
+    spec( streamer->is_open_on( stream, layer->get_sample() ), "a stream should be open on its sample" );
+    // deleted before the disk thread opens the file, the next one likely gets its address
+    delete layer->get_sample();
+    layer->set_sample( H2Core::Sample::load( BASE_DIR"/crash.wav" ) );
+    H2Core::Sample::set_stream_threshold( 0 );
+    spec( !streamer->is_open_on( stream, layer->get_sample() ), "a stream should not be open on the sample replacing its own" );
+    usleep( 200000 );
+    const float* data_l;
+    const float* data_r;
+    int head = layer->get_sample()->get_frames();
+    streamer->fetch( stream, head, BLOCK, &data_l, &data_r );
+    spec( memcmp( data_l, loaded->get_data_l() + head, BLOCK * sizeof( float ) )==0, "the disk thread should not need the deleted sample" );
+    streamer->close( stream );
+    stream = streamer->open( layer->get_sample() );
+    usleep( 200000 );
+    streamer->fetch( stream, 0, BLOCK, &data_l, &data_r );
+    spec( memcmp( data_l, loaded->get_data_l(), BLOCK * sizeof( float ) )==0, "a stream reopened on the new sample should give its data" );
+    streamer->close( stream );
+    delete layer;
+    spec( streamer->get_active()==0, "every stream should be closed" );
+
+    delete streamer;
+    delete streamed;
+    delete loaded;
+    return EXIT_SUCCESS;
+}
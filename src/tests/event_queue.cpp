@@ -0,0 +1,90 @@
+
+#include <unistd.h>
+#include <cstdlib>
+#include <pthread.h>
+
+#include <hydrogen/event_queue.h>
+
+#define PRODUCERS   4
+#define ITEMS       50000
+
+static void spec( bool cond, const char* msg )
+{
+    if( !cond ) {
+        ___ERRORLOG( QString( " ** SPEC : %1" ).arg( msg ) );
+        sleep( 1 );
+        exit( EXIT_FAILURE );
+    }
+}
+
+static void* produce( void* param )
+{
+    long producer = ( long )param;
+    for( int i=0; i<ITEMS; i++ ) {
+        while( !H2Core::EventQueue::get_instance()->push_event( H2Core::EVENT_PATTERN_CHANGED, producer * ITEMS + i ) ) usleep( 10 );
+    }
+    return 0;
+}
+
+int event_queue( int log_level )
+{
+    H2Core::EventQueue::create_instance();
+    H2Core::EventQueue* queue = H2Core::EventQueue::get_instance();
+    H2Core::Event ev;
+    while( queue->pop_event().type!=H2Core::EVENT_NONE ) ;
+
+    ___INFOLOG( "test the coalescing of the event queue" );
+    queue->push_event( H2Core::EVENT_NOTEON, 5 );
+    queue->push_event( H2Core::EVENT_NOTEON, 5 );
+    queue->push_event( H2Core::EVENT_NOTEON, 6 );
+    queue->push_event( H2Core::EVENT_NOTEON, 5 );
+    queue->push_event( H2Core::EVENT_PROGRESS, 10 );
+    queue->push_event( H2Core::EVENT_PROGRESS, 20 );
+    ev = queue->pop_event();
+    spec( ev.type==H2Core::EVENT_NOTEON && ev.value==5, "first note on should be popped" );
+    queue->push_event( H2Core::EVENT_NOTEON, 5 );
+    ev = queue->pop_event();
+    spec( ev.type==H2Core::EVENT_NOTEON && ev.value==6, "waiting note ons should absorb the same instrument" );
+    queue->push_event( H2Core::EVENT_PROGRESS, 30 );
+    ev = queue->pop_event();
+    spec( ev.type==H2Core::EVENT_PROGRESS && ev.value==30, "progress should have the latest value" );
+    ev = queue->pop_event();
+    spec( ev.type==H2Core::EVENT_NOTEON && ev.value==5, "a popped note on should be queued again" );
+    spec( queue->pop_event().type==H2Core::EVENT_NONE, "the queue should be empty" );
+
+    ___INFOLOG( "test the overflow of the event queue" );
+    int dropped = queue->get_dropped_events();
+    for( int i=0; i<MAX_EVENTS + 10; i++ ) queue->push_event( H2Core::EVENT_PATTERN_MODIFIED, i );
+    spec( queue->get_dropped_events()==dropped + 10, "events pushed to a full queue should be counted" );
+    for( int i=0; i<MAX_EVENTS; i++ ) {
+        ev = queue->pop_event();
+        spec( ev.type==H2Core::EVENT_PATTERN_MODIFIED && ev.value==i, "events should be popped in order" );
+    }
+    spec( queue->pop_event().type==H2Core::EVENT_NONE, "the queue should be empty" );
+
+    ___INFOLOG( "test the event queue with several producers" );
+    pthread_t producers[ PRODUCERS ];
+    for( long p=0; p<PRODUCERS; p++ ) pthread_create( &producers[p], 0, produce, ( void* )p );
+    int next[ PRODUCERS ] = { 0 };
+    for( int n=0; n<PRODUCERS * ITEMS; ) {
+        ev = queue->pop_event();
+        if( ev.type==H2Core::EVENT_NONE ) continue;
+        spec( ev.type==H2Core::EVENT_PATTERN_CHANGED, "only the pushed events should be popped" );
+        int p = ev.value / ITEMS;
+        spec( p>=0 && p<PRODUCERS && ev.value % ITEMS==next[p], "events of a producer should be popped in order" );
+        next[p]++;
+        n++;
+    }
+    for( int p=0; p<PRODUCERS; p++ ) pthread_join( producers[p], 0 );
+    spec( queue->pop_event().type==H2Core::EVENT_NONE, "the queue should be empty" );
+
+    ___INFOLOG( "test the recorded midi notes" );
+    H2Core::EventQueue::AddMidiNoteVector note;
+    note.m_column = 12;
+    spec( queue->push_midi_note( note ), "a midi note should be queued" );
+    note.m_column = 0;
+    spec( queue->pop_midi_note( note ) && note.m_column==12, "the midi note should be popped" );
+    spec( !queue->pop_midi_note( note ), "no midi note should be left" );
+
+    return EXIT_SUCCESS;
+}
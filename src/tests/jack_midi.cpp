@@ -0,0 +1,61 @@
+#include <unistd.h>
+#include <cstdlib>
+
+#include <hydrogen/config.h>
+#include <hydrogen/basics/note.h>
+
+#include "IO/JackMidiDriver.h"
+
+static void spec( bool cond, const char* msg )
+{
+    if( !cond ) {
+        ___ERRORLOG( QString( " ** SPEC : %1" ).arg( msg ) );
+        sleep( 1 );
+        exit( EXIT_FAILURE );
+    }
+}
+
+int jack_midi_input( int log_level )
+{
+#ifdef H2CORE_HAVE_JACK
+    ___INFOLOG( "test the frame of JACK MIDI input events" );
+
+    /* a synthetic JACK MIDI buffer of one 1024 frames period: two hits, a note off, a control change and a clock */
+    jack_midi_data_t data[][3] = { { 0x99, 36, 100 }, { 0x99, 38, 90 }, { 0x89, 36, 0 }, { 0xB0, 7, 64 }, { 0xF8, 0, 0 } };
+    jack_nframes_t times[] = { 0, 211, 733, 900, 1023 };
+    size_t sizes[] = { 3, 3, 3, 3, 1 };
+    H2Core::MidiMessage::MidiMessageType types[] = {
+        H2Core::MidiMessage::NOTE_ON, H2Core::MidiMessage::NOTE_ON, H2Core::MidiMessage::NOTE_OFF,
+        H2Core::MidiMessage::CONTROL_CHANGE, H2Core::MidiMessage::UNKNOWN
+    };
+    /* 120 bpm at 44100 Hz, 192 ticks per beat */
+    const float tick_size = 44100 * 60.0 / 120 / 192;
+    const long long cycle = 44100 * 10 + 17;
+
+    for( int i=0; i<5; i++ ) {
+        jack_midi_event_t event;
+        event.time = times[i];
+        event.size = sizes[i];
+        event.buffer = data[i];
+
+        H2Core::MidiMessage msg;
+        bool handled = H2Core::JackMidiDriver::decodeEvent( event, &msg );
+        spec( handled==( types[i]!=H2Core::MidiMessage::UNKNOWN ), "only known messages should be handled" );
+        spec( msg.m_type==types[i], "message type should be decoded" );
+        spec( msg.m_nFrameOffset==( int )times[i], "the frame of the event within the period should be kept" );
+        if( !handled || msg.m_type==H2Core::MidiMessage::CONTROL_CHANGE ) continue;
+        spec( msg.m_nData1==data[i][1] && msg.m_nData2==data[i][2] && msg.m_nChannel==( data[i][0] & 0xF ), "note data should be decoded" );
+
+        /* the note played from it, as the sampler computes its start */
+        H2Core::Note note( 0, 0, 1.0f, 0.5f, 0.5f, -1, 0 );
+        long long frame = cycle + msg.m_nFrameOffset;
+        note.set_start_frame( frame, tick_size );
+        spec( ( long long )( note.get_position() * tick_size ) + note.get_humanize_delay()==frame, "the note should start on the frame of the event" );
+        spec( note.get_humanize_delay()>=0 && note.get_humanize_delay()<tick_size, "the note should be placed on the tick of the event" );
+    }
+#else
+    ___INFOLOG( "JACK support not built, JACK MIDI input not tested" );
+#endif
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,50 @@
+#include <unistd.h>
+#include <cstdlib>
+
+#include <hydrogen/midi_action.h>
+#include <hydrogen/midi_map.h>
+
+static void spec( bool cond, const char* msg )
+{
+    if( !cond ) {
+        ___ERRORLOG( QString( " ** SPEC : %1" ).arg( msg ) );
+        sleep( 1 );
+        exit( EXIT_FAILURE );
+    }
+}
+
+int midi_map( int log_level )
+{
+    ___INFOLOG( "test the midi map lookups" );
+
+    MidiAction* pAction = new MidiAction( "STRIP_VOLUME_ABSOLUTE" );
+    pAction->setParameter1( "3" );
+    spec( pAction->getTypeId()==MidiAction::STRIP_VOLUME_ABSOLUTE, "the type should be resolved at creation" );
+    spec( pAction->getIntParameter1()==3 && pAction->getIntParameter2()==0, "the parameters should be parsed once" );
+    spec( MidiAction( "NOTHING" ).getTypeId()==MidiAction::NOTHING, "NOTHING should have no implementation" );
+    spec( MidiAction( "UNKNOWN_ACTION" ).getTypeId()==MidiAction::NOTHING, "unknown types should be NOTHING" );
+    spec( QString( MidiAction::getTypeName( MidiAction::PLAY_STOP_TOGGLE ) )=="PLAY/STOP_TOGGLE", "names should follow the types" );
+
+    MidiMap::create_instance();
+    MidiMap* mM = MidiMap::get_instance();
+    mM->registerCCEvent( 7, pAction );
+    mM->registerMMCEvent( "MMC_STOP", new MidiAction( "STOP" ) );
+
+    // the midi input thread looking up while the map changes
+    mM->beginLookup();
+    MidiAction* pLookup = mM->getCCAction( 7 );
+    spec( pLookup==pAction, "the registered cc action should be looked up" );
+    mM->registerCCEvent( 7, new MidiAction( "PAN_ABSOLUTE" ) );
+    spec( pLookup->getTypeId()==MidiAction::STRIP_VOLUME_ABSOLUTE, "the replaced action should live till the end of the lookup" );
+    spec( mM->getCCAction( 7 )->getTypeId()==MidiAction::PAN_ABSOLUTE, "the new action should be looked up at once" );
+    spec( mM->getMMCAction( "MMC_STOP" )->getTypeId()==MidiAction::STOP, "the mmc actions should be kept" );
+    spec( mM->getMMCAction( "MMC_PLAY" )==NULL, "unregistered mmc events should have no action" );
+    mM->endLookup();
+
+    MidiMap::reset_instance();
+    spec( mM->getCCAction( 7 )->getTypeId()==MidiAction::NOTHING, "reset should clear the cc actions" );
+    spec( mM->getMMCMap().empty(), "reset should clear the mmc actions" );
+    delete mM;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,109 @@
+
+#include <unistd.h>
+#include <cstdlib>
+#include <vector>
+
+#include <hydrogen/basics/note.h>
+#include <hydrogen/basics/note_queue.h>
+
+#define PERIODS     5000
+
+static void spec( bool cond, const char* msg )
+{
+    if( !cond ) {
+        ___ERRORLOG( QString( " ** SPEC : %1" ).arg( msg ) );
+        sleep( 1 );
+        exit( EXIT_FAILURE );
+    }
+}
+
+/* the start frame of a note is stored as its position */
+static long long start_frame( H2Core::Note* note )
+{
+    return note->get_position();
+}
+
+static void remove( std::vector<H2Core::Note*>& notes, H2Core::Note* note )
+{
+    for( unsigned i=0; i<notes.size(); i++ ) {
+        if( notes[i]==note ) {
+            notes.erase( notes.begin() + i );
+            return;
+        }
+    }
+    spec( false, "popped note should have been queued" );
+}
+
+int note_queue( int log_level )
+{
+    ___INFOLOG( "test the note queue against a plain list of notes" );
+
+    H2Core::NoteQueue queue;
+    std::vector<H2Core::Note*> queued;
+    long long pos = 100000;
+    for( int p=0; p<PERIODS; p++ ) {
+        // late notes, notes within the lookahead and notes beyond the wheel
+        int n = rand() % 8;
+        for( int i=0; i<n; i++ ) {
+            long long start;
+            int r = rand() % 10;
+            if( r==0 ) start = pos - rand() % 3000;
+            else if( r==1 ) start = pos + 70000 + rand() % 200000;
+            else start = pos + rand() % 40000;
+            H2Core::Note* note = new H2Core::Note( 0, start, 1.0f, 0.5f, 0.5f, -1, 0 );
+            queue.push( note, start );
+            queued.push_back( note );
+        }
+        // seek forward or back from time to time
+        if( rand() % 200==0 ) {
+            pos = ( rand() % 2 ? pos + rand() % 500000 : pos - rand() % 5000 );
+        }
+        // tempo change
+        if( rand() % 300==0 ) {
+            for( unsigned i=0; i<queued.size(); i++ ) queued[i]->set_position( queued[i]->get_position() + rand() % 100 - 50 );
+            queue.reschedule( start_frame );
+        }
+
+        long long end = pos + 1 + rand() % 1024;
+        long long last = -1;
+        H2Core::Note* note;
+        while( ( note = queue.pop( end ) ) ) {
+            spec( note->get_position() < end, "popped note should start before the end of the period" );
+            spec( note->get_position() >= last, "notes should be popped in start order" );
+            last = note->get_position();
+            remove( queued, note );
+            delete note;
+        }
+        for( unsigned i=0; i<queued.size(); i++ ) {
+            spec( queued[i]->get_position() >= end, "every note starting before the end of the period should be popped" );
+        }
+        spec( queue.size()==( int )queued.size(), "queue size should be the number of queued notes" );
+        pos = end;
+
+        // stop
+        if( rand() % 500==0 ) {
+            while( ( note = queue.pop_any() ) ) {
+                remove( queued, note );
+                delete note;
+            }
+            spec( queued.empty() && queue.empty(), "pop_any should empty the queue" );
+        }
+    }
+    while( H2Core::Note* note = queue.pop_any() ) delete note;
+
+    // within a bucket, notes pushed out of order
+    H2Core::NoteQueue bucket;
+    long long starts[] = { 40, 10, 30, 10, 5 };
+    H2Core::Note* notes[5];
+    for( int i=0; i<5; i++ ) {
+        notes[i] = new H2Core::Note( 0, starts[i], 1.0f, 0.5f, 0.5f, -1, 0 );
+        bucket.push( notes[i], starts[i] );
+    }
+    spec( bucket.pop( 20 )==notes[4], "the earliest note of a bucket should be popped first" );
+    spec( bucket.pop( 20 )==notes[1] && bucket.pop( 20 )==notes[3], "notes starting at the same frame should be popped in push order" );
+    spec( bucket.pop( 20 )==0, "notes starting after the end should wait" );
+    spec( bucket.pop( 64 )==notes[2] && bucket.pop( 64 )==notes[0] && bucket.empty(), "the bucket should be popped in start order" );
+    for( int i=0; i<5; i++ ) delete notes[i];
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,60 @@
+
+#include <unistd.h>
+#include <cstdlib>
+
+#include <hydrogen/helpers/reclaimer.h>
+
+static void spec( bool cond, const char* msg )
+{
+    if( !cond ) {
+        ___ERRORLOG( QString( " ** SPEC : %1" ).arg( msg ) );
+        sleep( 1 );
+        exit( EXIT_FAILURE );
+    }
+}
+
+static int destroyed = 0;
+
+static void destroy( void* object )
+{
+    destroyed++;
+    delete static_cast<int*>( object );
+}
+
+int reclaimer( int log_level )
+{
+    ___INFOLOG( "test the deferred deletion of the reclaimer" );
+
+    H2Core::Reclaimer reclaimer( false );
+    reclaimer.retire( new int( 1 ), destroy );
+    reclaimer.collect();
+    spec( destroyed==1, "objects should be destroyed at once out of a cycle" );
+
+    // retired during a cycle
+    reclaimer.enter();
+    reclaimer.retire( new int( 2 ), destroy );
+    reclaimer.collect();
+    spec( destroyed==1 && reclaimer.get_pending()==1, "objects retired during a cycle should wait for its end" );
+    reclaimer.leave();
+
+    // retired before a cycle
+    reclaimer.retire( new int( 3 ), destroy );
+    reclaimer.enter();
+    reclaimer.collect();
+    spec( destroyed==3 && reclaimer.get_pending()==0, "objects retired before the cycle should be destroyed" );
+
+    reclaimer.retire( new int( 4 ), destroy );
+    reclaimer.retire( new int( 5 ) );
+    reclaimer.leave();
+    spec( destroyed==3 && reclaimer.get_pending()==2, "leaving a cycle should not destroy anything" );
+    reclaimer.collect();
+    spec( reclaimer.get_pending()==0, "objects should be destroyed after the cycle" );
+
+    // nobody collects but the background thread
+    H2Core::Reclaimer periodic;
+    periodic.retire( new int( 6 ) );
+    sleep( 1 );
+    spec( periodic.get_pending()==0, "objects should be destroyed in the background" );
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,66 @@
+
+#include <unistd.h>
+#include <cstdlib>
+#include <pthread.h>
+
+#include <hydrogen/object.h>
+#include <hydrogen/helpers/ring_buffer.h>
+
+#define ITEMS       200000
+
+static void spec( bool cond, const char* msg )
+{
+    if( !cond ) {
+        ___ERRORLOG( QString( " ** SPEC : %1" ).arg( msg ) );
+        sleep( 1 );
+        exit( EXIT_FAILURE );
+    }
+}
+
+static void* produce( void* param )
+{
+    H2Core::RingBuffer<int>* ring = ( H2Core::RingBuffer<int>* )param;
+    for( int i=0; i<ITEMS; ) {
+        if( ring->push( i ) ) i++;
+    }
+    return 0;
+}
+
+int ring_buffer( int log_level )
+{
+    ___INFOLOG( "test the ring buffer within one thread" );
+    H2Core::RingBuffer<int> ring( 100 );
+    spec( ring.get_capacity()==128, "capacity should be rounded up to a power of 2" );
+    int item;
+    spec( ring.empty() && !ring.pop( item ), "a new ring should be empty" );
+    for( int i=0; i<128; i++ ) spec( ring.push( i ), "push should succeed until the ring is full" );
+    spec( !ring.push( 128 ), "push should fail when the ring is full" );
+    spec( ring.size()==128, "size should be the number of queued items" );
+    for( int i=0; i<100; i++ ) spec( ring.pop( item ) && item==i, "items should be popped in order" );
+    for( int i=128; i<228; i++ ) spec( ring.push( i ), "popped slots should be reused" );
+    for( int i=100; i<228; i++ ) spec( ring.pop( item ) && item==i, "items should be popped in order across the wrap" );
+    spec( ring.empty(), "the ring should be empty once every item is popped" );
+    ring.push( 0 );
+    ring.clear();
+    spec( ring.empty(), "clear should drop every item" );
+    int items[ 200 ];
+    for( int i=0; i<200; i++ ) items[i] = i;
+    spec( ring.write( items, 200 )==128, "write should queue what there is room for" );
+    spec( ring.read( 0, 28 )==28, "read should drop items when given no storage" );
+    spec( ring.read( items, 200 )==100 && items[0]==28 && items[99]==127, "read should dequeue the items in order" );
+
+    ___INFOLOG( "test the ring buffer between two threads" );
+    H2Core::RingBuffer<int> shared( 64 );
+    pthread_t producer;
+    pthread_create( &producer, 0, produce, &shared );
+    for( int i=0; i<ITEMS; ) {
+        if( shared.pop( item ) ) {
+            spec( item==i, "items should be received in order, none lost" );
+            i++;
+        }
+    }
+    pthread_join( producer, 0 );
+    spec( shared.empty(), "nothing should be left in the ring" );
+
+    return EXIT_SUCCESS;
+}
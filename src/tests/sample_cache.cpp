@@ -0,0 +1,106 @@
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+
+#include <hydrogen/basics/sample.h>
+#include <hydrogen/basics/sample_cache.h>
+
+#define BASE_DIR    "./src/tests/data/drumkit"
+
+static void spec( bool cond, const char* msg )
+{
+    if( !cond ) {
+        ___ERRORLOG( QString( " ** SPEC : %1" ).arg( msg ) );
+        sleep( 1 );
+        exit( EXIT_FAILURE );
+    }
+}
+
+int sample_cache( int log_level )
+{
+    ___INFOLOG( "test the sharing of decoded samples" );
+
+    H2Core::SampleCache::create_instance();
+    H2Core::SampleCache* cache = H2Core::SampleCache::get_instance();
+    cache->clear();
+    cache->set_budget( ( long long )64 << 20 );
+    int count = cache->get_count();
+
+    // same file, same data
+    H2Core::Sample* a = H2Core::Sample::load( BASE_DIR"/kick.wav" );
+    H2Core::Sample* b = H2Core::Sample::load( BASE_DIR"/kick.wav" );
+    spec( a!=0 && b!=0, "load should succeed" );
+    spec( a->get_data_l()==b->get_data_l(), "samples of the same file should share their data" );
+    spec( cache->get_count()==count+1, "the data should be stored once" );
+    H2Core::Sample* c = new H2Core::Sample( a );
+    spec( c->get_data_l()==a->get_data_l(), "a copy should share the data" );
+
+    // copy on write
+    float* shared = a->get_data_l();
+    float first = shared[0];
+    H2Core::Sample::VelocityEnvelope velocity;
+    velocity.push_back( H2Core::Sample::EnvelopePoint( 0, 91 ) );
+    velocity.push_back( H2Core::Sample::EnvelopePoint( 841, 91 ) );
+    c->apply_velocity( velocity );
+    spec( c->get_data_l()!=shared, "a modified sample should own its data" );
+    spec( a->get_data_l()==shared && shared[0]==first, "the shared data should be left untouched" );
+    delete c;
+
+    // unused data is kept within the budget
+    delete a;
+    delete b;
+    spec( cache->get_count()==count+1, "unused data should be kept" );
+    a = H2Core::Sample::load( BASE_DIR"/kick.wav" );
+    spec( a->get_data_l()==shared, "unused data should be reused" );
+    delete a;
+    cache->set_budget( 0 );
+    spec( cache->get_count()==count && cache->get_size()==0, "unused data should be evicted out of the budget" );
+    cache->set_budget( ( long long )64 << 20 );
+
+    // transformed data
+    H2Core::Sample::Loops loops;
+    loops.end_frame = 1000;
+    loops.count = 2;
+    H2Core::Sample::Rubberband rubber;
+    H2Core::Sample::PanEnvelope pan;
+    a = H2Core::Sample::load( BASE_DIR"/snare.wav", loops, rubber, velocity, pan );
+    b = H2Core::Sample::load( BASE_DIR"/snare.wav", loops, rubber, velocity, pan );
+    spec( a!=0 && b!=0, "load should succeed" );
+    spec( a->get_data_l()==b->get_data_l(), "identically transformed samples should share their data" );
+    spec( b->get_frames()==a->get_frames() && b->get_loops()==loops && b->get_is_modified(), "a cached transformed sample should be set up as the loaded one" );
+    c = H2Core::Sample::load( BASE_DIR"/snare.wav" );
+    spec( c->get_data_l()!=a->get_data_l() && c->get_frames()!=a->get_frames(), "plain and transformed data should be stored apart" );
+    delete a;
+    delete b;
+    delete c;
+
+    // compact storage, lossless for 16 bit files
+    a = H2Core::Sample::load( BASE_DIR"/snare.wav" );
+    H2Core::Sample::set_storage_format( H2Core::Sample::INT16 );
+    b = H2Core::Sample::load( BASE_DIR"/snare.wav" );
+    H2Core::Sample::set_storage_format( H2Core::Sample::INT24 );
+    c = H2Core::Sample::load( BASE_DIR"/kick.wav" );
+    H2Core::Sample::set_storage_format( H2Core::Sample::FLOAT );
+    H2Core::Sample* d = H2Core::Sample::load( BASE_DIR"/kick.wav" );
+    spec( b->get_format()==H2Core::Sample::INT16 && b->get_data_l()==0 && b->get_size()==b->get_frames() * 2 * 2, "a compact sample should hold 16 bit values" );
+    spec( c->get_format()==H2Core::Sample::INT24 && c->is_mono() && c->get_size()==c->get_frames() * 3, "a compact mono sample should hold a single channel of 24 bit values" );
+    spec( d->is_mono() && d->get_data_r()==d->get_data_l(), "the channels of a mono sample should share their data" );
+    float* data_l = new float[ b->get_frames() ];
+    float* data_r = new float[ b->get_frames() ];
+    b->read( 0, b->get_frames(), data_l, data_r );
+    spec( memcmp( data_l, a->get_data_l(), a->get_frames() * sizeof( float ) )==0
+          && memcmp( data_r, a->get_data_r(), a->get_frames() * sizeof( float ) )==0, "16 bit values should read back as the decoded ones" );
+    c->read( 100, 1000, data_l, data_r );
+    spec( memcmp( data_l, d->get_data_l() + 100, 1000 * sizeof( float ) )==0
+          && memcmp( data_r, d->get_data_l() + 100, 1000 * sizeof( float ) )==0, "24 bit values should read back as the decoded ones" );
+    spec( c->get_value_r( 1234 )==d->get_data_r()[ 1234 ], "a single value should read back as the decoded one" );
+    delete[] data_l;
+    delete[] data_r;
+    delete a;
+    delete b;
+    delete c;
+    delete d;
+
+    cache->set_budget( 0 );
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,76 @@
+
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <hydrogen/basics/sample.h>
+#include <hydrogen/basics/sample_loader.h>
+
+#define BASE_DIR    "./src/tests/data/drumkit"
+#define ROUNDS      8
+
+static void spec( bool cond, const char* msg )
+{
+    if( !cond ) {
+        ___ERRORLOG( QString( " ** SPEC : %1" ).arg( msg ) );
+        sleep( 1 );
+        exit( EXIT_FAILURE );
+    }
+}
+
+static bool same_data( H2Core::Sample* a, H2Core::Sample* b )
+{
+    if( a->get_frames()!=b->get_frames() || a->get_sample_rate()!=b->get_sample_rate() ) return false;
+    return memcmp( a->get_data_l(), b->get_data_l(), a->get_frames() * sizeof( float ) )==0
+           && memcmp( a->get_data_r(), b->get_data_r(), a->get_frames() * sizeof( float ) )==0;
+}
+
+int sample_loader( int log_level )
+{
+    ___INFOLOG( "test the concurrent loading of samples against serial loading" );
+
+    const char* files[] = { "crash.wav", "hh.wav", "kick.wav", "snare.wav" };
+    std::vector<H2Core::Sample*> serial;
+    for( int i=0; i<4; i++ ) {
+        serial.push_back( H2Core::Sample::load( QString( BASE_DIR"/%1" ).arg( files[i] ) ) );
+        spec( serial[i]!=0, "serial load should succeed" );
+    }
+
+    H2Core::SampleLoader* loader = new H2Core::SampleLoader( 3 );
+    std::vector<int> jobs;
+    for( int r=0; r<ROUNDS; r++ ) {
+        for( int i=0; i<4; i++ ) jobs.push_back( loader->add( QString( BASE_DIR"/%1" ).arg( files[i] ) ) );
+    }
+    int missing = loader->add( QString( BASE_DIR"/missing.wav" ) );
+    H2Core::Sample* existing = new H2Core::Sample( QString( BASE_DIR"/kick.wav" ) );
+    int reload = loader->add( existing );
+
+    // take them out of order, while the others are still decoded
+    for( int j=jobs.size()-1; j>=0; j-=2 ) {
+        H2Core::Sample* sample = loader->take( jobs[j] );
+        spec( sample!=0, "queued sample should be loaded" );
+        spec( same_data( sample, serial[ j % 4 ] ), "concurrent load should decode the same data" );
+        delete sample;
+    }
+    spec( loader->take( missing )==0, "unreadable file should give a null sample" );
+    spec( loader->take( reload )==existing, "existing sample should be given back" );
+    spec( same_data( existing, serial[2] ), "existing sample should be loaded" );
+    loader->wait();
+    spec( loader->get_done()==loader->get_count(), "every job should be done" );
+    // the samples not taken are deleted with the loader
+    delete loader;
+
+    // the shared loader starts over once every job is taken
+    H2Core::SampleLoader::create_instance();
+    H2Core::SampleLoader* shared = H2Core::SampleLoader::get_instance();
+    int first = shared->add( QString( BASE_DIR"/kick.wav" ) );
+    delete shared->take( first );
+    spec( shared->add( QString( BASE_DIR"/snare.wav" ) )==first, "job numbers should be reused" );
+    spec( shared->get_count()==1, "taken jobs should be forgotten" );
+    delete shared->take( first );
+
+    delete existing;
+    for( int i=0; i<4; i++ ) delete serial[i];
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,73 @@
+#include <unistd.h>
+#include <cstdlib>
+#include <cmath>
+
+#include <hydrogen/basics/sample.h>
+#include <hydrogen/basics/sample_cache.h>
+
+#define BASE_DIR    "./src/tests/data/drumkit"
+
+static void spec( bool cond, const char* msg )
+{
+    if( !cond ) {
+        ___ERRORLOG( QString( " ** SPEC : %1" ).arg( msg ) );
+        sleep( 1 );
+        exit( EXIT_FAILURE );
+    }
+}
+
+/* a mono sample holding a sine tone */
+static H2Core::Sample* sine( double frequency, int sample_rate, int frames )
+{
+    float* data = new float[ frames ];
+    for( int i=0; i<frames; i++ ) data[i] = 0.5 * sin( 2 * M_PI * frequency * i / sample_rate );
+    return new H2Core::Sample( BASE_DIR"/sine.wav", frames, sample_rate, data, data );
+}
+
+int sample_resample( int log_level )
+{
+    ___INFOLOG( "test the conversion of samples to another sample rate" );
+
+    // a tone within the band is kept as is
+    H2Core::Sample* a = sine( 1000, 44100, 4410 );
+    H2Core::Sample* b = a->resample( 48000 );
+    spec( b!=0, "resample should succeed" );
+    spec( b->get_sample_rate()==48000 && b->get_frames()==4800, "the length should follow the sample rate" );
+    spec( b->is_mono(), "a mono sample should stay mono" );
+    float error = 0;
+    for( int i=64; i<4800-64; i++ ) {
+        error = std::max( error, ( float )fabs( b->get_value_l( i ) - 0.5 * sin( 2 * M_PI * 1000 * i / 48000.0 ) ) );
+    }
+    spec( error<1e-3, "a tone within the band should be preserved" );
+    delete a;
+    delete b;
+
+    // a tone above the new Nyquist frequency is filtered out
+    a = sine( 30000, 96000, 9600 );
+    b = a->resample( 44100 );
+    float peak = 0;
+    for( int i=64; i<b->get_frames()-64; i++ ) peak = std::max( peak, ( float )fabs( b->get_value_l( i ) ) );
+    spec( peak<1e-3, "a tone out of the band should be filtered out" );
+    delete a;
+    delete b;
+
+    // nothing to convert
+    a = new H2Core::Sample( BASE_DIR"/sine.wav" );
+    spec( a->resample( 48000 )==0, "an empty sample should not be converted" );
+    delete a;
+
+    // converted once for every sample sharing the data
+    H2Core::SampleCache::create_instance();
+    H2Core::SampleCache::get_instance()->set_budget( ( long long )64 << 20 );
+    a = H2Core::Sample::load( BASE_DIR"/snare.wav" );
+    spec( a!=0, "load should succeed" );
+    b = a->resample( 48000 );
+    H2Core::Sample* c = a->resample( 48000 );
+    spec( b->get_data_l()==c->get_data_l(), "the converted data should be shared" );
+    spec( !b->is_mono() && b->get_frames()==( int )ceil( a->get_frames() * 48000.0 / a->get_sample_rate() ), "a stereo sample should be converted" );
+    delete a;
+    delete b;
+    delete c;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,110 @@
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+
+#include <hydrogen/basics/sample.h>
+#include <hydrogen/basics/sample_cache.h>
+#include <hydrogen/basics/sample_store.h>
+#include <hydrogen/helpers/filesystem.h>
+
+#define BASE_DIR    "./src/tests/data/drumkit"
+
+static void spec( bool cond, const char* msg )
+{
+    if( !cond ) {
+        ___ERRORLOG( QString( " ** SPEC : %1" ).arg( msg ) );
+        sleep( 1 );
+        exit( EXIT_FAILURE );
+    }
+}
+
+static bool aligned( const float* data )
+{
+    return ( ( size_t )data & 31 )==0;
+}
+
+int sample_store( int log_level )
+{
+    ___INFOLOG( "test the on disk store of decoded samples" );
+
+    QString dir = H2Core::Filesystem::tmp_dir()+"/samples";
+    QString wav = H2Core::Filesystem::tmp_dir()+"/store.wav";
+    QString kick = H2Core::Filesystem::drumkit_path_search( "GMkit" )+"/kick_Dry_b.flac";
+    QString snare = H2Core::Filesystem::drumkit_path_search( "GMkit" )+"/sn_Jazz_c.flac";
+    QString hh = H2Core::Filesystem::drumkit_path_search( "GMkit" )+"/hhc_Dry_a.flac";
+    H2Core::Filesystem::path_usable( H2Core::Filesystem::tmp_dir() );
+    H2Core::Filesystem::rm( dir, true );
+    H2Core::Filesystem::file_copy( BASE_DIR"/kick.wav", wav );
+    H2Core::SampleStore::create_instance( dir );
+    H2Core::SampleStore* store = H2Core::SampleStore::get_instance();
+    H2Core::SampleCache::create_instance();
+    H2Core::SampleCache* cache = H2Core::SampleCache::get_instance();
+
+    // a file outside of the drumkits is not stored
+    H2Core::SampleStore::Mapping mapping;
+    H2Core::Sample* decoded = H2Core::Sample::load( wav );
+    spec( decoded!=0, "load should succeed" );
+    spec( !H2Core::Filesystem::file_exists( store->get_path( wav ), true ), "one-off data should not be stored" );
+    delete decoded;
+    cache->clear();
+
+    // mono drumkit sample, stored as a single channel
+    spec( !store->map( kick, &mapping ), "nothing should be stored yet" );
+    decoded = H2Core::Sample::load( kick );
+    spec( decoded!=0, "load should succeed" );
+    spec( store->map( kick, &mapping ), "stored data should be mapped" );
+    spec( mapping.frames==decoded->get_frames() && mapping.sample_rate==decoded->get_sample_rate(), "mapped data should be the decoded one" );
+    spec( mapping.data_r==mapping.data_l, "mono data should be stored once" );
+    spec( memcmp( mapping.data_l, decoded->get_data_l(), mapping.frames * sizeof( float ) )==0, "mapped data should be the decoded one" );
+    spec( aligned( mapping.data_l ), "mapped channels should be aligned" );
+    H2Core::SampleStore::unmap( mapping );
+    delete decoded;
+    cache->clear();
+
+    // stereo drumkit sample
+    decoded = H2Core::Sample::load( snare );
+    spec( store->map( snare, &mapping ), "stored data should be mapped" );
+    spec( mapping.data_r!=mapping.data_l, "stereo data should be stored twice" );
+    spec( memcmp( mapping.data_l, decoded->get_data_l(), mapping.frames * sizeof( float ) )==0
+          && memcmp( mapping.data_r, decoded->get_data_r(), mapping.frames * sizeof( float ) )==0, "mapped data should be the decoded one" );
+    spec( aligned( mapping.data_l ) && aligned( mapping.data_r ), "mapped channels should be aligned" );
+    H2Core::SampleStore::unmap( mapping );
+    delete decoded;
+    cache->clear();
+
+    // next load maps the store file
+    H2Core::Sample* mapped = H2Core::Sample::load( snare );
+    spec( mapped!=0 && aligned( mapped->get_data_l() ), "load should map the stored data" );
+    delete mapped;
+    cache->clear();
+
+    // another file under the same path
+    H2Core::Sample* crash = H2Core::Sample::load( BASE_DIR"/crash.wav" );
+    spec( store->write( wav, crash->get_data_l(), crash->get_data_r(), crash->get_frames(), crash->get_sample_rate() ), "write should succeed" );
+    spec( store->map( wav, &mapping ), "stored data should be mapped" );
+    H2Core::SampleStore::unmap( mapping );
+    sleep( 1 );
+    H2Core::Filesystem::rm( wav );
+    H2Core::Filesystem::file_copy( BASE_DIR"/snare.wav", wav );
+    spec( !store->map( wav, &mapping ), "stale data should not be mapped" );
+    delete crash;
+    cache->clear();
+
+    // the least recently mapped files are removed first
+    spec( store->map( kick, &mapping ), "stored data should be mapped" );
+    store->set_budget( 2 * mapping.length );
+    H2Core::SampleStore::unmap( mapping );
+    decoded = H2Core::Sample::load( hh );
+    spec( store->map( hh, &mapping ), "data just written should be kept" );
+    H2Core::SampleStore::unmap( mapping );
+    spec( H2Core::Filesystem::file_exists( store->get_path( kick ), true ), "recently mapped data should be kept" );
+    spec( !H2Core::Filesystem::file_exists( store->get_path( snare ), true )
+          && !H2Core::Filesystem::file_exists( store->get_path( wav ), true ), "data exceeding the budget should be removed" );
+    delete decoded;
+    cache->clear();
+
+    delete store;
+    H2Core::Filesystem::rm( dir, true );
+    H2Core::Filesystem::rm( wav );
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,196 @@
+
+#include <unistd.h>
+#include <cstdlib>
+#include <cstring>
+
+#include <hydrogen/audio_engine.h>
+#include <hydrogen/hydrogen.h>
+#include <hydrogen/Preferences.h>
+#include <hydrogen/basics/adsr.h>
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_layer.h>
+#include <hydrogen/basics/instrument_list.h>
+#include <hydrogen/basics/note.h>
+#include <hydrogen/basics/note_pool.h>
+#include <hydrogen/basics/sample.h>
+#include <hydrogen/basics/song.h>
+#include <hydrogen/sampler/Sampler.h>
+#include <hydrogen/sampler/sampler_kernels.h>
+
+#define FRAMES      1500
+#define RENDERED    3000
+#define BASE_DIR    "./src/tests/data/drumkit"
+
+static void spec( bool cond, const char* msg )
+{
+    if( !cond ) {
+        ___ERRORLOG( QString( " ** SPEC : %1" ).arg( msg ) );
+        sleep( 1 );
+        exit( EXIT_FAILURE );
+    }
+}
+
+static void fill_random( float* buf, int n )
+{
+    for( int i=0; i<n; i++ ) buf[i] = ( ( float )rand() / RAND_MAX ) * 2.0f - 1.0f;
+}
+
+/*
+ * play a note of instr through the sampler, period frames at a time
+ */
+static void render_note( H2Core::Sampler* sampler, H2Core::Song* song, H2Core::Instrument* instr, int period, float* out_L, float* out_R )
+{
+    H2Core::Note* note = H2Core::AudioEngine::get_instance()->get_note_pool()->get( instr, 0, 1.0f, 0.5f, 0.5f, -1, 0 );
+    sampler->note_on( note );
+    for( int pos=0; pos<RENDERED; pos+=period ) {
+        int n = ( RENDERED - pos > period ? period : RENDERED - pos );
+        sampler->process( n, song );
+        memcpy( out_L + pos, sampler->__main_out_L, n * sizeof( float ) );
+        memcpy( out_R + pos, sampler->__main_out_R, n * sizeof( float ) );
+    }
+    sampler->stop_playing_notes();
+}
+
+template<class Interpolation>
+static void check_resample( const char* name )
+{
+    float data_l[ FRAMES ], data_r[ FRAMES ];
+    float ref_l[ FRAMES ], ref_r[ FRAMES ];
+    float blk_l[ FRAMES ], blk_r[ FRAMES ];
+    fill_random( data_l, FRAMES );
+    fill_random( data_r, FRAMES );
+
+    // pitched down, up, and a sample rate conversion, starting at the head, in the middle and near the end
+    float steps[] = { 0.5f, 0.9438743f, 1.0f, 1.0884862f, 2.9f };
+    double starts[] = { 0.0, 0.3, 17.25, FRAMES - 300.5, FRAMES - 2.0 };
+    for( unsigned s=0; s<sizeof( steps )/sizeof( float ); s++ ) {
+        for( unsigned p=0; p<sizeof( starts )/sizeof( double ); p++ ) {
+            int n = ( int )( ( FRAMES - starts[p] ) / steps[s] );
+            if( n > SAMPLER_BLOCK_SIZE ) n = SAMPLER_BLOCK_SIZE;
+            double ref_pos = starts[p];
+            double blk_pos = starts[p];
+            H2Core::SamplerKernels::resample_ref<Interpolation>( ref_l, ref_r, data_l, data_r, FRAMES, ref_pos, steps[s], n );
+            H2Core::SamplerKernels::resample<Interpolation>( blk_l, blk_r, data_l, data_r, FRAMES, blk_pos, steps[s], n );
+            if( memcmp( ref_l, blk_l, n*sizeof( float ) )!=0 || memcmp( ref_r, blk_r, n*sizeof( float ) )!=0 ) {
+                ___ERRORLOG( QString( "%1 resampling differs from the reference, step %2 start %3" ).arg( name ).arg( steps[s] ).arg( starts[p] ) );
+                spec( false, "resampled block should be bit exact" );
+            }
+            spec( ref_pos==blk_pos, "resample position should be the same" );
+        }
+    }
+}
+
+int sampler_kernels( int log_level )
+{
+    ___INFOLOG( QString( "test sampler block kernels against the scalar reference (%1)" ).arg( H2Core::SamplerKernels::simd_name() ) );
+
+    float ref_track[ FRAMES ], ref_main[ FRAMES ];
+    float blk_track[ FRAMES ], blk_main[ FRAMES ];
+
+    // vectorized kernels against their scalar reference
+    float a[ FRAMES ], b[ FRAMES ];
+    fill_random( ref_main, FRAMES );
+    memcpy( blk_main, ref_main, sizeof( ref_main ) );
+    fill_random( a, FRAMES );
+    fill_random( b, FRAMES );
+    H2Core::SamplerKernels::mul_ref( ref_track, a + 1, b + 2, FRAMES - 2 );
+    H2Core::SamplerKernels::mul( blk_track, a + 1, b + 2, FRAMES - 2 );
+    spec( memcmp( ref_track, blk_track, ( FRAMES - 2 )*sizeof( float ) )==0, "mul should be bit exact" );
+    H2Core::SamplerKernels::mac_ref( ref_main + 3, a, 0.25f, FRAMES - 3 );
+    H2Core::SamplerKernels::mac( blk_main + 3, a, 0.25f, FRAMES - 3 );
+    spec( memcmp( ref_main, blk_main, sizeof( ref_main ) )==0, "mac should be bit exact" );
+    float ref_peak = H2Core::SamplerKernels::mac_peak_ref( ref_main, b, 2.0f, -1.0f, FRAMES - 1 );
+    float blk_peak = H2Core::SamplerKernels::mac_peak( blk_main, b, 2.0f, -1.0f, FRAMES - 1 );
+    spec( memcmp( ref_main, blk_main, sizeof( ref_main ) )==0, "mac_peak should be bit exact" );
+    spec( ref_peak==blk_peak, "mac_peak peak should be the same" );
+
+    // integer to float conversions of the compact sample storage
+    short s16[ FRAMES ];
+    unsigned char s24[ FRAMES * 3 ];
+    for( int i=0; i<FRAMES; i++ ) s16[i] = ( short )( rand() % 65536 - 32768 );
+    for( int i=0; i<FRAMES * 3; i++ ) s24[i] = ( unsigned char )rand();
+    for( int o=0; o<4; o++ ) {
+        H2Core::SamplerKernels::s16_to_float_ref( ref_track, s16 + o, FRAMES - 4 );
+        H2Core::SamplerKernels::s16_to_float( blk_track, s16 + o, FRAMES - 4 );
+        spec( memcmp( ref_track, blk_track, ( FRAMES - 4 )*sizeof( float ) )==0, "s16_to_float should be bit exact" );
+        H2Core::SamplerKernels::s24_to_float_ref( ref_track, s24 + o * 3, FRAMES - 4 );
+        H2Core::SamplerKernels::s24_to_float( blk_track, s24 + o * 3, FRAMES - 4 );
+        spec( memcmp( ref_track, blk_track, ( FRAMES - 4 )*sizeof( float ) )==0, "s24_to_float should be bit exact" );
+    }
+    short s16_bounds[] = { -32768, 16384 };
+    H2Core::SamplerKernels::s16_to_float( a, s16_bounds, 2 );
+    spec( a[0]==-1.0f && a[1]==0.5f, "16 bit values should be scaled to [-1,1)" );
+    unsigned char s24_bounds[] = { 0x00, 0x00, 0x80, 0x00, 0x00, 0x40 };
+    H2Core::SamplerKernels::s24_to_float( a, s24_bounds, 2 );
+    spec( a[0]==-1.0f && a[1]==0.5f, "24 bit values should be scaled to [-1,1)" );
+
+    // resampling fast path against the bounds checked one
+    check_resample<H2Core::SamplerKernels::Linear>( "linear" );
+    check_resample<H2Core::SamplerKernels::Cosine>( "cosine" );
+    check_resample<H2Core::SamplerKernels::Third>( "third" );
+    check_resample<H2Core::SamplerKernels::Cubic>( "cubic" );
+    check_resample<H2Core::SamplerKernels::Hermite>( "hermite" );
+
+    return EXIT_SUCCESS;
+}
+
+int sampler_render( int log_level )
+{
+    ___INFOLOG( "test the notes rendered by the sampler, in blocks, against a frame by frame rendering" );
+
+    // the sampler is driven by hand, no driver thread nor midi output
+    H2Core::Preferences::create_instance();
+    H2Core::Preferences* pref = H2Core::Preferences::get_instance();
+    pref->m_sAudioDriver = "Fake";
+    pref->m_sMidiDriver = "None";
+    pref->m_nRenderThreads = 0;
+    pref->m_bUseSampleStore = false;
+    pref->m_nStreamThreshold = 0;
+    pref->m_nSampleBits = 32;
+    pref->m_nJackTrackOutputMode = 0;
+    H2Core::Hydrogen::create_instance();
+    H2Core::Sampler* sampler = H2Core::AudioEngine::get_instance()->get_sampler();
+
+    // every gain is 1, the output is the sample data times the envelope
+    H2Core::Song* song = new H2Core::Song( "sampler", "test", 120, 1.0 );
+    song->set_instrument_list( new H2Core::InstrumentList() );
+    H2Core::Sample* sample = H2Core::Sample::load( BASE_DIR"/snare.wav" );
+    spec( sample!=0 && sample->get_frames()>RENDERED && !sample->is_mono(), "a long enough stereo sample should be loaded" );
+    spec( sample->get_sample_rate()==H2Core::Hydrogen::get_instance()->getAudioOutput()->getSampleRate(), "the sample should not be resampled" );
+    H2Core::Instrument* instr = new H2Core::Instrument( 0, "snare", new H2Core::ADSR( 0, 0, 1.0, 1000 ) );
+    instr->set_layer( new H2Core::InstrumentLayer( sample ), 0 );
+    song->get_instrument_list()->add( instr );
+
+    float frame_L[ RENDERED ], frame_R[ RENDERED ];
+    float block_L[ RENDERED ], block_R[ RENDERED ];
+    float odd_L[ RENDERED ], odd_R[ RENDERED ];
+
+    // one frame per period is rendered by the scalar tails only
+    render_note( sampler, song, instr, 1, frame_L, frame_R );
+    render_note( sampler, song, instr, 1024, block_L, block_R );
+    render_note( sampler, song, instr, 77, odd_L, odd_R );
+    spec( memcmp( frame_L, sample->get_data_l(), sizeof( frame_L ) )==0
+          && memcmp( frame_R, sample->get_data_r(), sizeof( frame_R ) )==0, "the sample data should be rendered as is" );
+    spec( memcmp( frame_L, block_L, sizeof( frame_L ) )==0 && memcmp( frame_R, block_R, sizeof( frame_R ) )==0, "block rendering should be bit exact" );
+    spec( memcmp( frame_L, odd_L, sizeof( frame_L ) )==0 && memcmp( frame_R, odd_R, sizeof( frame_R ) )==0, "odd periods should be bit exact" );
+
+    // low pass resonant filter
+    instr->set_filter_active( true );
+    instr->get_parameter( H2Core::Instrument::FILTER_CUTOFF )->reset( 0.3f );
+    instr->get_parameter( H2Core::Instrument::FILTER_RESONANCE )->reset( 0.6f );
+    render_note( sampler, song, instr, 1, frame_L, frame_R );
+    render_note( sampler, song, instr, 1024, block_L, block_R );
+    spec( memcmp( frame_L, block_L, sizeof( frame_L ) )==0 && memcmp( frame_R, block_R, sizeof( frame_R ) )==0, "filtered block rendering should be bit exact" );
+    H2Core::Note* filter = H2Core::AudioEngine::get_instance()->get_note_pool()->get( instr, 0, 1.0f, 0.5f, 0.5f, -1, 0 );
+    for( int i=0; i<RENDERED; i++ ) {
+        float val_L = sample->get_data_l()[i];
+        float val_R = sample->get_data_r()[i];
+        filter->compute_lr_values( &val_L, &val_R, 0.3f, 0.6f );
+        spec( frame_L[i]==val_L && frame_R[i]==val_R, "the sample data should be filtered" );
+    }
+    H2Core::AudioEngine::get_instance()->get_note_pool()->release( filter );
+
+    delete song;
+    delete H2Core::Hydrogen::get_instance();
+    return EXIT_SUCCESS;
+}
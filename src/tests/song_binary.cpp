@@ -0,0 +1,107 @@
+#include <unistd.h>
+#include <cstdlib>
+
+#include <hydrogen/basics/instrument.h>
+#include <hydrogen/basics/instrument_list.h>
+#include <hydrogen/basics/note.h>
+#include <hydrogen/basics/pattern.h>
+#include <hydrogen/basics/pattern_list.h>
+#include <hydrogen/basics/song_binary.h>
+#include <hydrogen/helpers/filesystem.h>
+
+#include <QtXml/QDomDocument>
+
+static void spec( bool cond, const char* msg )
+{
+    if( !cond ) {
+        ___ERRORLOG( QString( " ** SPEC : %1" ).arg( msg ) );
+        sleep( 1 );
+        exit( EXIT_FAILURE );
+    }
+}
+
+int song_binary( int log_level )
+{
+    ___INFOLOG( "test the compiled copy of songs" );
+
+    QString song_path = H2Core::Filesystem::tmp_dir()+"/compiled.h2song";
+    QString xml = "<song><name>compiled</name><patternList><pattern><name>p1</name></pattern></patternList><patternSequence/></song>";
+    H2Core::Filesystem::path_usable( H2Core::Filesystem::tmp_dir() );
+    H2Core::Filesystem::write_to_file( song_path, xml );
+    QDomDocument doc;
+    doc.setContent( xml );
+
+    H2Core::InstrumentList* instruments = new H2Core::InstrumentList();
+    H2Core::Instrument* kick = new H2Core::Instrument( 0, "kick" );
+    H2Core::Instrument* snare = new H2Core::Instrument( 3, "snare" );
+    instruments->add( kick );
+    instruments->add( snare );
+
+    H2Core::PatternList* patterns = new H2Core::PatternList();
+    H2Core::Pattern* p1 = new H2Core::Pattern( "p1", "verse", 96 );
+    for ( int i = 0; i < 16; i++ ) {
+        p1->insert_note( new H2Core::Note( ( i & 1 ) ? snare : kick, i * 12, 0.5f + i * 0.01f, 0.25f, 0.75f, i, -1.5f ) );
+    }
+    H2Core::Note* odd = new H2Core::Note( snare, 48, 0.9f, 0.5f, 0.5f, -1, 2.0f );
+    odd->set_key_octave( H2Core::Note::Fs, H2Core::Note::P8B );
+    odd->set_lead_lag( -0.3f );
+    odd->set_note_off( true );
+    p1->insert_note( odd );
+    patterns->add( p1 );
+    patterns->add( new H2Core::Pattern( "p2 \xc3\xa9", "", 192 ) );
+
+    spec( H2Core::SongBinary::load( song_path )==0, "nothing should be compiled yet" );
+    spec( H2Core::SongBinary::save( song_path, doc, patterns ), "save should succeed" );
+
+    H2Core::SongBinary* binary = H2Core::SongBinary::load( song_path );
+    spec( binary!=0, "compiled copy should be loaded" );
+    spec( binary->get_pattern_count()==2, "compiled copy should hold the patterns" );
+    QDomElement song = binary->get_document().documentElement();
+    spec( song.firstChildElement( "name" ).text()=="compiled", "document should be kept" );
+    spec( song.firstChildElement( "patternList" ).firstChildElement( "pattern" ).isNull(), "document should not hold the patterns" );
+
+    H2Core::Pattern* c1 = binary->get_pattern( 0, instruments );
+    H2Core::Pattern* c2 = binary->get_pattern( 1, instruments );
+    spec( c1->get_name()=="p1" && c1->get_category()=="verse" && c1->get_length()==96, "pattern should be restored" );
+    spec( c2->get_name()==QString::fromUtf8( "p2 \xc3\xa9" ) && c2->get_length()==192, "pattern should be restored" );
+    spec( c1->has_pending_notes(), "notes should not be created before access" );
+    spec( c1->get_notes()->size()==p1->get_notes()->size(), "notes should be created on access" );
+    spec( !c1->has_pending_notes(), "notes should be created once" );
+    spec( c2->get_notes()->empty(), "empty pattern should stay empty" );
+
+    H2Core::Pattern::notes_cst_it_t a = p1->get_notes()->begin();
+    H2Core::Pattern::notes_cst_it_t b = c1->get_notes()->begin();
+    for ( ; a!=p1->get_notes()->end(); ++a, ++b ) {
+        H2Core::Note* n = a->second;
+        H2Core::Note* m = b->second;
+        spec( a->first==b->first && n->get_instrument()==m->get_instrument(), "notes should be restored in order" );
+        spec( n->get_velocity()==m->get_velocity() && n->get_pan_l()==m->get_pan_l() && n->get_pan_r()==m->get_pan_r()
+              && n->get_length()==m->get_length() && n->get_pitch()==m->get_pitch() && n->get_lead_lag()==m->get_lead_lag()
+              && n->get_key()==m->get_key() && n->get_octave()==m->get_octave() && n->get_note_off()==m->get_note_off(),
+              "notes should be restored as they were" );
+    }
+
+    // the audio thread reads the notes created off it, by the background pass
+    H2Core::Pattern* c3 = binary->get_pattern( 0, instruments );
+    H2Core::Pattern* c4 = binary->get_pattern( 0, instruments );
+    spec( c3->get_created_notes()->empty() && c3->has_pending_notes(), "reading the created notes should not create them" );
+    delete c4;
+    H2Core::Pattern::create_pending_notes();
+    spec( !c3->has_pending_notes(), "the pending notes should be created by the pass" );
+    spec( c3->get_created_notes()->size()==p1->get_notes()->size(), "the created notes should be read once created" );
+
+    delete c1;
+    delete c2;
+    delete c3;
+    delete binary;
+
+    // the song changed behind the compiled copy
+    H2Core::Filesystem::write_to_file( song_path, xml+" " );
+    spec( H2Core::SongBinary::load( song_path )==0, "stale compiled copy should be ignored" );
+
+    delete patterns;
+    delete instruments;
+    H2Core::Filesystem::rm( song_path );
+    H2Core::Filesystem::rm( H2Core::SongBinary::get_path( song_path ) );
+    return EXIT_SUCCESS;
+}
@@ -6,6 +6,23 @@
 void rubberband_test( const QString& sample_path );
 int xml_drumkit( int log_level );
 int xml_pattern( int log_level );
+int xml_reader( int log_level );
+int xml_validation( int log_level );
+int sampler_kernels( int log_level );
+int sampler_render( int log_level );
+int note_queue( int log_level );
+int ring_buffer( int log_level );
+int reclaimer( int log_level );
+int event_queue( int log_level );
+int sample_loader( int log_level );
+int sample_cache( int log_level );
+int sample_store( int log_level );
+int disk_streamer( int log_level );
+int sample_resample( int log_level );
+int song_binary( int log_level );
+int jack_midi_input( int log_level );
+int midi_map( int log_level );
+int automation( int log_level );
 
 int main( int argc, char* argv[] )
 {
@@ -22,6 +39,23 @@ int main( int argc, char* argv[] )
     rubberband_test( H2Core::Filesystem::drumkit_path_search( "GMkit" )+"/cym_Jazz.flac" );
     xml_drumkit( log_level );
     xml_pattern( log_level );
+    xml_reader( log_level );
+    xml_validation( log_level );
+    sampler_kernels( log_level );
+    note_queue( log_level );
+    ring_buffer( log_level );
+    reclaimer( log_level );
+    event_queue( log_level );
+    sample_loader( log_level );
+    sample_cache( log_level );
+    sample_store( log_level );
+    disk_streamer( log_level );
+    sample_resample( log_level );
+    song_binary( log_level );
+    jack_midi_input( log_level );
+    midi_map( log_level );
+    automation( log_level );
+    sampler_render( log_level );
 
     delete logger;
 
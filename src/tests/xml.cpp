@@ -8,6 +8,7 @@
 #include <hydrogen/basics/instrument_list.h>
 #include <hydrogen/basics/instrument_layer.h>
 #include <hydrogen/basics/sample.h>
+#include <hydrogen/helpers/xml.h>
 
 #define BASE_DIR    "./src/tests/data"
 
@@ -101,6 +102,69 @@ int xml_drumkit( int log_level )
     return EXIT_SUCCESS;
 }
 
+int xml_reader( int log_level )
+{
+    ___INFOLOG( "test xml streaming reader" );
+
+    QDomDocument doc;
+    H2Core::XMLReader reader;
+    QByteArray data( "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                     "<!-- comment -->\n"
+                     "<root xmlns=\"http://www.hydrogen-music.org/drumkit\">\n"
+                     "  <name>a &amp; b</name>\n"
+                     "  <list count=\"2\"><item>1</item><item><![CDATA[<2>]]></item></list>\n"
+                     "  <empty/>\n"
+                     "</root>\n" );
+    spec( reader.read( data, &doc ), "document should be read" );
+    H2Core::XMLNode root = doc.firstChildElement( "root" );
+    spec( !root.isNull(), "root should be read" );
+    spec( root.toElement().attribute( "xmlns" )=="http://www.hydrogen-music.org/drumkit", "xmlns should be kept as an attribute" );
+    spec( root.read_string( "name", "" )=="a & b", "entities should be resolved" );
+    spec( root.read_string( "name", "" )=="a & b", "a node read twice should be found again" );
+    QDomElement list = root.firstChildElement( "list" );
+    spec( list.attribute( "count" )=="2", "attributes should be read" );
+    spec( list.firstChildElement( "item" ).nextSiblingElement( "item" ).text()=="<2>", "cdata should be read" );
+    spec( root.read_string( "empty", "default" )=="default", "empty node should have no text" );
+    spec( root.read_string( "name", "" )=="a & b", "a node before the last one read should be found" );
+    spec( !root.firstChild().isText(), "blank text should be dropped" );
+
+    QDomDocument repeated;
+    spec( reader.read( QByteArray( "<root><a>1</a><b>2</b><a>3</a></root>" ), &repeated ), "document should be read" );
+    H2Core::XMLNode node = repeated.firstChildElement( "root" );
+    spec( node.read_string( "a", "" )=="1", "the first node should be read" );
+    spec( node.read_string( "b", "" )=="2", "the next node should be read" );
+    spec( node.read_string( "a", "" )=="1", "the first node should be read again, not the next one" );
+    spec( node.read_string( "c", "none" )=="none", "a missing node should not be found" );
+
+    QDomDocument broken;
+    spec( !reader.read( QByteArray( "<root><name></root>" ), &broken ), "malformed document should fail" );
+
+    return EXIT_SUCCESS;
+}
+
+int xml_validation( int log_level )
+{
+    QString dk_path = H2Core::Filesystem::tmp_dir()+"/dk1";
+
+    ___INFOLOG( "test the record of validated xml files" );
+
+    H2Core::Drumkit* dk0 = H2Core::Drumkit::load( BASE_DIR"/drumkit" );
+    spec( dk0!=0, "dk0 should not be null" );
+    spec( H2Core::XMLDoc::is_validated( BASE_DIR"/drumkit/drumkit.xml", H2Core::Filesystem::drumkit_xsd() ), "validation should be recorded" );
+    spec( dk0->save( dk_path, false ), "should be able to save drumkit" );
+    H2Core::Drumkit* dk1 = H2Core::Drumkit::load_file( dk_path+"/drumkit.xml" );
+    spec( dk1!=0, "should be able to reload drumkit" );
+    sleep( 1 );
+    dk1->set_name( "COPY" );
+    spec( dk1->save_file( dk_path+"/drumkit.xml", true ), "should be able to save drumkit xml file" );
+    spec( !H2Core::XMLDoc::is_validated( dk_path+"/drumkit.xml", H2Core::Filesystem::drumkit_xsd() ), "modified file should be validated again" );
+
+    delete dk0;
+    delete dk1;
+
+    return EXIT_SUCCESS;
+}
+
 int xml_pattern( int log_level )
 {
     QString pat_path = H2Core::Filesystem::tmp_dir()+"/pat";